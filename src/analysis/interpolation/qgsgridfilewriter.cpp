@@ -21,6 +21,53 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QProgressDialog>
+#include <QtConcurrentMap>
+
+//! Number of rows which are interpolated at once before they are written
+static const int ROW_BATCH_SIZE = 64;
+
+/** Values of a row of the grid*/
+struct GridRow
+{
+  //! y coordinate of the center of the cells
+  double y;
+  QVector<double> values;
+  //! whether the interpolation succeeded for each cell
+  QVector<bool> valid;
+};
+
+/** Interpolates the cells of a row, runs concurrently for several rows if the
+ interpolator is thread safe*/
+class RowInterpolator
+{
+  public:
+    typedef void result_type;
+
+    RowInterpolator( QgsInterpolator* interpolator, double xMin, double cellSizeX, int columns )
+        : mInterpolator( interpolator )
+        , mXMin( xMin )
+        , mCellSizeX( cellSizeX )
+        , mColumns( columns )
+    {}
+
+    void operator()( GridRow& row )
+    {
+      row.values.resize( mColumns );
+      row.valid.resize( mColumns );
+      double currentXValue = mXMin + mCellSizeX / 2.0; //calculate value in the center of the cell
+      for ( int j = 0; j < mColumns; ++j )
+      {
+        row.valid[j] = mInterpolator->interpolatePoint( currentXValue, row.y, row.values[j] ) == 0;
+        currentXValue += mCellSizeX;
+      }
+    }
+
+  private:
+    QgsInterpolator* mInterpolator;
+    double mXMin;
+    double mCellSizeX;
+    int mColumns;
+};
 
 QgsGridFileWriter::QgsGridFileWriter( QgsInterpolator* i, const QString& outputPath, const QgsRectangle& extent, int nCols, int nRows, double cellSizeX, double cellSizeY )
     : mInterpolator( i )
@@ -64,8 +111,6 @@ int QgsGridFileWriter::writeFile( bool showProgressDialog )
   writeHeader( outStream );
 
   double currentYValue = mInterpolationExtent.yMaximum() - mCellSizeY / 2.0; //calculate value in the center of the cell
-  double currentXValue;
-  double interpolatedValue;
 
   QProgressDialog* progressDialog = nullptr;
   if ( showProgressDialog )
@@ -74,23 +119,48 @@ int QgsGridFileWriter::writeFile( bool showProgressDialog )
     progressDialog->setWindowModality( Qt::WindowModal );
   }
 
-  for ( int i = 0; i < mNumRows; ++i )
+  // rows are interpolated in parallel by batches and written in order
+  bool concurrent = mInterpolator->prepareConcurrentInterpolation();
+  RowInterpolator rowInterpolator( mInterpolator, mInterpolationExtent.xMinimum(), mCellSizeX, mNumColumns );
+  QList<GridRow> rows;
+
+  for ( int i = 0; i < mNumRows; i += ROW_BATCH_SIZE )
   {
-    currentXValue = mInterpolationExtent.xMinimum() + mCellSizeX / 2.0; //calculate value in the center of the cell
-    for ( int j = 0; j < mNumColumns; ++j )
+    int batchRows = qMin( ROW_BATCH_SIZE, mNumRows - i );
+    rows.clear();
+    for ( int k = 0; k < batchRows; ++k )
     {
-      if ( mInterpolator->interpolatePoint( currentXValue, currentYValue, interpolatedValue ) == 0 )
-      {
-        outStream << interpolatedValue << ' ';
-      }
-      else
+      GridRow row;
+      row.y = currentYValue;
+      rows << row;
+      currentYValue -= mCellSizeY;
+    }
+
+    if ( concurrent && batchRows > 1 )
+    {
+      QtConcurrent::blockingMap( rows, rowInterpolator );
+    }
+    else
+    {
+      for ( int k = 0; k < batchRows; ++k )
+        rowInterpolator( rows[k] );
+    }
+
+    Q_FOREACH ( const GridRow& row, rows )
+    {
+      for ( int j = 0; j < mNumColumns; ++j )
       {
-        outStream << "-9999 ";
+        if ( row.valid.at( j ) )
+        {
+          outStream << row.values.at( j ) << ' ';
+        }
+        else
+        {
+          outStream << "-9999 ";
+        }
       }
-      currentXValue += mCellSizeX;
+      outStream << endl;
     }
-    outStream << endl;
-    currentYValue -= mCellSizeY;
 
     if ( showProgressDialog )
     {
@@ -99,7 +169,7 @@ int QgsGridFileWriter::writeFile( bool showProgressDialog )
         outputFile.remove();
         return 3;
       }
-      progressDialog->setValue( i );
+      progressDialog->setValue( i + batchRows - 1 );
     }
   }
 
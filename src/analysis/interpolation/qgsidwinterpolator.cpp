@@ -16,15 +16,52 @@
  ***************************************************************************/
 
 #include "qgsidwinterpolator.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
-QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData>& layerData ): QgsInterpolator( layerData ), mDistanceCoefficient( 2.0 )
+//! Highest distance coefficient which is computed by multiplications instead of pow()
+static const int MAX_INTEGER_COEFFICIENT = 16;
+
+static bool compareX( const vertexData& v1, const vertexData& v2 )
 {
+  return v1.x < v2.x;
+}
 
+static bool compareY( const vertexData& v1, const vertexData& v2 )
+{
+  return v1.y < v2.y;
 }
 
-QgsIDWInterpolator::QgsIDWInterpolator(): QgsInterpolator( QList<LayerData>() ), mDistanceCoefficient( 2.0 )
+/** Returns 1 / distance^p, integerCoefficient is p if it is a small integer, 0 otherwise*/
+static inline double inverseDistanceWeight( double distance2, double coefficient, int integerCoefficient )
+{
+  if ( integerCoefficient > 0 )
+  {
+    double power = integerCoefficient % 2 ? sqrt( distance2 ) : 1.0;
+    for ( int i = 0; i < integerCoefficient / 2; ++i )
+      power *= distance2;
+    return 1 / power;
+  }
+  return 1 / pow( distance2, coefficient / 2 );
+}
+
+QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData>& layerData )
+    : QgsInterpolator( layerData )
+    , mDistanceCoefficient( 2.0 )
+    , mMaxPoints( 0 )
+    , mSearchRadius( 0 )
+    , mIndexBuilt( false )
+{
+
+}
+
+QgsIDWInterpolator::QgsIDWInterpolator()
+    : QgsInterpolator( QList<LayerData>() )
+    , mDistanceCoefficient( 2.0 )
+    , mMaxPoints( 0 )
+    , mSearchRadius( 0 )
+    , mIndexBuilt( false )
 {
 
 }
@@ -34,6 +71,77 @@ QgsIDWInterpolator::~QgsIDWInterpolator()
 
 }
 
+bool QgsIDWInterpolator::prepareConcurrentInterpolation()
+{
+  if ( !mDataIsCached )
+  {
+    cacheBaseData();
+  }
+
+  if ( !mIndexBuilt )
+  {
+    buildIndex( 0, mCachedBaseData.size(), 0 );
+    mIndexBuilt = true;
+  }
+
+  return true;
+}
+
+void QgsIDWInterpolator::buildIndex( int begin, int end, int depth )
+{
+  // the median of the range splits it alternately along x and y
+  if ( end - begin < 2 )
+    return;
+
+  int middle = begin + ( end - begin ) / 2;
+  vertexData* data = mCachedBaseData.data();
+  std::nth_element( data + begin, data + middle, data + end, depth % 2 == 0 ? compareX : compareY );
+
+  buildIndex( begin, middle, depth + 1 );
+  buildIndex( middle + 1, end, depth + 1 );
+}
+
+void QgsIDWInterpolator::searchIndex( double x, double y, int begin, int end, int depth, double& maxDistance2, int maxPoints, QVector< QPair<double, int> >& neighbours ) const
+{
+  if ( begin >= end )
+    return;
+
+  int middle = begin + ( end - begin ) / 2;
+  const vertexData& vertex = mCachedBaseData.at( middle );
+  double distance2 = ( vertex.x - x ) * ( vertex.x - x ) + ( vertex.y - y ) * ( vertex.y - y );
+  if ( distance2 <= maxDistance2 )
+  {
+    neighbours.append( qMakePair( distance2, middle ) );
+    if ( maxPoints > 0 )
+    {
+      // keep the nearest points only, the search limit becomes the farthest of them
+      std::push_heap( neighbours.begin(), neighbours.end() );
+      if ( neighbours.size() > maxPoints )
+      {
+        std::pop_heap( neighbours.begin(), neighbours.end() );
+        neighbours.pop_back();
+      }
+      if ( neighbours.size() == maxPoints )
+        maxDistance2 = neighbours.first().first;
+    }
+  }
+
+  // search the side of the point first, the other side if it is within the limit
+  double diff = depth % 2 == 0 ? x - vertex.x : y - vertex.y;
+  if ( diff < 0 )
+  {
+    searchIndex( x, y, begin, middle, depth + 1, maxDistance2, maxPoints, neighbours );
+    if ( diff * diff <= maxDistance2 )
+      searchIndex( x, y, middle + 1, end, depth + 1, maxDistance2, maxPoints, neighbours );
+  }
+  else
+  {
+    searchIndex( x, y, middle + 1, end, depth + 1, maxDistance2, maxPoints, neighbours );
+    if ( diff * diff <= maxDistance2 )
+      searchIndex( x, y, begin, middle, depth + 1, maxDistance2, maxPoints, neighbours );
+  }
+}
+
 int QgsIDWInterpolator::interpolatePoint( double x, double y, double& result )
 {
   if ( !mDataIsCached )
@@ -41,23 +149,59 @@ int QgsIDWInterpolator::interpolatePoint( double x, double y, double& result )
     cacheBaseData();
   }
 
+  int integerCoefficient = 0;
+  if ( mDistanceCoefficient > 0 && mDistanceCoefficient <= MAX_INTEGER_COEFFICIENT && mDistanceCoefficient == floor( mDistanceCoefficient ) )
+    integerCoefficient = static_cast< int >( mDistanceCoefficient );
+
+  double distance2;
   double currentWeight;
-  double distance;
 
   double sumCounter = 0;
   double sumDenominator = 0;
 
-  Q_FOREACH ( const vertexData& vertex_it, mCachedBaseData )
+  if ( mMaxPoints <= 0 && mSearchRadius <= 0 )
+  {
+    QVector<vertexData>::const_iterator vertex_it = mCachedBaseData.constBegin();
+    for ( ; vertex_it != mCachedBaseData.constEnd(); ++vertex_it )
+    {
+      distance2 = ( vertex_it->x - x ) * ( vertex_it->x - x ) + ( vertex_it->y - y ) * ( vertex_it->y - y );
+      if ( distance2 <= 0 )
+      {
+        result = vertex_it->z;
+        return 0;
+      }
+      currentWeight = inverseDistanceWeight( distance2, mDistanceCoefficient, integerCoefficient );
+      sumCounter += ( currentWeight * vertex_it->z );
+      sumDenominator += currentWeight;
+    }
+  }
+  else
   {
-    distance = sqrt(( vertex_it.x - x ) * ( vertex_it.x - x ) + ( vertex_it.y - y ) * ( vertex_it.y - y ) );
-    if (( distance - 0 ) < std::numeric_limits<double>::min() )
+    if ( !mIndexBuilt )
+    {
+      buildIndex( 0, mCachedBaseData.size(), 0 );
+      mIndexBuilt = true;
+    }
+
+    double maxDistance2 = mSearchRadius > 0 ? mSearchRadius * mSearchRadius : std::numeric_limits<double>::max();
+    QVector< QPair<double, int> > neighbours;
+    if ( mMaxPoints > 0 )
+      neighbours.reserve( mMaxPoints + 1 );
+    searchIndex( x, y, 0, mCachedBaseData.size(), 0, maxDistance2, mMaxPoints, neighbours );
+
+    for ( int i = 0; i < neighbours.size(); ++i )
     {
-      result = vertex_it.z;
-      return 0;
+      const vertexData& vertex = mCachedBaseData.at( neighbours.at( i ).second );
+      distance2 = neighbours.at( i ).first;
+      if ( distance2 <= 0 )
+      {
+        result = vertex.z;
+        return 0;
+      }
+      currentWeight = inverseDistanceWeight( distance2, mDistanceCoefficient, integerCoefficient );
+      sumCounter += ( currentWeight * vertex.z );
+      sumDenominator += currentWeight;
     }
-    currentWeight = 1 / ( pow( distance, mDistanceCoefficient ) );
-    sumCounter += ( currentWeight * vertex_it.z );
-    sumDenominator += currentWeight;
   }
 
   if ( sumDenominator == 0.0 )
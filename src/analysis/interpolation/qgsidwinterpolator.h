@@ -20,6 +20,8 @@
 
 #include "qgsinterpolator.h"
 
+#include <QPair>
+
 class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
 {
   public:
@@ -33,16 +35,61 @@ class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
        @return 0 in case of success*/
     int interpolatePoint( double x, double y, double& result ) override;
 
+    bool prepareConcurrentInterpolation() override;
+
     void setDistanceCoefficient( double p ) {mDistanceCoefficient = p;}
 
+    /** Returns the distance coefficient
+     * @note added in QGIS 2.16
+     */
+    double distanceCoefficient() const { return mDistanceCoefficient; }
+
+    /** Sets the number of nearest points which are used for the interpolation of a
+     * point, 0 to use all points (the default).
+     * @note added in QGIS 2.16
+     */
+    void setMaxPoints( int count ) { mMaxPoints = count; }
+
+    /** Returns the number of nearest points which are used for the interpolation of a
+     * point, 0 if all points are used.
+     * @note added in QGIS 2.16
+     */
+    int maxPoints() const { return mMaxPoints; }
+
+    /** Sets the maximum distance of the points which are used for the interpolation of
+     * a point, 0 for no limit (the default). Points without data within the radius get
+     * no value.
+     * @note added in QGIS 2.16
+     */
+    void setSearchRadius( double radius ) { mSearchRadius = radius; }
+
+    /** Returns the maximum distance of the points which are used for the interpolation
+     * of a point, 0 if there is no limit.
+     * @note added in QGIS 2.16
+     */
+    double searchRadius() const { return mSearchRadius; }
+
   private:
 
     QgsIDWInterpolator(); //forbidden
 
+    /** Sorts the cached base data into a k-d tree*/
+    void buildIndex( int begin, int end, int depth );
+
+    /** Collects the points of the subtree [begin, end) which are closer to x, y than
+     the current limit into neighbours (a max-heap on the squared distance)*/
+    void searchIndex( double x, double y, int begin, int end, int depth, double& maxDistance2, int maxPoints, QVector< QPair<double, int> >& neighbours ) const;
+
     /** The parameter that sets how the values are weighted with distance.
        Smaller values mean sharper peaks at the data points. The default is a
        value of 2*/
     double mDistanceCoefficient;
+
+    int mMaxPoints;
+    double mSearchRadius;
+
+    /** Flag that tells if mCachedBaseData has been sorted into a k-d tree*/
+    bool mIndexBuilt;
 };
 
 #endif
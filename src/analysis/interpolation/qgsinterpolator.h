@@ -64,6 +64,14 @@ class ANALYSIS_EXPORT QgsInterpolator
        @return 0 in case of success*/
     virtual int interpolatePoint( double x, double y, double& result ) = 0;
 
+    /** Caches the base data and builds the structures used by interpolatePoint(), so that
+     * interpolatePoint() can then be called from several threads at once.
+     * @return true if interpolatePoint() is thread safe after the call. The default
+     * implementation returns false.
+     * @note added in QGIS 2.16
+     */
+    virtual bool prepareConcurrentInterpolation() { return false; }
+
     //! @note not available in Python bindings
     const QList<LayerData>& layerData() const { return mLayerData; }
 
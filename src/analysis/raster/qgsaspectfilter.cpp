@@ -17,6 +17,8 @@
 
 #include "qgsaspectfilter.h"
 
+#include <QVector>
+
 QgsAspectFilter::QgsAspectFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -35,7 +37,25 @@ float QgsAspectFilter::processNineCellWindow(
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return aspect( derX, derY );
+}
 
+void QgsAspectFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width )
+{
+  QVector<float> derX( width );
+  QVector<float> derY( width );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), width );
+
+  const float* x = derX.constData();
+  const float* y = derY.constData();
+  for ( int j = 0; j < width; ++j )
+  {
+    resultRow[j] = aspect( x[j], y[j] );
+  }
+}
+
+float QgsAspectFilter::aspect( float derX, float derY ) const
+{
   if ( derX == mOutputNodataValue ||
        derY == mOutputNodataValue ||
        ( derX == 0.0 && derY == 0.0 ) )
@@ -33,6 +33,12 @@ class ANALYSIS_EXPORT QgsAspectFilter: public QgsDerivativeFilter
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 ) override;
 
+  protected:
+    void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width ) override;
+
+  private:
+    /** Calculates the aspect from the first order derivatives*/
+    float aspect( float derX, float derY ) const;
 };
 
 #endif // QGSASPECTFILTER_H
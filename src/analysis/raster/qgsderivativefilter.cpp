@@ -28,6 +28,53 @@ QgsDerivativeFilter::~QgsDerivativeFilter()
 
 }
 
+void QgsDerivativeFilter::calcFirstDerRow( float* rowAbove, float* row, float* rowBelow, float* derX, float* derY, int width )
+{
+  //windows on the border always contain nodata values
+  bool noNodata = width > 2;
+  for ( int j = 0; j < width && noNodata; ++j )
+  {
+    if ( rowAbove[j] == mInputNodataValue || row[j] == mInputNodataValue || rowBelow[j] == mInputNodataValue )
+    {
+      noNodata = false;
+    }
+  }
+
+  if ( !noNodata )
+  {
+    for ( int j = 0; j < width; ++j )
+    {
+      derX[j] = calcFirstDerX( &rowAbove[j-1], &rowAbove[j], &rowAbove[j+1], &row[j-1], &row[j], &row[j+1], &rowBelow[j-1], &rowBelow[j], &rowBelow[j+1] );
+      derY[j] = calcFirstDerY( &rowAbove[j-1], &rowAbove[j], &rowAbove[j+1], &row[j-1], &row[j], &row[j+1], &rowBelow[j-1], &rowBelow[j], &rowBelow[j+1] );
+    }
+    return;
+  }
+
+  //same operations in the same order as calcFirstDerX / calcFirstDerY without nodata values
+  double divisorX = 8 * mCellSizeX * mZFactor;
+  double divisorY = 8 * mCellSizeY * mZFactor;
+  for ( int j = 1; j < width - 1; ++j )
+  {
+    double sumX = rowAbove[j+1] - rowAbove[j-1];
+    sumX += 2 * ( row[j+1] - row[j-1] );
+    sumX += rowBelow[j+1] - rowBelow[j-1];
+    derX[j] = sumX / divisorX;
+
+    double sumY = rowAbove[j-1] - rowBelow[j-1];
+    sumY += 2 * ( rowAbove[j] - rowBelow[j] );
+    sumY += rowAbove[j+1] - rowBelow[j+1];
+    derY[j] = sumY / divisorY;
+  }
+
+  int borders[2] = { 0, width - 1 };
+  for ( int b = 0; b < 2; ++b )
+  {
+    int j = borders[b];
+    derX[j] = calcFirstDerX( &rowAbove[j-1], &rowAbove[j], &rowAbove[j+1], &row[j-1], &row[j], &row[j+1], &rowBelow[j-1], &rowBelow[j], &rowBelow[j+1] );
+    derY[j] = calcFirstDerY( &rowAbove[j-1], &rowAbove[j], &rowAbove[j+1], &row[j-1], &row[j], &row[j+1], &rowBelow[j-1], &rowBelow[j], &rowBelow[j+1] );
+  }
+}
+
 float QgsDerivativeFilter::calcFirstDerX( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
 {
   //the basic formula would be simple, but we need to test for nodata values...
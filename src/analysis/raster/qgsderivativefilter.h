@@ -36,6 +36,13 @@ class ANALYSIS_EXPORT QgsDerivativeFilter : public QgsNineCellFilter
     float calcFirstDerX( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 );
     /** Calculates the first order derivative in y-direction according to Horn (1981)*/
     float calcFirstDerY( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 );
+    /** Calculates the first order derivatives in x- and y-direction of a row of cells, see processNineCellRow() for the layout
+      of the rows. Windows without nodata values are computed without branches so that the loop can be vectorised, the
+      result is the same as calcFirstDerX() and calcFirstDerY().
+      @note added in QGIS 2.16
+      @note not available in Python bindings
+     */
+    void calcFirstDerRow( float* rowAbove, float* row, float* rowBelow, float* derX, float* derY, int width );
 };
 
 #endif // QGSDERIVATIVEFILTER_H
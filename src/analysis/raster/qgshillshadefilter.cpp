@@ -17,6 +17,8 @@
 
 #include "qgshillshadefilter.h"
 
+#include <QVector>
+
 QgsHillshadeFilter::QgsHillshadeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat, double lightAzimuth,
                                         double lightAngle )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -35,7 +37,25 @@ float QgsHillshadeFilter::processNineCellWindow( float* x11, float* x21, float*
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return hillshade( derX, derY );
+}
 
+void QgsHillshadeFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width )
+{
+  QVector<float> derX( width );
+  QVector<float> derY( width );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), width );
+
+  const float* x = derX.constData();
+  const float* y = derY.constData();
+  for ( int j = 0; j < width; ++j )
+  {
+    resultRow[j] = hillshade( x[j], y[j] );
+  }
+}
+
+float QgsHillshadeFilter::hillshade( float derX, float derY ) const
+{
   if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
   {
     return mOutputNodataValue;
@@ -38,7 +38,13 @@ class ANALYSIS_EXPORT QgsHillshadeFilter: public QgsDerivativeFilter
     float lightAngle() const { return mLightAngle; }
     void setLightAngle( float angle ) { mLightAngle = angle; }
 
+  protected:
+    void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width ) override;
+
   private:
+    /** Calculates the hillshade from the first order derivatives*/
+    float hillshade( float derX, float derY ) const;
+
     float mLightAzimuth;
     float mLightAngle;
 };
@@ -20,6 +20,9 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8F(x) (x).toUtf8().constData()
@@ -27,6 +30,50 @@
 #define TO8F(x) QFile::encodeName( x ).constData()
 #endif
 
+//! Number of cells which are read and processed at once by a thread
+static const int STRIP_CELLS = 1 << 20;
+
+/** Rows of the raster processed together, with the rows above and below them*/
+struct NineCellStrip
+{
+  //! index of the first processed row
+  int firstRow;
+  //! number of processed rows
+  int rows;
+  //! rows + 2 input rows of width + 2 cells, padded with nodata values
+  QVector<float> input;
+  //! rows output rows of width cells
+  QVector<float> output;
+};
+
+/** Processes the rows of a strip, runs concurrently for several strips*/
+class NineCellStripProcessor
+{
+  public:
+    typedef void result_type;
+
+    NineCellStripProcessor( QgsNineCellFilter* filter, int width )
+        : mFilter( filter )
+        , mWidth( width )
+    {}
+
+    void operator()( NineCellStrip& strip )
+    {
+      int stride = mWidth + 2;
+      float* input = strip.input.data();
+      float* output = strip.output.data();
+      for ( int k = 0; k < strip.rows; ++k )
+      {
+        mFilter->processNineCellRow( input + k * stride + 1, input + ( k + 1 ) * stride + 1, input + ( k + 2 ) * stride + 1,
+                                     output + k * mWidth, mWidth );
+      }
+    }
+
+  private:
+    QgsNineCellFilter* mFilter;
+    int mWidth;
+};
+
 QgsNineCellFilter::QgsNineCellFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : mInputFile( inputFile )
     , mOutputFile( outputFile )
@@ -107,12 +154,13 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float* scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  float* resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  //read strips of rows with the row above and below, a strip holds about STRIP_CELLS cells
+  int stripRows = qBound( 1, STRIP_CELLS / xSize, 256 );
+  int stride = xSize + 2;
+  int threads = QThreadPool::globalInstance()->maxThreadCount();
+  int batchSize = qMax( 1, threads );
+  NineCellStripProcessor processor( this, xSize );
+  QList<NineCellStrip> strips;
 
   if ( p )
   {
@@ -120,7 +168,7 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
   }
 
   //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  for ( int i = 0; i < ySize; )
   {
     if ( p )
     {
@@ -132,65 +180,48 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
       break;
     }
 
-    if ( i == 0 )
+    //GDAL datasets must not be accessed concurrently, only the processing runs in parallel
+    strips.clear();
+    for ( int b = 0; b < batchSize && i < ySize; ++b )
     {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+      NineCellStrip strip;
+      strip.firstRow = i;
+      strip.rows = qMin( stripRows, ySize - i );
+      strip.input.fill( mInputNodataValue, ( strip.rows + 2 ) * stride );
+      strip.output.resize( strip.rows * xSize );
+
+      int firstInputRow = qMax( 0, i - 1 );
+      int lastInputRow = qMin( ySize - 1, i + strip.rows );
+      float* firstInputLine = strip.input.data() + ( firstInputRow - i + 1 ) * stride + 1;
+      if ( GDALRasterIO( rasterBand, GF_Read, 0, firstInputRow, xSize, lastInputRow - firstInputRow + 1, firstInputLine,
+                         xSize, lastInputRow - firstInputRow + 1, GDT_Float32, 0, stride * sizeof( float ) ) != CE_None )
       {
         QgsDebugMsg( "Raster IO Error" );
       }
-    }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+
+      strips << strip;
+      i += strip.rows;
     }
 
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
+    if ( threads > 1 && strips.size() > 1 )
     {
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine3[a] = mInputNodataValue;
-      }
+      QtConcurrent::blockingMap( strips, processor );
     }
     else
     {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
+      for ( int b = 0; b < strips.size(); ++b )
+        processor( strips[b] );
     }
 
-    for ( int j = 0; j < xSize; ++j )
+    for ( int b = 0; b < strips.size(); ++b )
     {
-      if ( j == 0 )
+      NineCellStrip& strip = strips[b];
+      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, strip.firstRow, xSize, strip.rows, strip.output.data(),
+                         xSize, strip.rows, GDT_Float32, 0, 0 ) != CE_None )
       {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j+1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j+1], &mInputNodataValue, &scanLine3[j], &scanLine3[j+1] );
-      }
-      else if ( j == xSize - 1 )
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &mInputNodataValue, &scanLine2[j-1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j-1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &scanLine1[j+1], &scanLine2[j-1], &scanLine2[j],
-                                               &scanLine2[j+1], &scanLine3[j-1], &scanLine3[j], &scanLine3[j+1] );
+        QgsDebugMsg( "Raster IO Error" );
       }
     }
-
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-    {
-      QgsDebugMsg( "Raster IO Error" );
-    }
   }
 
   if ( p )
@@ -198,11 +229,6 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     p->setValue( ySize );
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   GDALClose( inputDataset );
 
   if ( p && p->wasCanceled() )
@@ -216,6 +242,15 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
   return 0;
 }
 
+void QgsNineCellFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width )
+{
+  for ( int j = 0; j < width; ++j )
+  {
+    resultRow[j] = processNineCellWindow( &rowAbove[j-1], &rowAbove[j], &rowAbove[j+1], &row[j-1], &row[j],
+                                          &row[j+1], &rowBelow[j-1], &rowBelow[j], &rowBelow[j+1] );
+  }
+}
+
 GDALDatasetH QgsNineCellFilter::openInputFile( int& nCellsX, int& nCellsY )
 {
   GDALDatasetH inputDataset = GDALOpen( TO8F( mInputFile ), GA_ReadOnly );
@@ -33,7 +33,8 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     /** Constructor that takes input file, output file and output format (GDAL string)*/
     QgsNineCellFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat );
     virtual ~QgsNineCellFilter();
-    /** Starts the calculation, reads from mInputFile and stores the result in mOutputFile
+    /** Starts the calculation, reads from mInputFile and stores the result in mOutputFile.
+      The raster is read by strips of rows which are processed in parallel if the global thread pool has several threads.
       @param p progress dialog that receives update and that is checked for abort. 0 if no progress bar is needed.
       @return 0 in case of success*/
     int processRaster( QProgressDialog* p );
@@ -52,12 +53,30 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     void setOutputNodataValue( double value ) { mOutputNodataValue = value; }
 
     /** Calculates output value from nine input values. The input values and the output value can be equal to the
-      nodata value if not present or outside of the border. Must be implemented by subclasses*/
+      nodata value if not present or outside of the border. Must be implemented by subclasses.
+      The method is called concurrently for different cells and must not modify the filter*/
     virtual float processNineCellWindow( float* x11, float* x21, float* x31,
                                          float* x12, float* x22, float* x32,
                                          float* x13, float* x23, float* x33 ) = 0;
 
+  protected:
+    /** Calculates the output values of a row of cells. The input rows are padded with one input nodata value on each side,
+      i.e. rowAbove[-1] and rowAbove[width] are valid. The default implementation calls processNineCellWindow() for each cell,
+      subclasses may reimplement it with a faster kernel working on the whole row.
+      The method is called concurrently for different rows and must not modify the filter.
+      @param rowAbove input values of the row above, nodata values for the first row
+      @param row input values of the row
+      @param rowBelow input values of the row below, nodata values for the last row
+      @param resultRow receives the width output values
+      @param width number of cells of the row
+      @note added in QGIS 2.16
+      @note not available in Python bindings
+     */
+    virtual void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width );
+
   private:
+    friend class NineCellStripProcessor;
+
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter();
 
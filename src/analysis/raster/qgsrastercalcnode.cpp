@@ -15,6 +15,159 @@
 #include "qgsrastercalcnode.h"
 #include "qgsrasterblock.h"
 #include <cfloat>
+#include <qmath.h>
+
+//operations on values which are not nodata, same as QgsRasterMatrix
+
+struct CalcPlus
+{
+  static double apply( double a, double b, double ) { return a + b; }
+};
+struct CalcMinus
+{
+  static double apply( double a, double b, double ) { return a - b; }
+};
+struct CalcMul
+{
+  static double apply( double a, double b, double ) { return a * b; }
+};
+struct CalcDiv
+{
+  static double apply( double a, double b, double nodata ) { return b == 0 ? nodata : a / b; }
+};
+struct CalcPow
+{
+  static double apply( double a, double b, double nodata )
+  {
+    if (( a == 0 && b < 0 ) || ( a < 0 && ( b - floor( b ) ) > 0 ) )
+      return nodata;
+    return qPow( a, b );
+  }
+};
+struct CalcEq
+{
+  static double apply( double a, double b, double ) { return a == b ? 1.0 : 0.0; }
+};
+struct CalcNe
+{
+  static double apply( double a, double b, double ) { return a == b ? 0.0 : 1.0; }
+};
+struct CalcGt
+{
+  static double apply( double a, double b, double ) { return a > b ? 1.0 : 0.0; }
+};
+struct CalcLt
+{
+  static double apply( double a, double b, double ) { return a < b ? 1.0 : 0.0; }
+};
+struct CalcGe
+{
+  static double apply( double a, double b, double ) { return a >= b ? 1.0 : 0.0; }
+};
+struct CalcLe
+{
+  static double apply( double a, double b, double ) { return a <= b ? 1.0 : 0.0; }
+};
+struct CalcAnd
+{
+  static double apply( double a, double b, double ) { return a && b ? 1.0 : 0.0; }
+};
+struct CalcOr
+{
+  static double apply( double a, double b, double ) { return a || b ? 1.0 : 0.0; }
+};
+
+struct CalcSqrt
+{
+  static double apply( double a, double nodata ) { return a < 0 ? nodata : sqrt( a ); }
+};
+struct CalcSin
+{
+  static double apply( double a, double ) { return sin( a ); }
+};
+struct CalcCos
+{
+  static double apply( double a, double ) { return cos( a ); }
+};
+struct CalcTan
+{
+  static double apply( double a, double ) { return tan( a ); }
+};
+struct CalcAsin
+{
+  static double apply( double a, double ) { return asin( a ); }
+};
+struct CalcAcos
+{
+  static double apply( double a, double ) { return acos( a ); }
+};
+struct CalcAtan
+{
+  static double apply( double a, double ) { return atan( a ); }
+};
+struct CalcSign
+{
+  static double apply( double a, double ) { return -a; }
+};
+struct CalcLog
+{
+  static double apply( double a, double nodata ) { return a <= 0 ? nodata : ::log( a ); }
+};
+struct CalcLog10
+{
+  static double apply( double a, double nodata ) { return a <= 0 ? nodata : ::log10( a ); }
+};
+
+/** Combines the left values with the right values into the left values, a number is stored in the first value.
+ Operations with nodata values always generate nodata*/
+template <typename Op> static void combineValues( double* left, bool& leftIsNumber, const double* right, bool rightIsNumber, int count, double nodata )
+{
+  if ( leftIsNumber && rightIsNumber )
+  {
+    left[0] = left[0] == nodata || right[0] == nodata ? nodata : Op::apply( left[0], right[0], nodata );
+  }
+  else if ( leftIsNumber )
+  {
+    double value = left[0];
+    if ( value == nodata )
+    {
+      for ( int i = 0; i < count; ++i )
+        left[i] = nodata;
+    }
+    else
+    {
+      for ( int i = 0; i < count; ++i )
+        left[i] = right[i] == nodata ? nodata : Op::apply( value, right[i], nodata );
+    }
+    leftIsNumber = false;
+  }
+  else if ( rightIsNumber )
+  {
+    double value = right[0];
+    if ( value == nodata )
+    {
+      for ( int i = 0; i < count; ++i )
+        left[i] = nodata;
+    }
+    else
+    {
+      for ( int i = 0; i < count; ++i )
+        left[i] = left[i] == nodata ? nodata : Op::apply( left[i], value, nodata );
+    }
+  }
+  else
+  {
+    for ( int i = 0; i < count; ++i )
+      left[i] = left[i] == nodata || right[i] == nodata ? nodata : Op::apply( left[i], right[i], nodata );
+  }
+}
+
+/** Applies a function to the values which are not nodata*/
+template <typename Op> static void applyToValues( double* values, int count, double nodata )
+{
+  for ( int i = 0; i < count; ++i )
+    values[i] = values[i] == nodata ? nodata : Op::apply( values[i], nodata );
+}
 
 QgsRasterCalcNode::QgsRasterCalcNode()
     : mType( tNumber )
@@ -252,6 +405,181 @@ bool QgsRasterCalcNode::calculate( QMap<QString, QgsRasterBlock* >& rasterData,
   return false;
 }
 
+bool QgsRasterCalcNode::calculateBlock( const QMap<QString, QgsRasterBlock* >& rasterData, double* result, int count, double nodataValue, double* scratch ) const
+{
+  bool isNumber = false;
+  if ( !calculateBlockValues( rasterData, result, isNumber, count, nodataValue, scratch ) )
+  {
+    return false;
+  }
+
+  if ( isNumber )
+  {
+    double value = result[0];
+    for ( int i = 1; i < count; ++i )
+      result[i] = value;
+  }
+  return true;
+}
+
+int QgsRasterCalcNode::scratchSize( int count ) const
+{
+  return scratchBuffers() * count;
+}
+
+int QgsRasterCalcNode::scratchBuffers() const
+{
+  if ( mType != tOperator )
+  {
+    return 0;
+  }
+
+  //the left node is calculated into the result, the right one into the first scratch buffer
+  int buffers = mLeft ? mLeft->scratchBuffers() : 0;
+  if ( mRight )
+  {
+    buffers = qMax( buffers, 1 + mRight->scratchBuffers() );
+  }
+  return buffers;
+}
+
+bool QgsRasterCalcNode::calculateBlockValues( const QMap<QString, QgsRasterBlock* >& rasterData, double* values, bool& isNumber, int count,
+    double nodataValue, double* scratch ) const
+{
+  if ( mType == tRasterRef )
+  {
+    QMap<QString, QgsRasterBlock*>::const_iterator it = rasterData.constFind( mRasterName );
+    if ( it == rasterData.constEnd() )
+    {
+      return false;
+    }
+
+    QgsRasterBlock* block = it.value();
+    if ( static_cast< qgssize >( block->width() ) * block->height() != static_cast< qgssize >( count ) )
+    {
+      return false;
+    }
+
+    //convert input raster values to double, also convert input no data to result no data
+    for ( int i = 0; i < count; ++i )
+    {
+      values[i] = block->isNoData( i ) ? nodataValue : block->value( i );
+    }
+    isNumber = false;
+    return true;
+  }
+  else if ( mType == tOperator )
+  {
+    if ( !mLeft || !mLeft->calculateBlockValues( rasterData, values, isNumber, count, nodataValue, scratch ) )
+    {
+      return false;
+    }
+    bool rightIsNumber = false;
+    if ( mRight && !mRight->calculateBlockValues( rasterData, scratch, rightIsNumber, count, nodataValue, scratch + count ) )
+    {
+      return false;
+    }
+
+    int n = isNumber ? 1 : count;
+    switch ( mOperator )
+    {
+      case opPLUS:
+        combineValues<CalcPlus>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opMINUS:
+        combineValues<CalcMinus>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opMUL:
+        combineValues<CalcMul>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opDIV:
+        combineValues<CalcDiv>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opPOW:
+        combineValues<CalcPow>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opEQ:
+        combineValues<CalcEq>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opNE:
+        combineValues<CalcNe>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opGT:
+        combineValues<CalcGt>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opLT:
+        combineValues<CalcLt>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opGE:
+        combineValues<CalcGe>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opLE:
+        combineValues<CalcLe>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opAND:
+        combineValues<CalcAnd>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opOR:
+        combineValues<CalcOr>( values, isNumber, scratch, rightIsNumber, count, nodataValue );
+        break;
+      case opSQRT:
+        applyToValues<CalcSqrt>( values, n, nodataValue );
+        break;
+      case opSIN:
+        applyToValues<CalcSin>( values, n, nodataValue );
+        break;
+      case opCOS:
+        applyToValues<CalcCos>( values, n, nodataValue );
+        break;
+      case opTAN:
+        applyToValues<CalcTan>( values, n, nodataValue );
+        break;
+      case opASIN:
+        applyToValues<CalcAsin>( values, n, nodataValue );
+        break;
+      case opACOS:
+        applyToValues<CalcAcos>( values, n, nodataValue );
+        break;
+      case opATAN:
+        applyToValues<CalcAtan>( values, n, nodataValue );
+        break;
+      case opSIGN:
+        applyToValues<CalcSign>( values, n, nodataValue );
+        break;
+      case opLOG:
+        applyToValues<CalcLog>( values, n, nodataValue );
+        break;
+      case opLOG10:
+        applyToValues<CalcLog10>( values, n, nodataValue );
+        break;
+      default:
+        return false;
+    }
+    return true;
+  }
+  else if ( mType == tNumber )
+  {
+    values[0] = mNumber;
+    isNumber = true;
+    return true;
+  }
+  else if ( mType == tMatrix )
+  {
+    int nEntries = mMatrix->nColumns() * mMatrix->nRows();
+    if ( nEntries != 1 && nEntries != count )
+    {
+      return false;
+    }
+    for ( int i = 0; i < nEntries; ++i )
+    {
+      values[i] = mMatrix->data()[i] == mMatrix->nodataValue() ? nodataValue : mMatrix->data()[i];
+    }
+    isNumber = nEntries == 1;
+    return true;
+  }
+  return false;
+}
+
 QgsRasterCalcNode* QgsRasterCalcNode::parseRasterCalcString( const QString& str, QString& parserErrorMsg )
 {
   extern QgsRasterCalcNode* localParseRasterCalcString( const QString & str, QString & parserErrorMsg );
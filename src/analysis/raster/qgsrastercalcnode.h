@@ -93,6 +93,26 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
      */
     Q_DECL_DEPRECATED bool calculate( QMap<QString, QgsRasterMatrix*>& rasterData, QgsRasterMatrix& result ) const;
 
+    /** Calculates the result for all the cells of input blocks of the same size, in a single pass over the expression
+     * tree. Intermediate results are stored in a scratch buffer and no memory is allocated, so the method can be
+     * called for many tiles and from several threads at the same time.
+     * @param rasterData input raster data references, map of raster name to raster data block of count cells
+     * @param result receives the count result values
+     * @param count number of cells
+     * @param nodataValue value of the results for nodata cells
+     * @param scratch buffer of scratchSize( count ) values for the intermediate results
+     * @returns true in case of success
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    bool calculateBlock( const QMap<QString, QgsRasterBlock* >& rasterData, double* result, int count, double nodataValue, double* scratch ) const;
+
+    /** Returns the number of values of the scratch buffer used by calculateBlock() for count cells.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    int scratchSize( int count ) const;
+
     static QgsRasterCalcNode* parseRasterCalcString( const QString& str, QString& parserErrorMsg );
 
   private:
@@ -104,6 +124,14 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     QgsRasterMatrix* mMatrix;
     Operator mOperator;
 
+    /** Returns the number of intermediate buffers needed to calculate the node, besides its own result*/
+    int scratchBuffers() const;
+
+    /** Calculates the values of the node for a block of cells into values, which receives a single value if
+     * the result is a number. Children use the scratch buffer*/
+    bool calculateBlockValues( const QMap<QString, QgsRasterBlock* >& rasterData, double* values, bool& isNumber, int count,
+                               double nodataValue, double* scratch ) const;
+
     QgsRasterCalcNode( const QgsRasterCalcNode& rh );
     QgsRasterCalcNode& operator=( const QgsRasterCalcNode& rh );
 };
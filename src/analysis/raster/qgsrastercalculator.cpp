@@ -19,9 +19,12 @@
 #include "qgsrastercalcnode.h"
 #include "qgsrasterlayer.h"
 #include "qgsrastermatrix.h"
+#include "qgsrasterprojector.h"
 
 #include <QProgressDialog>
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -43,6 +46,7 @@ QgsRasterCalculator::QgsRasterCalculator( const QString& formulaString, const QS
     , mNumOutputColumns( nOutputColumns )
     , mNumOutputRows( nOutputRows )
     , mRasterEntries( rasterEntries )
+    , mTileSize( 512 )
 {
   //default to first layer's crs
   mOutputCrs = mRasterEntries.at( 0 ).raster->crs();
@@ -58,9 +62,56 @@ QgsRasterCalculator::QgsRasterCalculator( const QString& formulaString, const QS
     , mNumOutputColumns( nOutputColumns )
     , mNumOutputRows( nOutputRows )
     , mRasterEntries( rasterEntries )
+    , mTileSize( 512 )
 {
 }
 
+//! Output tile with the input blocks it is calculated from
+struct QgsRasterCalculatorTile
+{
+  int col;
+  int row;
+  int width;
+  int height;
+  QMap< QString, QgsRasterBlock* > inputBlocks;
+  QVector<float> result;
+  bool ok;
+};
+
+//! Calculates the output values of a tile, the tiles of a batch are calculated in parallel
+struct QgsRasterCalculatorTileTask
+{
+  typedef void result_type;
+
+  QgsRasterCalculatorTileTask( const QgsRasterCalcNode* node, float nodataValue )
+      : mNode( node )
+      , mNodataValue( nodataValue )
+  {}
+
+  void operator()( QgsRasterCalculatorTile& tile ) const
+  {
+    int count = tile.width * tile.height;
+    QVector<double> values( count );
+    QVector<double> scratch( mNode->scratchSize( count ) );
+    tile.ok = mNode->calculateBlock( tile.inputBlocks, values.data(), count, mNodataValue, scratch.data() );
+    if ( !tile.ok )
+    {
+      return;
+    }
+
+    tile.result.resize( count );
+    const double* src = values.constData();
+    float* dst = tile.result.data();
+    for ( int i = 0; i < count; ++i )
+    {
+      dst[i] = static_cast< float >( src[i] );
+    }
+  }
+
+  const QgsRasterCalcNode* mNode;
+  float mNodataValue;
+};
+
 int QgsRasterCalculator::processCalculation( QProgressDialog* p )
 {
   //prepare search string / tree
@@ -72,113 +123,165 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     return static_cast<int>( ParserError );
   }
 
-  QMap< QString, QgsRasterBlock* > inputBlocks;
+  //projectors for the entries in another crs, nullptr if the provider is read directly
+  QVector<QgsRasterProjector*> projectors;
   QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
   for ( ; it != mRasterEntries.constEnd(); ++it )
   {
     if ( !it->raster ) // no raster layer in entry
     {
       delete calcNode;
-      qDeleteAll( inputBlocks );
+      qDeleteAll( projectors );
       return static_cast< int >( InputLayerError );
     }
 
-    QgsRasterBlock* block = nullptr;
+    QgsRasterProjector* proj = nullptr;
     // if crs transform needed
     if ( it->raster->crs() != mOutputCrs )
     {
-      QgsRasterProjector proj;
-      proj.setCRS( it->raster->crs(), mOutputCrs );
-      proj.setInput( it->raster->dataProvider() );
-      proj.setPrecision( QgsRasterProjector::Exact );
-
-      block = proj.block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    else
-    {
-      block = it->raster->dataProvider()->block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
+      proj = new QgsRasterProjector();
+      proj->setCRS( it->raster->crs(), mOutputCrs );
+      proj->setInput( it->raster->dataProvider() );
+      proj->setPrecision( QgsRasterProjector::Exact );
     }
-    if ( block->isEmpty() )
-    {
-      delete block;
-      delete calcNode;
-      qDeleteAll( inputBlocks );
-      return static_cast<int>( MemoryError );
-    }
-    inputBlocks.insert( it->ref, block );
+    projectors << proj;
   }
 
   //open output dataset for writing
   GDALDriverH outputDriver = openOutputDriver();
-  if ( !outputDriver )
+  GDALDatasetH outputDataset = outputDriver ? openOutputFile( outputDriver ) : nullptr;
+  if ( !outputDataset )
   {
+    delete calcNode;
+    qDeleteAll( projectors );
     return static_cast< int >( CreateOutputError );
   }
 
-  GDALDatasetH outputDataset = openOutputFile( outputDriver );
   GDALSetProjection( outputDataset, mOutputCrs.toWkt().toLocal8Bit().data() );
   GDALRasterBandH outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
 
   float outputNodataValue = -FLT_MAX;
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
+  //the output is calculated by square tiles, the tiles are aligned on output pixels
+  int nTileColumns = ( mNumOutputColumns + mTileSize - 1 ) / mTileSize;
+  int nTileRows = ( mNumOutputRows + mTileSize - 1 ) / mTileSize;
+  int nTiles = nTileColumns * nTileRows;
+  double cellWidth = mOutputRectangle.width() / mNumOutputColumns;
+  double cellHeight = mOutputRectangle.height() / mNumOutputRows;
+
   if ( p )
   {
-    p->setMaximum( mNumOutputRows );
+    p->setMaximum( nTiles );
   }
 
-  QgsRasterMatrix resultMatrix;
-  resultMatrix.setNodataValue( outputNodataValue );
+  //inputs are read on this thread, as many tiles as threads are calculated at once
+  int batchSize = qMax( 1, QThreadPool::globalInstance()->maxThreadCount() );
+  Result result = Success;
+  QgsRasterCalculatorTileTask task( calcNode, outputNodataValue );
 
-  //read / write line by line
-  for ( int i = 0; i < mNumOutputRows; ++i )
+  for ( int batchStart = 0; batchStart < nTiles && result == Success; batchStart += batchSize )
   {
     if ( p )
     {
-      p->setValue( i );
+      p->setValue( batchStart );
+      if ( p->wasCanceled() )
+      {
+        result = Cancelled;
+        break;
+      }
     }
 
-    if ( p && p->wasCanceled() )
+    QVector<QgsRasterCalculatorTile> tiles;
+    for ( int t = batchStart; t < qMin( nTiles, batchStart + batchSize ) && result == Success; ++t )
     {
-      break;
+      QgsRasterCalculatorTile tile;
+      tile.col = ( t % nTileColumns ) * mTileSize;
+      tile.row = ( t / nTileColumns ) * mTileSize;
+      tile.width = qMin( mTileSize, mNumOutputColumns - tile.col );
+      tile.height = qMin( mTileSize, mNumOutputRows - tile.row );
+      tile.ok = false;
+
+      //use the exact output extent on the last row and column
+      double xMin = mOutputRectangle.xMinimum() + tile.col * cellWidth;
+      double xMax = tile.col + tile.width == mNumOutputColumns ? mOutputRectangle.xMaximum() : xMin + tile.width * cellWidth;
+      double yMax = mOutputRectangle.yMaximum() - tile.row * cellHeight;
+      double yMin = tile.row + tile.height == mNumOutputRows ? mOutputRectangle.yMinimum() : yMax - tile.height * cellHeight;
+      QgsRectangle tileExtent( xMin, yMin, xMax, yMax );
+
+      for ( int i = 0; i < mRasterEntries.size(); ++i )
+      {
+        const QgsRasterCalculatorEntry& entry = mRasterEntries.at( i );
+        QgsRasterBlock* block = nullptr;
+        if ( projectors.at( i ) )
+        {
+          block = projectors.at( i )->block( entry.bandNumber, tileExtent, tile.width, tile.height );
+        }
+        else
+        {
+          block = entry.raster->dataProvider()->block( entry.bandNumber, tileExtent, tile.width, tile.height );
+        }
+        if ( block->isEmpty() )
+        {
+          delete block;
+          result = MemoryError;
+          break;
+        }
+        delete tile.inputBlocks.value( entry.ref );
+        tile.inputBlocks.insert( entry.ref, block );
+      }
+      tiles << tile;
     }
 
-    if ( calcNode->calculate( inputBlocks, resultMatrix, i ) )
+    if ( result == Success )
     {
-      bool resultIsNumber = resultMatrix.isNumber();
-      float* calcData = new float[mNumOutputColumns];
-
-      for ( int j = 0; j < mNumOutputColumns; ++j )
+      if ( tiles.size() > 1 && QThreadPool::globalInstance()->maxThreadCount() > 1 )
       {
-        calcData[j] = ( float )( resultIsNumber ? resultMatrix.number() : resultMatrix.data()[j] );
+        QtConcurrent::blockingMap( tiles, task );
       }
-
-      //write scanline to the dataset
-      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, mNumOutputColumns, 1, calcData, mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
+      else
       {
-        QgsDebugMsg( "RasterIO error!" );
+        for ( int t = 0; t < tiles.size(); ++t )
+        {
+          task( tiles[t] );
+        }
       }
 
-      delete[] calcData;
+      //write the calculated tiles to the dataset
+      for ( int t = 0; t < tiles.size(); ++t )
+      {
+        QgsRasterCalculatorTile& tile = tiles[t];
+        if ( !tile.ok )
+        {
+          continue;
+        }
+        if ( GDALRasterIO( outputRasterBand, GF_Write, tile.col, tile.row, tile.width, tile.height, tile.result.data(), tile.width, tile.height, GDT_Float32, 0, 0 ) != CE_None )
+        {
+          QgsDebugMsg( "RasterIO error!" );
+        }
+      }
     }
 
+    for ( int t = 0; t < tiles.size(); ++t )
+    {
+      qDeleteAll( tiles[t].inputBlocks );
+    }
   }
 
-  if ( p )
+  if ( p && result == Success )
   {
-    p->setValue( mNumOutputRows );
+    p->setValue( nTiles );
   }
 
   //close datasets and release memory
   delete calcNode;
-  qDeleteAll( inputBlocks );
-  inputBlocks.clear();
+  qDeleteAll( projectors );
 
-  if ( p && p->wasCanceled() )
+  if ( result != Success )
   {
     //delete the dataset without closing (because it is faster)
     GDALDeleteDataset( outputDriver, TO8F( mOutputFile ) );
-    return static_cast< int >( Cancelled );
+    return static_cast< int >( result );
   }
   GDALClose( outputDataset );
 
@@ -188,6 +291,7 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
 QgsRasterCalculator::QgsRasterCalculator()
     : mNumOutputColumns( 0 )
     , mNumOutputRows( 0 )
+    , mTileSize( 512 )
 {
 }
 
@@ -84,6 +84,21 @@ class ANALYSIS_EXPORT QgsRasterCalculator
     //TODO QGIS 3.0 - return QgsRasterCalculator::Result
     int processCalculation( QProgressDialog* p = nullptr );
 
+    /** Sets the size in pixels of the square tiles the output raster is calculated by.
+     * Tiles are read one after the other and calculated in parallel, only the input
+     * blocks of the current tiles are kept in memory.
+     * @param size tile width and height in pixels, default is 512
+     * @see tileSize()
+     * @note added in QGIS 2.16
+     */
+    void setTileSize( int size ) { mTileSize = qMax( 1, size ); }
+
+    /** Returns the size in pixels of the square tiles the output raster is calculated by.
+     * @see setTileSize()
+     * @note added in QGIS 2.16
+     */
+    int tileSize() const { return mTileSize; }
+
   private:
     //default constructor forbidden. We need formula, output file, output format and output raster resolution obligatory
     QgsRasterCalculator();
@@ -115,6 +130,9 @@ class ANALYSIS_EXPORT QgsRasterCalculator
 
     /***/
     QVector<QgsRasterCalculatorEntry> mRasterEntries;
+
+    /** Width and height of the calculated tiles*/
+    int mTileSize;
 };
 
 #endif // QGSRASTERCALCULATOR_H
@@ -17,6 +17,8 @@
 
 #include "qgsslopefilter.h"
 
+#include <QVector>
+
 QgsSlopeFilter::QgsSlopeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -33,7 +35,25 @@ float QgsSlopeFilter::processNineCellWindow( float* x11, float* x21, float* x31,
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return slope( derX, derY );
+}
 
+void QgsSlopeFilter::processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width )
+{
+  QVector<float> derX( width );
+  QVector<float> derY( width );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), width );
+
+  const float* x = derX.constData();
+  const float* y = derY.constData();
+  for ( int j = 0; j < width; ++j )
+  {
+    resultRow[j] = slope( x[j], y[j] );
+  }
+}
+
+float QgsSlopeFilter::slope( float derX, float derY ) const
+{
   if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
   {
     return mOutputNodataValue;
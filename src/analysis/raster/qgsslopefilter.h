@@ -32,6 +32,13 @@ class ANALYSIS_EXPORT QgsSlopeFilter: public QgsDerivativeFilter
     float processNineCellWindow( float* x11, float* x21, float* x31,
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 ) override;
+
+  protected:
+    void processNineCellRow( float* rowAbove, float* row, float* rowBelow, float* resultRow, int width ) override;
+
+  private:
+    /** Calculates the slope from the first order derivatives*/
+    float slope( float derX, float derY ) const;
 };
 
 #endif // QGSSLOPEFILTER_H
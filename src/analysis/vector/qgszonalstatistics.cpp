@@ -17,6 +17,8 @@
 
 #include "qgszonalstatistics.h"
 #include "qgsgeometry.h"
+#include "qgsspatialindex.h"
+#include "qgsstatisticalsummary.h"
 #include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qmath.h"
@@ -24,6 +26,9 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8F(x) (x).toUtf8().constData()
@@ -31,6 +36,198 @@
 #define TO8F(x) QFile::encodeName( x ).constData()
 #endif
 
+//! Number of cells which are read at once
+static const int STRIP_CELLS = 1 << 22;
+
+/** Polygon of the layer with the raster cells covering its bounding box*/
+struct ZonalStatisticsZone
+{
+  ZonalStatisticsZone( QgsFeatureId featureId, const QgsGeometry& featureGeometry, bool storeValues, bool storeValueCounts )
+      : id( featureId )
+      , geometry( featureGeometry )
+      , prepared( nullptr )
+      , offsetX( 0 )
+      , offsetY( 0 )
+      , nCellsX( 0 )
+      , nCellsY( 0 )
+      , stats( storeValues, storeValueCounts )
+  {}
+
+  ~ZonalStatisticsZone()
+  {
+    if ( prepared )
+      GEOSPreparedGeom_destroy_r( QgsGeometry::getGEOSHandler(), prepared );
+  }
+
+  QgsFeatureId id;
+  QgsGeometry geometry;
+  const GEOSPreparedGeometry* prepared;
+  int offsetX;
+  int offsetY;
+  int nCellsX;
+  int nCellsY;
+  QgsZonalStatistics::FeatureStats stats;
+
+  private:
+    ZonalStatisticsZone( const ZonalStatisticsZone& rh );
+    ZonalStatisticsZone& operator=( const ZonalStatisticsZone& rh );
+};
+
+/** Adds the cells of a block of rows to the statistics of the zones overlapping it,
+ runs concurrently for several zones*/
+class ZonalStatisticsZoneTask
+{
+  public:
+    typedef void result_type;
+
+    ZonalStatisticsZoneTask( const QgsZonalStatistics* zonalStatistics, const QgsZonalStatistics::RasterBlock& block, int blockRows,
+                             double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox )
+        : mZonalStatistics( zonalStatistics )
+        , mBlock( block )
+        , mBlockRows( blockRows )
+        , mCellSizeX( cellSizeX )
+        , mCellSizeY( cellSizeY )
+        , mRasterBBox( rasterBBox )
+    {}
+
+    void operator()( ZonalStatisticsZone* zone )
+    {
+      int firstRow = qMax( zone->offsetY, mBlock.offsetY );
+      int lastRow = qMin( zone->offsetY + zone->nCellsY, mBlock.offsetY + mBlockRows );
+      mZonalStatistics->statisticsFromMiddlePointTest( zone->prepared, zone->offsetX, firstRow, zone->nCellsX, lastRow - firstRow,
+          mCellSizeX, mCellSizeY, mRasterBBox, mBlock, zone->stats );
+    }
+
+  private:
+    const QgsZonalStatistics* mZonalStatistics;
+    QgsZonalStatistics::RasterBlock mBlock;
+    int mBlockRows;
+    double mCellSizeX;
+    double mCellSizeY;
+    QgsRectangle mRasterBBox;
+};
+
+/** Computes the statistics of the zones which received all their cells and collects them as attribute changes*/
+class ZonalStatisticsOutput
+{
+  public:
+    ZonalStatisticsOutput( const QgsZonalStatistics* zonalStatistics, GDALRasterBandH rasterBand, double cellSizeX, double cellSizeY,
+                           const QgsRectangle& rasterBBox, QgsStatisticalSummary::Statistics summaryStatistics )
+        : countIndex( -1 )
+        , sumIndex( -1 )
+        , meanIndex( -1 )
+        , medianIndex( -1 )
+        , stdevIndex( -1 )
+        , minIndex( -1 )
+        , maxIndex( -1 )
+        , rangeIndex( -1 )
+        , minorityIndex( -1 )
+        , majorityIndex( -1 )
+        , varietyIndex( -1 )
+        , mZonalStatistics( zonalStatistics )
+        , mRasterBand( rasterBand )
+        , mCellSizeX( cellSizeX )
+        , mCellSizeY( cellSizeY )
+        , mRasterBBox( rasterBBox )
+        , mSummary( summaryStatistics )
+    {}
+
+    void finishZone( ZonalStatisticsZone* zone );
+
+    //! field indexes of the statistics, -1 for the statistics which are not calculated
+    int countIndex;
+    int sumIndex;
+    int meanIndex;
+    int medianIndex;
+    int stdevIndex;
+    int minIndex;
+    int maxIndex;
+    int rangeIndex;
+    int minorityIndex;
+    int majorityIndex;
+    int varietyIndex;
+
+    //! new attribute values of the finished zones
+    QgsChangedAttributesMap changeMap;
+
+  private:
+    const QgsZonalStatistics* mZonalStatistics;
+    GDALRasterBandH mRasterBand;
+    double mCellSizeX;
+    double mCellSizeY;
+    QgsRectangle mRasterBBox;
+    QgsStatisticalSummary mSummary;
+    QVector<float> mZoneData;
+};
+
+void ZonalStatisticsOutput::finishZone( ZonalStatisticsZone* zone )
+{
+  QgsZonalStatistics::FeatureStats& featureStats = zone->stats;
+  if ( featureStats.count <= 1 && zone->prepared )
+  {
+    //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
+    featureStats.reset();
+    int zoneRows = qBound( 1, STRIP_CELLS / zone->nCellsX, zone->nCellsY );
+    for ( int row = zone->offsetY; row < zone->offsetY + zone->nCellsY; row += zoneRows )
+    {
+      int rows = qMin( zoneRows, zone->offsetY + zone->nCellsY - row );
+      mZoneData.resize( zone->nCellsX * rows );
+      if ( GDALRasterIO( mRasterBand, GF_Read, zone->offsetX, row, zone->nCellsX, rows, mZoneData.data(),
+                         zone->nCellsX, rows, GDT_Float32, 0, 0 ) != CE_None )
+      {
+        QgsDebugMsg( "Raster IO Error" );
+        continue;
+      }
+
+      QgsZonalStatistics::RasterBlock block = { mZoneData.constData(), zone->offsetX, row, zone->nCellsX };
+      mZonalStatistics->statisticsFromPreciseIntersection( &zone->geometry, zone->offsetX, row, zone->nCellsX, rows, mCellSizeX, mCellSizeY,
+          mRasterBBox, block, featureStats );
+    }
+  }
+
+  //write the statistics value to the vector data provider
+  QgsAttributeMap changeAttributeMap;
+  if ( countIndex != -1 )
+    changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
+  if ( sumIndex != -1 )
+    changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
+  if ( featureStats.count > 0 )
+  {
+    double mean = featureStats.sum / featureStats.count;
+    if ( meanIndex != -1 )
+      changeAttributeMap.insert( meanIndex, QVariant( mean ) );
+    if ( minIndex != -1 )
+      changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
+    if ( maxIndex != -1 )
+      changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
+    if ( rangeIndex != -1 )
+      changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
+
+    if ( medianIndex != -1 || stdevIndex != -1 )
+    {
+      mSummary.calculate( featureStats.values );
+      if ( medianIndex != -1 )
+        changeAttributeMap.insert( medianIndex, QVariant( mSummary.median() ) );
+      if ( stdevIndex != -1 )
+        changeAttributeMap.insert( stdevIndex, QVariant( mSummary.stDev() ) );
+    }
+
+    if ( !featureStats.valueCount.isEmpty() && ( minorityIndex != -1 || majorityIndex != -1 ) )
+    {
+      QList<int> vals = featureStats.valueCount.values();
+      qSort( vals.begin(), vals.end() );
+      if ( minorityIndex != -1 )
+        changeAttributeMap.insert( minorityIndex, QVariant( featureStats.valueCount.key( vals.first() ) ) );
+      if ( majorityIndex != -1 )
+        changeAttributeMap.insert( majorityIndex, QVariant( featureStats.valueCount.key( vals.last() ) ) );
+    }
+    if ( varietyIndex != -1 )
+      changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
+  }
+
+  changeMap.insert( zone->id, changeAttributeMap );
+}
+
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer* polygonLayer, const QString& rasterFile, const QString& attributePrefix, int rasterBand, const Statistics& stats )
     : mRasterFilePath( rasterFile )
     , mRasterBand( rasterBand )
@@ -226,22 +423,43 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
     p->setMaximum( featureCount );
   }
 
-
-  //iterate over each polygon
+  //collect the polygons and the cells covering them
   QgsFeatureRequest request;
   request.setSubsetOfAttributes( QgsAttributeList() );
+  request.setFilterRect( rasterBBox );
   QgsFeatureIterator fi = vectorProvider->getFeatures( request );
   QgsFeature f;
 
   bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
                           ( mStatistics & QgsZonalStatistics::StDev );
-  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
-                              ( mStatistics & QgsZonalStatistics::Majority );
+  bool statsStoreValueCounts = ( mStatistics & QgsZonalStatistics::Minority ) ||
+                               ( mStatistics & QgsZonalStatistics::Majority ) ||
+                               ( mStatistics & QgsZonalStatistics::Variety );
+
+  QgsStatisticalSummary::Statistics summaryStats = 0;
+  if ( mStatistics & QgsZonalStatistics::Median )
+    summaryStats |= QgsStatisticalSummary::Median;
+  if ( mStatistics & QgsZonalStatistics::StDev )
+    summaryStats |= QgsStatisticalSummary::StDev;
+  ZonalStatisticsOutput output( this, rasterBand, cellsizeX, cellsizeY, rasterBBox, summaryStats );
+  output.countIndex = countIndex;
+  output.sumIndex = sumIndex;
+  output.meanIndex = meanIndex;
+  output.medianIndex = medianIndex;
+  output.stdevIndex = stdevIndex;
+  output.minIndex = minIndex;
+  output.maxIndex = maxIndex;
+  output.rangeIndex = rangeIndex;
+  output.minorityIndex = minorityIndex;
+  output.majorityIndex = majorityIndex;
+  output.varietyIndex = varietyIndex;
 
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
+  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
+  //zones waiting for cells, they are finished and deleted once the strips have passed them
+  QHash<QgsFeatureId, ZonalStatisticsZone*> zonesById;
+  QgsSpatialIndex index;
   int featureCounter = 0;
 
-  QgsChangedAttributesMap changeMap;
   while ( fi.nextFeature( f ) )
   {
     if ( p )
@@ -254,9 +472,9 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
       break;
     }
 
+    ++featureCounter;
     if ( !f.constGeometry() )
     {
-      ++featureCounter;
       continue;
     }
     const QgsGeometry* featureGeometry = f.constGeometry();
@@ -264,14 +482,12 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
     QgsRectangle featureRect = featureGeometry->boundingBox().intersect( &rasterBBox );
     if ( featureRect.isEmpty() )
     {
-      ++featureCounter;
       continue;
     }
 
     int offsetX, offsetY, nCellsX, nCellsY;
     if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
     {
-      ++featureCounter;
       continue;
     }
 
@@ -285,94 +501,130 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
       nCellsY = nCellsYGDAL - offsetY;
     }
 
-    statisticsFromMiddlePointTest( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                   rasterBBox, featureStats );
+    ZonalStatisticsZone* zone = new ZonalStatisticsZone( f.id(), *featureGeometry, statsStoreValues, statsStoreValueCounts );
+    zone->offsetX = offsetX;
+    zone->offsetY = offsetY;
+    zone->nCellsX = qMax( nCellsX, 0 );
+    zone->nCellsY = qMax( nCellsY, 0 );
 
-    if ( featureStats.count <= 1 )
+    //zones without cells get empty statistics
+    const GEOSGeometry* polyGeos = zone->geometry.asGeos();
+    if ( zone->nCellsX > 0 && zone->nCellsY > 0 && polyGeos )
     {
-      //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                         rasterBBox, featureStats );
+      zone->prepared = GEOSPrepare_r( geosctxt, polyGeos );
+    }
+    if ( !zone->prepared )
+    {
+      output.finishZone( zone );
+      delete zone;
+      continue;
     }
 
-    //write the statistics value to the vector data provider
-    QgsAttributeMap changeAttributeMap;
-    if ( mStatistics & QgsZonalStatistics::Count )
-      changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
-    if ( mStatistics & QgsZonalStatistics::Sum )
-      changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
-    if ( featureStats.count > 0 )
+    zonesById.insert( zone->id, zone );
+    index.insertFeature( f );
+  }
+
+  //read the raster once by strips of rows and add the cells to the zones overlapping each strip
+  int stripRows = qBound( 1, STRIP_CELLS / nCellsXGDAL, nCellsYGDAL );
+  bool concurrent = QThreadPool::globalInstance()->maxThreadCount() > 1;
+  QVector<float> stripData;
+
+  if ( p && !p->wasCanceled() )
+  {
+    p->setMaximum( nCellsYGDAL );
+  }
+
+  for ( int stripOffsetY = 0; stripOffsetY < nCellsYGDAL && !zonesById.isEmpty(); stripOffsetY += stripRows )
+  {
+    if ( p )
     {
-      double mean = featureStats.sum / featureStats.count;
-      if ( mStatistics & QgsZonalStatistics::Mean )
-        changeAttributeMap.insert( meanIndex, QVariant( mean ) );
-      if ( mStatistics & QgsZonalStatistics::Median )
+      if ( p->wasCanceled() )
       {
-        qSort( featureStats.values.begin(), featureStats.values.end() );
-        int size =  featureStats.values.count();
-        bool even = ( size % 2 ) < 1;
-        double medianValue;
-        if ( even )
-        {
-          medianValue = ( featureStats.values.at( size / 2 - 1 ) + featureStats.values.at( size / 2 ) ) / 2;
-        }
-        else //odd
-        {
-          medianValue = featureStats.values.at(( size + 1 ) / 2 - 1 );
-        }
-        changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
+        break;
       }
-      if ( mStatistics & QgsZonalStatistics::StDev )
+      p->setValue( stripOffsetY );
+    }
+
+    int rows = qMin( stripRows, nCellsYGDAL - stripOffsetY );
+
+    //cells of a zone may exceed its bounding box by one row because of rounding
+    QgsRectangle stripRect( rasterBBox.xMinimum(), rasterBBox.yMaximum() - ( stripOffsetY + rows + 1 ) * cellsizeY,
+                            rasterBBox.xMaximum(), rasterBBox.yMaximum() - ( stripOffsetY - 1 ) * cellsizeY );
+    QList<ZonalStatisticsZone*> stripZones;
+    int minColumn = nCellsXGDAL;
+    int maxColumn = 0;
+    Q_FOREACH ( QgsFeatureId id, index.intersects( stripRect ) )
+    {
+      ZonalStatisticsZone* zone = zonesById.value( id );
+      if ( !zone || zone->offsetY >= stripOffsetY + rows || zone->offsetY + zone->nCellsY <= stripOffsetY )
       {
-        double sumSquared = 0;
-        for ( int i = 0; i < featureStats.values.count(); ++i )
-        {
-          double diff = featureStats.values.at( i ) - mean;
-          sumSquared += diff * diff;
-        }
-        double stdev = qPow( sumSquared / featureStats.values.count(), 0.5 );
-        changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
+        continue;
+      }
+      stripZones << zone;
+      minColumn = qMin( minColumn, zone->offsetX );
+      maxColumn = qMax( maxColumn, zone->offsetX + zone->nCellsX );
+    }
+    if ( stripZones.isEmpty() )
+    {
+      continue;
+    }
+
+    int width = maxColumn - minColumn;
+    stripData.resize( width * rows );
+    if ( GDALRasterIO( rasterBand, GF_Read, minColumn, stripOffsetY, width, rows, stripData.data(), width, rows, GDT_Float32, 0, 0 ) != CE_None )
+    {
+      QgsDebugMsg( "Raster IO Error" );
+    }
+    else
+    {
+      RasterBlock block = { stripData.constData(), minColumn, stripOffsetY, width };
+      ZonalStatisticsZoneTask task( this, block, rows, cellsizeX, cellsizeY, rasterBBox );
+      if ( concurrent && stripZones.size() > 1 )
+      {
+        QtConcurrent::blockingMap( stripZones, task );
       }
-      if ( mStatistics & QgsZonalStatistics::Min )
-        changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Max )
-        changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
-      if ( mStatistics & QgsZonalStatistics::Range )
-        changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
+      else
       {
-        QList<int> vals = featureStats.valueCount.values();
-        qSort( vals.begin(), vals.end() );
-        if ( mStatistics & QgsZonalStatistics::Minority )
-        {
-          float minorityKey = featureStats.valueCount.key( vals.first() );
-          changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
-        }
-        if ( mStatistics & QgsZonalStatistics::Majority )
-        {
-          float majKey = featureStats.valueCount.key( vals.last() );
-          changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
-        }
+        Q_FOREACH ( ZonalStatisticsZone* zone, stripZones )
+          task( zone );
       }
-      if ( mStatistics & QgsZonalStatistics::Variety )
-        changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
     }
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+    //the zones ending in this strip have all their cells, their values are not needed anymore
+    Q_FOREACH ( ZonalStatisticsZone* zone, stripZones )
+    {
+      if ( zone->offsetY + zone->nCellsY <= stripOffsetY + rows )
+      {
+        zonesById.remove( zone->id );
+        output.finishZone( zone );
+        delete zone;
+      }
+    }
+  }
+
+  bool canceled = p && p->wasCanceled();
+
+  if ( !canceled )
+  {
+    Q_FOREACH ( ZonalStatisticsZone* zone, zonesById )
+      output.finishZone( zone );
   }
+  qDeleteAll( zonesById );
 
-  vectorProvider->changeAttributeValues( changeMap );
+  if ( !canceled )
+  {
+    vectorProvider->changeAttributeValues( output.changeMap );
+  }
 
   if ( p )
   {
-    p->setValue( featureCount );
+    p->setValue( p->maximum() );
   }
 
   GDALClose( inputDataset );
   mPolygonLayer->updateFields();
 
-  if ( p && p->wasCanceled() )
+  if ( canceled )
   {
     return 9;
   }
@@ -407,51 +659,34 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle& rasterBBox, const Q
   return 0;
 }
 
-void QgsZonalStatistics::statisticsFromMiddlePointTest( void* band, const QgsGeometry* poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats &stats )
+void QgsZonalStatistics::statisticsFromMiddlePointTest( const GEOSPreparedGeometry* poly, int pixelOffsetX,
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox,
+    const RasterBlock& block, FeatureStats &stats ) const
 {
   double cellCenterX, cellCenterY;
 
-  float* scanLine = ( float * ) CPLMalloc( sizeof( float ) * nCellsX );
   cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  stats.reset();
-
-  const GEOSGeometry* polyGeos = poly->asGeos();
-  if ( !polyGeos )
-  {
-    return;
-  }
 
   GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  const GEOSPreparedGeometry* polyGeosPrepared = GEOSPrepare_r( geosctxt, poly->asGeos() );
-  if ( !polyGeosPrepared )
-  {
-    return;
-  }
-
   GEOSCoordSequence* cellCenterCoords = nullptr;
   GEOSGeometry* currentCellCenter = nullptr;
 
   for ( int i = 0; i < nCellsY; ++i )
   {
-    if ( GDALRasterIO( band, GF_Read, pixelOffsetX, pixelOffsetY + i, nCellsX, 1, scanLine, nCellsX, 1, GDT_Float32, 0, 0 )
-         != CPLE_None )
-    {
-      continue;
-    }
     cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
     for ( int j = 0; j < nCellsX; ++j )
     {
-      if ( validPixel( scanLine[j] ) )
+      float value = block.value( pixelOffsetX + j, pixelOffsetY + i );
+      if ( validPixel( value ) )
       {
         GEOSGeom_destroy_r( geosctxt, currentCellCenter );
         cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
         GEOSCoordSeq_setX_r( geosctxt, cellCenterCoords, 0, cellCenterX );
         GEOSCoordSeq_setY_r( geosctxt, cellCenterCoords, 0, cellCenterY );
         currentCellCenter = GEOSGeom_createPoint_r( geosctxt, cellCenterCoords );
-        if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared, currentCellCenter ) )
+        if ( GEOSPreparedContains_r( geosctxt, poly, currentCellCenter ) )
         {
-          stats.addValue( scanLine[j] );
+          stats.addValue( value );
         }
       }
       cellCenterX += cellSizeX;
@@ -459,17 +694,13 @@ void QgsZonalStatistics::statisticsFromMiddlePointTest( void* band, const QgsGeo
     cellCenterY -= cellSizeY;
   }
   GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-  CPLFree( scanLine );
-  GEOSPreparedGeom_destroy_r( geosctxt, polyGeosPrepared );
 }
 
-void QgsZonalStatistics::statisticsFromPreciseIntersection( void* band, const QgsGeometry* poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats &stats )
+void QgsZonalStatistics::statisticsFromPreciseIntersection( const QgsGeometry* poly, int pixelOffsetX,
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox,
+    const RasterBlock& block, FeatureStats &stats ) const
 {
-  stats.reset();
-
   double currentY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  float* pixelData = ( float * ) CPLMalloc( sizeof( float ) );
   QgsGeometry* pixelRectGeometry = nullptr;
 
   double hCellSizeX = cellSizeX / 2.0;
@@ -480,14 +711,10 @@ void QgsZonalStatistics::statisticsFromPreciseIntersection( void* band, const Qg
   for ( int row = 0; row < nCellsY; ++row )
   {
     double currentX = rasterBBox.xMinimum() + cellSizeX / 2.0 + pixelOffsetX * cellSizeX;
-    for ( int col = 0; col < nCellsX; ++col )
+    for ( int col = 0; col < nCellsX; ++col, currentX += cellSizeX )
     {
-      if ( GDALRasterIO( band, GF_Read, pixelOffsetX + col, pixelOffsetY + row, nCellsX, 1, pixelData, 1, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
-
-      if ( !validPixel( *pixelData ) )
+      float value = block.value( pixelOffsetX + col, pixelOffsetY + row );
+      if ( !validPixel( value ) )
         continue;
 
       pixelRectGeometry = QgsGeometry::fromRect( QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
@@ -501,18 +728,16 @@ void QgsZonalStatistics::statisticsFromPreciseIntersection( void* band, const Qg
           if ( intersectionArea >= 0.0 )
           {
             weight = intersectionArea / pixelArea;
-            stats.addValue( *pixelData, weight );
+            stats.addValue( value, weight );
           }
           delete intersectGeometry;
         }
         delete pixelRectGeometry;
         pixelRectGeometry = nullptr;
       }
-      currentX += cellSizeX;
     }
     currentY -= cellSizeY;
   }
-  CPLFree( pixelData );
 }
 
 bool QgsZonalStatistics::validPixel( float value ) const
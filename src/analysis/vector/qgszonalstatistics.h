@@ -19,13 +19,20 @@
 #define QGSZONALSTATISTICS_H
 
 #include "qgsrectangle.h"
+#include <QMap>
 #include <QString>
 
+#include <geos_c.h>
+
 class QgsGeometry;
 class QgsVectorLayer;
 class QProgressDialog;
 
-/** A class that calculates raster statistics (count, sum, mean) for a polygon or multipolygon layer and appends the results as attributes*/
+/** A class that calculates raster statistics (count, sum, mean) for a polygon or multipolygon layer and appends the results as attributes.
+  The raster is read once by strips of rows, the polygons overlapping a strip are found with a spatial index and processed in parallel.
+  The statistics of a polygon are written as soon as the strips have passed it.
+  A cell belongs to a polygon if its center is inside the polygon. Cells are only weighted by the fraction of their area covered
+  by the polygon for polygons which contain at most one cell center.*/
 class ANALYSIS_EXPORT QgsZonalStatistics
 {
   public:
@@ -58,6 +65,10 @@ class ANALYSIS_EXPORT QgsZonalStatistics
   private:
     QgsZonalStatistics();
 
+    friend struct ZonalStatisticsZone;
+    friend class ZonalStatisticsZoneTask;
+    friend class ZonalStatisticsOutput;
+
     class FeatureStats
     {
       public:
@@ -91,26 +102,46 @@ class ANALYSIS_EXPORT QgsZonalStatistics
         double count;
         float max;
         float min;
-        QMap< float, int > valueCount;
-        QList< float > values;
+        //! number of cells by value, for minority, majority and variety
+        QMap< double, int > valueCount;
+        //! values for the median and the standard deviation computed by QgsStatisticalSummary
+        QList< double > values;
 
       private:
         bool mStoreValues;
         bool mStoreValueCounts;
     };
 
+    /** Cells of the raster read at once*/
+    struct RasterBlock
+    {
+      //! values of the cells, width values per row
+      const float* data;
+      //! column of the first cell
+      int offsetX;
+      //! row of the first cell
+      int offsetY;
+      int width;
+
+      float value( int column, int row ) const { return data[( row - offsetY ) * width + column - offsetX]; }
+    };
+
     /** Analysis what cells need to be considered to cover the bounding box of a feature
       @return 0 in case of success*/
     int cellInfoForBBox( const QgsRectangle& rasterBBox, const QgsRectangle& featureBBox, double cellSizeX, double cellSizeY,
                          int& offsetX, int& offsetY, int& nCellsX, int& nCellsY ) const;
 
-    /** Returns statistics by considering the pixels where the center point is within the polygon (fast)*/
-    void statisticsFromMiddlePointTest( void* band, const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats& stats );
-
-    /** Returns statistics with precise pixel - polygon intersection test (slow) */
-    void statisticsFromPreciseIntersection( void* band, const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                            double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats& stats );
+    /** Adds to the statistics the pixels where the center point is within the polygon (fast). The cells are taken from a
+      block, which must contain the nCellsX x nCellsY cells starting at pixelOffsetX / pixelOffsetY*/
+    void statisticsFromMiddlePointTest( const GEOSPreparedGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
+                                        double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, const RasterBlock& block,
+                                        FeatureStats& stats ) const;
+
+    /** Adds to the statistics the pixels weighted by their precise intersection with the polygon (slow). The cells are
+      taken from a block, which must contain the nCellsX x nCellsY cells starting at pixelOffsetX / pixelOffsetY*/
+    void statisticsFromPreciseIntersection( const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
+                                            double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, const RasterBlock& block,
+                                            FeatureStats& stats ) const;
 
     /** Tests whether a pixel's value should be included in the result*/
     bool validPixel( float value ) const;
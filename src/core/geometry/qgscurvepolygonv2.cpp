@@ -558,8 +558,37 @@ void QgsCurvePolygonV2::draw( QPainter& p ) const
   }
 }
 
+bool QgsCurvePolygonV2::linearRings( QList<QgsLineStringV2*>& rings ) const
+{
+  if ( mExteriorRing && QgsWKBTypes::flatType( mExteriorRing->wkbType() ) != QgsWKBTypes::LineString )
+    return false;
+
+  Q_FOREACH ( const QgsCurveV2* curve, mInteriorRings )
+  {
+    if ( QgsWKBTypes::flatType( curve->wkbType() ) != QgsWKBTypes::LineString )
+      return false;
+  }
+
+  if ( mExteriorRing )
+    rings << static_cast< QgsLineStringV2* >( mExteriorRing );
+  Q_FOREACH ( QgsCurveV2* curve, mInteriorRings )
+  {
+    rings << static_cast< QgsLineStringV2* >( curve );
+  }
+  return true;
+}
+
 void QgsCurvePolygonV2::transform( const QgsCoordinateTransform& ct, QgsCoordinateTransform::TransformDirection d )
 {
+  // all the rings at once when possible
+  QList<QgsLineStringV2*> rings;
+  if ( linearRings( rings ) )
+  {
+    QgsLineStringV2::transformLines( rings, ct, d );
+    clearCache();
+    return;
+  }
+
   if ( mExteriorRing )
   {
     mExteriorRing->transform( ct, d );
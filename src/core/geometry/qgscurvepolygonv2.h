@@ -20,6 +20,7 @@
 
 #include "qgssurfacev2.h"
 
+class QgsLineStringV2;
 class QgsPolygonV2;
 
 /** \ingroup core
@@ -119,6 +120,16 @@ class CORE_EXPORT QgsCurvePolygonV2: public QgsSurfaceV2
     QList<QgsCurveV2*> mInteriorRings;
 
     virtual QgsRectangle calculateBoundingBox() const override;
+
+  private:
+
+    /** Appends the rings to a list of line strings if all of them are line strings, so that
+     * the vertices of several polygons can be transformed at once.
+     * @returns false if a ring is not a line string, the list is then unchanged
+     */
+    bool linearRings( QList<QgsLineStringV2*>& rings ) const;
+
+    friend class QgsGeometryCollectionV2;
 };
 
 #endif // QGSCURVEPOLYGONV2_H
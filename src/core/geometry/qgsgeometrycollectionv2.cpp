@@ -19,6 +19,7 @@ email                : marco.hugentobler at sourcepole dot com
 #include "qgsgeometryutils.h"
 #include "qgscircularstringv2.h"
 #include "qgscompoundcurvev2.h"
+#include "qgscurvepolygonv2.h"
 #include "qgslinestringv2.h"
 #include "qgsmultilinestringv2.h"
 #include "qgspointv2.h"
@@ -145,10 +146,67 @@ int QgsGeometryCollectionV2::dimension() const
 
 void QgsGeometryCollectionV2::transform( const QgsCoordinateTransform& ct, QgsCoordinateTransform::TransformDirection d )
 {
+  // the vertices of the linear parts and of the points are transformed at once,
+  // the other parts in turn
+  QList<QgsLineStringV2*> lines;
+  QList<QgsCurvePolygonV2*> polygons;
+  QList<QgsPointV2*> points;
   Q_FOREACH ( QgsAbstractGeometryV2* g, mGeometries )
   {
-    g->transform( ct, d );
+    QgsWKBTypes::Type type = QgsWKBTypes::flatType( g->wkbType() );
+    if ( type == QgsWKBTypes::Point )
+    {
+      points << static_cast< QgsPointV2* >( g );
+    }
+    else if ( type == QgsWKBTypes::LineString )
+    {
+      lines << static_cast< QgsLineStringV2* >( g );
+    }
+    else if (( type == QgsWKBTypes::Polygon || type == QgsWKBTypes::CurvePolygon )
+             && static_cast< QgsCurvePolygonV2* >( g )->linearRings( lines ) )
+    {
+      polygons << static_cast< QgsCurvePolygonV2* >( g );
+    }
+    else
+    {
+      g->transform( ct, d );
+    }
+  }
+
+  QgsLineStringV2::transformLines( lines, ct, d );
+  Q_FOREACH ( QgsCurvePolygonV2* polygon, polygons )
+  {
+    polygon->clearCache();
   }
+
+  if ( points.size() > 1 && !ct.isShortCircuited() && ct.isInitialised() )
+  {
+    int nPoints = points.size();
+    QVector<double> x( nPoints );
+    QVector<double> y( nPoints );
+    QVector<double> z( nPoints );
+    for ( int i = 0; i < nPoints; ++i )
+    {
+      x[i] = points.at( i )->x();
+      y[i] = points.at( i )->y();
+      z[i] = points.at( i )->z();
+    }
+
+    ct.transformCoords( nPoints, x.data(), y.data(), z.data(), d );
+
+    for ( int i = 0; i < nPoints; ++i )
+    {
+      QgsPointV2* point = points.at( i );
+      point->setX( x.at( i ) );
+      point->setY( y.at( i ) );
+      point->setZ( z.at( i ) );
+    }
+  }
+  else if ( points.size() == 1 )
+  {
+    points.at( 0 )->transform( ct, d );
+  }
+
   clearCache(); //set bounding box invalid
 }
 
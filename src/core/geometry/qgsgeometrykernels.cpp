@@ -0,0 +1,263 @@
+/***************************************************************************
+                         qgsgeometrykernels.cpp
+                         ----------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgeometrykernels.h"
+
+#include <QPointF>
+#include <QTransform>
+
+#include <cmath>
+#include <limits>
+
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) ) && !defined( QT_COORD_TYPE )
+#define QGS_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+/// @cond PRIVATE
+
+void QgsGeometryKernels::boundingBox( const double* x, const double* y, int count, double& xMin, double& yMin, double& xMax, double& yMax )
+{
+  xMin = std::numeric_limits<double>::max();
+  yMin = std::numeric_limits<double>::max();
+  xMax = -std::numeric_limits<double>::max();
+  yMax = -std::numeric_limits<double>::max();
+
+  int i = 0;
+#ifdef QGS_KERNELS_SSE2
+  if ( count >= 4 )
+  {
+    // min/max return their second operand if the first one is NaN, like the comparisons below
+    __m128d vxMin = _mm_set1_pd( xMin ), vyMin = _mm_set1_pd( yMin );
+    __m128d vxMax = _mm_set1_pd( xMax ), vyMax = _mm_set1_pd( yMax );
+    for ( ; i + 2 <= count; i += 2 )
+    {
+      __m128d vx = _mm_loadu_pd( x + i );
+      __m128d vy = _mm_loadu_pd( y + i );
+      vxMin = _mm_min_pd( vx, vxMin );
+      vxMax = _mm_max_pd( vx, vxMax );
+      vyMin = _mm_min_pd( vy, vyMin );
+      vyMax = _mm_max_pd( vy, vyMax );
+    }
+    double lanes[2];
+    _mm_storeu_pd( lanes, vxMin );
+    xMin = qMin( lanes[0], lanes[1] );
+    _mm_storeu_pd( lanes, vxMax );
+    xMax = qMax( lanes[0], lanes[1] );
+    _mm_storeu_pd( lanes, vyMin );
+    yMin = qMin( lanes[0], lanes[1] );
+    _mm_storeu_pd( lanes, vyMax );
+    yMax = qMax( lanes[0], lanes[1] );
+  }
+#endif
+  for ( ; i < count; ++i )
+  {
+    if ( x[i] < xMin )
+      xMin = x[i];
+    if ( x[i] > xMax )
+      xMax = x[i];
+    if ( y[i] < yMin )
+      yMin = y[i];
+    if ( y[i] > yMax )
+      yMax = y[i];
+  }
+}
+
+void QgsGeometryKernels::transform( double* x, double* y, int count, const QTransform& t )
+{
+  const double m11 = t.m11(), m12 = t.m12(), m21 = t.m21(), m22 = t.m22(), dx = t.dx(), dy = t.dy();
+
+  // same operations as QTransform::map() for each kind of transform
+  int i = 0;
+  switch ( t.type() )
+  {
+    case QTransform::TxNone:
+      return;
+
+    case QTransform::TxTranslate:
+#ifdef QGS_KERNELS_SSE2
+      for ( ; i + 2 <= count; i += 2 )
+      {
+        _mm_storeu_pd( x + i, _mm_add_pd( _mm_loadu_pd( x + i ), _mm_set1_pd( dx ) ) );
+        _mm_storeu_pd( y + i, _mm_add_pd( _mm_loadu_pd( y + i ), _mm_set1_pd( dy ) ) );
+      }
+#endif
+      for ( ; i < count; ++i )
+      {
+        x[i] += dx;
+        y[i] += dy;
+      }
+      return;
+
+    case QTransform::TxScale:
+#ifdef QGS_KERNELS_SSE2
+      for ( ; i + 2 <= count; i += 2 )
+      {
+        _mm_storeu_pd( x + i, _mm_add_pd( _mm_mul_pd( _mm_loadu_pd( x + i ), _mm_set1_pd( m11 ) ), _mm_set1_pd( dx ) ) );
+        _mm_storeu_pd( y + i, _mm_add_pd( _mm_mul_pd( _mm_loadu_pd( y + i ), _mm_set1_pd( m22 ) ), _mm_set1_pd( dy ) ) );
+      }
+#endif
+      for ( ; i < count; ++i )
+      {
+        x[i] = m11 * x[i] + dx;
+        y[i] = m22 * y[i] + dy;
+      }
+      return;
+
+    case QTransform::TxRotate:
+    case QTransform::TxShear:
+#ifdef QGS_KERNELS_SSE2
+      for ( ; i + 2 <= count; i += 2 )
+      {
+        __m128d vx = _mm_loadu_pd( x + i );
+        __m128d vy = _mm_loadu_pd( y + i );
+        __m128d nx = _mm_add_pd( _mm_add_pd( _mm_mul_pd( _mm_set1_pd( m11 ), vx ), _mm_mul_pd( _mm_set1_pd( m21 ), vy ) ), _mm_set1_pd( dx ) );
+        __m128d ny = _mm_add_pd( _mm_add_pd( _mm_mul_pd( _mm_set1_pd( m12 ), vx ), _mm_mul_pd( _mm_set1_pd( m22 ), vy ) ), _mm_set1_pd( dy ) );
+        _mm_storeu_pd( x + i, nx );
+        _mm_storeu_pd( y + i, ny );
+      }
+#endif
+      for ( ; i < count; ++i )
+      {
+        double nx = m11 * x[i] + m21 * y[i] + dx;
+        double ny = m12 * x[i] + m22 * y[i] + dy;
+        x[i] = nx;
+        y[i] = ny;
+      }
+      return;
+
+    case QTransform::TxProject:
+      break;
+  }
+
+  for ( ; i < count; ++i )
+  {
+    qreal nx, ny;
+    t.map( x[i], y[i], &nx, &ny );
+    x[i] = nx;
+    y[i] = ny;
+  }
+}
+
+void QgsGeometryKernels::transform( QPointF* points, int count, const QTransform& t )
+{
+#ifdef QGS_KERNELS_SSE2
+  double* p = reinterpret_cast<double*>( points );
+  const __m128d diag = _mm_set_pd( t.m22(), t.m11() );    // ( m11, m22 )
+  const __m128d anti = _mm_set_pd( t.m12(), t.m21() );    // ( m21, m12 )
+  const __m128d offset = _mm_set_pd( t.dy(), t.dx() );    // ( dx, dy )
+
+  switch ( t.type() )
+  {
+    case QTransform::TxNone:
+      return;
+
+    case QTransform::TxTranslate:
+      for ( int i = 0; i < count; ++i, p += 2 )
+        _mm_storeu_pd( p, _mm_add_pd( _mm_loadu_pd( p ), offset ) );
+      return;
+
+    case QTransform::TxScale:
+      for ( int i = 0; i < count; ++i, p += 2 )
+        _mm_storeu_pd( p, _mm_add_pd( _mm_mul_pd( diag, _mm_loadu_pd( p ) ), offset ) );
+      return;
+
+    case QTransform::TxRotate:
+    case QTransform::TxShear:
+      for ( int i = 0; i < count; ++i, p += 2 )
+      {
+        // ( x, y ) -> ( m11 * x + m21 * y + dx, m22 * y + m12 * x + dy )
+        __m128d xy = _mm_loadu_pd( p );
+        __m128d yx = _mm_shuffle_pd( xy, xy, 1 );
+        _mm_storeu_pd( p, _mm_add_pd( _mm_add_pd( _mm_mul_pd( diag, xy ), _mm_mul_pd( anti, yx ) ), offset ) );
+      }
+      return;
+
+    case QTransform::TxProject:
+      break;
+  }
+#endif
+
+  for ( int i = 0; i < count; ++i, ++points )
+  {
+    qreal nx, ny;
+    t.map( points->x(), points->y(), &nx, &ny );
+    points->setX( nx );
+    points->setY( ny );
+  }
+}
+
+void QgsGeometryKernels::interleave( const double* x, const double* y, int count, QPointF* points )
+{
+  int i = 0;
+#ifdef QGS_KERNELS_SSE2
+  double* p = reinterpret_cast<double*>( points );
+  for ( ; i + 2 <= count; i += 2, p += 4 )
+  {
+    __m128d vx = _mm_loadu_pd( x + i );
+    __m128d vy = _mm_loadu_pd( y + i );
+    _mm_storeu_pd( p, _mm_unpacklo_pd( vx, vy ) );
+    _mm_storeu_pd( p + 2, _mm_unpackhi_pd( vx, vy ) );
+  }
+#endif
+  for ( ; i < count; ++i )
+    points[i] = QPointF( x[i], y[i] );
+}
+
+double QgsGeometryKernels::length( const double* x, const double* y, int count )
+{
+  double length = 0;
+  int i = 1;
+#ifdef QGS_KERNELS_SSE2
+  double segments[2];
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    __m128d dx = _mm_sub_pd( _mm_loadu_pd( x + i ), _mm_loadu_pd( x + i - 1 ) );
+    __m128d dy = _mm_sub_pd( _mm_loadu_pd( y + i ), _mm_loadu_pd( y + i - 1 ) );
+    _mm_storeu_pd( segments, _mm_sqrt_pd( _mm_add_pd( _mm_mul_pd( dx, dx ), _mm_mul_pd( dy, dy ) ) ) );
+    length += segments[0];
+    length += segments[1];
+  }
+#endif
+  for ( ; i < count; ++i )
+  {
+    double dx = x[i] - x[i - 1];
+    double dy = y[i] - y[i - 1];
+    length += sqrt( dx * dx + dy * dy );
+  }
+  return length;
+}
+
+void QgsGeometryKernels::sumUpArea( const double* x, const double* y, int count, double& sum )
+{
+  int i = 0;
+  int last = count - 1;
+#ifdef QGS_KERNELS_SSE2
+  double terms[2];
+  for ( ; i + 2 <= last; i += 2 )
+  {
+    __m128d cross = _mm_sub_pd( _mm_mul_pd( _mm_loadu_pd( x + i ), _mm_loadu_pd( y + i + 1 ) ),
+                                _mm_mul_pd( _mm_loadu_pd( y + i ), _mm_loadu_pd( x + i + 1 ) ) );
+    _mm_storeu_pd( terms, _mm_mul_pd( _mm_set1_pd( 0.5 ), cross ) );
+    sum += terms[0];
+    sum += terms[1];
+  }
+#endif
+  for ( ; i < last; ++i )
+  {
+    sum += 0.5 * ( x[i] * y[i + 1] - y[i] * x[i + 1] );
+  }
+}
+
+/// @endcond
@@ -0,0 +1,68 @@
+/***************************************************************************
+                         qgsgeometrykernels.h
+                         --------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGEOMETRYKERNELS_H
+#define QGSGEOMETRYKERNELS_H
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+class QPointF;
+class QTransform;
+
+/** \ingroup core
+ * Loops over whole coordinate arrays, either separate x and y arrays (as stored by
+ * QgsLineStringV2) or interleaved points (as in QPolygonF).
+ *
+ * When built for a target with SSE2 the kernels process two coordinates per
+ * instruction, otherwise they fall back to plain loops. Both variants perform the
+ * same floating point operations in the same order as the point by point code they
+ * replace, so the results are identical: sums are still accumulated one term after
+ * the other.
+ * @note added in QGIS 2.16
+ */
+class QgsGeometryKernels
+{
+  public:
+
+    //! Computes the extent of the points, NaN coordinates are ignored. Empty arrays give an inverted extent.
+    static void boundingBox( const double* x, const double* y, int count, double& xMin, double& yMin, double& xMax, double& yMax );
+
+    //! Applies the transform to the points in place, with the same results as QTransform::map()
+    static void transform( double* x, double* y, int count, const QTransform& t );
+
+    //! Applies the transform to the points in place, with the same results as QTransform::map()
+    static void transform( QPointF* points, int count, const QTransform& t );
+
+    //! Interleaves separate coordinate arrays into points
+    static void interleave( const double* x, const double* y, int count, QPointF* points );
+
+    //! Returns the sum of the lengths of the segments of a line
+    static double length( const double* x, const double* y, int count );
+
+    //! Adds the signed area of a ring (shoelace formula) to sum
+    static void sumUpArea( const double* x, const double* y, int count, double& sum );
+};
+
+/// @endcond
+
+#endif // QGSGEOMETRYKERNELS_H
@@ -18,6 +18,7 @@
 #include "qgslinestringv2.h"
 #include "qgsapplication.h"
 #include "qgscoordinatetransform.h"
+#include "qgsgeometrykernels.h"
 #include "qgsgeometryutils.h"
 #include "qgsmaptopixel.h"
 #include "qgswkbptr.h"
@@ -115,25 +116,8 @@ void QgsLineStringV2::fromWkbPoints( QgsWKBTypes::Type type, const QgsConstWkbPt
 
 QgsRectangle QgsLineStringV2::calculateBoundingBox() const
 {
-  double xmin = std::numeric_limits<double>::max();
-  double ymin = std::numeric_limits<double>::max();
-  double xmax = -std::numeric_limits<double>::max();
-  double ymax = -std::numeric_limits<double>::max();
-
-  Q_FOREACH ( double x, mX )
-  {
-    if ( x < xmin )
-      xmin = x;
-    if ( x > xmax )
-      xmax = x;
-  }
-  Q_FOREACH ( double y, mY )
-  {
-    if ( y < ymin )
-      ymin = y;
-    if ( y > ymax )
-      ymax = y;
-  }
+  double xmin, ymin, xmax, ymax;
+  QgsGeometryKernels::boundingBox( mX.constData(), mY.constData(), qMin( mX.size(), mY.size() ), xmin, ymin, xmax, ymax );
   return QgsRectangle( xmin, ymin, xmax, ymax );
 }
 
@@ -234,16 +218,7 @@ QString QgsLineStringV2::asJSON( int precision ) const
 
 double QgsLineStringV2::length() const
 {
-  double length = 0;
-  int size = mX.size();
-  double dx, dy;
-  for ( int i = 1; i < size; ++i )
-  {
-    dx = mX.at( i ) - mX.at( i - 1 );
-    dy = mY.at( i ) - mY.at( i - 1 );
-    length += sqrt( dx * dx + dy * dy );
-  }
-  return length;
+  return QgsGeometryKernels::length( mX.constData(), mY.constData(), mX.size() );
 }
 
 QgsPointV2 QgsLineStringV2::startPoint() const
@@ -575,11 +550,8 @@ void QgsLineStringV2::drawAsPolygon( QPainter& p ) const
 
 QPolygonF QgsLineStringV2::asQPolygonF() const
 {
-  QPolygonF points;
-  for ( int i = 0; i < mX.count(); ++i )
-  {
-    points << QPointF( mX.at( i ), mY.at( i ) );
-  }
+  QPolygonF points( mX.count() );
+  QgsGeometryKernels::interleave( mX.constData(), mY.constData(), mX.count(), points.data() );
   return points;
 }
 
@@ -611,16 +583,55 @@ void QgsLineStringV2::transform( const QgsCoordinateTransform& ct, QgsCoordinate
   clearCache();
 }
 
-void QgsLineStringV2::transform( const QTransform& t )
+void QgsLineStringV2::transformLines( const QList<QgsLineStringV2*>& lines, const QgsCoordinateTransform& ct, QgsCoordinateTransform::TransformDirection d )
 {
-  int nPoints = numPoints();
-  for ( int i = 0; i < nPoints; ++i )
+  if ( lines.size() == 1 )
   {
-    qreal x, y;
-    t.map( mX.at( i ), mY.at( i ), &x, &y );
-    mX[i] = x;
-    mY[i] = y;
+    lines.at( 0 )->transform( ct, d );
+    return;
   }
+  if ( lines.isEmpty() || ct.isShortCircuited() || !ct.isInitialised() )
+    return;
+
+  int nPoints = 0;
+  Q_FOREACH ( const QgsLineStringV2* line, lines )
+  {
+    nPoints += line->numPoints();
+  }
+
+  // gather the vertices of all the lines for a single call to the transform
+  QVector<double> x( nPoints );
+  QVector<double> y( nPoints );
+  QVector<double> z( nPoints, 0.0 );
+  int offset = 0;
+  Q_FOREACH ( const QgsLineStringV2* line, lines )
+  {
+    int n = line->numPoints();
+    memcpy( x.data() + offset, line->mX.constData(), n * sizeof( double ) );
+    memcpy( y.data() + offset, line->mY.constData(), n * sizeof( double ) );
+    if ( line->is3D() )
+      memcpy( z.data() + offset, line->mZ.constData(), n * sizeof( double ) );
+    offset += n;
+  }
+
+  ct.transformCoords( nPoints, x.data(), y.data(), z.data(), d );
+
+  offset = 0;
+  Q_FOREACH ( QgsLineStringV2* line, lines )
+  {
+    int n = line->numPoints();
+    memcpy( line->mX.data(), x.constData() + offset, n * sizeof( double ) );
+    memcpy( line->mY.data(), y.constData() + offset, n * sizeof( double ) );
+    if ( line->is3D() )
+      memcpy( line->mZ.data(), z.constData() + offset, n * sizeof( double ) );
+    offset += n;
+    line->clearCache();
+  }
+}
+
+void QgsLineStringV2::transform( const QTransform& t )
+{
+  QgsGeometryKernels::transform( mX.data(), mY.data(), numPoints(), t );
   clearCache();
 }
 
@@ -838,10 +849,7 @@ void QgsLineStringV2::sumUpArea( double& sum ) const
   if ( maxIndex == 1 )
     return; //no area, just a single line
 
-  for ( int i = 0; i < maxIndex; ++i )
-  {
-    sum += 0.5 * ( mX.at( i ) * mY.at( i + 1 ) - mY.at( i ) * mX.at( i + 1 ) );
-  }
+  QgsGeometryKernels::sumUpArea( mX.constData(), mY.constData(), numPoints(), sum );
 }
 
 void QgsLineStringV2::importVerticesFromWkb( const QgsConstWkbPtr& wkb )
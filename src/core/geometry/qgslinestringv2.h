@@ -163,6 +163,17 @@ class CORE_EXPORT QgsLineStringV2: public QgsCurveV2
     void transform( const QgsCoordinateTransform& ct, QgsCoordinateTransform::TransformDirection d = QgsCoordinateTransform::ForwardTransform ) override;
     void transform( const QTransform& t ) override;
 
+    /** Transforms the vertices of several line strings with a single call to the coordinate
+     * transform, which is faster than transforming each of them in turn.
+     * @param lines line strings to transform
+     * @param ct coordinate transform
+     * @param d transform direction
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    static void transformLines( const QList<QgsLineStringV2*>& lines, const QgsCoordinateTransform& ct,
+                                QgsCoordinateTransform::TransformDirection d = QgsCoordinateTransform::ForwardTransform );
+
     void addToPainterPath( QPainterPath& path ) const override;
     void drawAsPolygon( QPainter& p ) const override;
 
@@ -0,0 +1,336 @@
+/***************************************************************************
+                         qgswkbview.cpp
+                         --------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswkbview.h"
+#include "qgsapplication.h"
+
+#include <QPolygonF>
+
+#include <cstring>
+#include <limits>
+
+static const int HEADER_SIZE = 1 + sizeof( int );
+
+QgsWkbView::QgsWkbView()
+    : mWkb( nullptr )
+    , mSize( 0 )
+    , mType( QgsWKBTypes::Unknown )
+    , mDimensions( 0 )
+{
+}
+
+QgsWkbView::QgsWkbView( const unsigned char* wkb, int size )
+    : mWkb( nullptr )
+    , mSize( 0 )
+    , mType( QgsWKBTypes::Unknown )
+    , mDimensions( 0 )
+{
+  int geometrySize = wkb ? measure( wkb, size, &mOffsets ) : -1;
+  if ( geometrySize < 0 )
+  {
+    mOffsets.clear();
+    return;
+  }
+
+  mWkb = wkb;
+  mSize = geometrySize;
+  mType = static_cast<QgsWKBTypes::Type>( readInt( wkb + 1 ) );
+  mDimensions = QgsWKBTypes::coordDimensions( mType );
+}
+
+int QgsWkbView::readInt( const unsigned char* p )
+{
+  int value;
+  memcpy( &value, p, sizeof( int ) );
+  return value;
+}
+
+int QgsWkbView::measure( const unsigned char* wkb, int size, QVector<int>* offsets )
+{
+  if ( size < HEADER_SIZE || wkb[0] != QgsApplication::endian() )
+    return -1;
+
+  QgsWKBTypes::Type type = static_cast<QgsWKBTypes::Type>( readInt( wkb + 1 ) );
+  qint64 pointSize = QgsWKBTypes::coordDimensions( type ) * sizeof( double );
+  qint64 pos = HEADER_SIZE;
+
+  QgsWKBTypes::Type flatType = QgsWKBTypes::flatType( type );
+  switch ( flatType )
+  {
+    case QgsWKBTypes::Point:
+      pos += pointSize;
+      break;
+
+    case QgsWKBTypes::LineString:
+    case QgsWKBTypes::Polygon:
+    {
+      int rings = 1;
+      if ( flatType == QgsWKBTypes::Polygon )
+      {
+        if ( pos + 4 > size )
+          return -1;
+        rings = readInt( wkb + pos );
+        pos += 4;
+        if ( rings < 0 )
+          return -1;
+        if ( offsets )
+          offsets->reserve( rings );
+      }
+
+      for ( int i = 0; i < rings; ++i )
+      {
+        if ( pos + 4 > size )
+          return -1;
+        if ( offsets && flatType == QgsWKBTypes::Polygon )
+          offsets->append( static_cast<int>( pos ) );
+        int points = readInt( wkb + pos );
+        if ( points < 0 )
+          return -1;
+        pos += 4 + points * pointSize;
+        if ( pos > size )
+          return -1;
+      }
+      break;
+    }
+
+    case QgsWKBTypes::MultiPoint:
+    case QgsWKBTypes::MultiLineString:
+    case QgsWKBTypes::MultiPolygon:
+    case QgsWKBTypes::GeometryCollection:
+    {
+      if ( pos + 4 > size )
+        return -1;
+      int parts = readInt( wkb + pos );
+      pos += 4;
+      if ( parts < 0 )
+        return -1;
+      if ( offsets )
+        offsets->reserve( parts );
+
+      for ( int i = 0; i < parts; ++i )
+      {
+        if ( pos + HEADER_SIZE > size )
+          return -1;
+        QgsWKBTypes::Type partType = QgsWKBTypes::flatType( static_cast<QgsWKBTypes::Type>( readInt( wkb + pos + 1 ) ) );
+        bool supported = flatType == QgsWKBTypes::GeometryCollection
+                         ? partType == QgsWKBTypes::Point || partType == QgsWKBTypes::LineString || partType == QgsWKBTypes::Polygon
+                         : partType == QgsWKBTypes::singleType( flatType );
+        if ( !supported )
+          return -1;
+
+        int partSize = measure( wkb + pos, static_cast<int>( size - pos ), nullptr );
+        if ( partSize < 0 )
+          return -1;
+        if ( offsets )
+          offsets->append( static_cast<int>( pos ) );
+        pos += partSize;
+      }
+      break;
+    }
+
+    default:
+      return -1;
+  }
+
+  if ( pos > size )
+    return -1;
+
+  return static_cast<int>( pos );
+}
+
+int QgsWkbView::partCount() const
+{
+  if ( !mWkb )
+    return 0;
+
+  return QgsWKBTypes::isMultiType( mType ) ? mOffsets.count() : 1;
+}
+
+QgsWkbView QgsWkbView::part( int index ) const
+{
+  if ( !mWkb )
+    return QgsWkbView();
+
+  if ( !QgsWKBTypes::isMultiType( mType ) )
+    return index == 0 ? *this : QgsWkbView();
+
+  if ( index < 0 || index >= mOffsets.count() )
+    return QgsWkbView();
+
+  return QgsWkbView( mWkb + mOffsets.at( index ), mSize - mOffsets.at( index ) );
+}
+
+int QgsWkbView::ringCount() const
+{
+  switch ( QgsWKBTypes::flatType( mType ) )
+  {
+    case QgsWKBTypes::LineString:
+      return 1;
+    case QgsWKBTypes::Polygon:
+      return mOffsets.count();
+    default:
+      return 0;
+  }
+}
+
+const unsigned char* QgsWkbView::ringStart( int ring ) const
+{
+  switch ( QgsWKBTypes::flatType( mType ) )
+  {
+    case QgsWKBTypes::LineString:
+      return ring == 0 ? mWkb + HEADER_SIZE : nullptr;
+    case QgsWKBTypes::Polygon:
+      return ring >= 0 && ring < mOffsets.count() ? mWkb + mOffsets.at( ring ) : nullptr;
+    default:
+      return nullptr;
+  }
+}
+
+int QgsWkbView::pointCount( int ring ) const
+{
+  if ( QgsWKBTypes::flatType( mType ) == QgsWKBTypes::Point )
+    return ring == 0 ? 1 : 0;
+
+  const unsigned char* start = ringStart( ring );
+  return start ? readInt( start ) : 0;
+}
+
+QgsPointV2 QgsWkbView::point( int index, int ring ) const
+{
+  if ( index < 0 || index >= pointCount( ring ) )
+    return QgsPointV2();
+
+  const unsigned char* p;
+  if ( QgsWKBTypes::flatType( mType ) == QgsWKBTypes::Point )
+    p = mWkb + HEADER_SIZE;
+  else
+    p = ringStart( ring ) + sizeof( int ) + index * mDimensions * sizeof( double );
+
+  double coords[4] = { 0, 0, 0, 0 };
+  memcpy( coords, p, mDimensions * sizeof( double ) );
+
+  bool hasZ = QgsWKBTypes::hasZ( mType );
+  bool hasM = QgsWKBTypes::hasM( mType );
+  QgsWKBTypes::Type pointType = QgsWKBTypes::Point;
+  if ( mType == QgsWKBTypes::Point25D || mType == QgsWKBTypes::LineString25D || mType == QgsWKBTypes::Polygon25D )
+    pointType = QgsWKBTypes::Point25D;
+  else if ( hasZ && hasM )
+    pointType = QgsWKBTypes::PointZM;
+  else if ( hasZ )
+    pointType = QgsWKBTypes::PointZ;
+  else if ( hasM )
+    pointType = QgsWKBTypes::PointM;
+
+  return QgsPointV2( pointType, coords[0], coords[1], hasZ ? coords[2] : 0.0, hasM ? coords[hasZ ? 3 : 2] : 0.0 );
+}
+
+void QgsWkbView::ringPoints( int ring, QPolygonF& points ) const
+{
+  int count = pointCount( ring );
+  points.resize( count );
+  if ( count == 0 )
+    return;
+
+  const unsigned char* p;
+  if ( QgsWKBTypes::flatType( mType ) == QgsWKBTypes::Point )
+    p = mWkb + HEADER_SIZE;
+  else
+    p = ringStart( ring ) + sizeof( int );
+
+  QPointF* out = points.data();
+  int stride = mDimensions * sizeof( double );
+  for ( int i = 0; i < count; ++i, p += stride, ++out )
+  {
+    double xy[2];
+    memcpy( xy, p, sizeof( xy ) );
+    out->setX( xy[0] );
+    out->setY( xy[1] );
+  }
+}
+
+int QgsWkbView::vertexCount() const
+{
+  if ( QgsWKBTypes::isMultiType( mType ) )
+  {
+    int count = 0;
+    for ( int i = 0; i < mOffsets.count(); ++i )
+      count += part( i ).vertexCount();
+    return count;
+  }
+
+  if ( QgsWKBTypes::flatType( mType ) == QgsWKBTypes::Point )
+    return 1;
+
+  int count = 0;
+  for ( int i = 0; i < ringCount(); ++i )
+    count += pointCount( i );
+  return count;
+}
+
+QgsRectangle QgsWkbView::boundingBox() const
+{
+  switch ( QgsWKBTypes::flatType( mType ) )
+  {
+    case QgsWKBTypes::Point:
+    {
+      QgsPointV2 pt = point( 0 );
+      return QgsRectangle( pt.x(), pt.y(), pt.x(), pt.y() );
+    }
+
+    case QgsWKBTypes::LineString:
+    case QgsWKBTypes::Polygon:
+    {
+      // polygons take the extent of their exterior ring
+      if ( ringCount() == 0 )
+        return QgsRectangle();
+
+      double xMin = std::numeric_limits<double>::max();
+      double yMin = std::numeric_limits<double>::max();
+      double xMax = -std::numeric_limits<double>::max();
+      double yMax = -std::numeric_limits<double>::max();
+
+      int count = pointCount( 0 );
+      const unsigned char* p = ringStart( 0 ) + sizeof( int );
+      int stride = mDimensions * sizeof( double );
+      for ( int i = 0; i < count; ++i, p += stride )
+      {
+        double xy[2];
+        memcpy( xy, p, sizeof( xy ) );
+        if ( xy[0] < xMin )
+          xMin = xy[0];
+        if ( xy[0] > xMax )
+          xMax = xy[0];
+        if ( xy[1] < yMin )
+          yMin = xy[1];
+        if ( xy[1] > yMax )
+          yMax = xy[1];
+      }
+      return QgsRectangle( xMin, yMin, xMax, yMax );
+    }
+
+    default:
+      break;
+  }
+
+  if ( mOffsets.isEmpty() )
+    return QgsRectangle();
+
+  QgsRectangle bbox = part( 0 ).boundingBox();
+  for ( int i = 1; i < mOffsets.count(); ++i )
+  {
+    QgsRectangle partBox = part( i ).boundingBox();
+    bbox.combineExtentWith( &partBox );
+  }
+  return bbox;
+}
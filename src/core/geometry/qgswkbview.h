@@ -0,0 +1,110 @@
+/***************************************************************************
+                         qgswkbview.h
+                         ------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSWKBVIEW_H
+#define QGSWKBVIEW_H
+
+#include "qgswkbtypes.h"
+#include "qgspointv2.h"
+#include "qgsrectangle.h"
+
+#include <QVector>
+
+class QPolygonF;
+
+/** \ingroup core
+ * Read-only access to the structure and coordinates of a WKB buffer, without building
+ * QgsAbstractGeometryV2 objects.
+ *
+ * The view is cheap to create: the buffer is checked and the offsets of the parts or
+ * rings are recorded, coordinates are only read when they are accessed. The buffer is
+ * not copied and has to outlive the view.
+ *
+ * Points, line strings, polygons, their multi types and collections of them are
+ * supported, in the byte order of the machine. Other buffers (curved types, swapped
+ * byte order, truncated or inconsistent buffers) give an invalid view, they have to be
+ * handled with QgsGeometryFactory::geomFromWkb().
+ * @note added in QGIS 2.16
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsWkbView
+{
+  public:
+    //! Constructs an invalid view
+    QgsWkbView();
+
+    /** Constructs a view over a WKB buffer
+     * @param wkb start of the geometry
+     * @param size number of bytes available in the buffer, may be more than the size of the geometry
+     */
+    QgsWkbView( const unsigned char* wkb, int size );
+
+    //! Returns whether the buffer holds a supported and consistent geometry
+    bool isValid() const { return nullptr != mWkb; }
+
+    //! Returns whether a view over the buffer would be valid, without recording the offsets of its parts
+    static bool isSupported( const unsigned char* wkb, int size ) { return wkb && measure( wkb, size, nullptr ) >= 0; }
+
+    //! Returns the type of the geometry, QgsWKBTypes::Unknown for an invalid view
+    QgsWKBTypes::Type wkbType() const { return mType; }
+
+    //! Returns the start of the geometry
+    const unsigned char* wkb() const { return mWkb; }
+
+    //! Returns the number of bytes of the geometry
+    int wkbSize() const { return mSize; }
+
+    //! Returns the number of parts of a collection, 1 for other geometries and 0 for an invalid view
+    int partCount() const;
+
+    //! Returns a part of a collection, or the view itself for other geometries and index 0
+    QgsWkbView part( int index ) const;
+
+    //! Returns the number of rings of a polygon, 1 for line strings and 0 for other geometries
+    int ringCount() const;
+
+    //! Returns the number of points of a ring of a polygon, of a line string or of a point
+    int pointCount( int ring = 0 ) const;
+
+    //! Returns a point of a ring of a polygon, of a line string or of a point
+    QgsPointV2 point( int index, int ring = 0 ) const;
+
+    //! Copies the x and y coordinates of a ring of a polygon, of a line string or of a point to points
+    void ringPoints( int ring, QPolygonF& points ) const;
+
+    //! Returns the total number of points of the geometry
+    int vertexCount() const;
+
+    //! Returns the same bounding box as QgsAbstractGeometryV2::boundingBox() for the geometry
+    QgsRectangle boundingBox() const;
+
+  private:
+    //! Returns the size of the geometry at wkb, or -1 if it is not supported, records the offsets of its parts or rings
+    static int measure( const unsigned char* wkb, int size, QVector<int>* offsets );
+
+    //! Returns the start of the point count of a ring
+    const unsigned char* ringStart( int ring ) const;
+
+    static int readInt( const unsigned char* p );
+
+    const unsigned char* mWkb;
+    int mSize;
+    QgsWKBTypes::Type mType;
+    int mDimensions;
+
+    //! offsets of the parts of collections or of the rings of polygons
+    QVector<int> mOffsets;
+};
+
+#endif // QGSWKBVIEW_H
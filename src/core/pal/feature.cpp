@@ -38,7 +38,6 @@
 #include "qgis.h"
 #include "qgsgeos.h"
 #include "qgsmessagelog.h"
-#include "costcalculator.h"
 #include <QLinkedList>
 #include <cmath>
 #include <cfloat>
@@ -1286,17 +1285,8 @@ int FeaturePart::createCandidatesForPolygon( QList< LabelPosition*>& lPos, Point
   return nbp;
 }
 
-int FeaturePart::createCandidates( QList< LabelPosition*>& lPos,
-                                   double bboxMin[2], double bboxMax[2],
-                                   PointSet *mapShape, RTree<LabelPosition*, double, 2, double>* candidates )
+int FeaturePart::createCandidates( QList< LabelPosition*>& lPos, PointSet *mapShape )
 {
-  double bbox[4];
-
-  bbox[0] = bboxMin[0];
-  bbox[1] = bboxMin[1];
-  bbox[2] = bboxMax[0];
-  bbox[3] = bboxMax[1];
-
   double angle = mLF->hasFixedAngle() ? mLF->fixedAngle() : 0.0;
 
   if ( mLF->hasFixedPosition() )
@@ -1344,6 +1334,18 @@ int FeaturePart::createCandidates( QList< LabelPosition*>& lPos,
     }
   }
 
+  return lPos.count();
+}
+
+int FeaturePart::removeCandidatesOutside( QList< LabelPosition*>& lPos, double bboxMin[2], double bboxMax[2] ) const
+{
+  double bbox[4];
+
+  bbox[0] = bboxMin[0];
+  bbox[1] = bboxMin[1];
+  bbox[2] = bboxMax[0];
+  bbox[3] = bboxMax[1];
+
   // purge candidates that are outside the bbox
 
   QMutableListIterator< LabelPosition*> i( lPos );
@@ -1360,16 +1362,51 @@ int FeaturePart::createCandidates( QList< LabelPosition*>& lPos,
       i.remove();
       delete pos;
     }
-    else   // this one is OK
-    {
-      pos->insertIntoIndex( candidates );
-    }
   }
 
-  qSort( lPos.begin(), lPos.end(), CostCalculator::candidateSortGrow );
   return lPos.count();
 }
 
+static uint hashDoubles( const double* values, int count, uint seed )
+{
+  return seed * 31 + qHash( QByteArray::fromRawData( reinterpret_cast< const char* >( values ), count * sizeof( double ) ) );
+}
+
+uint FeaturePart::geometryHash() const
+{
+  uint hash = type * 31 + nbPoints;
+  hash = hashDoubles( x, nbPoints, hash );
+  hash = hashDoubles( y, nbPoints, hash );
+
+  // polygon candidates must not lie over the holes
+  Q_FOREACH ( const FeaturePart* hole, mHoles )
+    hash = hash * 31 + hole->geometryHash();
+
+  return hash;
+}
+
+uint FeaturePart::candidatesSettingsHash() const
+{
+  const QgsLabelFeature::VisualMargin& margin = mLF->visualMargin();
+  const double values[] =
+  {
+    mLF->size().width(), mLF->size().height(),
+    mLF->hasFixedPosition(), mLF->fixedPosition().x(), mLF->fixedPosition().y(),
+    mLF->hasFixedAngle(), mLF->fixedAngle(),
+    mLF->hasFixedQuadrant(), mLF->quadOffset().x(), mLF->quadOffset().y(),
+    mLF->positionOffset().x(), mLF->positionOffset().y(),
+    static_cast< double >( mLF->offsetType() ), mLF->distLabel(), mLF->repeatDistance(),
+    margin.left, margin.right, margin.top, margin.bottom,
+    mLF->symbolSize().width(), mLF->symbolSize().height()
+  };
+
+  uint hash = hashDoubles( values, sizeof( values ) / sizeof( double ), qHash( mLF->labelText() ) );
+  Q_FOREACH ( QgsPalLayerSettings::PredefinedPointPosition position, mLF->predefinedPositionOrder() )
+    hash = hash * 31 + position;
+
+  return hash;
+}
+
 void FeaturePart::addSizePenalty( int nbp, QList< LabelPosition* >& lPos, double bbx[4], double bby[4] )
 {
   if ( !mGeos )
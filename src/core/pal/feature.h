@@ -117,14 +117,38 @@ namespace pal
       QgsFeatureId featureId() const;
 
       /** Generic method to generate label candidates for the feature.
+       * The candidates are left in the order they were generated in: the caller removes
+       * the ones outside of the map extent, inserts them into the candidates index and
+       * sorts them by cost. The method does not touch any shared state, candidates for
+       * several features can be generated in parallel.
        * \param lPos pointer to an array of candidates, will be filled by generated candidates
-       * \param bboxMin min values of the map extent
-       * \param bboxMax max values of the map extent
        * \param mapShape generate candidates for this spatial entity
-       * \param candidates index for candidates
        * \return the number of candidates generated in lPos
+       * \see removeCandidatesOutside()
+       */
+      int createCandidates( QList<LabelPosition *> &lPos, PointSet *mapShape );
+
+      /** Deletes the candidates which are not inside the map extent, or which do not
+       * intersect it if partial labels are shown.
+       * \param lPos candidates of the feature
+       * \param bboxMin min values of the map extent
+       * \param bboxMax max values of the map extent
+       * \return the number of candidates left in lPos
+       */
+      int removeCandidatesOutside( QList<LabelPosition *> &lPos, double bboxMin[2], double bboxMax[2] ) const;
+
+      /** Returns a hash of the coordinates of the part. Together with the feature id it
+       * identifies the part in the label placement cache.
+       * @note added in QGIS 2.16
+       */
+      uint geometryHash() const;
+
+      /** Returns a hash of the label size and text and of the placement settings of the
+       * feature: candidates only depend on them, on the geometry and on the settings of
+       * the layer.
+       * @note added in QGIS 2.16
        */
-      int createCandidates( QList<LabelPosition *> &lPos, double bboxMin[2], double bboxMax[2], PointSet *mapShape, RTree<LabelPosition*, double, 2, double>* candidates );
+      uint candidatesSettingsHash() const;
 
       /** Generate candidates for point feature, located around a specified point.
        * @param x x coordinate of the point
@@ -245,6 +245,20 @@ bool LabelPosition::isInConflict( LabelPosition *lp )
     return isInConflictMultiPart( lp );
 }
 
+void LabelPosition::createConflictGeometries()
+{
+  GEOSContextHandle_t geosctxt = geosContext();
+  for ( LabelPosition* part = this; part; part = part->nextPart )
+  {
+    if ( !part->mGeos )
+      part->createGeosGeom();
+
+    // GEOS computes the extent of a geometry the first time it is needed
+    GEOSGeometry* envelope = GEOSEnvelope_r( geosctxt, part->mGeos );
+    GEOSGeom_destroy_r( geosctxt, envelope );
+  }
+}
+
 bool LabelPosition::isInConflictSinglePart( LabelPosition* lp )
 {
   if ( !mGeos )
@@ -341,6 +355,12 @@ FeaturePart * LabelPosition::getFeaturePart()
   return feature;
 }
 
+void LabelPosition::setFeaturePart( FeaturePart* feature )
+{
+  for ( LabelPosition* part = this; part; part = part->nextPart )
+    part->feature = feature;
+}
+
 void LabelPosition::getBoundingBox( double amin[2], double amax[2] ) const
 {
   if ( nextPart )
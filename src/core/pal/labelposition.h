@@ -123,6 +123,12 @@ namespace pal
        */
       bool isInConflict( LabelPosition *ls );
 
+      /** Creates the GEOS geometries of the position and of its parts ahead of the conflict
+       * tests. Conflict tests running in other threads then only read them.
+       * @note added in QGIS 2.16
+       */
+      void createConflictGeometries();
+
       /** Return bounding box - amin: xmin,ymin - amax: xmax,ymax */
       void getBoundingBox( double amin[2], double amax[2] ) const;
 
@@ -158,6 +164,12 @@ namespace pal
        */
       FeaturePart * getFeaturePart();
 
+      /** Sets the feature of the position and of its parts, for positions copied from
+       * another labeling run.
+       * @note added in QGIS 2.16
+       */
+      void setFeaturePart( FeaturePart* feature );
+
       int getNumOverlaps() const { return nbOverlap; }
       void resetNumOverlaps() { nbOverlap = 0; } // called from problem.cpp, pal.cpp
 
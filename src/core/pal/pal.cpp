@@ -28,6 +28,8 @@
  */
 
 #include "qgsgeometry.h"
+#include "qgslabelingenginev2.h"
+#include "qgslabelplacementcache.h"
 #include "pal.h"
 #include "layer.h"
 #include "palexception.h"
@@ -42,6 +44,8 @@
 #include "internalexception.h"
 #include "util.h"
 #include <cfloat>
+#include <QtConcurrentMap>
+#include <QSet>
 
 using namespace pal;
 
@@ -58,6 +62,9 @@ Pal::Pal()
   fnIsCancelled = nullptr;
   fnIsCancelledContext = nullptr;
 
+  mPlacementCache = nullptr;
+  mPlacementCacheScale = 0;
+
   ejChainDeg = 50;
   tenure = 10;
   candListSize = 0.2;
@@ -120,12 +127,8 @@ Layer* Pal::addLayer( QgsAbstractLabelProvider* provider, const QString& layerNa
 
 typedef struct _featCbackCtx
 {
-  Layer *layer;
-  QLinkedList<Feats*>* fFeats;
+  QList<FeaturePart*>* parts;
   RTree<FeaturePart*, double, 2, double> *obstacles;
-  RTree<LabelPosition*, double, 2, double> *candidates;
-  double bbox_min[2];
-  double bbox_max[2];
 } FeatCallBackCtx;
 
 
@@ -152,27 +155,121 @@ bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
     }
   }
 
-  // generate candidates for the feature part
-  QList< LabelPosition* > lPos;
-  if ( ft_ptr->createCandidates( lPos, context->bbox_min, context->bbox_max, ft_ptr, context->candidates ) )
-  {
-    // valid features are added to fFeats
-    Feats *ft = new Feats();
-    ft->feature = ft_ptr;
-    ft->shape = nullptr;
-    ft->lPos = lPos;
-    ft->priority = ft_ptr->calculatePriority();
-    context->fFeats->append( ft );
-  }
-  else
-  {
-    // Others are deleted
-    qDeleteAll( lPos );
-  }
+  // candidates are generated later, for all the parts of the layer at once
+  context->parts->append( ft_ptr );
 
   return true;
 }
 
+/*
+ * A feature part and its candidates
+ */
+typedef struct _partCandidates
+{
+  FeaturePart *part;
+  // identification of the part in the placement cache
+  uint geometryHash;
+  uint settingsHash;
+  // whether the candidates were taken from the placement cache
+  bool cached;
+  // candidates as generated, to be stored in the placement cache
+  QList<LabelPosition*> cache;
+  // candidates in the order they were generated (or cached)
+  QList<LabelPosition*> positions;
+  // candidate placed by the previous run, NULL if none
+  LabelPosition* preferred;
+  // candidates sorted by cost, NULL if there are none
+  Feats* feats;
+} PartCandidates;
+
+/*
+ * Feature parts of a layer and the candidates generated for them
+ */
+typedef struct _layerCandidates
+{
+  Layer *layer;
+  QList<PartCandidates> parts;
+  int obstacleCount;
+} LayerCandidates;
+
+/*
+ * Generates the candidates of the parts of a layer. Runs concurrently for
+ * several layers: only the feature parts of the layer are touched, the
+ * candidates are inserted into the problem's index afterwards.
+ */
+class CandidatesGenerator
+{
+  public:
+    typedef void result_type;
+
+    CandidatesGenerator( Pal* pal, const double bboxMin[2], const double bboxMax[2], bool fillCache )
+        : mPal( pal )
+        , mFillCache( fillCache )
+    {
+      mBboxMin[0] = bboxMin[0];
+      mBboxMin[1] = bboxMin[1];
+      mBboxMax[0] = bboxMax[0];
+      mBboxMax[1] = bboxMax[1];
+    }
+
+    void operator()( LayerCandidates& job )
+    {
+      for ( int i = 0; i < job.parts.count(); ++i )
+      {
+        PartCandidates& part = job.parts[i];
+        FeaturePart* ft_ptr = part.part;
+        QList< LabelPosition* >& lPos = part.positions;
+
+        if ( mPal->isCancelled() )
+        {
+          qDeleteAll( lPos );
+          lPos.clear();
+          part.preferred = nullptr;
+          continue;
+        }
+
+        // generate candidates for the feature part, unless they come from the cache
+        if ( !part.cached )
+        {
+          ft_ptr->createCandidates( lPos, ft_ptr );
+          if ( mFillCache )
+          {
+            Q_FOREACH ( LabelPosition* pos, lPos )
+              part.cache << new LabelPosition( *pos );
+          }
+        }
+
+        if ( ft_ptr->removeCandidatesOutside( lPos, mBboxMin, mBboxMax ) )
+        {
+          if ( part.preferred && !lPos.contains( part.preferred ) )
+            part.preferred = nullptr;
+
+          // valid features are added to fFeats
+          Feats* ft = new Feats();
+          ft->feature = ft_ptr;
+          ft->shape = nullptr;
+          ft->lPos = lPos;
+          ft->priority = ft_ptr->calculatePriority();
+          qSort( ft->lPos.begin(), ft->lPos.end(), CostCalculator::candidateSortGrow );
+          part.feats = ft;
+        }
+        else
+        {
+          // Others are deleted
+          qDeleteAll( lPos );
+          lPos.clear();
+          part.preferred = nullptr;
+        }
+      }
+    }
+
+  private:
+    Pal* mPal;
+    bool mFillCache;
+    double mBboxMin[2];
+    double mBboxMax[2];
+};
+
 typedef struct _obstaclebackCtx
 {
   RTree<FeaturePart*, double, 2, double> *obstacles;
@@ -222,6 +319,92 @@ bool filteringCallback( FeaturePart *featurePart, void *ctx )
   return true;
 }
 
+/*
+ * Key of the candidates of a layer in the placement cache, empty if the
+ * layer can not be cached
+ */
+static QString placementCacheKey( Layer* layer )
+{
+  if ( !layer->provider() )
+    return QString();
+
+  return layer->provider()->layerId() + '/' + layer->provider()->providerId();
+}
+
+/*
+ * Hash of the settings of a layer which the candidates depend on
+ */
+static uint placementSettingsHash( Layer* layer, int pointP, int lineP, int polyP )
+{
+  uint hash = pointP;
+  hash = hash * 31 + lineP;
+  hash = hash * 31 + polyP;
+  hash = hash * 31 + layer->arrangement();
+  hash = hash * 31 + layer->arrangementFlags();
+  hash = hash * 31 + layer->labelMode();
+  hash = hash * 31 + layer->upsidedownLabels();
+  hash = hash * 31 + layer->centroidInside();
+  hash = hash * 31 + layer->fitInPolygonOnly();
+  return hash;
+}
+
+/*
+ * Whether two candidates have the same position and shape
+ */
+static bool samePosition( const LabelPosition* lp1, const LabelPosition* lp2 )
+{
+  return lp1->getX() == lp2->getX() && lp1->getY() == lp2->getY()
+         && lp1->getAlpha() == lp2->getAlpha()
+         && lp1->getWidth() == lp2->getWidth() && lp1->getHeight() == lp2->getHeight()
+         && lp1->getQuadrant() == lp2->getQuadrant()
+         && lp1->getReversed() == lp2->getReversed()
+         && lp1->getUpsideDown() == lp2->getUpsideDown();
+}
+
+void Pal::setPlacementCache( QgsLabelPlacementCache* cache, double scale )
+{
+  mPlacementCache = cache;
+  mPlacementCacheScale = scale;
+}
+
+void Pal::updatePlacementCache( Problem* prob )
+{
+  if ( !mPlacementCache || !prob->sol )
+    return;
+
+  QMutexLocker locker( &mPlacementCache->mMutex );
+  for ( int i = 0; i < prob->nbft; i++ )
+  {
+    if ( prob->featNbLp[i] == 0 )
+      continue;
+
+    FeaturePart* part = prob->mLabelPositions.at( prob->featStartId[i] )->getFeaturePart();
+    QHash<QString, QgsLabelPlacementCache::Layer>::iterator layerIt = mPlacementCache->mLayers.find( placementCacheKey( part->layer() ) );
+    if ( layerIt == mPlacementCache->mLayers.end() )
+      continue;
+
+    QHash<QgsLabelPlacementCache::PartKey, QgsLabelPlacementCache::Part>::iterator it =
+      layerIt.value().parts.find( QgsLabelPlacementCache::PartKey( part->featureId(), part->geometryHash() ) );
+    if ( it == layerIt.value().parts.end() )
+      continue;
+
+    QgsLabelPlacementCache::Part& cachePart = it.value();
+    cachePart.chosen = -1;
+    if ( prob->sol->s[i] == -1 )
+      continue;
+
+    const LabelPosition* lp = prob->mLabelPositions.at( prob->sol->s[i] );
+    for ( int j = 0; j < cachePart.candidates.count(); j++ )
+    {
+      if ( samePosition( lp, cachePart.candidates.at( j ) ) )
+      {
+        cachePart.chosen = j;
+        break;
+      }
+    }
+  }
+}
+
 Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, double phi_max )
 {
   // to store obstacles
@@ -250,14 +433,10 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
   QLinkedList<Feats*> *fFeats = new QLinkedList<Feats*>;
 
+  QList<LayerCandidates> layerCandidates;
+
   FeatCallBackCtx context;
-  context.fFeats = fFeats;
   context.obstacles = obstacles;
-  context.candidates = prob->candidates;
-  context.bbox_min[0] = amin[0];
-  context.bbox_min[1] = amin[1];
-  context.bbox_max[0] = amax[0];
-  context.bbox_max[1] = amax[1];
 
   ObstacleCallBackCtx obstacleContext;
   obstacleContext.obstacles = obstacles;
@@ -265,7 +444,6 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
   // first step : extract features from layers
 
-  int previousFeatureCount = 0;
   int previousObstacleCount = 0;
 
   QStringList layersWithFeaturesInBBox;
@@ -289,22 +467,187 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
     layer->chopFeaturesAtRepeatDistance();
 
+    LayerCandidates job;
+    job.layer = layer;
+
     layer->mMutex.lock();
 
-    // find features within bounding box and generate candidates list
-    context.layer = layer;
+    // find features within bounding box
+    QList<FeaturePart*> parts;
+    context.parts = &parts;
     layer->mFeatureIndex->Search( amin, amax, extractFeatCallback, static_cast< void* >( &context ) );
     // find obstacles within bounding box
     layer->mObstacleIndex->Search( amin, amax, extractObstaclesCallback, static_cast< void* >( &obstacleContext ) );
 
     layer->mMutex.unlock();
 
-    if ( context.fFeats->size() - previousFeatureCount > 0 || obstacleContext.obstacleCount > previousObstacleCount )
+    Q_FOREACH ( FeaturePart* ft_ptr, parts )
     {
-      layersWithFeaturesInBBox << layer->name();
+      PartCandidates part;
+      part.part = ft_ptr;
+      part.geometryHash = 0;
+      part.settingsHash = 0;
+      part.cached = false;
+      part.preferred = nullptr;
+      part.feats = nullptr;
+      job.parts << part;
     }
-    previousFeatureCount = context.fFeats->size();
+
+    job.obstacleCount = obstacleContext.obstacleCount - previousObstacleCount;
     previousObstacleCount = obstacleContext.obstacleCount;
+    layerCandidates << job;
+  }
+
+  if ( mPlacementCache )
+  {
+    // take the candidates of the unchanged parts from the placement cache
+    QMutexLocker locker( &mPlacementCache->mMutex );
+    for ( i = 0; i < layerCandidates.count(); i++ )
+    {
+      LayerCandidates& job = layerCandidates[i];
+      QString key = placementCacheKey( job.layer );
+      if ( key.isEmpty() )
+        continue;
+
+      QgsLabelPlacementCache::Layer& cacheLayer = mPlacementCache->mLayers[key];
+      uint settings = placementSettingsHash( job.layer, point_p, line_p, poly_p );
+      if ( cacheLayer.scale != mPlacementCacheScale || cacheLayer.settings != settings )
+      {
+        QgsLabelPlacementCache::clearParts( cacheLayer );
+        cacheLayer.layerId = job.layer->provider()->layerId();
+        cacheLayer.scale = mPlacementCacheScale;
+        cacheLayer.settings = settings;
+      }
+
+      QHash<QgsLabelPlacementCache::PartKey, QgsLabelPlacementCache::Part>::iterator it = cacheLayer.parts.begin();
+      for ( ; it != cacheLayer.parts.end(); ++it )
+        it.value().used = false;
+
+      for ( j = 0; j < job.parts.count(); j++ )
+      {
+        PartCandidates& part = job.parts[j];
+        part.geometryHash = part.part->geometryHash();
+        part.settingsHash = part.part->candidatesSettingsHash();
+
+        it = cacheLayer.parts.find( QgsLabelPlacementCache::PartKey( part.part->featureId(), part.geometryHash ) );
+        if ( it == cacheLayer.parts.end() || it.value().settings != part.settingsHash )
+          continue;
+
+        const QgsLabelPlacementCache::Part& cachePart = it.value();
+        for ( int k = 0; k < cachePart.candidates.count(); k++ )
+        {
+          LabelPosition* pos = new LabelPosition( *cachePart.candidates.at( k ) );
+          pos->setFeaturePart( part.part );
+          part.positions << pos;
+          if ( k == cachePart.chosen )
+            part.preferred = pos;
+        }
+        part.cached = true;
+        it.value().used = true;
+      }
+    }
+  }
+
+  // generate candidates lists, one layer per thread
+  CandidatesGenerator generator( this, amin, amax, nullptr != mPlacementCache );
+  if ( layerCandidates.count() > 1 )
+    QtConcurrent::blockingMap( layerCandidates, generator );
+  else if ( !layerCandidates.isEmpty() )
+    generator( layerCandidates.first() );
+
+  if ( mPlacementCache )
+  {
+    // store the new candidates and drop the parts which are not in the extent any more
+    QMutexLocker locker( &mPlacementCache->mMutex );
+    QSet<QString> keys;
+    for ( i = 0; i < layerCandidates.count(); i++ )
+    {
+      LayerCandidates& job = layerCandidates[i];
+      QString key = placementCacheKey( job.layer );
+      if ( key.isEmpty() )
+        continue;
+
+      keys << key;
+      QgsLabelPlacementCache::Layer& cacheLayer = mPlacementCache->mLayers[key];
+      for ( j = 0; j < job.parts.count(); j++ )
+      {
+        PartCandidates& part = job.parts[j];
+        if ( part.cached )
+          continue;
+
+        QgsLabelPlacementCache::Part& cachePart = cacheLayer.parts[ QgsLabelPlacementCache::PartKey( part.part->featureId(), part.geometryHash )];
+        if ( cachePart.used )
+        {
+          // another part with the same id and geometry
+          qDeleteAll( part.cache );
+        }
+        else
+        {
+          qDeleteAll( cachePart.candidates );
+          cachePart.settings = part.settingsHash;
+          cachePart.candidates = part.cache;
+          cachePart.chosen = -1;
+          cachePart.used = true;
+        }
+        part.cache.clear();
+      }
+
+      QHash<QgsLabelPlacementCache::PartKey, QgsLabelPlacementCache::Part>::iterator it = cacheLayer.parts.begin();
+      while ( it != cacheLayer.parts.end() )
+      {
+        if ( it.value().used )
+        {
+          ++it;
+        }
+        else
+        {
+          qDeleteAll( it.value().candidates );
+          it = cacheLayer.parts.erase( it );
+        }
+      }
+    }
+
+    // layers which are not labeled any more
+    QHash<QString, QgsLabelPlacementCache::Layer>::iterator it = mPlacementCache->mLayers.begin();
+    while ( it != mPlacementCache->mLayers.end() )
+    {
+      if ( keys.contains( it.key() ) )
+      {
+        ++it;
+      }
+      else
+      {
+        QgsLabelPlacementCache::clearParts( it.value() );
+        it = mPlacementCache->mLayers.erase( it );
+      }
+    }
+  }
+
+  // candidates placed by the previous run, by feature
+  QHash<Feats*, LabelPosition*> preferredPositions;
+
+  // collect the candidates in the order of the layers, so that the index is
+  // filled in the same order whatever the number of threads
+  Q_FOREACH ( const LayerCandidates& job, layerCandidates )
+  {
+    bool hasFeatures = false;
+    Q_FOREACH ( const PartCandidates& part, job.parts )
+    {
+      if ( !part.feats )
+        continue;
+
+      Q_FOREACH ( LabelPosition* pos, part.positions )
+        pos->insertIntoIndex( prob->candidates );
+      fFeats->append( part.feats );
+      if ( part.preferred )
+        preferredPositions.insert( part.feats, part.preferred );
+      hasFeatures = true;
+    }
+
+    if ( hasFeatures || job.obstacleCount > 0 )
+    {
+      layersWithFeaturesInBBox << job.layer->name();
+    }
   }
   mMutex.unlock();
 
@@ -382,6 +725,10 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
       delete feat->lPos.takeLast();
     }
 
+    LabelPosition* preferred = preferredPositions.value( feat );
+    if ( preferred && feat->lPos.contains( preferred ) )
+      prob->mPreferredPositions << preferred;
+
     // update problem's # candidate
     prob->featNbLp[i] = feat->lPos.count();
     prob->nblp += feat->lPos.count();
@@ -487,6 +834,8 @@ QList<LabelPosition*>* Pal::labeller( double bbox[4], PalStat **stats, bool disp
   // Post-Optimization
   //prob->post_optimization();
 
+  updatePlacementCache( prob );
+
 
   QList<LabelPosition*> * solution = prob->getSolution( displayAll );
 
@@ -535,6 +884,8 @@ QList<LabelPosition*>* Pal::solveProblem( Problem* prob, bool displayAll )
     return new QList<LabelPosition*>();
   }
 
+  updatePlacementCache( prob );
+
   return prob->getSolution( displayAll );
 }
 
@@ -41,6 +41,7 @@
 // TODO ${MAJOR} ${MINOR} etc instead of 0.2
 
 class QgsAbstractLabelProvider;
+class QgsLabelPlacementCache;
 
 namespace pal
 {
@@ -143,6 +144,15 @@ namespace pal
       /** Check whether the job has been cancelled */
       inline bool isCancelled() { return fnIsCancelled ? fnIsCancelled( fnIsCancelledContext ) : false; }
 
+      /** Sets a cache of the candidates and of the solution of previous runs. Unchanged
+       * features take their candidates from the cache and the search starts from their
+       * previous placement. The cache is updated by extractProblem() and solveProblem().
+       * @param cache label placement cache, not owned by pal. May be NULL.
+       * @param scale map units per pixel of the run
+       * @note added in QGIS 2.16
+       */
+      void setPlacementCache( QgsLabelPlacementCache* cache, double scale );
+
       Problem* extractProblem( double bbox[4] );
 
       QList<LabelPosition*>* solveProblem( Problem* prob, bool displayAll );
@@ -262,6 +272,12 @@ namespace pal
       /** Application-specific context for the cancellation check function */
       void* fnIsCancelledContext;
 
+      QgsLabelPlacementCache* mPlacementCache;
+      double mPlacementCacheScale;
+
+      /** Stores the solution of a problem in the placement cache */
+      void updatePlacementCache( Problem* prob );
+
       /**
        * \brief Problem factory
        * Extract features to label and generates candidates for them,
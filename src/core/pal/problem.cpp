@@ -40,11 +40,16 @@
 #include "internalexception.h"
 #include <cfloat>
 #include <limits.h> //for INT_MAX
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
 #include "qgslabelingenginev2.h"
 
 using namespace pal;
 
+// maximum number of sub parts optimized at the same time by popmusic
+static const int POPMUSIC_BATCH_SIZE = 16;
+
 inline void delete_chain( Chain *chain )
 {
   if ( chain )
@@ -78,7 +83,6 @@ Problem::Problem()
   featWrap = nullptr;
   candidates = new RTree<LabelPosition*, double, 2, double>();
   candidates_sol = new RTree<LabelPosition*, double, 2, double>();
-  candidates_subsol = nullptr;
 }
 
 Problem::~Problem()
@@ -105,11 +109,6 @@ Problem::~Problem()
 
   delete candidates;
   delete candidates_sol;
-
-  if ( candidates_subsol )
-  {
-    delete candidates_subsol;
-  }
 }
 
 typedef struct
@@ -310,6 +309,31 @@ void Problem::init_sol_falp()
       }
     }
 
+  // start from the placement of the previous run where it is still possible,
+  // candidates which conflict with it are removed from the list
+  Q_FOREACH ( LabelPosition* preferred, mPreferredPositions )
+  {
+    label = preferred->getId();
+    int probFeatId = preferred->getProblemFeatureId();
+    if ( sol->s[probFeatId] != -1
+         || label >= featStartId[probFeatId] + featNbLp[probFeatId]
+         || !list->isIn( label ) )
+      continue;
+
+    sol->s[probFeatId] = label;
+
+    for ( i = featStartId[probFeatId]; i < featStartId[probFeatId] + featNbLp[probFeatId]; i++ )
+    {
+      ignoreLabel( mLabelPositions.at( i ), list, candidates );
+    }
+
+    preferred->getBoundingBox( amin, amax );
+
+    context->lp = preferred;
+    candidates->Search( amin, amax, falpCallback1, reinterpret_cast< void* >( context ) );
+    candidates_sol->Insert( amin, amax, preferred );
+  }
+
   while ( list->getSize() > 0 ) // O (log size)
   {
     if ( pal->isCancelled() )
@@ -390,6 +414,69 @@ void Problem::init_sol_falp()
   delete list;
 }
 
+/*
+ * Optimizes the sub parts of a batch, the sub parts of a batch share no feature
+ * so they can be processed in parallel.
+ */
+class SubPartOptimizer
+{
+  public:
+    typedef void result_type;
+
+    SubPartOptimizer( Problem* problem, SearchMethod searchMethod )
+        : mProblem( problem )
+        , mSearchMethod( searchMethod )
+    {}
+
+    void operator()( SubPart* part )
+    {
+      part->delta = mProblem->popmusic_subpart( part, mSearchMethod );
+    }
+
+  private:
+    Problem* mProblem;
+    SearchMethod mSearchMethod;
+};
+
+double Problem::popmusic_subpart( SubPart *part, SearchMethod searchMethod )
+{
+  // update sub part solution
+  RTree<LabelPosition*, double, 2, double> subsol;
+  part->candidates_subsol = &subsol;
+
+  for ( int i = 0; i < part->subSize; i++ )
+  {
+    part->sol[i] = sol->s[part->sub[i]];
+    if ( part->sol[i] != -1 )
+    {
+      mLabelPositions.at( part->sol[i] )->insertIntoIndex( &subsol );
+    }
+  }
+
+  double delta = 0.0;
+  switch ( searchMethod )
+  {
+      //case branch_and_bound :
+      //delta = current->branch_and_bound_search();
+      //   break;
+
+    case POPMUSIC_TABU :
+      delta = popmusic_tabu( part );
+      break;
+    case POPMUSIC_TABU_CHAIN :
+      delta = popmusic_tabu_chain( part );
+      break;
+    case POPMUSIC_CHAIN :
+      delta = popmusic_chain( part );
+      break;
+    default:
+      break;
+  }
+
+  part->candidates_subsol = nullptr;
+  return delta;
+}
+
 void Problem::popmusic()
 {
 
@@ -398,20 +485,21 @@ void Problem::popmusic()
 
   int i;
   int seed;
-  bool *ok = new bool[nbft];
 
   int r = pal->popmusic_r;
 
   SearchMethod searchMethod = pal->searchMethod;
+  if ( searchMethod != POPMUSIC_TABU && searchMethod != POPMUSIC_TABU_CHAIN && searchMethod != POPMUSIC_CHAIN )
+  {
+    init_sol_falp();
+    solution_cost();
+    return;
+  }
 
-  candidates_subsol = new RTree<LabelPosition*, double, 2, double>();
-
-  double delta = 0.0;
+  bool *ok = new bool[nbft];
 
   int it = 0;
 
-  SubPart *current = nullptr;
-
   labelPositionCost = new double[all_nblp];
   nbOlap = new int[all_nblp];
 
@@ -429,7 +517,6 @@ void Problem::popmusic()
     parts[i] = subPart( r, i, isIn );
     ok[i] = false;
   }
-  delete[] isIn;
   Util::sort( reinterpret_cast< void** >( parts ), nbft, borderSizeInc );
   //sort ((void**)parts, nbft, borderSizeDec);
 
@@ -437,93 +524,104 @@ void Problem::popmusic()
 
   solution_cost();
 
+  // Sub parts which share no feature are optimized at the same time, each
+  // one only reads and writes the costs of its own features' candidates.
+  // The batches are formed and merged in the order of the seeds and do not
+  // depend on the number of threads, so the solution is the same on every
+  // machine.
+  bool parallel = QThreadPool::globalInstance()->maxThreadCount() > 1;
+  if ( parallel )
+  {
+    // conflict tests from other threads read the geometries of the candidates
+    Q_FOREACH ( LabelPosition* lp, mLabelPositions )
+      lp->createConflictGeometries();
+  }
+
+  // isIn now marks the features of the sub parts of the current batch
+  QList<SubPart*> batch;
+  QList<int> batchSeeds;
+  SubPartOptimizer optimizer( this, searchMethod );
+
   int popit = 0;
 
   seed = 0;
   while ( true )
   {
     it++;
-    /* find the next seed not ok */
-    for ( i = ( seed + 1 ) % nbft; ok[i] && i != seed; i = ( i + 1 ) % nbft )
-      ;
 
-    if ( i == seed && ok[seed] )
-    {
-      current = nullptr; // everything is OK :-)
-      break;
-    }
-    else
+    /* find the next seeds not ok, whose sub parts do not overlap */
+    batch.clear();
+    batchSeeds.clear();
+    for ( int step = 1; step <= nbft && batch.size() < POPMUSIC_BATCH_SIZE; step++ )
     {
-      seed = i;
-      current = parts[seed];
-    }
-
-    // update sub part solution
-    candidates_subsol->RemoveAll();
+      i = ( seed + step ) % nbft;
+      if ( ok[i] )
+        continue;
 
-    for ( i = 0; i < current->subSize; i++ )
-    {
-      current->sol[i] = sol->s[current->sub[i]];
-      if ( current->sol[i] != -1 )
-      {
-        mLabelPositions.at( current->sol[i] )->insertIntoIndex( candidates_subsol );
-      }
+      SubPart *part = parts[i];
+      int j;
+      for ( j = 0; j < part->subSize && !isIn[part->sub[j]]; j++ )
+        ;
+      if ( j < part->subSize )
+        continue; // shares a feature with the batch, wait for the next one
+
+      for ( j = 0; j < part->subSize; j++ )
+        isIn[part->sub[j]] = 1;
+      batch << part;
+      batchSeeds << i;
+      seed = i;
     }
 
-    switch ( searchMethod )
-    {
-        //case branch_and_bound :
-        //delta = current->branch_and_bound_search();
-        //   break;
+    if ( batch.isEmpty() )
+      break; // everything is OK :-)
 
-      case POPMUSIC_TABU :
-        delta = popmusic_tabu( current );
-        break;
-      case POPMUSIC_TABU_CHAIN :
-        delta = popmusic_tabu_chain( current );
-        break;
-      case POPMUSIC_CHAIN :
-        delta = popmusic_chain( current );
-        break;
-      default:
-        delete[] ok;
-        delete[] parts;
-        return;
-    }
+    if ( parallel && batch.size() > 1 )
+      QtConcurrent::blockingMap( batch, optimizer );
+    else
+      Q_FOREACH ( SubPart* part, batch )
+        optimizer( part );
 
-    popit++;
+    popit += batch.size();
 
-    if ( delta > EPSILON )
+    for ( int b = 0; b < batch.size(); b++ )
     {
-      /* Update solution */
-      for ( i = 0; i < current->borderSize; i++ )
-      {
-        ok[current->sub[i]] = false;
-      }
+      SubPart *current = batch.at( b );
+      for ( i = 0; i < current->subSize; i++ )
+        isIn[current->sub[i]] = 0;
 
-      for ( i = current->borderSize; i < current->subSize; i++ )
+      if ( current->delta > EPSILON )
       {
-
-        if ( sol->s[current->sub[i]] != -1 )
+        /* Update solution */
+        for ( i = 0; i < current->borderSize; i++ )
         {
-          mLabelPositions.at( sol->s[current->sub[i]] )->removeFromIndex( candidates_sol );
+          ok[current->sub[i]] = false;
         }
 
-        sol->s[current->sub[i]] = current->sol[i];
-
-        if ( current->sol[i] != -1 )
+        for ( i = current->borderSize; i < current->subSize; i++ )
         {
-          mLabelPositions.at( current->sol[i] )->insertIntoIndex( candidates_sol );
-        }
 
-        ok[current->sub[i]] = false;
+          if ( sol->s[current->sub[i]] != -1 )
+          {
+            mLabelPositions.at( sol->s[current->sub[i]] )->removeFromIndex( candidates_sol );
+          }
+
+          sol->s[current->sub[i]] = current->sol[i];
+
+          if ( current->sol[i] != -1 )
+          {
+            mLabelPositions.at( current->sol[i] )->insertIntoIndex( candidates_sol );
+          }
+
+          ok[current->sub[i]] = false;
+        }
+      }
+      else  // not improved
+      {
+        ok[batchSeeds.at( b )] = true;
       }
-    }
-    else  // not improved
-    {
-      ok[seed] = true;
     }
   }
+  delete[] isIn;
 
   solution_cost();
 
@@ -672,7 +770,7 @@ double Problem::compute_feature_cost( SubPart *part, int feat_id, int label_id,
     lp->getBoundingBox( amin, amax );
 
     context.lp = lp;
-    candidates_subsol->Search( amin, amax, LabelPosition::countFullOverlapCallback, reinterpret_cast< void* >( &context ) );
+    part->candidates_subsol->Search( amin, amax, LabelPosition::countFullOverlapCallback, reinterpret_cast< void* >( &context ) );
 
     cost += lp->cost();
   }
@@ -1010,7 +1108,7 @@ double Problem::popmusic_tabu( SubPart *part )
       candidateList[candidateId]->label_id = choosed_label;
 
       if ( old_label != -1 )
-        mLabelPositions.at( old_label )->removeFromIndex( candidates_subsol );
+        mLabelPositions.at( old_label )->removeFromIndex( part->candidates_subsol );
 
       /* re-compute all labelpositioncost that overlap with old an new label */
       double local_inactive = inactiveCost[sub[choosed_feat]];
@@ -1065,7 +1163,7 @@ double Problem::popmusic_tabu( SubPart *part )
 
         candidates->Search( amin, amax, updateCandidatesCost, &context );
 
-        lp->insertIntoIndex( candidates_subsol );
+        lp->insertIntoIndex( part->candidates_subsol );
       }
 
       Util::sort( reinterpret_cast< void** >( candidateList ), probSize, decreaseCost );
@@ -1253,7 +1351,7 @@ inline Chain *Problem::chain( SubPart *part, int seed )
             context.lp = lp;
 
             // search ative conflicts and count them
-            candidates_subsol->Search( amin, amax, chainCallback, reinterpret_cast< void* >( &context ) );
+            part->candidates_subsol->Search( amin, amax, chainCallback, reinterpret_cast< void* >( &context ) );
 
             // no conflict -> end of chain
             if ( conflicts->isEmpty() )
@@ -1416,12 +1514,12 @@ inline Chain *Problem::chain( SubPart *part, int seed )
 
       if ( et->old_label != -1 )
       {
-        mLabelPositions.at( et->old_label )->removeFromIndex( candidates_subsol );
+        mLabelPositions.at( et->old_label )->removeFromIndex( part->candidates_subsol );
       }
 
       if ( et->new_label != -1 )
       {
-        mLabelPositions.at( et->new_label )->insertIntoIndex( candidates_subsol );
+        mLabelPositions.at( et->new_label )->insertIntoIndex( part->candidates_subsol );
       }
 
       tmpsol[seed] = retainedLabel;
@@ -1436,12 +1534,12 @@ inline Chain *Problem::chain( SubPart *part, int seed )
 
     if ( et->new_label != -1 )
     {
-      mLabelPositions.at( et->new_label )->removeFromIndex( candidates_subsol );
+      mLabelPositions.at( et->new_label )->removeFromIndex( part->candidates_subsol );
     }
 
     if ( et->old_label != -1 )
     {
-      mLabelPositions.at( et->old_label )->insertIntoIndex( candidates_subsol );
+      mLabelPositions.at( et->old_label )->insertIntoIndex( part->candidates_subsol );
     }
 
     delete et;
@@ -1827,13 +1925,13 @@ double Problem::popmusic_chain( SubPart *part )
 
           if ( sol[fid] >= 0 )
           {
-            mLabelPositions.at( sol[fid] )->removeFromIndex( candidates_subsol );
+            mLabelPositions.at( sol[fid] )->removeFromIndex( part->candidates_subsol );
           }
           sol[fid] = lid;
 
           if ( sol[fid] >= 0 )
           {
-            mLabelPositions.at( lid )->insertIntoIndex( candidates_subsol );
+            mLabelPositions.at( lid )->insertIntoIndex( part->candidates_subsol );
           }
 
           tabu_list[fid] = it + tenure;
@@ -2018,12 +2116,12 @@ double Problem::popmusic_tabu_chain( SubPart *part )
         lid = retainedChain->label[i];
 
         if ( sol[fid] >= 0 )
-          mLabelPositions.at( sol[fid] )->removeFromIndex( candidates_subsol );
+          mLabelPositions.at( sol[fid] )->removeFromIndex( part->candidates_subsol );
 
         sol[fid] = lid;
 
         if ( lid >= 0 )
-          mLabelPositions.at( lid )->insertIntoIndex( candidates_subsol );
+          mLabelPositions.at( lid )->insertIntoIndex( part->candidates_subsol );
 
         tabu_list[fid] = it + tenure;
         candidatesUnsorted[fid-borderSize]->cost = ( lid == -1 ? inactiveCost[sub[fid]] : mLabelPositions.at( lid )->cost() );
@@ -81,6 +81,14 @@ namespace pal
      * first feat in sub part
      */
     int seed;
+    /**
+     * index of the labels of the sub solution, while the sub part is optimized
+     */
+    RTree<LabelPosition*, double, 2, double> *candidates_subsol;
+    /**
+     * improvement of the cost given by the last optimization
+     */
+    double delta;
   } SubPart;
 
   typedef struct _chain
@@ -164,6 +172,13 @@ namespace pal
        */
       double popmusic_tabu_chain( SubPart *part );
 
+      /**
+       * Optimizes a sub part from the current solution with a popmusic search method and
+       * returns the improvement of the cost. Sub parts which share no feature can be
+       * optimized in parallel.
+       */
+      double popmusic_subpart( SubPart *part, SearchMethod searchMethod );
+
       /**
        * \brief Basic initial solution : every feature to -1
        */
@@ -214,9 +229,11 @@ namespace pal
 
       QList< LabelPosition* > mLabelPositions;
 
+      //! candidates placed by the previous run, init_sol_falp() selects them first
+      QList< LabelPosition* > mPreferredPositions;
+
       RTree<LabelPosition*, double, 2, double> *candidates;  // index all candidates
       RTree<LabelPosition*, double, 2, double> *candidates_sol; // index active candidates
-      RTree<LabelPosition*, double, 2, double> *candidates_subsol; // idem for subparts
 
       //int *feat;        // [nblp]
       int *featStartId; // [nbft]
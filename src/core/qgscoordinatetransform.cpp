@@ -23,6 +23,7 @@
 //qt includes
 #include <QDomNode>
 #include <QDomElement>
+#include <QMap>
 #include <QApplication>
 #include <QPolygonF>
 #include <QStringList>
@@ -45,6 +46,10 @@ QgsCoordinateTransform::QgsCoordinateTransform()
     , mDestinationProjection( nullptr )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
+    , mLinear( false )
+    , mLinearScale( 1.0 )
+    , mLinearOffsetX( 0.0 )
+    , mLinearOffsetY( 0.0 )
 {
   setFinder();
 }
@@ -57,6 +62,10 @@ QgsCoordinateTransform::QgsCoordinateTransform( const QgsCoordinateReferenceSyst
     , mDestinationProjection( nullptr )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
+    , mLinear( false )
+    , mLinearScale( 1.0 )
+    , mLinearOffsetX( 0.0 )
+    , mLinearOffsetY( 0.0 )
 {
   setFinder();
   mSourceCRS = source;
@@ -73,6 +82,10 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrsId, long theDes
     , mDestinationProjection( nullptr )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
+    , mLinear( false )
+    , mLinearScale( 1.0 )
+    , mLinearOffsetX( 0.0 )
+    , mLinearOffsetY( 0.0 )
 {
   initialise();
 }
@@ -84,6 +97,10 @@ QgsCoordinateTransform::QgsCoordinateTransform( const QString& theSourceCRS, con
     , mDestinationProjection( nullptr )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
+    , mLinear( false )
+    , mLinearScale( 1.0 )
+    , mLinearOffsetX( 0.0 )
+    , mLinearOffsetY( 0.0 )
 {
   setFinder();
   mSourceCRS.createFromWkt( theSourceCRS );
@@ -104,6 +121,10 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrid,
     , mDestinationProjection( nullptr )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
+    , mLinear( false )
+    , mLinearScale( 1.0 )
+    , mLinearOffsetX( 0.0 )
+    , mLinearOffsetY( 0.0 )
 {
   setFinder();
 
@@ -167,6 +188,7 @@ void QgsCoordinateTransform::initialise()
     // Pass through with no projection since we have no idea what the layer
     // coordinates are and projecting them may not be appropriate
     mShortCircuit = true;
+    mLinear = false;
     QgsDebugMsg( "SourceCRS seemed invalid!" );
     return;
   }
@@ -226,6 +248,8 @@ void QgsCoordinateTransform::initialise()
   {
     mInitialisedFlag = false;
   }
+
+  initLinearMapping( sourceProjString, destProjString );
 #ifdef COORDINATE_TRANSFORM_VERBOSE
   if ( mInitialisedFlag )
   {
@@ -267,6 +291,121 @@ void QgsCoordinateTransform::initialise()
 
 }
 
+//! Returns the parameters of a proj4 definition by name, without their leading '+'
+static QMap<QString, QString> projParameters( const QString& proj4 )
+{
+  QMap<QString, QString> parameters;
+  Q_FOREACH ( const QString& token, proj4.split( ' ', QString::SkipEmptyParts ) )
+  {
+    QString parameter = token.startsWith( '+' ) ? token.mid( 1 ) : token;
+    int pos = parameter.indexOf( '=' );
+    if ( pos < 0 )
+      parameters.insert( parameter, QString() );
+    else
+      parameters.insert( parameter.left( pos ), parameter.mid( pos + 1 ) );
+  }
+  return parameters;
+}
+
+//! Returns the size in meters of the unit of a projected proj4 definition, or -1 if it is not known
+static double projUnitToMeter( const QMap<QString, QString>& parameters )
+{
+  bool ok;
+  if ( parameters.contains( "to_meter" ) )
+  {
+    double toMeter = parameters.value( "to_meter" ).toDouble( &ok );
+    return ok && toMeter > 0 ? toMeter : -1;
+  }
+
+  // the most frequent units of PROJ.4 unit table
+  QString units = parameters.value( "units", "m" );
+  if ( units == "m" )
+    return 1.0;
+  else if ( units == "km" )
+    return 1000.0;
+  else if ( units == "ft" )
+    return 0.3048;
+  else if ( units == "us-ft" )
+    return 1200.0 / 3937.0;
+  else if ( units == "yd" )
+    return 0.9144;
+  else if ( units == "mi" )
+    return 1609.344;
+  return -1;
+}
+
+void QgsCoordinateTransform::initLinearMapping( const QString& srcProjString, const QString& destProjString )
+{
+  mLinear = false;
+  mLinearScale = 1.0;
+  mLinearOffsetX = 0.0;
+  mLinearOffsetY = 0.0;
+
+  if ( !mInitialisedFlag || !mSourceProjection || !mDestinationProjection )
+    return;
+
+  QMap<QString, QString> srcParameters = projParameters( srcProjString );
+  QMap<QString, QString> destParameters = projParameters( destProjString );
+
+  // geographic and geocentric coordinates do not use false easting and units,
+  // the axis order and geoid grids are applied out of the projection
+  QString proj = srcParameters.value( "proj" );
+  if ( proj.isEmpty() || proj == "latlong" || proj == "longlat" || proj == "latlon" || proj == "lonlat" || proj == "geocent"
+       || srcParameters.contains( "axis" ) || srcParameters.contains( "geoidgrids" ) )
+    return;
+
+  // all the other parameters must be the same, so that the projections themselves are identical
+  QStringList linearParameters;
+  linearParameters << "x_0" << "y_0" << "units" << "to_meter";
+  Q_FOREACH ( const QString& parameter, linearParameters )
+  {
+    srcParameters.remove( parameter );
+    destParameters.remove( parameter );
+  }
+  if ( srcParameters.keys() != destParameters.keys() )
+    return;
+
+  QMap<QString, QString>::const_iterator srcIt = srcParameters.constBegin();
+  QMap<QString, QString>::const_iterator destIt = destParameters.constBegin();
+  for ( ; srcIt != srcParameters.constEnd(); ++srcIt, ++destIt )
+  {
+    if ( srcIt.value() == destIt.value() )
+      continue;
+
+    bool srcOk, destOk;
+    double srcValue = srcIt.value().toDouble( &srcOk );
+    double destValue = destIt.value().toDouble( &destOk );
+    if ( !srcOk || !destOk || srcValue != destValue )
+      return;
+  }
+
+  // PROJ.4 projects to x = ( easting + x_0 ) / to_meter, with x_0 in meters
+  srcParameters = projParameters( srcProjString );
+  destParameters = projParameters( destProjString );
+  double srcToMeter = projUnitToMeter( srcParameters );
+  double destToMeter = projUnitToMeter( destParameters );
+  if ( srcToMeter <= 0 || destToMeter <= 0 )
+    return;
+
+  bool ok = true;
+  double offsets[4] = { 0.0, 0.0, 0.0, 0.0 };
+  const char* offsetParameters[4] = { "x_0", "y_0", "x_0", "y_0" };
+  for ( int i = 0; i < 4 && ok; ++i )
+  {
+    const QMap<QString, QString>& parameters = i < 2 ? srcParameters : destParameters;
+    if ( parameters.contains( offsetParameters[i] ) )
+      offsets[i] = parameters.value( offsetParameters[i] ).toDouble( &ok );
+  }
+  if ( !ok )
+    return;
+
+  mLinearScale = srcToMeter / destToMeter;
+  mLinearOffsetX = ( offsets[2] - offsets[0] ) / destToMeter;
+  mLinearOffsetY = ( offsets[3] - offsets[1] ) / destToMeter;
+  mLinear = true;
+  QgsDebugMsgLevel( QString( "Linear transform, scale %1, offset %2 %3" ).arg( mLinearScale ).arg( mLinearOffsetX ).arg( mLinearOffsetY ), 3 );
+}
+
 //
 //
 // TRANSFORMERS BELOW THIS POINT .........
@@ -446,6 +585,59 @@ void QgsCoordinateTransform::transformPolygon( QPolygonF& poly, TransformDirecti
   }
 }
 
+void QgsCoordinateTransform::transformPolygons( QList<QPolygonF>& polygons, TransformDirection direction ) const
+{
+  if ( mShortCircuit || !mInitialisedFlag )
+  {
+    return;
+  }
+
+  //create x, y arrays with the vertices of all the polygons
+  int nVertices = 0;
+  Q_FOREACH ( const QPolygonF& poly, polygons )
+  {
+    nVertices += poly.size();
+  }
+
+  QVector<double> x( nVertices );
+  QVector<double> y( nVertices );
+  QVector<double> z( nVertices, 0.0 );
+
+  int i = 0;
+  Q_FOREACH ( const QPolygonF& poly, polygons )
+  {
+    const QPointF* pt = poly.constData();
+    for ( int j = 0; j < poly.size(); ++j, ++pt, ++i )
+    {
+      x[i] = pt->x();
+      y[i] = pt->y();
+    }
+  }
+
+  try
+  {
+    transformCoords( nVertices, x.data(), y.data(), z.data(), direction );
+  }
+  catch ( const QgsCsException & )
+  {
+    // rethrow the exception
+    QgsDebugMsg( "rethrowing exception" );
+    throw;
+  }
+
+  i = 0;
+  QList<QPolygonF>::iterator it = polygons.begin();
+  for ( ; it != polygons.end(); ++it )
+  {
+    QPointF* pt = it->data();
+    for ( int j = 0; j < it->size(); ++j, ++pt, ++i )
+    {
+      pt->rx() = x[i];
+      pt->ry() = y[i];
+    }
+  }
+}
+
 void QgsCoordinateTransform::transformInPlace(
   QVector<double>& x, QVector<double>& y, QVector<double>& z,
   TransformDirection direction ) const
@@ -657,6 +849,28 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
   QgsDebugMsg( QString( "[[[[[[ Number of points to transform: %1 ]]]]]]" ).arg( numPoints ) );
 #endif
 
+  if ( mLinear )
+  {
+    // same projection, only the false easting and northing and the units differ
+    if ( direction == ReverseTransform )
+    {
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        x[i] = ( x[i] - mLinearOffsetX ) / mLinearScale;
+        y[i] = ( y[i] - mLinearOffsetY ) / mLinearScale;
+      }
+    }
+    else
+    {
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        x[i] = x[i] * mLinearScale + mLinearOffsetX;
+        y[i] = y[i] * mLinearScale + mLinearOffsetY;
+      }
+    }
+    return;
+  }
+
   // use proj4 to do the transform
   QString dir;
   // if the source/destination projection is lat/long, convert the points to radians
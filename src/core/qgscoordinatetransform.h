@@ -173,6 +173,17 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
 
     void transformPolygon( QPolygonF& poly, TransformDirection direction = ForwardTransform ) const;
 
+    /** Transforms several polygons or polylines in place, with a single call to PROJ.4 for
+     * all their vertices. This is faster than transforming each of them with transformPolygon(),
+     * e.g. for the rings of a polygon or the parts of a multi geometry. If the transform
+     * fails, none of the polygons is modified.
+     * @param polygons polygons to transform
+     * @param direction TransformDirection (defaults to ForwardTransform)
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void transformPolygons( QList<QPolygonF>& polygons, TransformDirection direction = ForwardTransform ) const;
+
     /** Transform a QgsRectangle to the dest Coordinate system
      * If the direction is ForwardTransform then coordinates are transformed from layer CS --> map canvas CS,
      * otherwise points are transformed from map canvas CS to layerCS.
@@ -205,6 +216,13 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
      */
     bool isShortCircuited() const { return mShortCircuit; }
 
+    /** Returns whether the transform is a linear mapping which does not need PROJ.4, i.e. the
+     * source and destination CRS have the same definition except for their false easting,
+     * false northing and units (e.g. a state plane CRS in meters and in feet).
+     * @note added in QGIS 2.16
+     */
+    bool isLinear() const { return mLinear; }
+
     /** Change the destination coordinate system by passing it a qgis srsid
     * A QGIS srsid is a unique key value to an entry on the tbl_srs in the
     * srs.db sqlite database.
@@ -287,6 +305,18 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
     int mSourceDatumTransform;
     int mDestinationDatumTransform;
 
+    /*!
+     * Flag to indicate that the forward transform is x' = x * mLinearScale + mLinearOffsetX,
+     * y' = y * mLinearScale + mLinearOffsetY and that PROJ.4 is not needed
+     */
+    bool mLinear;
+    double mLinearScale;
+    double mLinearOffsetX;
+    double mLinearOffsetY;
+
+    /** Sets the linear mapping if the proj4 definitions only differ by false easting, false northing and units */
+    void initLinearMapping( const QString& srcProjString, const QString& destProjString );
+
     /*!
      * Finder for PROJ grid files.
      */
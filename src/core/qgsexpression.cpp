@@ -48,6 +48,7 @@
 #include "qgsmultilinestringv2.h"
 #include "qgscurvepolygonv2.h"
 #include "qgsexpressionprivate.h"
+#include "qgsexpressionbytecode.h"
 #include "qgsexpressionsorter.h"
 
 #if QT_VERSION < 0x050000
@@ -130,51 +131,6 @@ bool QgsExpression::Interval::operator==( QgsExpression::Interval other ) const
   return qgsDoubleNear( mSeconds, other.mSeconds );
 }
 
-///////////////////////////////////////////////
-// three-value logic
-
-enum TVL
-{
-  False,
-  True,
-  Unknown
-};
-
-static TVL AND[3][3] =
-{
-  // false  true    unknown
-  { False, False,   False },   // false
-  { False, True,    Unknown }, // true
-  { False, Unknown, Unknown }  // unknown
-};
-
-static TVL OR[3][3] =
-{
-  { False,   True, Unknown },  // false
-  { True,    True, True },     // true
-  { Unknown, True, Unknown }   // unknown
-};
-
-static TVL NOT[3] = { True, False, Unknown };
-
-static QVariant tvl2variant( TVL v )
-{
-  switch ( v )
-  {
-    case False:
-      return 0;
-    case True:
-      return 1;
-    case Unknown:
-    default:
-      return QVariant();
-  }
-}
-
-#define TVL_True     QVariant(1)
-#define TVL_False    QVariant(0)
-#define TVL_Unknown  QVariant()
-
 ///////////////////////////////////////////////
 // QVariant checks and conversions
 
@@ -379,40 +335,6 @@ static QgsExpression::Node* getNode( const QVariant& value, QgsExpression* paren
   return nullptr;
 }
 
-// this handles also NULL values
-static TVL getTVLValue( const QVariant& value, QgsExpression* parent )
-{
-  // we need to convert to TVL
-  if ( value.isNull() )
-    return Unknown;
-
-  //handle some special cases
-  if ( value.canConvert<QgsGeometry>() )
-  {
-    //geom is false if empty
-    QgsGeometry geom = value.value<QgsGeometry>();
-    return geom.isEmpty() ? False : True;
-  }
-  else if ( value.canConvert<QgsFeature>() )
-  {
-    //feat is false if non-valid
-    QgsFeature feat = value.value<QgsFeature>();
-    return feat.isValid() ? True : False;
-  }
-
-  if ( value.type() == QVariant::Int )
-    return value.toInt() != 0 ? True : False;
-
-  bool ok;
-  double x = value.toDouble( &ok );
-  if ( !ok )
-  {
-    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to boolean" ).arg( value.toString() ) );
-    return Unknown;
-  }
-  return !qgsDoubleNear( x, 0.0 ) ? True : False;
-}
-
 //////
 
 static QVariant fcnGetVariable( const QVariantList& values, const QgsExpressionContext* context, QgsExpression* parent )
@@ -3228,6 +3150,12 @@ int QgsExpression::functionCount()
 }
 
 
+QgsExpressionPrivate::~QgsExpressionPrivate()
+{
+  delete mBytecode;
+  delete mRootNode;
+}
+
 QgsExpression::QgsExpression( const QString& expr )
     : d( new QgsExpressionPrivate )
 {
@@ -3348,7 +3276,45 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
     return false;
   }
 
-  return d->mRootNode->prepare( this, context );
+  delete d->mBytecode;
+  d->mBytecode = nullptr;
+
+  if ( !d->mRootNode->prepare( this, context ) )
+    return false;
+
+  if ( d->mCompilationEnabled )
+    d->mBytecode = QgsExpressionBytecode::compile( this, d->mRootNode, context );
+
+  return true;
+}
+
+void QgsExpression::setCompilationEnabled( bool enabled )
+{
+  if ( d->mCompilationEnabled == enabled )
+    return;
+
+  detach();
+  d->mCompilationEnabled = enabled;
+  if ( !enabled )
+  {
+    delete d->mBytecode;
+    d->mBytecode = nullptr;
+  }
+}
+
+bool QgsExpression::compilationEnabled() const
+{
+  return d->mCompilationEnabled;
+}
+
+bool QgsExpression::isCompiled() const
+{
+  return d->mBytecode != nullptr;
+}
+
+QString QgsExpression::dumpCompiled() const
+{
+  return d->mBytecode ? d->mBytecode->dump() : QString();
 }
 
 QVariant QgsExpression::evaluate( const QgsFeature* f )
@@ -3411,9 +3377,49 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
     return QVariant();
   }
 
+  if ( d->mBytecode )
+    return d->mBytecode->run( this, context );
+
   return d->mRootNode->eval( this, context );
 }
 
+QVariantList QgsExpression::evaluateBlock( QgsExpressionContext* context, const QgsFeatureList& features )
+{
+  d->mEvalErrorString = QString();
+  if ( d->mBytecode && d->mBytecode->isColumnar() && d->mBytecode->foldedVariablesMatch( context ) )
+    return d->mBytecode->evaluateBlock( this, features );
+
+  QgsExpressionContext localContext;
+  if ( !context )
+    context = &localContext;
+
+  QVariantList results;
+  results.reserve( features.count() );
+  QString error;
+  Q_FOREACH ( const QgsFeature& feature, features )
+  {
+    context->setFeature( feature );
+    results << evaluate( context );
+    if ( hasEvalError() )
+      error = d->mEvalErrorString;
+  }
+  d->mEvalErrorString = error;
+  return results;
+}
+
+QVector<bool> QgsExpression::filterBlock( QgsExpressionContext* context, const QgsFeatureList& features )
+{
+  d->mEvalErrorString = QString();
+  if ( d->mBytecode && d->mBytecode->isColumnar() && d->mBytecode->foldedVariablesMatch( context ) )
+    return d->mBytecode->filterBlock( this, features );
+
+  QVariantList results = evaluateBlock( context, features );
+  QVector<bool> mask( results.count() );
+  for ( int i = 0; i < results.count(); ++i )
+    mask[i] = results.at( i ).toBool();
+  return mask;
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
@@ -3621,6 +3627,11 @@ QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression *parent, const Qg
   QVariant val = mOperand->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperand( parent, val );
+}
+
+QVariant QgsExpression::NodeUnaryOperator::evalOperand( QgsExpression *parent, const QVariant &val )
+{
   switch ( mOp )
   {
     case uoNot:
@@ -3664,9 +3675,26 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression *parent, const Q
 {
   QVariant vL = mOpLeft->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
+
+  if ( mOp == boAnd || mOp == boOr )
+  {
+    // the right operand does not need to be evaluated if the left one decides the result
+    TVL tvlL = getTVLValue( vL, parent );
+    ENSURE_NO_EVAL_ERROR;
+    if ( mOp == boAnd && tvlL == False )
+      return TVL_False;
+    if ( mOp == boOr && tvlL == True )
+      return TVL_True;
+  }
+
   QVariant vR = mOpRight->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperands( parent, vL, vR );
+}
+
+QVariant QgsExpression::NodeBinaryOperator::evalOperands( QgsExpression *parent, const QVariant &vL, const QVariant &vR )
+{
   switch ( mOp )
   {
     case boPlus:
@@ -4081,6 +4109,27 @@ QgsExpression::Node* QgsExpression::NodeBinaryOperator::clone() const
 
 //
 
+static bool inListValueEquals( const QVariant& v1, const QVariant& v2, QgsExpression* parent )
+{
+  // check whether they are equal
+  if ( isDoubleSafe( v1 ) && isDoubleSafe( v2 ) )
+  {
+    double f1 = getDoubleValue( v1, parent );
+    if ( parent->hasEvalError() )
+      return false;
+    double f2 = getDoubleValue( v2, parent );
+    if ( parent->hasEvalError() )
+      return false;
+    return qgsDoubleNear( f1, f2 );
+  }
+  else
+  {
+    QString s1 = getStringValue( v1, parent );
+    QString s2 = getStringValue( v2, parent );
+    return QString::compare( s1, s2 ) == 0;
+  }
+}
+
 QVariant QgsExpression::NodeInOperator::eval( QgsExpression *parent, const QgsExpressionContext *context )
 {
   if ( mList->count() == 0 )
@@ -4100,24 +4149,38 @@ QVariant QgsExpression::NodeInOperator::eval( QgsExpression *parent, const QgsEx
       listHasNull = true;
     else
     {
-      bool equal = false;
-      // check whether they are equal
-      if ( isDoubleSafe( v1 ) && isDoubleSafe( v2 ) )
-      {
-        double f1 = getDoubleValue( v1, parent );
-        ENSURE_NO_EVAL_ERROR;
-        double f2 = getDoubleValue( v2, parent );
-        ENSURE_NO_EVAL_ERROR;
-        equal = qgsDoubleNear( f1, f2 );
-      }
-      else
-      {
-        QString s1 = getStringValue( v1, parent );
-        ENSURE_NO_EVAL_ERROR;
-        QString s2 = getStringValue( v2, parent );
-        ENSURE_NO_EVAL_ERROR;
-        equal = QString::compare( s1, s2 ) == 0;
-      }
+      bool equal = inListValueEquals( v1, v2, parent );
+      ENSURE_NO_EVAL_ERROR;
+
+      if ( equal ) // we know the result
+        return mNotIn ? TVL_False : TVL_True;
+    }
+  }
+
+  // item not found
+  if ( listHasNull )
+    return TVL_Unknown;
+  else
+    return mNotIn ? TVL_True : TVL_False;
+}
+
+QVariant QgsExpression::NodeInOperator::evalValues( QgsExpression *parent, const QVariant &value, const QVariantList &listValues )
+{
+  if ( listValues.isEmpty() )
+    return mNotIn ? TVL_True : TVL_False;
+  if ( isNull( value ) )
+    return TVL_Unknown;
+
+  bool listHasNull = false;
+
+  Q_FOREACH ( const QVariant& v2, listValues )
+  {
+    if ( isNull( v2 ) )
+      listHasNull = true;
+    else
+    {
+      bool equal = inListValueEquals( value, v2, parent );
+      ENSURE_NO_EVAL_ERROR;
 
       if ( equal ) // we know the result
         return mNotIn ? TVL_False : TVL_True;
@@ -25,6 +25,7 @@
 #include <QSet>
 
 #include "qgis.h"
+#include "qgsfeature.h"
 #include "qgsunittypes.h"
 
 class QgsFeature;
@@ -151,6 +152,38 @@ class CORE_EXPORT QgsExpression
      */
     bool prepare( const QgsExpressionContext *context );
 
+    /** Sets whether prepare() compiles the expression into a flat instruction stream
+     * which is then used by evaluate( const QgsExpressionContext* ). Compiled expressions
+     * avoid the recursive walk over the node tree and repeated column lookups, nodes which
+     * cannot be compiled are evaluated by the node tree instead. Compilation is enabled
+     * by default.
+     * @see compilationEnabled()
+     * @see isCompiled()
+     * @note added in QGIS 2.16
+     */
+    void setCompilationEnabled( bool enabled );
+
+    /** Returns whether prepare() compiles the expression.
+     * @see setCompilationEnabled()
+     * @note added in QGIS 2.16
+     */
+    bool compilationEnabled() const;
+
+    /** Returns true if the last call to prepare() compiled the expression, ie evaluate()
+     * runs the compiled instruction stream instead of walking the node tree.
+     * @see setCompilationEnabled()
+     * @note added in QGIS 2.16
+     */
+    bool isCompiled() const;
+
+    /** Returns a listing of the compiled instructions, after constant folding and
+     * merging of common subexpressions, or an empty string if the expression is not
+     * compiled. Meant for debugging, the format may change at any time.
+     * @see isCompiled()
+     * @note added in QGIS 2.16
+     */
+    QString dumpCompiled() const;
+
     /**
      * Get list of columns referenced by the expression.
      * @note if the returned list contains the QgsFeatureRequest::AllAttributes constant then
@@ -201,6 +234,33 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext* context );
 
+    /** Evaluate the expression for a block of features and return one result per feature.
+     * Compiled expressions made only of literals, column references and operators are
+     * evaluated column by column over all the features at once, other expressions are
+     * evaluated feature by feature.
+     * @param context context for evaluating expression. Its feature is replaced by the features
+     * of the block in turn, so it is undefined after the call.
+     * @param features features to evaluate the expression for
+     * @returns results in the order of the features. If the evaluation failed for some of the
+     * features, their result is NULL and hasEvalError() reports the error of the last of them.
+     * @note prepare() should be called before calling this method.
+     * @note added in QGIS 2.16
+     * @see filterBlock()
+     */
+    QVariantList evaluateBlock( QgsExpressionContext* context, const QgsFeatureList& features );
+
+    /** Evaluate the expression for a block of features and return a selection mask,
+     * which is true for the features for which the result of the expression converts
+     * to true.
+     * @param context context for evaluating expression, see evaluateBlock()
+     * @param features features to evaluate the expression for
+     * @note prepare() should be called before calling this method.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     * @see evaluateBlock()
+     */
+    QVector<bool> filterBlock( QgsExpressionContext* context, const QgsFeatureList& features );
+
     //! Returns true if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -1022,6 +1082,13 @@ class CORE_EXPORT QgsExpression
         virtual QVariant eval( QgsExpression* parent, const QgsExpressionContext* context ) override;
         virtual QString dump() const override;
 
+        /** Applies the operator to an already evaluated operand value.
+         * Errors are reported to the parent
+         * @note added in QGIS 2.16
+         * @note not available in Python bindings
+         */
+        QVariant evalOperand( QgsExpression* parent, const QVariant& value );
+
         virtual QStringList referencedColumns() const override { return mOperand->referencedColumns(); }
         virtual bool needsGeometry() const override { return mOperand->needsGeometry(); }
         virtual void accept( Visitor& v ) const override { v.visit( *this ); }
@@ -1051,6 +1118,13 @@ class CORE_EXPORT QgsExpression
         virtual QVariant eval( QgsExpression* parent, const QgsExpressionContext* context ) override;
         virtual QString dump() const override;
 
+        /** Applies the operator to already evaluated left and right operand values.
+         * Errors are reported to the parent
+         * @note added in QGIS 2.16
+         * @note not available in Python bindings
+         */
+        QVariant evalOperands( QgsExpression* parent, const QVariant& vL, const QVariant& vR );
+
         virtual QStringList referencedColumns() const override { return mOpLeft->referencedColumns() + mOpRight->referencedColumns(); }
         virtual bool needsGeometry() const override { return mOpLeft->needsGeometry() || mOpRight->needsGeometry(); }
         virtual void accept( Visitor& v ) const override { v.visit( *this ); }
@@ -1089,6 +1163,13 @@ class CORE_EXPORT QgsExpression
         virtual QVariant eval( QgsExpression* parent, const QgsExpressionContext* context ) override;
         virtual QString dump() const override;
 
+        /** Tests an already evaluated value against already evaluated list values.
+         * Errors are reported to the parent
+         * @note added in QGIS 2.16
+         * @note not available in Python bindings
+         */
+        QVariant evalValues( QgsExpression* parent, const QVariant& value, const QVariantList& listValues );
+
         virtual QStringList referencedColumns() const override { QStringList lst( mNode->referencedColumns() ); Q_FOREACH ( const Node* n, mList->list() ) lst.append( n->referencedColumns() ); return lst; }
         virtual bool needsGeometry() const override { bool needs = false; Q_FOREACH ( Node* n, mList->list() ) needs |= n->needsGeometry(); return needs; }
         virtual void accept( Visitor& v ) const override { v.visit( *this ); }
@@ -1320,6 +1401,18 @@ class CORE_EXPORT QgsExpression
         {}
         ~NodeCondition() { delete mElseExp; qDeleteAll( mConditions ); }
 
+        /** The WHEN ... THEN ... branches of the condition.
+         * @note added in QGIS 2.16
+         * @note not available in Python bindings
+         */
+        const WhenThenList& conditions() const { return mConditions; }
+
+        /** The ELSE expression, or nullptr if the condition has no ELSE branch.
+         * @note added in QGIS 2.16
+         * @note not available in Python bindings
+         */
+        Node* elseExp() const { return mElseExp; }
+
         virtual NodeType nodeType() const override { return ntCondition; }
         virtual QVariant eval( QgsExpression* parent, const QgsExpressionContext* context ) override;
         virtual bool prepare( QgsExpression* parent, const QgsExpressionContext* context ) override;
@@ -0,0 +1,1637 @@
+/***************************************************************************
+                         qgsexpressionbytecode.cpp
+                         -------------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionbytecode.h"
+
+#include <QtCore/qmath.h>
+#include <QVarLengthArray>
+
+#include <math.h>
+
+#include "qgsexpressioncontext.h"
+#include "qgsexpressionprivate.h"
+#include "qgsfeature.h"
+#include "qgsfield.h"
+
+///@cond PRIVATE
+
+QgsExpressionBytecode::QgsExpressionBytecode()
+    : mRegisterCount( 0 )
+    , mResultRegister( -1 )
+    , mNeedsFeature( false )
+    , mTreeNodes( 0 )
+    , mRoot( nullptr )
+    , mColumnar( false )
+{
+}
+
+//! built in functions whose result only depends on their arguments
+static const char* const sPureFunctions[] =
+{
+  "sqrt", "radians", "degrees", "azimuth", "project", "abs", "cos", "sin", "tan", "asin", "acos", "atan", "atan2",
+  "exp", "ln", "log10", "log", "round", "max", "min", "clamp", "scale_linear", "scale_exp", "floor", "ceil", "pi",
+  "to_int", "to_real", "to_string", "to_datetime", "to_date", "to_time", "to_interval", "coalesce", "if",
+  "regexp_match", "age", "year", "month", "week", "day", "hour", "minute", "second", "day_of_week",
+  "lower", "upper", "title", "trim", "levenshtein", "longest_common_substring", "hamming_distance", "soundex",
+  "wordwrap", "length", "replace", "regexp_replace", "regexp_substr", "substr", "concat", "strpos", "left", "right",
+  "rpad", "lpad", "format", "format_number", "format_date", "color_rgb", "color_rgba", "color_hsl", "color_hsla",
+  "color_hsv", "color_hsva", "color_cmyk", "color_cmyka", "color_part", "darker", "lighter", "set_color_part",
+  "area", "perimeter", "x", "y", "z", "m", "point_n", "start_point", "end_point", "make_point", "make_point_m",
+  "make_line", "make_polygon", "x_min", "x_max", "y_min", "y_max", "geom_from_wkt", "geom_from_gml", "relate",
+  "intersects_bbox", "disjoint", "intersects", "touches", "crosses", "contains", "overlaps", "within", "translate",
+  "buffer", "centroid", "point_on_surface", "reverse", "exterior_ring", "interior_ring_n", "geometry_n", "bounds",
+  "num_points", "num_interior_rings", "num_rings", "num_geometries", "bounds_width", "bounds_height", "is_closed",
+  "convex_hull", "difference", "distance", "intersection", "sym_difference", "combine", "union", "geom_to_wkt",
+  "extrude", "order_parts", "closest_point", "shortest_line", "nodes_to_points", "segments_to_lines",
+  nullptr
+};
+
+//! built in functions which may return a different result each time they are called
+static const char* const sVolatileFunctions[] =
+{
+  "rand", "randf", "now", "uuid", "eval",
+  nullptr
+};
+
+static bool containsName( const char* const* names, const QString& name )
+{
+  for ( ; *names; ++names )
+  {
+    if ( name == QLatin1String( *names ) )
+      return true;
+  }
+  return false;
+}
+
+QgsExpressionBytecode* QgsExpressionBytecode::compile( QgsExpression* parent, QgsExpression::Node* root, const QgsExpressionContext* context )
+{
+  if ( !root )
+    return nullptr;
+
+  QgsExpressionBytecode* bytecode = new QgsExpressionBytecode();
+  bytecode->mRoot = root;
+  bytecode->pushScope();
+  bytecode->mResultRegister = bytecode->compileNode( parent, root, context );
+  bytecode->mScopes.clear();
+  bytecode->mNodeKeys.clear();
+
+  if ( bytecode->mCode.count() == 1 && bytecode->mCode.at( 0 ).op == OpTree )
+  {
+    // nothing could be lowered, the tree walker is just as good
+    delete bytecode;
+    return nullptr;
+  }
+
+  bytecode->mColumnar = true;
+  Q_FOREACH ( const Instruction& ins, bytecode->mCode )
+  {
+    if ( ins.op != OpLoadConst && ins.op != OpLoadAttr && ins.op != OpUnary && ins.op != OpBinary && ins.op != OpIn && ins.op != OpShortCircuit )
+    {
+      bytecode->mColumnar = false;
+      break;
+    }
+  }
+
+  return bytecode;
+}
+
+int QgsExpressionBytecode::addInstruction( const Instruction& instruction )
+{
+  mCode.append( instruction );
+  return mCode.count() - 1;
+}
+
+int QgsExpressionBytecode::addConstant( const QVariant& value )
+{
+  Register reg;
+  setRegister( reg, value );
+  mConstants.append( reg );
+  return mConstants.count() - 1;
+}
+
+int QgsExpressionBytecode::treeNode( QgsExpression::Node* node )
+{
+  int dst = newRegister();
+  addInstruction( Instruction( OpTree, dst, -1, -1, -1, node ) );
+  mTreeNodes++;
+  return dst;
+}
+
+bool QgsExpressionBytecode::isConstant( QgsExpression::Node* node, const QgsExpressionContext* context, QStringList& variables ) const
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+      return true;
+
+    case QgsExpression::ntColumnRef:
+      return false;
+
+    case QgsExpression::ntUnaryOperator:
+      return isConstant( static_cast<QgsExpression::NodeUnaryOperator*>( node )->operand(), context, variables );
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      QgsExpression::NodeBinaryOperator* op = static_cast<QgsExpression::NodeBinaryOperator*>( node );
+      return isConstant( op->opLeft(), context, variables ) && isConstant( op->opRight(), context, variables );
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      QgsExpression::NodeInOperator* in = static_cast<QgsExpression::NodeInOperator*>( node );
+      if ( !isConstant( in->node(), context, variables ) )
+        return false;
+      Q_FOREACH ( QgsExpression::Node* n, in->list()->list() )
+      {
+        if ( !isConstant( n, context, variables ) )
+          return false;
+      }
+      return true;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      QgsExpression::NodeFunction* fn = static_cast<QgsExpression::NodeFunction*>( node );
+      QgsExpression::Function* fd = QgsExpression::Functions()[fn->fnIndex()];
+      if ( context && context->hasFunction( fd->name() ) )
+        return false;
+
+      QList<QgsExpression::Node*> args = fn->args() ? fn->args()->list() : QList<QgsExpression::Node*>();
+      if ( fd->name() == "var" )
+      {
+        // variables of static scopes do not change while the expression is evaluated
+        if ( !context || args.count() != 1 || args.at( 0 )->nodeType() != QgsExpression::ntLiteral )
+          return false;
+        QString name = static_cast<QgsExpression::NodeLiteral*>( args.at( 0 ) )->value().toString();
+        const QgsExpressionContextScope* scope = context->activeScopeForVariable( name );
+        if ( !scope || !scope->isStatic( name ) )
+          return false;
+        variables << name;
+        return true;
+      }
+
+      if ( !dynamic_cast<QgsExpression::StaticFunction*>( fd ) || !containsName( sPureFunctions, fd->name() ) )
+        return false;
+
+      Q_FOREACH ( QgsExpression::Node* n, args )
+      {
+        if ( !isConstant( n, context, variables ) )
+          return false;
+      }
+      return true;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      QgsExpression::NodeCondition* cond = static_cast<QgsExpression::NodeCondition*>( node );
+      Q_FOREACH ( QgsExpression::WhenThen* whenThen, cond->conditions() )
+      {
+        if ( !isConstant( whenThen->mWhenExp, context, variables ) || !isConstant( whenThen->mThenExp, context, variables ) )
+          return false;
+      }
+      return !cond->elseExp() || isConstant( cond->elseExp(), context, variables );
+    }
+  }
+
+  return false;
+}
+
+QString QgsExpressionBytecode::nodeKey( QgsExpression::Node* node, const QgsExpressionContext* context )
+{
+  // canonical text of a subtree, which identifies subexpressions always evaluating to the
+  // same value within one evaluation. Null for subtrees which must be evaluated each time.
+  QHash<QgsExpression::Node*, QString>::const_iterator it = mNodeKeys.constFind( node );
+  if ( it != mNodeKeys.constEnd() )
+    return it.value();
+
+  QString key;
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+    {
+      QVariant value = static_cast<QgsExpression::NodeLiteral*>( node )->value();
+      QString text = value.type() == QVariant::Double ? QString::number( value.toDouble(), 'g', 17 ) : value.toString();
+      key = QString( "lit(%1,%2,%3:%4)" ).arg( value.type() ).arg( value.isNull() ).arg( text.length() ).arg( text );
+      break;
+    }
+
+    case QgsExpression::ntColumnRef:
+    {
+      QString name = static_cast<QgsExpression::NodeColumnRef*>( node )->name();
+      key = QString( "col(%1:%2)" ).arg( name.length() ).arg( name );
+      break;
+    }
+
+    case QgsExpression::ntUnaryOperator:
+    {
+      QgsExpression::NodeUnaryOperator* op = static_cast<QgsExpression::NodeUnaryOperator*>( node );
+      QString operand = nodeKey( op->operand(), context );
+      if ( !operand.isNull() )
+        key = QString( "unary%1(%2)" ).arg( op->op() ).arg( operand );
+      break;
+    }
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      QgsExpression::NodeBinaryOperator* op = static_cast<QgsExpression::NodeBinaryOperator*>( node );
+      QString left = nodeKey( op->opLeft(), context );
+      QString right = nodeKey( op->opRight(), context );
+      if ( !left.isNull() && !right.isNull() )
+        key = QString( "binary%1(%2,%3)" ).arg( op->op() ).arg( left, right );
+      break;
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      QgsExpression::NodeInOperator* in = static_cast<QgsExpression::NodeInOperator*>( node );
+      QStringList keys;
+      keys << nodeKey( in->node(), context );
+      Q_FOREACH ( QgsExpression::Node* n, in->list()->list() )
+        keys << nodeKey( n, context );
+      if ( !keys.contains( QString() ) )
+        key = QString( "in%1(%2)" ).arg( in->isNotIn() ).arg( keys.join( "," ) );
+      break;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      QgsExpression::NodeFunction* fn = static_cast<QgsExpression::NodeFunction*>( node );
+      QgsExpression::Function* fd = QgsExpression::Functions()[fn->fnIndex()];
+      // functions registered by plugins or provided by the context may have side effects
+      if ( !dynamic_cast<QgsExpression::StaticFunction*>( fd ) || containsName( sVolatileFunctions, fd->name() )
+           || ( context && context->hasFunction( fd->name() ) ) )
+        break;
+
+      QStringList keys;
+      if ( fn->args() )
+      {
+        Q_FOREACH ( QgsExpression::Node* n, fn->args()->list() )
+          keys << nodeKey( n, context );
+      }
+      if ( !keys.contains( QString() ) )
+        key = QString( "fn%1(%2)" ).arg( fn->fnIndex() ).arg( keys.join( "," ) );
+      break;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      QgsExpression::NodeCondition* cond = static_cast<QgsExpression::NodeCondition*>( node );
+      QStringList keys;
+      Q_FOREACH ( QgsExpression::WhenThen* whenThen, cond->conditions() )
+        keys << nodeKey( whenThen->mWhenExp, context ) << nodeKey( whenThen->mThenExp, context );
+      keys << ( cond->elseExp() ? nodeKey( cond->elseExp(), context ) : QString( "" ) );
+      if ( !keys.contains( QString() ) )
+        key = QString( "case(%1)" ).arg( keys.join( "," ) );
+      break;
+    }
+  }
+
+  mNodeKeys.insert( node, key );
+  return key;
+}
+
+int QgsExpressionBytecode::compileNode( QgsExpression* parent, QgsExpression::Node* node, const QgsExpressionContext* context )
+{
+  if ( node->nodeType() == QgsExpression::ntLiteral )
+    return compileNodeUncached( parent, node, context );
+
+  // reuse the register of an identical subexpression, if it was computed on every path leading here
+  QString key = nodeKey( node, context );
+  if ( !key.isNull() )
+  {
+    for ( int i = mScopes.count() - 1; i >= 0; --i )
+    {
+      QHash<QString, int>::const_iterator it = mScopes.at( i ).constFind( key );
+      if ( it != mScopes.at( i ).constEnd() )
+      {
+        mOptimizations << QString( "reuse r%1 for %2" ).arg( it.value() ).arg( node->dump() );
+        return it.value();
+      }
+    }
+  }
+
+  int dst = compileNodeUncached( parent, node, context );
+  if ( !key.isNull() )
+    mScopes.last().insert( key, dst );
+  return dst;
+}
+
+int QgsExpressionBytecode::compileNodeUncached( QgsExpression* parent, QgsExpression::Node* node, const QgsExpressionContext* context )
+{
+  QStringList variables;
+  if ( node->nodeType() != QgsExpression::ntLiteral && isConstant( node, context, variables ) )
+  {
+    QVariant value = node->eval( parent, context );
+    if ( !parent->hasEvalError() )
+    {
+      // the scopes of the evaluation context may differ from the ones of the preparation
+      Q_FOREACH ( const QString& name, variables )
+        mFoldedVariables.insert( name, context->variable( name ) );
+
+      int dst = newRegister();
+      addInstruction( Instruction( OpLoadConst, dst, addConstant( value ), -1, -1, node ) );
+      mOptimizations << QString( "fold %1 to r%2" ).arg( node->dump() ).arg( dst );
+      return dst;
+    }
+
+    // leave the error to the evaluation
+    parent->setEvalErrorString( QString() );
+  }
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+    {
+      int dst = newRegister();
+      addInstruction( Instruction( OpLoadConst, dst, addConstant( static_cast<QgsExpression::NodeLiteral*>( node )->value() ) ) );
+      return dst;
+    }
+
+    case QgsExpression::ntColumnRef:
+    {
+      if ( !context || !context->hasVariable( QgsExpressionContext::EXPR_FIELDS ) )
+        return treeNode( node );
+
+      QgsFields fields = qvariant_cast<QgsFields>( context->variable( QgsExpressionContext::EXPR_FIELDS ) );
+      int index = fields.fieldNameIndex( static_cast<QgsExpression::NodeColumnRef*>( node )->name() );
+      if ( index < 0 )
+        return treeNode( node );
+
+      int dst = newRegister();
+      addInstruction( Instruction( OpLoadAttr, dst, index ) );
+      mNeedsFeature = true;
+      return dst;
+    }
+
+    case QgsExpression::ntUnaryOperator:
+    {
+      QgsExpression::NodeUnaryOperator* op = static_cast<QgsExpression::NodeUnaryOperator*>( node );
+      int operand = compileNode( parent, op->operand(), context );
+      int dst = newRegister();
+      addInstruction( Instruction( OpUnary, dst, operand, -1, op->op(), node ) );
+      return dst;
+    }
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      QgsExpression::NodeBinaryOperator* op = static_cast<QgsExpression::NodeBinaryOperator*>( node );
+      int left = compileNode( parent, op->opLeft(), context );
+      int dst = newRegister();
+      if ( op->op() != QgsExpression::boAnd && op->op() != QgsExpression::boOr )
+      {
+        int right = compileNode( parent, op->opRight(), context );
+        addInstruction( Instruction( OpBinary, dst, left, right, op->op(), node ) );
+        return dst;
+      }
+
+      // the right operand is only evaluated if the left one does not decide the result
+      int shortCircuit = addInstruction( Instruction( OpShortCircuit, dst, left, -1, op->op(), node ) );
+      pushScope();
+      int right = compileNode( parent, op->opRight(), context );
+      popScope();
+      addInstruction( Instruction( OpBinary, dst, left, right, op->op(), node ) );
+      mCode[shortCircuit].b = mCode.count();
+      return dst;
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      QgsExpression::NodeInOperator* in = static_cast<QgsExpression::NodeInOperator*>( node );
+      QVariantList values;
+      Q_FOREACH ( QgsExpression::Node* n, in->list()->list() )
+      {
+        if ( n->nodeType() != QgsExpression::ntLiteral )
+          return treeNode( node );
+        values << static_cast<QgsExpression::NodeLiteral*>( n )->value();
+      }
+
+      if ( values.isEmpty() )
+      {
+        // the tested value is not even evaluated for an empty list
+        int dst = newRegister();
+        addInstruction( Instruction( OpLoadConst, dst, addConstant( in->isNotIn() ? TVL_True : TVL_False ) ) );
+        return dst;
+      }
+
+      int value = compileNode( parent, in->node(), context );
+      mLists.append( values );
+      int dst = newRegister();
+      addInstruction( Instruction( OpIn, dst, value, mLists.count() - 1, -1, node ) );
+      return dst;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      QgsExpression::NodeFunction* fn = static_cast<QgsExpression::NodeFunction*>( node );
+      QgsExpression::Function* fd = QgsExpression::Functions()[fn->fnIndex()];
+      if ( fd->lazyEval() )
+      {
+        // the function evaluates its argument nodes itself
+        return treeNode( node );
+      }
+
+      int dst = newRegister();
+      mFunctionNames << fd->name();
+      int guard = addInstruction( Instruction( OpCallGuard, dst, -1, -1, mFunctionNames.count() - 1, node ) );
+
+      // arguments are evaluated in order, and like in the tree walker the first NULL
+      // argument ends the evaluation for functions which do not handle NULL.
+      // The guard may skip all of them, so they are not reused outside of the call.
+      QVector<int> args;
+      QList<int> exits;
+      exits << guard;
+      pushScope();
+      if ( fn->args() )
+      {
+        Q_FOREACH ( QgsExpression::Node* n, fn->args()->list() )
+        {
+          int arg = compileNode( parent, n, context );
+          args << arg;
+          if ( !fd->handlesNull() )
+            exits << addInstruction( Instruction( OpJumpIfNull, dst, arg ) );
+        }
+      }
+      popScope();
+      mArgLists.append( args );
+      addInstruction( Instruction( OpCall, dst, mArgLists.count() - 1, -1, -1, node ) );
+
+      Q_FOREACH ( int jump, exits )
+        mCode[jump].b = mCode.count();
+      return dst;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      QgsExpression::NodeCondition* cond = static_cast<QgsExpression::NodeCondition*>( node );
+      int dst = newRegister();
+      QList<int> exits;
+      int scopes = 0;
+      Q_FOREACH ( QgsExpression::WhenThen* whenThen, cond->conditions() )
+      {
+        // each condition is only evaluated if the previous ones did not match
+        int when = compileNode( parent, whenThen->mWhenExp, context );
+        int next = addInstruction( Instruction( OpJumpIfNotTrue, -1, when ) );
+        pushScope();
+        int then = compileNode( parent, whenThen->mThenExp, context );
+        addInstruction( Instruction( OpMove, dst, then ) );
+        popScope();
+        exits << addInstruction( Instruction( OpJump ) );
+        mCode[next].b = mCode.count();
+        pushScope();
+        scopes++;
+      }
+
+      if ( cond->elseExp() )
+      {
+        int elseReg = compileNode( parent, cond->elseExp(), context );
+        addInstruction( Instruction( OpMove, dst, elseReg ) );
+      }
+      else
+      {
+        // NULL if no condition is matching
+        addInstruction( Instruction( OpLoadConst, dst, addConstant( QVariant() ) ) );
+      }
+
+      while ( scopes-- > 0 )
+        popScope();
+
+      Q_FOREACH ( int jump, exits )
+        mCode[jump].b = mCode.count();
+      return dst;
+    }
+  }
+
+  return treeNode( node );
+}
+
+void QgsExpressionBytecode::setRegister( Register& reg, const QVariant& value )
+{
+  if ( value.isNull() )
+  {
+    // keep the original value, typed NULL values are returned as they are by the tree walker
+    reg.kind = KindNull;
+    reg.v = value;
+    return;
+  }
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+      reg.kind = KindInt;
+      reg.i = value.toInt();
+      break;
+
+    case QVariant::Double:
+      reg.d = value.toDouble();
+      if ( qIsFinite( reg.d ) )
+      {
+        reg.kind = KindDouble;
+      }
+      else
+      {
+        // the node tree reports conversion errors for these
+        reg.kind = KindVariant;
+        reg.v = value;
+      }
+      break;
+
+    case QVariant::String:
+      reg.kind = KindString;
+      reg.s = value.toString();
+      break;
+
+    default:
+      reg.kind = KindVariant;
+      reg.v = value;
+      break;
+  }
+}
+
+QVariant QgsExpressionBytecode::variant( const Register& reg )
+{
+  switch ( reg.kind )
+  {
+    case KindBool:
+    case KindInt:
+      return QVariant( reg.i );
+    case KindDouble:
+      return QVariant( reg.d );
+    case KindString:
+      return QVariant( reg.s );
+    case KindNull:
+    case KindVariant:
+      break;
+  }
+  return reg.v;
+}
+
+static void setTvl( QgsExpressionBytecode::Register& reg, TVL value )
+{
+  if ( value == Unknown )
+  {
+    reg.kind = QgsExpressionBytecode::KindNull;
+    reg.v = QVariant();
+  }
+  else
+  {
+    reg.kind = QgsExpressionBytecode::KindBool;
+    reg.i = value == True ? 1 : 0;
+  }
+}
+
+static void setDouble( QgsExpressionBytecode::Register& reg, double value )
+{
+  reg.d = value;
+  if ( qIsFinite( value ) )
+  {
+    reg.kind = QgsExpressionBytecode::KindDouble;
+  }
+  else
+  {
+    reg.kind = QgsExpressionBytecode::KindVariant;
+    reg.v = QVariant( value );
+  }
+}
+
+//! three value logic for null and numeric registers, other kinds are converted by getTVLValue()
+static TVL tvl( const QgsExpressionBytecode::Register& reg )
+{
+  switch ( reg.kind )
+  {
+    case QgsExpressionBytecode::KindBool:
+    case QgsExpressionBytecode::KindInt:
+      return reg.i != 0 ? True : False;
+    case QgsExpressionBytecode::KindDouble:
+      return !qgsDoubleNear( reg.d, 0.0 ) ? True : False;
+    default:
+      return Unknown;
+  }
+}
+
+bool QgsExpressionBytecode::fastUnary( QgsExpression::UnaryOperator op, const Register& operand, Register& out )
+{
+  if ( op == QgsExpression::uoNot && ( isNumeric( operand ) || operand.kind == KindNull ) )
+  {
+    setTvl( out, NOT[tvl( operand )] );
+    return true;
+  }
+  if ( op == QgsExpression::uoMinus && ( operand.kind == KindInt || operand.kind == KindBool ) )
+  {
+    out.kind = KindInt;
+    out.i = -operand.i;
+    return true;
+  }
+  if ( op == QgsExpression::uoMinus && operand.kind == KindDouble )
+  {
+    out.kind = KindDouble;
+    out.d = -operand.d;
+    return true;
+  }
+  return false;
+}
+
+bool QgsExpressionBytecode::fastBinary( QgsExpression::BinaryOperator op, const Register& l, const Register& r, Register& out ) const
+{
+  const bool numeric = isNumeric( l ) && isNumeric( r );
+  const bool anyNull = l.kind == KindNull || r.kind == KindNull;
+
+  switch ( op )
+  {
+    case QgsExpression::boPlus:
+      if ( l.kind == KindString && r.kind == KindString )
+      {
+        out.kind = KindString;
+        out.s = l.s + r.s;
+        return true;
+      }
+      FALLTHROUGH;
+    case QgsExpression::boMinus:
+    case QgsExpression::boMul:
+    case QgsExpression::boDiv:
+    case QgsExpression::boMod:
+    {
+      if ( !numeric )
+        return false;
+
+      if ( op != QgsExpression::boDiv && l.kind != KindDouble && r.kind != KindDouble )
+      {
+        // both are integers - integer arithmetics, like the node tree
+        if ( op == QgsExpression::boMod && r.i == 0 )
+        {
+          setTvl( out, Unknown );
+          return true;
+        }
+
+        out.kind = KindInt;
+        switch ( op )
+        {
+          case QgsExpression::boPlus:
+            out.i = l.i + r.i;
+            break;
+          case QgsExpression::boMinus:
+            out.i = l.i - r.i;
+            break;
+          case QgsExpression::boMul:
+            out.i = l.i * r.i;
+            break;
+          default:
+            out.i = l.i % r.i;
+            break;
+        }
+        return true;
+      }
+
+      double fL = number( l );
+      double fR = number( r );
+      if (( op == QgsExpression::boDiv || op == QgsExpression::boMod ) && fR == 0. )
+      {
+        // silently handle division by zero and return NULL
+        setTvl( out, Unknown );
+        return true;
+      }
+
+      switch ( op )
+      {
+        case QgsExpression::boPlus:
+          setDouble( out, fL + fR );
+          break;
+        case QgsExpression::boMinus:
+          setDouble( out, fL - fR );
+          break;
+        case QgsExpression::boMul:
+          setDouble( out, fL * fR );
+          break;
+        case QgsExpression::boDiv:
+          setDouble( out, fL / fR );
+          break;
+        default:
+          setDouble( out, fmod( fL, fR ) );
+          break;
+      }
+      return true;
+    }
+
+    case QgsExpression::boIntDiv:
+      if ( !numeric )
+        return false;
+      if ( number( r ) == 0. )
+      {
+        setTvl( out, Unknown );
+      }
+      else
+      {
+        out.kind = KindInt;
+        out.i = qFloor( number( l ) / number( r ) );
+      }
+      return true;
+
+    case QgsExpression::boPow:
+      if ( anyNull )
+      {
+        setTvl( out, Unknown );
+        return true;
+      }
+      if ( !numeric )
+        return false;
+      setDouble( out, pow( number( l ), number( r ) ) );
+      return true;
+
+    case QgsExpression::boAnd:
+    case QgsExpression::boOr:
+    {
+      if (( !isNumeric( l ) && l.kind != KindNull ) || ( !isNumeric( r ) && r.kind != KindNull ) )
+        return false;
+      TVL tvlL = tvl( l ), tvlR = tvl( r );
+      setTvl( out, op == QgsExpression::boAnd ? AND[tvlL][tvlR] : OR[tvlL][tvlR] );
+      return true;
+    }
+
+    case QgsExpression::boEQ:
+    case QgsExpression::boNE:
+    case QgsExpression::boLT:
+    case QgsExpression::boGT:
+    case QgsExpression::boLE:
+    case QgsExpression::boGE:
+    {
+      if ( anyNull )
+      {
+        setTvl( out, Unknown );
+        return true;
+      }
+      if ( !numeric )
+        return false;
+
+      double diff = number( l ) - number( r );
+      bool result;
+      switch ( op )
+      {
+        case QgsExpression::boEQ:
+          result = qgsDoubleNear( diff, 0.0 );
+          break;
+        case QgsExpression::boNE:
+          result = !qgsDoubleNear( diff, 0.0 );
+          break;
+        case QgsExpression::boLT:
+          result = diff < 0;
+          break;
+        case QgsExpression::boGT:
+          result = diff > 0;
+          break;
+        case QgsExpression::boLE:
+          result = diff <= 0;
+          break;
+        default:
+          result = diff >= 0;
+          break;
+      }
+      setTvl( out, result ? True : False );
+      return true;
+    }
+
+    case QgsExpression::boIs:
+    case QgsExpression::boIsNot:
+    {
+      bool equal;
+      if ( l.kind == KindNull || r.kind == KindNull )
+        equal = l.kind == r.kind;
+      else if ( numeric )
+        equal = qgsDoubleNear( number( l ), number( r ) );
+      else
+        return false;
+
+      setTvl( out, equal == ( op == QgsExpression::boIs ) ? True : False );
+      return true;
+    }
+
+    case QgsExpression::boRegexp:
+    case QgsExpression::boLike:
+    case QgsExpression::boNotLike:
+    case QgsExpression::boILike:
+    case QgsExpression::boNotILike:
+      if ( !anyNull )
+        return false;
+      setTvl( out, Unknown );
+      return true;
+
+    case QgsExpression::boConcat:
+      if ( anyNull )
+      {
+        setTvl( out, Unknown );
+        return true;
+      }
+      if ( l.kind != KindString || r.kind != KindString )
+        return false;
+      out.kind = KindString;
+      out.s = l.s + r.s;
+      return true;
+  }
+
+  return false;
+}
+
+bool QgsExpressionBytecode::foldedVariablesMatch( const QgsExpressionContext* context ) const
+{
+  if ( mFoldedVariables.isEmpty() )
+    return true;
+  if ( !context )
+    return false;
+
+  QHash<QString, QVariant>::const_iterator it = mFoldedVariables.constBegin();
+  for ( ; it != mFoldedVariables.constEnd(); ++it )
+  {
+    // resolved through the whole scope chain, a scope above the static one may shadow the variable
+    if ( context->variable( it.key() ) != it.value() )
+      return false;
+  }
+  return true;
+}
+
+QVariant QgsExpressionBytecode::run( QgsExpression* parent, const QgsExpressionContext* context )
+{
+  if ( !foldedVariablesMatch( context ) )
+    return mRoot->eval( parent, context );
+
+  QgsFeature feature;
+  if ( mNeedsFeature )
+  {
+    if ( !context || !context->hasVariable( QgsExpressionContext::EXPR_FEATURE ) )
+    {
+      // the tree walker has a special representation of column references without a feature
+      return mRoot->eval( parent, context );
+    }
+    feature = context->feature();
+  }
+
+  // the bytecode is shared by the copies of the expression, which may be evaluated
+  // concurrently or recursively: every evaluation gets registers of its own
+  QVarLengthArray<Register, 32> registers( mRegisterCount );
+  Register* regs = registers.data();
+  const Instruction* code = mCode.constData();
+  const int count = mCode.count();
+
+  int pc = 0;
+  while ( pc < count )
+  {
+    const Instruction& ins = code[pc++];
+    switch ( ins.op )
+    {
+      case OpLoadConst:
+        regs[ins.dst] = mConstants.at( ins.a );
+        break;
+
+      case OpLoadAttr:
+        setRegister( regs[ins.dst], feature.attribute( ins.a ) );
+        break;
+
+      case OpMove:
+        regs[ins.dst] = regs[ins.a];
+        break;
+
+      case OpUnary:
+      {
+        const Register& operand = regs[ins.a];
+        Register& out = regs[ins.dst];
+        if ( !fastUnary( static_cast<QgsExpression::UnaryOperator>( ins.c ), operand, out ) )
+        {
+          setRegister( out, static_cast<QgsExpression::NodeUnaryOperator*>( ins.node )->evalOperand( parent, variant( operand ) ) );
+          if ( parent->hasEvalError() )
+            return QVariant();
+        }
+        break;
+      }
+
+      case OpBinary:
+      {
+        const Register& left = regs[ins.a];
+        const Register& right = regs[ins.b];
+        Register& out = regs[ins.dst];
+        if ( !fastBinary( static_cast<QgsExpression::BinaryOperator>( ins.c ), left, right, out ) )
+        {
+          setRegister( out, static_cast<QgsExpression::NodeBinaryOperator*>( ins.node )->evalOperands( parent, variant( left ), variant( right ) ) );
+          if ( parent->hasEvalError() )
+            return QVariant();
+        }
+        break;
+      }
+
+      case OpIn:
+        setRegister( regs[ins.dst], static_cast<QgsExpression::NodeInOperator*>( ins.node )->evalValues( parent, variant( regs[ins.a] ), mLists.at( ins.b ) ) );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        break;
+
+      case OpCallGuard:
+        if ( context && context->hasFunction( mFunctionNames.at( ins.c ) ) )
+        {
+          // functions provided by the context take precedence over the built in ones
+          setRegister( regs[ins.dst], ins.node->eval( parent, context ) );
+          if ( parent->hasEvalError() )
+            return QVariant();
+          pc = ins.b;
+        }
+        break;
+
+      case OpJumpIfNull:
+        if ( regs[ins.a].kind == KindNull )
+        {
+          // all "normal" functions return NULL, when any parameter is NULL
+          setTvl( regs[ins.dst], Unknown );
+          pc = ins.b;
+        }
+        break;
+
+      case OpCall:
+      {
+        QgsExpression::NodeFunction* fn = static_cast<QgsExpression::NodeFunction*>( ins.node );
+        QgsExpression::Function* fd = QgsExpression::Functions()[fn->fnIndex()];
+
+        const QVector<int>& args = mArgLists.at( ins.a );
+        QVariantList argValues;
+        argValues.reserve( args.count() );
+        Q_FOREACH ( int arg, args )
+          argValues.append( variant( regs[arg] ) );
+
+        QVariant res = fd->func( argValues, context, parent );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        setRegister( regs[ins.dst], res );
+        break;
+      }
+
+      case OpTree:
+        setRegister( regs[ins.dst], ins.node->eval( parent, context ) );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        break;
+
+      case OpJumpIfNotTrue:
+      {
+        const Register& cond = regs[ins.a];
+        TVL value = isNumeric( cond ) || cond.kind == KindNull ? tvl( cond ) : getTVLValue( variant( cond ), parent );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        if ( value != True )
+          pc = ins.b;
+        break;
+      }
+
+      case OpJump:
+        pc = ins.b;
+        break;
+
+      case OpShortCircuit:
+      {
+        const Register& left = regs[ins.a];
+        TVL value = isNumeric( left ) || left.kind == KindNull ? tvl( left ) : getTVLValue( variant( left ), parent );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        if ( ( ins.c == QgsExpression::boAnd && value == False ) || ( ins.c == QgsExpression::boOr && value == True ) )
+        {
+          setTvl( regs[ins.dst], value );
+          pc = ins.b;
+        }
+        break;
+      }
+    }
+  }
+
+  return variant( regs[mResultRegister] );
+}
+
+QgsExpressionBytecode::Register QgsExpressionBytecode::element( const Column& column, int row )
+{
+  Register reg;
+  switch ( column.kind )
+  {
+    case KindBool:
+    case KindInt:
+      reg.kind = column.kind;
+      reg.i = column.i.at( row );
+      return reg;
+    case KindDouble:
+      reg.kind = KindDouble;
+      reg.d = column.d.at( row );
+      return reg;
+    default:
+      break;
+  }
+  return column.values.at( row );
+}
+
+void QgsExpressionBytecode::broadcast( const Register& value, int count, Column& out )
+{
+  out.kind = value.kind;
+  switch ( value.kind )
+  {
+    case KindBool:
+    case KindInt:
+      out.i.fill( value.i, count );
+      break;
+    case KindDouble:
+      out.d.fill( value.d, count );
+      break;
+    default:
+      out.kind = KindVariant;
+      out.values.fill( value, count );
+      break;
+  }
+}
+
+void QgsExpressionBytecode::compact( Column& column )
+{
+  // switch to unboxed storage if all values are of the same numeric kind
+  const int count = column.values.count();
+  const Register* values = column.values.constData();
+  const ValueKind kind = count > 0 ? values[0].kind : KindVariant;
+  column.kind = KindVariant;
+  if ( kind != KindInt && kind != KindBool && kind != KindDouble )
+    return;
+
+  for ( int row = 1; row < count; ++row )
+  {
+    if ( values[row].kind != kind )
+      return;
+  }
+
+  if ( kind == KindDouble )
+  {
+    column.d.resize( count );
+    double* d = column.d.data();
+    for ( int row = 0; row < count; ++row )
+      d[row] = values[row].d;
+  }
+  else
+  {
+    column.i.resize( count );
+    int* i = column.i.data();
+    for ( int row = 0; row < count; ++row )
+      i[row] = values[row].i;
+  }
+  column.kind = kind;
+}
+
+void QgsExpressionBytecode::setElement( Column& column, int row, const Register& value )
+{
+  // back to boxed storage, call compact() once done
+  if ( column.kind == KindInt || column.kind == KindBool || column.kind == KindDouble )
+  {
+    const int count = column.kind == KindDouble ? column.d.count() : column.i.count();
+    column.values.resize( count );
+    for ( int r = 0; r < count; ++r )
+      column.values[r] = element( column, r );
+    column.kind = KindVariant;
+  }
+  column.values[row] = value;
+}
+
+//! returns the values of a numeric column as doubles, converting integer columns into scratch
+static const double* columnDoubles( const QgsExpressionBytecode::Column& column, int count, QVector<double>& scratch )
+{
+  if ( column.kind == QgsExpressionBytecode::KindDouble )
+    return column.d.constData();
+
+  scratch.resize( count );
+  const int* i = column.i.constData();
+  double* d = scratch.data();
+  for ( int row = 0; row < count; ++row )
+    d[row] = i[row];
+  return d;
+}
+
+static bool allFinite( const double* values, int count )
+{
+  for ( int row = 0; row < count; ++row )
+  {
+    if ( !qIsFinite( values[row] ) )
+      return false;
+  }
+  return true;
+}
+
+static bool anyZero( const double* values, int count )
+{
+  for ( int row = 0; row < count; ++row )
+  {
+    if ( values[row] == 0. )
+      return true;
+  }
+  return false;
+}
+
+bool QgsExpressionBytecode::columnUnary( QgsExpression::UnaryOperator op, const Column& operand, int count, Column& out )
+{
+  if ( operand.kind == KindVariant )
+    return false;
+
+  if ( op == QgsExpression::uoNot )
+  {
+    QVector<double> scratch;
+    const double* a = columnDoubles( operand, count, scratch );
+    out.kind = KindBool;
+    out.i.resize( count );
+    int* o = out.i.data();
+    for ( int row = 0; row < count; ++row )
+      o[row] = qgsDoubleNear( a[row], 0.0 ) ? 1 : 0;
+    return true;
+  }
+
+  if ( op == QgsExpression::uoMinus && operand.kind == KindDouble )
+  {
+    out.kind = KindDouble;
+    out.d.resize( count );
+    const double* a = operand.d.constData();
+    double* o = out.d.data();
+    for ( int row = 0; row < count; ++row )
+      o[row] = -a[row];
+    return true;
+  }
+
+  if ( op == QgsExpression::uoMinus )
+  {
+    out.kind = KindInt;
+    out.i.resize( count );
+    const int* a = operand.i.constData();
+    int* o = out.i.data();
+    for ( int row = 0; row < count; ++row )
+      o[row] = -a[row];
+    return true;
+  }
+
+  return false;
+}
+
+bool QgsExpressionBytecode::columnBinary( QgsExpression::BinaryOperator op, const Column& l, const Column& r, int count, Column& out )
+{
+  // only columns of numbers (which are never NULL) are handled here, the loops
+  // below are the column counterparts of fastBinary()
+  if ( l.kind == KindVariant || r.kind == KindVariant )
+    return false;
+
+  const bool integers = l.kind != KindDouble && r.kind != KindDouble;
+
+  switch ( op )
+  {
+    case QgsExpression::boPlus:
+    case QgsExpression::boMinus:
+    case QgsExpression::boMul:
+    case QgsExpression::boMod:
+      if ( integers )
+      {
+        const int* a = l.i.constData();
+        const int* b = r.i.constData();
+        if ( op == QgsExpression::boMod )
+        {
+          for ( int row = 0; row < count; ++row )
+          {
+            if ( b[row] == 0 )
+              return false;
+          }
+        }
+
+        out.kind = KindInt;
+        out.i.resize( count );
+        int* o = out.i.data();
+        switch ( op )
+        {
+          case QgsExpression::boPlus:
+            for ( int row = 0; row < count; ++row )
+              o[row] = a[row] + b[row];
+            break;
+          case QgsExpression::boMinus:
+            for ( int row = 0; row < count; ++row )
+              o[row] = a[row] - b[row];
+            break;
+          case QgsExpression::boMul:
+            for ( int row = 0; row < count; ++row )
+              o[row] = a[row] * b[row];
+            break;
+          default:
+            for ( int row = 0; row < count; ++row )
+              o[row] = a[row] % b[row];
+            break;
+        }
+        return true;
+      }
+      FALLTHROUGH;
+    case QgsExpression::boDiv:
+    case QgsExpression::boPow:
+    {
+      QVector<double> scratchL, scratchR;
+      const double* a = columnDoubles( l, count, scratchL );
+      const double* b = columnDoubles( r, count, scratchR );
+      if (( op == QgsExpression::boDiv || op == QgsExpression::boMod ) && anyZero( b, count ) )
+        return false;
+
+      out.d.resize( count );
+      double* o = out.d.data();
+      switch ( op )
+      {
+        case QgsExpression::boPlus:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] + b[row];
+          break;
+        case QgsExpression::boMinus:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] - b[row];
+          break;
+        case QgsExpression::boMul:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] * b[row];
+          break;
+        case QgsExpression::boDiv:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] / b[row];
+          break;
+        case QgsExpression::boMod:
+          for ( int row = 0; row < count; ++row )
+            o[row] = fmod( a[row], b[row] );
+          break;
+        default:
+          for ( int row = 0; row < count; ++row )
+            o[row] = pow( a[row], b[row] );
+          break;
+      }
+
+      // infinite and NaN results are not plain doubles, let the element wise path handle them
+      out.kind = KindDouble;
+      return allFinite( o, count );
+    }
+
+    case QgsExpression::boIntDiv:
+    {
+      QVector<double> scratchL, scratchR;
+      const double* a = columnDoubles( l, count, scratchL );
+      const double* b = columnDoubles( r, count, scratchR );
+      if ( anyZero( b, count ) )
+        return false;
+
+      out.kind = KindInt;
+      out.i.resize( count );
+      int* o = out.i.data();
+      for ( int row = 0; row < count; ++row )
+        o[row] = qFloor( a[row] / b[row] );
+      return true;
+    }
+
+    case QgsExpression::boAnd:
+    case QgsExpression::boOr:
+    case QgsExpression::boEQ:
+    case QgsExpression::boNE:
+    case QgsExpression::boLT:
+    case QgsExpression::boGT:
+    case QgsExpression::boLE:
+    case QgsExpression::boGE:
+    case QgsExpression::boIs:
+    case QgsExpression::boIsNot:
+    {
+      QVector<double> scratchL, scratchR;
+      const double* a = columnDoubles( l, count, scratchL );
+      const double* b = columnDoubles( r, count, scratchR );
+
+      out.kind = KindBool;
+      out.i.resize( count );
+      int* o = out.i.data();
+      switch ( op )
+      {
+        case QgsExpression::boAnd:
+          for ( int row = 0; row < count; ++row )
+            o[row] = !qgsDoubleNear( a[row], 0.0 ) && !qgsDoubleNear( b[row], 0.0 );
+          break;
+        case QgsExpression::boOr:
+          for ( int row = 0; row < count; ++row )
+            o[row] = !qgsDoubleNear( a[row], 0.0 ) || !qgsDoubleNear( b[row], 0.0 );
+          break;
+        case QgsExpression::boEQ:
+          for ( int row = 0; row < count; ++row )
+            o[row] = qgsDoubleNear( a[row] - b[row], 0.0 );
+          break;
+        case QgsExpression::boNE:
+          for ( int row = 0; row < count; ++row )
+            o[row] = !qgsDoubleNear( a[row] - b[row], 0.0 );
+          break;
+        case QgsExpression::boLT:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] - b[row] < 0;
+          break;
+        case QgsExpression::boGT:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] - b[row] > 0;
+          break;
+        case QgsExpression::boLE:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] - b[row] <= 0;
+          break;
+        case QgsExpression::boGE:
+          for ( int row = 0; row < count; ++row )
+            o[row] = a[row] - b[row] >= 0;
+          break;
+        case QgsExpression::boIs:
+          for ( int row = 0; row < count; ++row )
+            o[row] = qgsDoubleNear( a[row], b[row] );
+          break;
+        default:
+          for ( int row = 0; row < count; ++row )
+            o[row] = !qgsDoubleNear( a[row], b[row] );
+          break;
+      }
+      return true;
+    }
+
+    default:
+      break;
+  }
+
+  return false;
+}
+
+void QgsExpressionBytecode::runElementwise( QgsExpression* parent, const Instruction& ins, int count, int& lastErrorRow, BlockState& state ) const
+{
+  Column& out = state.columns[ins.dst];
+  out.kind = KindVariant;
+  out.values.resize( count );
+  Register* values = out.values.data();
+
+  for ( int row = 0; row < count; ++row )
+  {
+    Register& value = values[row];
+    if ( state.rowErrors.at( row ) )
+    {
+      // the evaluation of this feature already failed
+      setTvl( value, Unknown );
+      continue;
+    }
+
+    QVariant res;
+    switch ( ins.op )
+    {
+      case OpUnary:
+      {
+        Register operand = element( state.columns.at( ins.a ), row );
+        if ( fastUnary( static_cast<QgsExpression::UnaryOperator>( ins.c ), operand, value ) )
+          continue;
+        res = static_cast<QgsExpression::NodeUnaryOperator*>( ins.node )->evalOperand( parent, variant( operand ) );
+        break;
+      }
+
+      case OpBinary:
+      {
+        Register left = element( state.columns.at( ins.a ), row );
+        Register right = element( state.columns.at( ins.b ), row );
+        if ( fastBinary( static_cast<QgsExpression::BinaryOperator>( ins.c ), left, right, value ) )
+          continue;
+        res = static_cast<QgsExpression::NodeBinaryOperator*>( ins.node )->evalOperands( parent, variant( left ), variant( right ) );
+        break;
+      }
+
+      default:
+        res = static_cast<QgsExpression::NodeInOperator*>( ins.node )->evalValues( parent, variant( element( state.columns.at( ins.a ), row ) ), mLists.at( ins.b ) );
+        break;
+    }
+
+    if ( parent->hasEvalError() )
+    {
+      blockError( parent, row, lastErrorRow, state );
+      setTvl( value, Unknown );
+    }
+    else
+    {
+      setRegister( value, res );
+    }
+  }
+
+  compact( out );
+}
+
+void QgsExpressionBytecode::blockError( QgsExpression* parent, int row, int& lastErrorRow, BlockState& state )
+{
+  // like the tree walker, stop evaluating this feature at its first error, unless the
+  // error comes from the right operand of AND / OR which is skipped for this feature
+  if ( state.suppressedErrors.at( row ) == 0 )
+  {
+    state.rowErrors[row] = true;
+    lastErrorRow = qMax( lastErrorRow, row );
+    if ( lastErrorRow == row )
+      state.error = parent->evalErrorString();
+  }
+  parent->setEvalErrorString( QString() );
+}
+
+void QgsExpressionBytecode::runShortCircuit( QgsExpression* parent, const Instruction& ins, int count, int& lastErrorRow, BlockState& state ) const
+{
+  // the right operand is computed for the whole block, the decided features get their
+  // result when the operator is complete and ignore the errors until then
+  ShortCircuit shortCircuit;
+  shortCircuit.target = ins.b;
+  shortCircuit.dst = ins.dst;
+  setTvl( shortCircuit.value, ins.c == QgsExpression::boAnd ? False : True );
+
+  const Column& left = state.columns.at( ins.a );
+  for ( int row = 0; row < count; ++row )
+  {
+    if ( state.rowErrors.at( row ) )
+      continue;
+
+    Register value = element( left, row );
+    TVL tvlL = isNumeric( value ) || value.kind == KindNull ? tvl( value ) : getTVLValue( variant( value ), parent );
+    if ( parent->hasEvalError() )
+    {
+      blockError( parent, row, lastErrorRow, state );
+      continue;
+    }
+    if ( ( ins.c == QgsExpression::boAnd && tvlL == False ) || ( ins.c == QgsExpression::boOr && tvlL == True ) )
+    {
+      shortCircuit.rows << row;
+      state.suppressedErrors[row]++;
+    }
+  }
+  state.shortCircuits << shortCircuit;
+}
+
+void QgsExpressionBytecode::endShortCircuit( BlockState& state )
+{
+  ShortCircuit shortCircuit = state.shortCircuits.takeLast();
+  if ( shortCircuit.rows.isEmpty() )
+    return;
+
+  Column& out = state.columns[shortCircuit.dst];
+  Q_FOREACH ( int row, shortCircuit.rows )
+  {
+    setElement( out, row, shortCircuit.value );
+    state.suppressedErrors[row]--;
+  }
+  compact( out );
+}
+
+void QgsExpressionBytecode::runColumns( QgsExpression* parent, const QgsFeatureList& features, BlockState& state ) const
+{
+  const int count = features.count();
+  state.columns.resize( mRegisterCount );
+  state.rowErrors.fill( false, count );
+  state.suppressedErrors.fill( 0, count );
+  state.shortCircuits.clear();
+  state.error = QString();
+  int lastErrorRow = -1;
+
+  for ( int pc = 0; pc < mCode.count(); ++pc )
+  {
+    while ( !state.shortCircuits.isEmpty() && state.shortCircuits.last().target == pc )
+      endShortCircuit( state );
+
+    const Instruction& ins = mCode.at( pc );
+    // every instruction writes a register of its own, so the output never aliases an operand
+    Column& out = state.columns[ins.dst];
+    switch ( ins.op )
+    {
+      case OpLoadConst:
+        broadcast( mConstants.at( ins.a ), count, out );
+        break;
+
+      case OpLoadAttr:
+      {
+        out.values.resize( count );
+        Register* values = out.values.data();
+        for ( int row = 0; row < count; ++row )
+          setRegister( values[row], features.at( row ).attribute( ins.a ) );
+        compact( out );
+        break;
+      }
+
+      case OpUnary:
+        if ( !columnUnary( static_cast<QgsExpression::UnaryOperator>( ins.c ), state.columns.at( ins.a ), count, out ) )
+          runElementwise( parent, ins, count, lastErrorRow, state );
+        break;
+
+      case OpBinary:
+        if ( !columnBinary( static_cast<QgsExpression::BinaryOperator>( ins.c ), state.columns.at( ins.a ), state.columns.at( ins.b ), count, out ) )
+          runElementwise( parent, ins, count, lastErrorRow, state );
+        break;
+
+      case OpShortCircuit:
+        runShortCircuit( parent, ins, count, lastErrorRow, state );
+        break;
+
+      default:
+        runElementwise( parent, ins, count, lastErrorRow, state );
+        break;
+    }
+  }
+
+  while ( !state.shortCircuits.isEmpty() )
+    endShortCircuit( state );
+
+  parent->setEvalErrorString( state.error );
+}
+
+QVariantList QgsExpressionBytecode::evaluateBlock( QgsExpression* parent, const QgsFeatureList& features )
+{
+  BlockState state;
+  runColumns( parent, features, state );
+
+  const Column& column = state.columns.at( mResultRegister );
+  const int count = features.count();
+  QVariantList results;
+  results.reserve( count );
+  for ( int row = 0; row < count; ++row )
+    results << ( state.rowErrors.at( row ) ? QVariant() : variant( element( column, row ) ) );
+  return results;
+}
+
+QVector<bool> QgsExpressionBytecode::filterBlock( QgsExpression* parent, const QgsFeatureList& features )
+{
+  BlockState state;
+  runColumns( parent, features, state );
+
+  const Column& column = state.columns.at( mResultRegister );
+  const int count = features.count();
+  QVector<bool> mask( count );
+  if ( column.kind == KindInt || column.kind == KindBool )
+  {
+    const int* values = column.i.constData();
+    for ( int row = 0; row < count; ++row )
+      mask[row] = !state.rowErrors.at( row ) && values[row] != 0;
+  }
+  else
+  {
+    for ( int row = 0; row < count; ++row )
+      mask[row] = !state.rowErrors.at( row ) && variant( element( column, row ) ).toBool();
+  }
+  return mask;
+}
+
+QString QgsExpressionBytecode::dump() const
+{
+  QStringList lines;
+  for ( int pc = 0; pc < mCode.count(); ++pc )
+  {
+    const Instruction& ins = mCode.at( pc );
+    QString line;
+    switch ( ins.op )
+    {
+      case OpLoadConst:
+        line = QString( "r%1 = const %2" ).arg( ins.dst ).arg( variant( mConstants.at( ins.a ) ).toString() );
+        if ( ins.node )
+          line += QString( " (folded %1)" ).arg( ins.node->dump() );
+        break;
+      case OpLoadAttr:
+        line = QString( "r%1 = attribute %2" ).arg( ins.dst ).arg( ins.a );
+        break;
+      case OpMove:
+        line = QString( "r%1 = r%2" ).arg( ins.dst ).arg( ins.a );
+        break;
+      case OpUnary:
+        line = QString( "r%1 = %2 r%3" ).arg( ins.dst ).arg( QgsExpression::UnaryOperatorText[ins.c] ).arg( ins.a );
+        break;
+      case OpBinary:
+        line = QString( "r%1 = r%2 %3 r%4" ).arg( ins.dst ).arg( ins.a ).arg( QgsExpression::BinaryOperatorText[ins.c] ).arg( ins.b );
+        break;
+      case OpIn:
+        line = QString( "r%1 = r%2 %3IN list %4" ).arg( ins.dst ).arg( ins.a ).arg( static_cast<QgsExpression::NodeInOperator*>( ins.node )->isNotIn() ? "NOT " : "" ).arg( ins.b );
+        break;
+      case OpCallGuard:
+        line = QString( "r%1 = context function %2, jump %3" ).arg( ins.dst ).arg( mFunctionNames.at( ins.c ) ).arg( ins.b );
+        break;
+      case OpJumpIfNull:
+        line = QString( "if r%1 is null: r%2 = NULL, jump %3" ).arg( ins.a ).arg( ins.dst ).arg( ins.b );
+        break;
+      case OpCall:
+      {
+        QStringList args;
+        Q_FOREACH ( int arg, mArgLists.at( ins.a ) )
+          args << QString( "r%1" ).arg( arg );
+        QgsExpression::NodeFunction* fn = static_cast<QgsExpression::NodeFunction*>( ins.node );
+        line = QString( "r%1 = call %2(%3)" ).arg( ins.dst ).arg( QgsExpression::Functions()[fn->fnIndex()]->name(), args.join( ", " ) );
+        break;
+      }
+      case OpTree:
+        line = QString( "r%1 = tree %2" ).arg( ins.dst ).arg( ins.node->dump() );
+        break;
+      case OpJumpIfNotTrue:
+        line = QString( "if not r%1: jump %2" ).arg( ins.a ).arg( ins.b );
+        break;
+      case OpJump:
+        line = QString( "jump %1" ).arg( ins.b );
+        break;
+      case OpShortCircuit:
+        line = QString( "if r%1 decides %2: r%3 = r%1, jump %4" ).arg( ins.a ).arg( QgsExpression::BinaryOperatorText[ins.c] ).arg( ins.dst ).arg( ins.b );
+        break;
+    }
+    lines << QString( "%1: %2" ).arg( pc ).arg( line );
+  }
+  lines << QString( "return r%1" ).arg( mResultRegister );
+  Q_FOREACH ( const QString& optimization, mOptimizations )
+    lines << QString( "# %1" ).arg( optimization );
+  return lines.join( "\n" );
+}
+
+///@endcond
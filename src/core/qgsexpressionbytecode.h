@@ -0,0 +1,269 @@
+/***************************************************************************
+                         qgsexpressionbytecode.h
+                         -----------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONBYTECODE_H
+#define QGSEXPRESSIONBYTECODE_H
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "qgsexpression.h"
+#include "qgsfeature.h"
+
+class QgsExpressionContext;
+
+/** \ingroup core
+ * A prepared QgsExpression node tree lowered into a linear instruction stream.
+ *
+ * Every instruction writes its result into its own register. Registers are typed
+ * (null, integer, boolean, double, string) so that numeric operators, comparisons
+ * and logical operators work directly on unboxed values, and column references
+ * read the attribute straight from the feature fetched once per evaluation.
+ * Values which do not fit one of the typed kinds are kept as QVariant and handed
+ * to the operator implementations of the node tree, so the results are always
+ * identical to QgsExpression::Node::eval().
+ *
+ * While compiling, subtrees which do not depend on the feature (literals, pure
+ * functions and variables of static context scopes) are evaluated once and folded
+ * into constants, identical subexpressions are only computed once, and the right
+ * operand of AND and OR is skipped when the left one already decides the result.
+ *
+ * Nodes which cannot be lowered (lazily evaluated functions, IN with non literal
+ * lists, functions overridden by the evaluation context) are evaluated with the
+ * node tree walker from within the instruction stream.
+ *
+ * Programs without control flow and function calls can also be run column by column
+ * over a block of features: each instruction then processes the values of all the
+ * features at once, with tight loops over unboxed values when a column holds only
+ * numbers.
+ *
+ * The bytecode refers to the nodes of the tree it was compiled from and has to be
+ * discarded together with it. The registers are allocated per evaluation and the
+ * columns of a block per evaluateBlock() / filterBlock() call, so the copies of a
+ * prepared expression sharing the bytecode can be evaluated concurrently.
+ * @note added in QGIS 2.16
+ */
+class QgsExpressionBytecode
+{
+  public:
+
+    /** Compiles a prepared node tree.
+     * @param parent expression the tree belongs to, used to evaluate constant subtrees
+     * @param root root node of the expression, has to outlive the bytecode
+     * @param context context used for preparing the expression
+     * @returns compiled bytecode or nullptr if the tree is not worth compiling, ie
+     * it would be entirely evaluated by the tree walker. Ownership is transferred
+     * to the caller.
+     */
+    static QgsExpressionBytecode* compile( QgsExpression* parent, QgsExpression::Node* root, const QgsExpressionContext* context );
+
+    /** Evaluates the bytecode for a context. Errors are reported to the parent.
+     */
+    QVariant run( QgsExpression* parent, const QgsExpressionContext* context );
+
+    /** Returns true if the bytecode can be evaluated column by column over blocks of
+     * features with evaluateBlock() and filterBlock(), ie it only consists of literals,
+     * column references and operators.
+     */
+    bool isColumnar() const { return mColumnar; }
+
+    /** Returns true if the variables folded into constants while compiling have the same
+     * values in the context. Otherwise the expression has to be evaluated with the node
+     * tree, run() falls back to it by itself.
+     */
+    bool foldedVariablesMatch( const QgsExpressionContext* context ) const;
+
+    /** Evaluates the bytecode for a block of features, one instruction at a time over the
+     * values of all features. isColumnar() has to be true. The results of features
+     * for which the evaluation failed are NULL, the error of the last of them is set on
+     * the parent.
+     */
+    QVariantList evaluateBlock( QgsExpression* parent, const QgsFeatureList& features );
+
+    /** Like evaluateBlock(), but returns for each feature whether the result converts to true.
+     */
+    QVector<bool> filterBlock( QgsExpression* parent, const QgsFeatureList& features );
+
+    //! Returns the number of instructions
+    int instructionCount() const { return mCode.count(); }
+
+    //! Returns a human readable listing of the instructions and of the applied optimizations, for debugging
+    QString dump() const;
+
+    enum ValueKind
+    {
+      KindNull,
+      KindBool,   //!< result of three value logic, materialized as integer 0/1 like in the node tree
+      KindInt,
+      KindDouble, //!< always finite
+      KindString,
+      KindVariant //!< any other value, handled by the node tree operators
+    };
+
+    struct Register
+    {
+      Register()
+          : kind( KindNull )
+          , i( 0 )
+          , d( 0.0 )
+      {}
+
+      ValueKind kind;
+      int i;
+      double d;
+      QString s;
+      QVariant v;
+    };
+
+    //! Values of a register for all the features of a block
+    struct Column
+    {
+      Column()
+          : kind( KindVariant )
+      {}
+
+      //! KindInt, KindBool or KindDouble if all the values are of this kind and stored in i or d, KindVariant otherwise
+      ValueKind kind;
+      QVector<int> i;
+      QVector<double> d;
+      QVector<Register> values;
+    };
+
+  private:
+
+    enum OpCode
+    {
+      OpLoadConst,     //!< dst = constant a
+      OpLoadAttr,      //!< dst = attribute a of the context feature
+      OpMove,          //!< dst = register a
+      OpUnary,         //!< dst = unary operator node applied to register a
+      OpBinary,        //!< dst = binary operator node applied to registers a and b
+      OpIn,            //!< dst = register a [NOT] IN literal list b
+      OpCallGuard,     //!< if the context overrides the function c of node: dst = tree eval of node, jump to b
+      OpJumpIfNull,    //!< if register a is null: dst = null, jump to b
+      OpCall,          //!< dst = function node called with the registers of argument list a
+      OpTree,          //!< dst = tree eval of node
+      OpJumpIfNotTrue, //!< jump to b if register a is not true
+      OpJump,          //!< jump to b
+      OpShortCircuit,  //!< if register a decides the result of the AND / OR operator c: dst = a, jump to b
+    };
+
+    struct Instruction
+    {
+      Instruction( OpCode op = OpJump, int dst = -1, int a = -1, int b = -1, int c = -1, QgsExpression::Node* node = nullptr )
+          : op( op )
+          , dst( dst )
+          , a( a )
+          , b( b )
+          , c( c )
+          , node( node )
+      {}
+
+      OpCode op;
+      int dst;
+      int a;
+      int b;
+      int c;
+      QgsExpression::Node* node;
+    };
+
+    QgsExpressionBytecode();
+
+    //! Rows of a block for which the right operand of AND / OR does not matter
+    struct ShortCircuit
+    {
+      int target;
+      int dst;
+      Register value;
+      QVector<int> rows;
+    };
+
+    //! State of the evaluation of a block, owned by the caller of runColumns()
+    struct BlockState
+    {
+      QVector<Column> columns;
+      QVector<bool> rowErrors;
+      QString error;
+      QVector<int> suppressedErrors;  //!< per row count of enclosing AND / OR whose right operand is skipped
+      QList<ShortCircuit> shortCircuits;
+    };
+
+    int compileNode( QgsExpression* parent, QgsExpression::Node* node, const QgsExpressionContext* context );
+    int compileNodeUncached( QgsExpression* parent, QgsExpression::Node* node, const QgsExpressionContext* context );
+    //! Returns true if the node does not depend on the feature, the names of the static variables it uses are appended to variables
+    bool isConstant( QgsExpression::Node* node, const QgsExpressionContext* context, QStringList& variables ) const;
+    QString nodeKey( QgsExpression::Node* node, const QgsExpressionContext* context );
+    void pushScope() { mScopes.append( QHash<QString, int>() ); }
+    void popScope() { mScopes.removeLast(); }
+    int addInstruction( const Instruction& instruction );
+    int newRegister() { return mRegisterCount++; }
+    int addConstant( const QVariant& value );
+    int treeNode( QgsExpression::Node* node );
+
+    static void setRegister( Register& reg, const QVariant& value );
+    static QVariant variant( const Register& reg );
+    static bool isNumeric( const Register& reg ) { return reg.kind == KindInt || reg.kind == KindBool || reg.kind == KindDouble; }
+    static double number( const Register& reg ) { return reg.kind == KindDouble ? reg.d : reg.i; }
+
+    static bool fastUnary( QgsExpression::UnaryOperator op, const Register& operand, Register& out );
+    bool fastBinary( QgsExpression::BinaryOperator op, const Register& l, const Register& r, Register& out ) const;
+
+    void runColumns( QgsExpression* parent, const QgsFeatureList& features, BlockState& state ) const;
+    void runElementwise( QgsExpression* parent, const Instruction& ins, int count, int& lastErrorRow, BlockState& state ) const;
+    void runShortCircuit( QgsExpression* parent, const Instruction& ins, int count, int& lastErrorRow, BlockState& state ) const;
+    static void endShortCircuit( BlockState& state );
+    static void blockError( QgsExpression* parent, int row, int& lastErrorRow, BlockState& state );
+    static bool columnUnary( QgsExpression::UnaryOperator op, const Column& operand, int count, Column& out );
+    static bool columnBinary( QgsExpression::BinaryOperator op, const Column& l, const Column& r, int count, Column& out );
+    static void broadcast( const Register& value, int count, Column& out );
+    static void compact( Column& column );
+    static void setElement( Column& column, int row, const Register& value );
+    static Register element( const Column& column, int row );
+
+    QVector<Instruction> mCode;
+    QVector<Register> mConstants;
+    QVector<QVariantList> mLists;
+    QVector< QVector<int> > mArgLists;
+    QStringList mFunctionNames;
+    int mRegisterCount;
+    int mResultRegister;
+    bool mNeedsFeature;
+    int mTreeNodes;
+    QgsExpression::Node* mRoot;
+    bool mColumnar;
+    QHash<QString, QVariant> mFoldedVariables; //!< values of the variables folded into constants
+
+    // optimization state while compiling
+    QList< QHash<QString, int> > mScopes; //!< registers of already computed subexpressions, by control flow region
+    QHash<QgsExpression::Node*, QString> mNodeKeys;
+    QStringList mOptimizations;           //!< description of the applied optimizations, for dump()
+};
+
+/// @endcond
+
+#endif // QGSEXPRESSIONBYTECODE_H
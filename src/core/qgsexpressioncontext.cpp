@@ -88,6 +88,8 @@ void QgsExpressionContextScope::setVariable( const QString &name, const QVariant
   {
     StaticVariable existing = mVariables.value( name );
     existing.value = value;
+    // a changed value is not static anymore
+    existing.isStatic = false;
     addVariable( existing );
   }
   else
@@ -171,6 +173,11 @@ bool QgsExpressionContextScope::isReadOnly( const QString &name ) const
   return hasVariable( name ) ? mVariables.value( name ).readOnly : false;
 }
 
+bool QgsExpressionContextScope::isStatic( const QString &name ) const
+{
+  return hasVariable( name ) ? mVariables.value( name ).isStatic : false;
+}
+
 bool QgsExpressionContextScope::hasFunction( const QString& name ) const
 {
   return mFunctions.contains( name );
@@ -468,19 +475,19 @@ QgsExpressionContextScope* QgsExpressionContextUtils::globalScope()
       QVariant value = ( *it );
       QString name = customVariableNames.at( variableIndex ).toString();
 
-      scope->setVariable( name, value );
+      scope->addVariable( QgsExpressionContextScope::StaticVariable( name, value, false, true ) );
       variableIndex++;
     }
   }
 
   //add some extra global variables
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_version", QGis::QGIS_VERSION, true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_version_no", QGis::QGIS_VERSION_INT, true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_release_name", QGis::QGIS_RELEASE_NAME, true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_platform", QgsApplication::platform(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_os_name", QgsApplication::osName(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "user_account_name", QgsApplication::userLoginName(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "user_full_name", QgsApplication::userFullName(), true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_version", QGis::QGIS_VERSION, true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_version_no", QGis::QGIS_VERSION_INT, true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_release_name", QGis::QGIS_RELEASE_NAME, true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_platform", QgsApplication::platform(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "qgis_os_name", QgsApplication::osName(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "user_account_name", QgsApplication::userLoginName(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "user_full_name", QgsApplication::userFullName(), true, true ) );
 
   return scope;
 }
@@ -591,14 +598,14 @@ QgsExpressionContextScope* QgsExpressionContextUtils::projectScope()
 
     QString varValueString = variableValues.at( varIndex );
     varIndex++;
-    scope->setVariable( variableName, varValueString );
+    scope->addVariable( QgsExpressionContextScope::StaticVariable( variableName, varValueString, false, true ) );
   }
 
   //add other known project variables
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_title", project->title(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_path", project->fileInfo().filePath(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_folder", project->fileInfo().dir().path(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_filename", project->fileInfo().fileName(), true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_title", project->title(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_path", project->fileInfo().filePath(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_folder", project->fileInfo().dir().path(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "project_filename", project->fileInfo().fileName(), true, true ) );
 
   scope->addFunction( "project_color", new GetNamedProjectColor() );
   return scope;
@@ -659,11 +666,11 @@ QgsExpressionContextScope* QgsExpressionContextUtils::layerScope( const QgsMapLa
 
     QVariant varValue = variableValues.at( varIndex );
     varIndex++;
-    scope->setVariable( variableName, varValue );
+    scope->addVariable( QgsExpressionContextScope::StaticVariable( variableName, varValue, false, true ) );
   }
 
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "layer_name", layer->name(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "layer_id", layer->id(), true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "layer_name", layer->name(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "layer_id", layer->id(), true, true ) );
 
   const QgsVectorLayer* vLayer = dynamic_cast< const QgsVectorLayer* >( layer );
   if ( vLayer )
@@ -721,13 +728,13 @@ QgsExpressionContextScope* QgsExpressionContextUtils::mapSettingsScope( const Qg
   QgsExpressionContextScope* scope = new QgsExpressionContextScope( QObject::tr( "Map Settings" ) );
 
   //add known map settings context variables
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_id", "canvas", true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_rotation", mapSettings.rotation(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_scale", mapSettings.scale(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_extent_width", mapSettings.extent().width(), true ) );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_extent_height", mapSettings.extent().height(), true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_id", "canvas", true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_rotation", mapSettings.rotation(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_scale", mapSettings.scale(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_extent_width", mapSettings.extent().width(), true, true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_extent_height", mapSettings.extent().height(), true, true ) );
   QgsGeometry* centerPoint = QgsGeometry::fromPoint( mapSettings.visibleExtent().center() );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_extent_center", QVariant::fromValue( *centerPoint ), true ) );
+  scope->addVariable( QgsExpressionContextScope::StaticVariable( "map_extent_center", QVariant::fromValue( *centerPoint ), true, true ) );
   delete centerPoint;
 
   return scope;
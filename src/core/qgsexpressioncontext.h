@@ -88,11 +88,14 @@ class CORE_EXPORT QgsExpressionContextScope
        * @param name variable name (should be unique within the QgsExpressionContextScope)
        * @param value intial variable value
        * @param readOnly true if variable should not be editable by users
+       * @param isStatic true if the value of the variable does not change while the context is used,
+       * so that expressions may use it as a constant when they are prepared (added in QGIS 2.16)
        */
-      StaticVariable( const QString& name = QString(), const QVariant& value = QVariant(), bool readOnly = false )
+      StaticVariable( const QString& name = QString(), const QVariant& value = QVariant(), bool readOnly = false, bool isStatic = false )
           : name( name )
           , value( value )
           , readOnly( readOnly )
+          , isStatic( isStatic )
       {}
 
       /** Variable name */
@@ -103,6 +106,11 @@ class CORE_EXPORT QgsExpressionContextScope
 
       /** True if variable should not be editable by users */
       bool readOnly;
+
+      /** True if the value of the variable does not change while the context is used
+       * @note added in QGIS 2.16
+       */
+      bool isStatic;
     };
 
     /** Constructor for QgsExpressionContextScope
@@ -123,7 +131,8 @@ class CORE_EXPORT QgsExpressionContextScope
     QString name() const { return mName; }
 
     /** Convenience method for setting a variable in the context scope by name and value. If a variable
-     * with the same name is already set then its value is overwritten, otherwise a new variable is added to the scope.
+     * with the same name is already set then its value is overwritten and it is not static anymore,
+     * otherwise a new variable is added to the scope.
      * @param name variable name
      * @param value variable value
      * @see addVariable()
@@ -181,6 +190,15 @@ class CORE_EXPORT QgsExpressionContextScope
      */
     bool isReadOnly( const QString& name ) const;
 
+    /** Tests whether the value of the specified variable is static, ie it does not change
+     * while the scope is used. Expressions may then use the value as a constant when they
+     * are prepared.
+     * @param name variable name
+     * @returns true if variable is static
+     * @note added in QGIS 2.16
+     */
+    bool isStatic( const QString& name ) const;
+
     /** Returns the count of variables contained within the scope.
      */
     int variableCount() const { return mVariables.count(); }
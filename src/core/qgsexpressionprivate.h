@@ -22,9 +22,93 @@
 
 #include "qgsexpression.h"
 #include "qgsdistancearea.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
 #include "qgsunittypes.h"
 
+class QgsExpressionBytecode;
+
 ///@cond
+
+///////////////////////////////////////////////
+// three-value logic, shared by the node tree walker and the bytecode interpreter
+
+enum TVL
+{
+  False,
+  True,
+  Unknown
+};
+
+static const TVL AND[3][3] =
+{
+  // false  true    unknown
+  { False, False,   False },   // false
+  { False, True,    Unknown }, // true
+  { False, Unknown, Unknown }  // unknown
+};
+
+static const TVL OR[3][3] =
+{
+  { False,   True, Unknown },  // false
+  { True,    True, True },     // true
+  { Unknown, True, Unknown }   // unknown
+};
+
+static const TVL NOT[3] = { True, False, Unknown };
+
+inline QVariant tvl2variant( TVL v )
+{
+  switch ( v )
+  {
+    case False:
+      return 0;
+    case True:
+      return 1;
+    case Unknown:
+    default:
+      return QVariant();
+  }
+}
+
+#define TVL_True     QVariant(1)
+#define TVL_False    QVariant(0)
+#define TVL_Unknown  QVariant()
+
+// this handles also NULL values
+inline TVL getTVLValue( const QVariant& value, QgsExpression* parent )
+{
+  // we need to convert to TVL
+  if ( value.isNull() )
+    return Unknown;
+
+  //handle some special cases
+  if ( value.canConvert<QgsGeometry>() )
+  {
+    //geom is false if empty
+    QgsGeometry geom = value.value<QgsGeometry>();
+    return geom.isEmpty() ? False : True;
+  }
+  else if ( value.canConvert<QgsFeature>() )
+  {
+    //feat is false if non-valid
+    QgsFeature feat = value.value<QgsFeature>();
+    return feat.isValid() ? True : False;
+  }
+
+  if ( value.type() == QVariant::Int )
+    return value.toInt() != 0 ? True : False;
+
+  bool ok;
+  double x = value.toDouble( &ok );
+  if ( !ok )
+  {
+    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to boolean" ).arg( value.toString() ) );
+    return Unknown;
+  }
+  return !qgsDoubleNear( x, 0.0 ) ? True : False;
+}
+
 /**
  * This class exists only for implicit sharing of QgsExpression
  * and is not part of the public API.
@@ -41,6 +125,8 @@ class QgsExpressionPrivate
         , mCalc( nullptr )
         , mDistanceUnit( QGis::UnknownUnit )
         , mAreaUnit( QgsUnitTypes::UnknownAreaUnit )
+        , mBytecode( nullptr )
+        , mCompilationEnabled( true )
     {}
 
     QgsExpressionPrivate( const QgsExpressionPrivate& other )
@@ -53,12 +139,11 @@ class QgsExpressionPrivate
         , mCalc( other.mCalc )
         , mDistanceUnit( other.mDistanceUnit )
         , mAreaUnit( other.mAreaUnit )
+        , mBytecode( nullptr ) // bytecode refers to the nodes of other.mRootNode, it is rebuilt in prepare()
+        , mCompilationEnabled( other.mCompilationEnabled )
     {}
 
-    ~QgsExpressionPrivate()
-    {
-      delete mRootNode;
-    }
+    ~QgsExpressionPrivate();
 
     QAtomicInt ref;
 
@@ -74,6 +159,10 @@ class QgsExpressionPrivate
     QSharedPointer<QgsDistanceArea> mCalc;
     QGis::UnitType mDistanceUnit;
     QgsUnitTypes::AreaUnit mAreaUnit;
+
+    //! Flat instruction stream compiled from mRootNode in prepare(), or null if not compiled
+    QgsExpressionBytecode* mBytecode;
+    bool mCompilationEnabled;
 };
 ///@endcond
 
@@ -20,6 +20,8 @@
 
 #include "qgsexpressionsorter.h"
 
+#include <QThread>
+
 QgsAbstractFeatureIterator::QgsAbstractFeatureIterator( const QgsFeatureRequest& request )
     : mRequest( request )
     , mClosed( false )
@@ -93,13 +95,40 @@ bool QgsAbstractFeatureIterator::nextFeature( QgsFeature& f )
 
 bool QgsAbstractFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
 {
-  while ( fetchFeature( f ) )
+  // features are read ahead by blocks, so that the expression can be evaluated for all of them at once
+  while ( mFilteredFeatures.isEmpty() )
   {
-    mRequest.expressionContext()->setFeature( f );
-    if ( mRequest.filterExpression()->evaluate( mRequest.expressionContext() ).toBool() )
-      return true;
+    QgsFeatureList block;
+    const int blockSize = filterBlockSize();
+    while ( block.count() < blockSize && fetchFeature( f ) )
+      block << f;
+
+    if ( block.isEmpty() )
+      return false;
+
+    filterFeatureBlock( block );
+  }
+
+  f = mFilteredFeatures.takeFirst();
+  return true;
+}
+
+int QgsAbstractFeatureIterator::filterBlockSize() const
+{
+  const int maxBlockSize = 1024;
+  if ( mRequest.limit() >= 0 )
+    return qBound( 1, static_cast< int >( mRequest.limit() - mFetchedCount ), maxBlockSize );
+  return maxBlockSize;
+}
+
+void QgsAbstractFeatureIterator::filterFeatureBlock( const QgsFeatureList& features )
+{
+  QVector<bool> mask = mRequest.filterExpression()->filterBlock( mRequest.expressionContext(), features );
+  for ( int i = 0; i < features.count(); ++i )
+  {
+    if ( mask.at( i ) )
+      mFilteredFeatures << features.at( i );
   }
-  return false;
 }
 
 bool QgsAbstractFeatureIterator::nextFeatureFilterFids( QgsFeature& f )
@@ -231,6 +260,164 @@ void QgsAbstractFeatureIterator::setInterruptionChecker( QgsInterruptionChecker*
 
 ///////
 
+/// @cond PRIVATE
+class QgsFeaturePrefetchThread : public QThread, public QgsInterruptionChecker
+{
+  public:
+    explicit QgsFeaturePrefetchThread( QgsPrefetchingFeatureIterator* iterator )
+        : mIterator( iterator )
+    {}
+
+    virtual bool mustStop() const override { return mIterator->mustStop(); }
+
+  protected:
+    virtual void run() override { mIterator->prefetch( this ); }
+
+  private:
+    QgsPrefetchingFeatureIterator* mIterator;
+};
+/// @endcond
+
+QgsPrefetchingFeatureIterator::QgsPrefetchingFeatureIterator( QgsAbstractFeatureSource* source, const QgsFeatureRequest& request, int capacity )
+    : QgsAbstractFeatureIterator( QgsFeatureRequest() )
+    , mSource( source )
+    , mSourceRequest( request )
+    , mThread( nullptr )
+    , mSlots( qMax( capacity, 1 ) )
+    , mHead( 0 )
+    , mTail( 0 )
+    , mFree( mSlots.count() )
+    , mStop( false )
+    , mInterruptionChecker( nullptr )
+{
+  start();
+}
+
+QgsPrefetchingFeatureIterator::~QgsPrefetchingFeatureIterator()
+{
+  close();
+}
+
+bool QgsPrefetchingFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  stop();
+  start();
+  return true;
+}
+
+bool QgsPrefetchingFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  stop();
+  mClosed = true;
+  return true;
+}
+
+void QgsPrefetchingFeatureIterator::setInterruptionChecker( QgsInterruptionChecker* interruptionChecker )
+{
+  QMutexLocker locker( &mMutex );
+  mInterruptionChecker = interruptionChecker;
+}
+
+bool QgsPrefetchingFeatureIterator::fetchFeature( QgsFeature& f )
+{
+  f.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  mUsed.acquire();
+  Slot& slot = mSlots.data()[mHead];
+  bool end = slot.end;
+  f = slot.feature;
+  slot.feature = QgsFeature();
+  mHead = ( mHead + 1 ) % mSlots.count();
+  mFree.release();
+
+  if ( end )
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void QgsPrefetchingFeatureIterator::start()
+{
+  mStop = false;
+  mThread = new QgsFeaturePrefetchThread( this );
+  mThread->start();
+
+  // wait for the iterator of the source, to know its compilation status
+  mStarted.acquire();
+}
+
+void QgsPrefetchingFeatureIterator::stop()
+{
+  if ( !mThread )
+    return;
+
+  mMutex.lock();
+  mStop = true;
+  mMutex.unlock();
+
+  // wake the worker up if the buffer is full
+  mFree.release();
+  mThread->wait();
+  delete mThread;
+  mThread = nullptr;
+
+  // back to an empty buffer
+  mFree.acquire( mFree.available() );
+  mFree.release( mSlots.count() );
+  mUsed.acquire( mUsed.available() );
+  for ( int i = 0; i < mSlots.count(); ++i )
+    mSlots[i] = Slot();
+  mHead = 0;
+  mTail = 0;
+}
+
+bool QgsPrefetchingFeatureIterator::mustStop() const
+{
+  QMutexLocker locker( &mMutex );
+  return mStop || ( mInterruptionChecker && mInterruptionChecker->mustStop() );
+}
+
+void QgsPrefetchingFeatureIterator::prefetch( QgsInterruptionChecker* checker )
+{
+  QgsFeatureIterator it = mSource->getFeatures( mSourceRequest );
+  it.setInterruptionChecker( checker );
+  mCompileStatus = it.compileStatus();
+  mStarted.release();
+
+  // the slots between mTail and mHead are owned by this thread until they are released
+  Slot* slots = mSlots.data();
+  QgsFeature f;
+  for ( ;; )
+  {
+    mFree.acquire();
+
+    // when stopped, the end is published too so that the consumer does not wait forever
+    bool valid = !mustStop() && it.nextFeature( f );
+    Slot& slot = slots[mTail];
+    slot.feature = valid ? f : QgsFeature();
+    slot.end = !valid;
+    mTail = ( mTail + 1 ) % mSlots.count();
+    mUsed.release();
+
+    if ( !valid )
+      break;
+  }
+
+  it.close();
+}
+
 QgsFeatureIterator& QgsFeatureIterator::operator=( const QgsFeatureIterator & other )
 {
   if ( this != &other )
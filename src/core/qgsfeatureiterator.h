@@ -19,7 +19,12 @@
 #include "qgslogger.h"
 #include "qgsindexedfeature.h"
 
+#include <QMutex>
+#include <QSemaphore>
+#include <QVector>
+
 class QgsAbstractGeometrySimplifier;
+class QgsFeaturePrefetchThread;
 
 /** \ingroup core
  * Interface that can be optionaly attached to an iterator so its
@@ -144,6 +149,24 @@ class CORE_EXPORT QgsAbstractFeatureIterator
     //! Setup the simplification of geometries to fetch using the specified simplify method
     virtual bool prepareSimplification( const QgsSimplifyMethod& simplifyMethod );
 
+    /** Returns how many features should be read ahead and tested at once against the
+     * filter expression. Requests with a limit use smaller blocks, so that not much
+     * more features than needed are fetched.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    int filterBlockSize() const;
+
+    /** Evaluates the filter expression of the request for a block of features at once
+     * and queues the features which match it in mFilteredFeatures.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void filterFeatureBlock( const QgsFeatureList& features );
+
+    //! Features which matched the filter expression and have not been returned yet
+    QgsFeatureList mFilteredFeatures;
+
   private:
     //! optional object to locally simplify geometries fetched by this feature iterator
     QgsAbstractGeometrySimplifier* mGeometrySimplifier;
@@ -210,6 +233,86 @@ class QgsAbstractFeatureIteratorFromSource : public QgsAbstractFeatureIterator
     bool mOwnSource;
 };
 
+/** \ingroup core
+ * Feature iterator which reads the features of a source on a worker thread, ahead of
+ * their consumption, so that waiting for the data provider and processing the features
+ * overlap.
+ *
+ * The features are handed over through a bounded ring buffer: the worker blocks when
+ * it is full, the consumer when it is empty. The iterator of the source is created,
+ * used and closed on the worker thread only, so data providers see a single thread.
+ *
+ * Vector layer iterators use it for the provider features of requests with the
+ * QgsFeatureRequest::PrefetchFeatures flag.
+ * @note added in QGIS 2.16
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsPrefetchingFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    /** Constructor
+     * @param source source of the features, has to outlive the iterator
+     * @param request request passed to the source, the filters, limit and ordering
+     * are applied by the iterator of the source
+     * @param capacity maximal number of features read ahead
+     */
+    QgsPrefetchingFeatureIterator( QgsAbstractFeatureSource* source, const QgsFeatureRequest& request, int capacity = 1024 );
+
+    ~QgsPrefetchingFeatureIterator();
+
+    //! restarts the worker with a new iterator of the source
+    virtual bool rewind() override;
+
+    //! stops the worker
+    virtual bool close() override;
+
+    virtual void setInterruptionChecker( QgsInterruptionChecker* interruptionChecker ) override;
+
+  protected:
+    virtual bool fetchFeature( QgsFeature& f ) override;
+
+    //! the filter has already been applied by the iterator of the source
+    virtual bool nextFeatureFilterExpression( QgsFeature& f ) override { return fetchFeature( f ); }
+
+    //! the filter has already been applied by the iterator of the source
+    virtual bool nextFeatureFilterFids( QgsFeature& f ) override { return fetchFeature( f ); }
+
+  private:
+    struct Slot
+    {
+      Slot() : end( false ) {}
+
+      QgsFeature feature;
+      bool end; //!< no more features after this slot
+    };
+
+    void start();
+    void stop();
+
+    //! body of the worker thread
+    void prefetch( QgsInterruptionChecker* checker );
+
+    //! whether the worker has to stop, queried by the iterator of the source
+    bool mustStop() const;
+
+    QgsAbstractFeatureSource* mSource;
+    QgsFeatureRequest mSourceRequest;
+    QgsFeaturePrefetchThread* mThread;
+
+    QVector<Slot> mSlots;
+    int mHead; //!< next slot to consume, only used by the consumer
+    int mTail; //!< next slot to fill, only used by the worker
+    QSemaphore mFree;
+    QSemaphore mUsed;
+    QSemaphore mStarted;
+
+    mutable QMutex mMutex; //!< protects mStop and mInterruptionChecker
+    bool mStop;
+    QgsInterruptionChecker* mInterruptionChecker;
+
+    friend class QgsFeaturePrefetchThread;
+};
+
 /**
  * \ingroup core
  * Wrapper for iterator of features from vector data provider or vector layer
@@ -291,7 +394,10 @@ inline bool QgsFeatureIterator::nextFeature( QgsFeature& f )
 inline bool QgsFeatureIterator::rewind()
 {
   if ( mIter )
+  {
     mIter->mFetchedCount = 0;
+    mIter->mFilteredFeatures.clear();
+  }
 
   return mIter ? mIter->rewind() : false;
 }
@@ -299,14 +405,18 @@ inline bool QgsFeatureIterator::rewind()
 inline bool QgsFeatureIterator::close()
 {
   if ( mIter )
+  {
     mIter->mFetchedCount = 0;
+    mIter->mFilteredFeatures.clear();
+  }
 
   return mIter ? mIter->close() : false;
 }
 
 inline bool QgsFeatureIterator::isClosed() const
 {
-  return mIter ? mIter->mClosed && !mIter->mZombie : true;
+  // the iterator may close itself after reading ahead the last features
+  return mIter ? mIter->mClosed && !mIter->mZombie && mIter->mFilteredFeatures.isEmpty() : true;
 }
 
 inline bool operator== ( const QgsFeatureIterator &fi1, const QgsFeatureIterator &fi2 )
@@ -253,9 +253,19 @@ bool QgsFeatureRequest::acceptFeature( const QgsFeature& feature )
 
 QgsAbstractFeatureSource::~QgsAbstractFeatureSource()
 {
-  while ( !mActiveIterators.empty() )
+  closeIterators();
+}
+
+void QgsAbstractFeatureSource::closeIterators()
+{
+  for ( ;; )
   {
-    QgsAbstractFeatureIterator *it = *mActiveIterators.begin();
+    mActiveIteratorsMutex.lock();
+    QgsAbstractFeatureIterator *it = mActiveIterators.isEmpty() ? nullptr : *mActiveIterators.begin();
+    mActiveIteratorsMutex.unlock();
+    if ( !it )
+      break;
+
     QgsDebugMsg( "closing active iterator" );
     it->close();
   }
@@ -263,11 +273,13 @@ QgsAbstractFeatureSource::~QgsAbstractFeatureSource()
 
 void QgsAbstractFeatureSource::iteratorOpened( QgsAbstractFeatureIterator* it )
 {
+  QMutexLocker locker( &mActiveIteratorsMutex );
   mActiveIterators.insert( it );
 }
 
 void QgsAbstractFeatureSource::iteratorClosed( QgsAbstractFeatureIterator* it )
 {
+  QMutexLocker locker( &mActiveIteratorsMutex );
   mActiveIterators.remove( it );
 }
 
@@ -17,6 +17,7 @@
 
 #include <QFlags>
 #include <QList>
+#include <QMutex>
 
 #include "qgsfeature.h"
 #include "qgsrectangle.h"
@@ -68,7 +69,8 @@ class CORE_EXPORT QgsFeatureRequest
       NoFlags            = 0,
       NoGeometry         = 1,  //!< Geometry is not required. It may still be returned if e.g. required for a filter condition.
       SubsetOfAttributes = 2,  //!< Fetch only a subset of attributes (setSubsetOfAttributes sets this flag)
-      ExactIntersect     = 4   //!< Use exact geometry intersection (slower) instead of bounding boxes
+      ExactIntersect     = 4,  //!< Use exact geometry intersection (slower) instead of bounding boxes
+      PrefetchFeatures   = 8   //!< Fetch the features from the provider on a worker thread, ahead of their use (honored by vector layer iterators, added in QGIS 2.16)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
@@ -435,8 +437,17 @@ class CORE_EXPORT QgsAbstractFeatureSource
     void iteratorOpened( QgsAbstractFeatureIterator* it );
     void iteratorClosed( QgsAbstractFeatureIterator* it );
 
+    /** Closes the active iterators. Sources which own other sources call it before releasing
+     * them, as closing an iterator stops its prefetching thread, see QgsFeatureRequest::PrefetchFeatures.
+     * @note added in QGIS 2.16
+     */
+    void closeIterators();
+
     QSet< QgsAbstractFeatureIterator* > mActiveIterators;
 
+    //! iterators may be opened and closed from different threads, see QgsFeatureRequest::PrefetchFeatures
+    QMutex mActiveIteratorsMutex;
+
     template<typename> friend class QgsAbstractFeatureIteratorFromSource;
 };
 
@@ -72,6 +72,7 @@ QgsLabelingEngineV2::QgsLabelingEngineV2()
     , mCandLine( 8 )
     , mCandPolygon( 8 )
     , mResults( nullptr )
+    , mPlacementCache( nullptr )
 {
   mResults = new QgsLabelingResults;
 }
@@ -207,6 +208,8 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
 
   p.setShowPartial( mFlags.testFlag( UsePartialCandidates ) );
 
+  p.setPlacementCache( mPlacementCache, mMapSettings.mapUnitsPerPixel() );
+
 
   // for each provider: get labels and register them in PAL
   Q_FOREACH ( QgsAbstractLabelProvider* provider, mProviders )
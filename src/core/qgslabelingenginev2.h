@@ -26,6 +26,7 @@
 
 
 class QgsLabelingEngineV2;
+class QgsLabelPlacementCache;
 
 
 /**
@@ -184,6 +185,14 @@ class CORE_EXPORT QgsLabelingEngineV2
     //! Get associated map settings
     const QgsMapSettings& mapSettings() const { return mMapSettings; }
 
+    /** Sets the cache of the label placements of the previous runs, which is used and updated by run().
+     * The engine does not take ownership of the cache.
+     * @note added in QGIS 2.16
+     */
+    void setPlacementCache( QgsLabelPlacementCache* cache ) { mPlacementCache = cache; }
+    //! Returns the cache of the label placements, or nullptr if none is set
+    QgsLabelPlacementCache* placementCache() const { return mPlacementCache; }
+
     //! Add provider of label features. Takes ownership of the provider
     void addProvider( QgsAbstractLabelProvider* provider );
 
@@ -242,6 +251,9 @@ class CORE_EXPORT QgsLabelingEngineV2
     //! Resulting labeling layout
     QgsLabelingResults* mResults;
 
+    //! Cached candidates and placements of the previous runs
+    QgsLabelPlacementCache* mPlacementCache;
+
   private:
 
     QgsLabelingEngineV2( const QgsLabelingEngineV2& rh );
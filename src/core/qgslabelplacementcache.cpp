@@ -0,0 +1,73 @@
+/***************************************************************************
+  qgslabelplacementcache.cpp
+  --------------------------------------
+  Date                 : May 2016
+  Copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslabelplacementcache.h"
+
+#include "pal/labelposition.h"
+
+QgsLabelPlacementCache::QgsLabelPlacementCache()
+{
+}
+
+QgsLabelPlacementCache::~QgsLabelPlacementCache()
+{
+  clear();
+}
+
+void QgsLabelPlacementCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+
+  QHash<QString, Layer>::iterator it = mLayers.begin();
+  for ( ; it != mLayers.end(); ++it )
+    clearParts( it.value() );
+  mLayers.clear();
+}
+
+void QgsLabelPlacementCache::clearLayer( const QString& layerId )
+{
+  QMutexLocker locker( &mMutex );
+
+  // a layer may have several label providers (rule based labeling, diagrams)
+  QHash<QString, Layer>::iterator it = mLayers.begin();
+  while ( it != mLayers.end() )
+  {
+    if ( it.value().layerId == layerId )
+    {
+      clearParts( it.value() );
+      it = mLayers.erase( it );
+    }
+    else
+      ++it;
+  }
+}
+
+int QgsLabelPlacementCache::count() const
+{
+  QMutexLocker locker( &mMutex );
+
+  int count = 0;
+  QHash<QString, Layer>::const_iterator it = mLayers.constBegin();
+  for ( ; it != mLayers.constEnd(); ++it )
+    count += it.value().parts.count();
+  return count;
+}
+
+void QgsLabelPlacementCache::clearParts( Layer& layer )
+{
+  QHash<PartKey, Part>::iterator it = layer.parts.begin();
+  for ( ; it != layer.parts.end(); ++it )
+    qDeleteAll( it.value().candidates );
+  layer.parts.clear();
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+  qgslabelplacementcache.h
+  --------------------------------------
+  Date                 : May 2016
+  Copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLABELPLACEMENTCACHE_H
+#define QGSLABELPLACEMENTCACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+
+#include "qgsfeature.h"
+
+namespace pal
+{
+  class LabelPosition;
+  class Pal;
+}
+
+/** \ingroup core
+ * Keeps the label candidates and the chosen placements of a labeling run, so that the
+ * next run over a close extent (e.g. after a pan or a small zoom) does not generate
+ * the candidates of unchanged features again and starts the search from the previous
+ * solution.
+ *
+ * Candidates are cached per layer, map scale and feature part. A feature part is
+ * identified by the id of its feature and its geometry, the candidates are only reused
+ * if the geometry, the label size and text and the placement settings of the feature
+ * and of its layer are unchanged. Parts which are not in the extent of a run are
+ * dropped from the cache.
+ *
+ * The class is thread-safe, it is filled by the labeling engine.
+ * @note added in QGIS 2.16
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsLabelPlacementCache
+{
+  public:
+    QgsLabelPlacementCache();
+    ~QgsLabelPlacementCache();
+
+    //! Removes all cached candidates and placements
+    void clear();
+
+    //! Removes the cached candidates and placements of a layer
+    void clearLayer( const QString& layerId );
+
+    //! Returns the number of feature parts with cached candidates
+    int count() const;
+
+  private:
+    friend class pal::Pal;
+
+    //! Cached candidates of a feature part
+    struct Part
+    {
+      Part() : settings( 0 ), chosen( -1 ), used( false ) {}
+
+      //! hash of the label and placement settings of the feature
+      uint settings;
+      //! candidates as generated, before they are clipped to the extent or get costs from obstacles
+      QList<pal::LabelPosition*> candidates;
+      //! index of the candidate placed by the last run, -1 if the feature was not labeled
+      int chosen;
+      //! whether the part was in the extent of the current run
+      bool used;
+    };
+
+    //! Parts are identified by feature id and hash of the geometry
+    typedef QPair<QgsFeatureId, uint> PartKey;
+
+    //! Cached candidates of the feature parts of a layer
+    struct Layer
+    {
+      Layer() : scale( 0 ), settings( 0 ) {}
+
+      QString layerId;
+      double scale;
+      //! hash of the placement settings of the layer
+      uint settings;
+      QHash<PartKey, Part> parts;
+    };
+
+    //! Deletes the candidates of the parts of a layer
+    static void clearParts( Layer& layer );
+
+    mutable QMutex mMutex;
+    //! cached layers, by id of the layer and of the label provider
+    QHash<QString, Layer> mLayers;
+
+    QgsLabelPlacementCache( const QgsLabelPlacementCache& rh );
+    QgsLabelPlacementCache& operator=( const QgsLabelPlacementCache& rh );
+};
+
+#endif // QGSLABELPLACEMENTCACHE_H
@@ -27,6 +27,7 @@ void QgsMapRendererCache::clear()
 {
   QMutexLocker lock( &mMutex );
   clearInternal();
+  mLabelPlacementCache.clear();
 }
 
 void QgsMapRendererCache::clearInternal()
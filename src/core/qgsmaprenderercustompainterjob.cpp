@@ -19,6 +19,7 @@
 #include "qgslogger.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaplayerrenderer.h"
+#include "qgsmaprenderercache.h"
 #include "qgspallabeling.h"
 #include "qgsvectorlayer.h"
 #include "qgsrendererv2.h"
@@ -88,6 +89,8 @@ void QgsMapRendererCustomPainterJob::start()
     mLabelingEngineV2 = new QgsLabelingEngineV2();
     mLabelingEngineV2->readSettingsFromProject();
     mLabelingEngineV2->setMapSettings( mSettings );
+    if ( mCache )
+      mLabelingEngineV2->setPlacementCache( mCache->labelPlacementCache() );
 #else
     mLabelingEngine = new QgsPalLabeling;
     mLabelingEngine->loadEngineSettings();
@@ -37,6 +37,7 @@
 QgsMapRendererJob::QgsMapRendererJob( const QgsMapSettings& settings )
     : mSettings( settings )
     , mCache( nullptr )
+    , mFeatureFilterProvider( nullptr )
     , mRenderingTime( 0 )
 {
 }
@@ -254,6 +255,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
     job.context.setLabelingEngineV2( labelingEngine2 );
     job.context.setCoordinateTransform( ct );
     job.context.setExtent( r1 );
+    job.context.setFeatureFilterProvider( mFeatureFilterProvider );
 
     // if we can use the cache, let's do it and avoid rendering!
     if ( mCache && !mCache->cacheImage( ml->id() ).isNull() )
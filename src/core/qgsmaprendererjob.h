@@ -29,6 +29,7 @@
 
 #include "qgsgeometrycache.h"
 
+class QgsFeatureFilterProvider;
 class QgsLabelingEngineV2;
 class QgsLabelingResults;
 class QgsMapLayerRenderer;
@@ -124,6 +125,19 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! Does not take ownership of the object.
     void setCache( QgsMapRendererCache* cache );
 
+    /** Sets a feature filter provider to restrict the features rendered by the job, e.g. for
+     * the access control of QGIS server. Does not take ownership of the object.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void setFeatureFilterProvider( const QgsFeatureFilterProvider* f ) { mFeatureFilterProvider = f; }
+
+    /** Returns the feature filter provider used by the job, if any.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    const QgsFeatureFilterProvider* featureFilterProvider() const { return mFeatureFilterProvider; }
+
     //! Set which vector layers should be cached while rendering
     //! @note The way how geometries are cached is really suboptimal - this method may be removed in future releases
     void setRequestedGeometryCacheForLayers( const QStringList& layerIds ) { mRequestedGeomCacheForLayers = layerIds; }
@@ -179,6 +193,8 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     QgsMapRendererCache* mCache;
 
+    const QgsFeatureFilterProvider* mFeatureFilterProvider;
+
     //! list of layer IDs for which the geometry cache should be updated
     QStringList mRequestedGeomCacheForLayers;
     //! map of geometry caches
@@ -18,6 +18,7 @@
 #include "qgslabelingenginev2.h"
 #include "qgslogger.h"
 #include "qgsmaplayerrenderer.h"
+#include "qgsmaprenderercache.h"
 #include "qgspallabeling.h"
 
 #include <QtConcurrentMap>
@@ -29,6 +30,8 @@ QgsMapRendererParallelJob::QgsMapRendererParallelJob( const QgsMapSettings& sett
     , mStatus( Idle )
     , mLabelingEngine( nullptr )
     , mLabelingEngineV2( nullptr )
+    , mLabelingEngineSettings( nullptr )
+    , mMaxThreadCount( 0 )
 {
 }
 
@@ -65,11 +68,45 @@ void QgsMapRendererParallelJob::start()
   {
 #ifdef LABELING_V2
     mLabelingEngineV2 = new QgsLabelingEngineV2();
-    mLabelingEngineV2->readSettingsFromProject();
+    if ( mLabelingEngineSettings )
+    {
+      int candPoint, candLine, candPolygon;
+      mLabelingEngineSettings->numCandidatePositions( candPoint, candLine, candPolygon );
+      mLabelingEngineV2->setNumCandidatePositions( candPoint, candLine, candPolygon );
+      mLabelingEngineV2->setSearchMethod( mLabelingEngineSettings->searchMethod() );
+      mLabelingEngineV2->setFlag( QgsLabelingEngineV2::DrawCandidates, mLabelingEngineSettings->isShowingCandidates() );
+      mLabelingEngineV2->setFlag( QgsLabelingEngineV2::DrawShadowRects, mLabelingEngineSettings->isShowingShadowRectangles() );
+      mLabelingEngineV2->setFlag( QgsLabelingEngineV2::UseAllLabels, mLabelingEngineSettings->isShowingAllLabels() );
+      mLabelingEngineV2->setFlag( QgsLabelingEngineV2::UsePartialCandidates, mLabelingEngineSettings->isShowingPartialsLabels() );
+      mLabelingEngineV2->setFlag( QgsLabelingEngineV2::RenderOutlineLabels, mLabelingEngineSettings->isDrawingOutlineLabels() );
+      mLabelingEngineV2->setFlag( QgsLabelingEngineV2::DrawLabelRectOnly, mLabelingEngineSettings->drawLabelRectOnly() );
+    }
+    else
+    {
+      mLabelingEngineV2->readSettingsFromProject();
+    }
     mLabelingEngineV2->setMapSettings( mSettings );
+    if ( mCache )
+      mLabelingEngineV2->setPlacementCache( mCache->labelPlacementCache() );
 #else
     mLabelingEngine = new QgsPalLabeling;
-    mLabelingEngine->loadEngineSettings();
+    if ( mLabelingEngineSettings )
+    {
+      int candPoint, candLine, candPolygon;
+      mLabelingEngineSettings->numCandidatePositions( candPoint, candLine, candPolygon );
+      mLabelingEngine->setNumCandidatePositions( candPoint, candLine, candPolygon );
+      mLabelingEngine->setSearchMethod( mLabelingEngineSettings->searchMethod() );
+      mLabelingEngine->setShowingCandidates( mLabelingEngineSettings->isShowingCandidates() );
+      mLabelingEngine->setShowingShadowRectangles( mLabelingEngineSettings->isShowingShadowRectangles() );
+      mLabelingEngine->setShowingAllLabels( mLabelingEngineSettings->isShowingAllLabels() );
+      mLabelingEngine->setShowingPartialsLabels( mLabelingEngineSettings->isShowingPartialsLabels() );
+      mLabelingEngine->setDrawingOutlineLabels( mLabelingEngineSettings->isDrawingOutlineLabels() );
+      mLabelingEngine->setDrawLabelRectOnly( mLabelingEngineSettings->drawLabelRectOnly() );
+    }
+    else
+    {
+      mLabelingEngine->loadEngineSettings();
+    }
     mLabelingEngine->init( mSettings );
 #endif
   }
@@ -82,7 +119,19 @@ void QgsMapRendererParallelJob::start()
 
   connect( &mFutureWatcher, SIGNAL( finished() ), SLOT( renderLayersFinished() ) );
 
-  mFuture = QtConcurrent::map( mLayerJobs, renderLayerStatic );
+  mWorkers.clear();
+  if ( mMaxThreadCount > 0 && mMaxThreadCount < mLayerJobs.count() )
+  {
+    // only as many tasks as allowed threads, each of them renders layers until none is left
+    mNextLayerJob.fetchAndStoreOrdered( 0 );
+    for ( int i = 0; i < mMaxThreadCount; ++i )
+      mWorkers << this;
+    mFuture = QtConcurrent::map( mWorkers, renderLayersWorkerStatic );
+  }
+  else
+  {
+    mFuture = QtConcurrent::map( mLayerJobs, renderLayerStatic );
+  }
   mFutureWatcher.setFuture( mFuture );
 }
 
@@ -254,6 +303,15 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob& job )
   QgsDebugMsg( QString( "job %1 end [%2 ms] (layer %3)" ).arg( reinterpret_cast< ulong >( &job ), 0, 16 ).arg( job.renderingTime ).arg( job.layerId ) );
 }
 
+void QgsMapRendererParallelJob::renderLayersWorkerStatic( QgsMapRendererParallelJob* self )
+{
+  int i;
+  while (( i = self->mNextLayerJob.fetchAndAddOrdered( 1 ) ) < self->mLayerJobs.count() )
+  {
+    renderLayerStatic( self->mLayerJobs[i] );
+  }
+}
+
 
 void QgsMapRendererParallelJob::renderLabelsStatic( QgsMapRendererParallelJob* self )
 {
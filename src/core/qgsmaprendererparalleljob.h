@@ -18,6 +18,8 @@
 
 #include "qgsmaprendererjob.h"
 
+#include <QAtomicInt>
+
 /** Job implementation that renders all layers in parallel.
  *
  * The resulting map image can be retrieved with renderedImage() function.
@@ -42,6 +44,32 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     // from QgsMapRendererJobWithPreview
     virtual QImage renderedImage() override;
 
+    /** Sets the maximum number of threads rendering the layers of the job at the same time.
+     * With the default value 0, the layers are spread over all the threads of the global
+     * thread pool. Must be set before start().
+     * @note added in QGIS 2.16
+     */
+    void setMaxThreadCount( int count ) { mMaxThreadCount = count; }
+
+    /** Returns the maximum number of threads rendering the layers of the job at the same time,
+     * 0 if it is only limited by the global thread pool.
+     * @note added in QGIS 2.16
+     */
+    int maxThreadCount() const { return mMaxThreadCount; }
+
+    /** Sets a labeling engine whose settings (search method, candidate positions and debugging flags)
+     * are used for the labels of the job instead of the labeling settings of the project.
+     * The engine is not owned by the job and must stay valid until start(). Must be set before start().
+     * @note added in QGIS 2.16
+     */
+    void setLabelingEngineSettings( QgsPalLabeling* engine ) { mLabelingEngineSettings = engine; }
+
+    /** Returns the labeling engine whose settings are used for the labels of the job,
+     * nullptr if the settings of the project are used.
+     * @note added in QGIS 2.16
+     */
+    QgsPalLabeling* labelingEngineSettings() const { return mLabelingEngineSettings; }
+
   protected slots:
     //! layers are rendered, labeling is still pending
     void renderLayersFinished();
@@ -53,6 +81,9 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     static void renderLayerStatic( LayerRenderJob& job );
     static void renderLabelsStatic( QgsMapRendererParallelJob* self );
 
+    //! renders the next pending layers until all of them are rendered, for a limited number of threads
+    static void renderLayersWorkerStatic( QgsMapRendererParallelJob* self );
+
   protected:
 
     QImage mFinalImage;
@@ -69,9 +100,17 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     QgsPalLabeling* mLabelingEngine;
     //! New labeling engine
     QgsLabelingEngineV2* mLabelingEngineV2;
+    //! engine to take the labeling settings from instead of the project
+    QgsPalLabeling* mLabelingEngineSettings;
     QgsRenderContext mLabelingRenderContext;
     QFuture<void> mLabelingFuture;
     QFutureWatcher<void> mLabelingFutureWatcher;
+
+    int mMaxThreadCount;
+    //! the job once per thread when the number of threads is limited
+    QList<QgsMapRendererParallelJob*> mWorkers;
+    //! index of the next layer job for the workers
+    QAtomicInt mNextLayerJob;
 };
 
 
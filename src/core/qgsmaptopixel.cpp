@@ -17,11 +17,13 @@
 #include "qgsmaptopixel.h"
 
 #include <QPoint>
+#include <QPolygonF>
 #include <QTextStream>
 #include <QVector>
 #include <QTransform>
 
 #include "qgslogger.h"
+#include "qgsgeometrykernels.h"
 
 QgsMapToPixel::QgsMapToPixel( double mapUnitsPerPixel,
                               double xc,
@@ -323,6 +325,11 @@ void QgsMapToPixel::transformInPlace( double& x, double& y ) const
   y = my;
 }
 
+void QgsMapToPixel::transformInPlace( QPolygonF& poly ) const
+{
+  QgsGeometryKernels::transform( poly.data(), poly.size(), mMatrix );
+}
+
 void QgsMapToPixel::transformInPlace( float& x, float& y ) const
 {
   double mx = x, my = y;
@@ -25,6 +25,7 @@
 
 class QgsPoint;
 class QPoint;
+class QPolygonF;
 
 /** \ingroup core
   * Perform transforms between map coordinates and device coordinates.
@@ -111,6 +112,14 @@ class CORE_EXPORT QgsMapToPixel
         transformInPlace( x[i], y[i] );
     }
 
+    /**
+     * Transform map coordinates of all the points of a polygon to device
+     * coordinates, in place. Faster than transforming the points one by one.
+     * @note added in QGIS 2.16
+     * @note not available in python bindings
+     */
+    void transformInPlace( QPolygonF& poly ) const;
+
     QgsPoint toMapCoordinates( int x, int y ) const;
 
     //! Transform device coordinates to map (world) coordinates
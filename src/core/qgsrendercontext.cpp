@@ -22,6 +22,8 @@
 #include "qgsexpression.h"
 #include "qgsvectorlayer.h"
 #include "qgsfeaturefilterprovider.h"
+#include "qgsgeometry.h"
+#include "qgsgeometrycollectionv2.h"
 
 QgsRenderContext::QgsRenderContext()
     : mFlags( DrawEditingInfo | UseAdvancedEffects | DrawSelection | UseRenderingOptimization )
@@ -34,6 +36,8 @@ QgsRenderContext::QgsRenderContext()
     , mLabelingEngine( nullptr )
     , mLabelingEngine2( nullptr )
     , mGeometry( nullptr )
+    , mFeatureGeometry( nullptr )
+    , mFeatureGeometryPart( -1 )
     , mFeatureFilterProvider( nullptr )
 {
   mVectorSimplifyMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
@@ -55,6 +59,8 @@ QgsRenderContext::QgsRenderContext( const QgsRenderContext& rh )
     , mVectorSimplifyMethod( rh.mVectorSimplifyMethod )
     , mExpressionContext( rh.mExpressionContext )
     , mGeometry( rh.mGeometry )
+    , mFeatureGeometry( rh.mFeatureGeometry )
+    , mFeatureGeometryPart( rh.mFeatureGeometryPart )
     , mFeatureFilterProvider( rh.mFeatureFilterProvider ? rh.mFeatureFilterProvider->clone() : nullptr )
 {
 }
@@ -76,6 +82,8 @@ QgsRenderContext&QgsRenderContext::operator=( const QgsRenderContext & rh )
   mVectorSimplifyMethod = rh.mVectorSimplifyMethod;
   mExpressionContext = rh.mExpressionContext;
   mGeometry = rh.mGeometry;
+  mFeatureGeometry = rh.mFeatureGeometry;
+  mFeatureGeometryPart = rh.mFeatureGeometryPart;
   mFeatureFilterProvider = rh.mFeatureFilterProvider ? rh.mFeatureFilterProvider->clone() : nullptr;
   return *this;
 }
@@ -200,3 +208,32 @@ void QgsRenderContext::setFeatureFilterProvider( const QgsFeatureFilterProvider*
     mFeatureFilterProvider = ffp->clone();
   }
 }
+
+const QgsAbstractGeometryV2* QgsRenderContext::geometry() const
+{
+  if ( mGeometry || !mFeatureGeometry )
+    return mGeometry;
+
+  const QgsAbstractGeometryV2* geometry = mFeatureGeometry->geometry();
+  if ( mFeatureGeometryPart >= 0 )
+  {
+    const QgsGeometryCollectionV2* collection = dynamic_cast<const QgsGeometryCollectionV2*>( geometry );
+    if ( collection )
+      return collection->geometryN( mFeatureGeometryPart );
+  }
+  return geometry;
+}
+
+void QgsRenderContext::setGeometry( const QgsAbstractGeometryV2* geometry )
+{
+  mGeometry = geometry;
+  mFeatureGeometry = nullptr;
+  mFeatureGeometryPart = -1;
+}
+
+void QgsRenderContext::setFeatureGeometry( const QgsGeometry* geometry, int part )
+{
+  mGeometry = nullptr;
+  mFeatureGeometry = geometry;
+  mFeatureGeometryPart = part;
+}
@@ -29,6 +29,7 @@
 class QPainter;
 
 class QgsAbstractGeometryV2;
+class QgsGeometry;
 class QgsLabelingEngineInterface;
 class QgsLabelingEngineV2;
 class QgsMapSettings;
@@ -201,9 +202,17 @@ class CORE_EXPORT QgsRenderContext
     const QgsExpressionContext& expressionContext() const { return mExpressionContext; }
 
     /** Returns pointer to the unsegmentized geometry*/
-    const QgsAbstractGeometryV2* geometry() const { return mGeometry; }
+    const QgsAbstractGeometryV2* geometry() const;
     /** Sets pointer to original (unsegmentized) geometry*/
-    void setGeometry( const QgsAbstractGeometryV2* geometry ) { mGeometry = geometry; }
+    void setGeometry( const QgsAbstractGeometryV2* geometry );
+    /** Sets the feature geometry the original geometry is taken from. Its geometry object is
+     * only built if geometry() is called, e.g. when the feature is rendered from its wkb.
+     * @param geometry feature geometry
+     * @param part index of the part of a multi geometry, or -1 for the whole geometry
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void setFeatureGeometry( const QgsGeometry* geometry, int part = -1 );
 
     /** Set a filter feature provider used for additional filtering of rendered features.
      * @param ffp the filter feature provider
@@ -263,6 +272,12 @@ class CORE_EXPORT QgsRenderContext
     /** Pointer to the (unsegmentized) geometry*/
     const QgsAbstractGeometryV2* mGeometry;
 
+    /** Feature geometry the (unsegmentized) geometry is built from on demand, if mGeometry is not set*/
+    const QgsGeometry* mFeatureGeometry;
+
+    /** Part of the feature geometry, -1 for the whole geometry*/
+    int mFeatureGeometryPart;
+
     /** The feature filter provider */
     const QgsFeatureFilterProvider* mFeatureFilterProvider;
 
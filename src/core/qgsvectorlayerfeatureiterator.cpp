@@ -78,6 +78,9 @@ QgsVectorLayerFeatureSource::QgsVectorLayerFeatureSource( QgsVectorLayer *layer
 
 QgsVectorLayerFeatureSource::~QgsVectorLayerFeatureSource()
 {
+  // the iterators may still read from the provider source on a prefetching thread
+  closeIterators();
+
   delete mJoinBuffer;
   delete mExpressionFieldBuffer;
   delete mProviderFeatureSource;
@@ -93,6 +96,7 @@ QgsFeatureIterator QgsVectorLayerFeatureSource::getFeatures( const QgsFeatureReq
 QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource<QgsVectorLayerFeatureSource>( source, ownSource, request )
     , mFetchedFid( false )
+    , mHasDirectJoins( false )
     , mEditGeometrySimplifier( nullptr )
     , mInterruptionChecker( nullptr )
 {
@@ -104,6 +108,13 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeat
 
   mHasVirtualAttributes = !mFetchJoinInfo.isEmpty() || !mExpressionFieldInfo.isEmpty();
 
+  // joins which are not cached in memory are resolved by blocks of features
+  Q_FOREACH ( const FetchJoinInfo& info, mFetchJoinInfo )
+  {
+    if ( info.joinInfo->cachedAttributes.isEmpty() )
+      mHasDirectJoins = true;
+  }
+
   // by default provider's request is the same
   mProviderRequest = mRequest;
 
@@ -169,7 +180,7 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeat
     }
     else
     {
-      mProviderIterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+      mProviderIterator = providerFeatures();
     }
 
     rewindEditBuffer();
@@ -183,6 +194,14 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeat
 }
 
 
+QgsFeatureIterator QgsVectorLayerFeatureIterator::providerFeatures()
+{
+  if ( mRequest.flags() & QgsFeatureRequest::PrefetchFeatures )
+    return QgsFeatureIterator( new QgsPrefetchingFeatureIterator( mSource->mProviderFeatureSource, mProviderRequest ) );
+
+  return mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+}
+
 QgsVectorLayerFeatureIterator::~QgsVectorLayerFeatureIterator()
 {
   delete mEditGeometrySimplifier;
@@ -236,10 +255,89 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature& f )
   if ( mProviderIterator.isClosed() )
   {
     mChangedFeaturesIterator.close();
-    mProviderIterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+    mProviderIterator = providerFeatures();
     mProviderIterator.setInterruptionChecker( mInterruptionChecker );
   }
 
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && mProviderRequest.filterType() != QgsFeatureRequest::FilterExpression )
+  {
+    //filtering by expression, and couldn't do it on the provider side:
+    //read ahead a block of features and evaluate the filter for all of them at once
+    while ( mFilteredFeatures.isEmpty() )
+    {
+      QgsFeatureList block;
+      const int blockSize = filterBlockSize();
+      while ( block.count() < blockSize && !mustStop() && fetchNextProviderFeature( f ) )
+        block << f;
+
+      // an interrupted render does not need the rest of the block
+      if ( block.isEmpty() || mustStop() )
+        break;
+
+      filterFeatureBlock( block );
+    }
+
+    if ( !mFilteredFeatures.isEmpty() )
+    {
+      f = mFilteredFeatures.takeFirst();
+
+      // update geometry
+      if ( !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
+        updateFeatureGeometry( f );
+
+      return true;
+    }
+  }
+  else
+  {
+    while ( fetchNextProviderFeature( f ) )
+    {
+      // update geometry
+      // TODO[MK]: FilterRect check after updating the geometry
+      if ( !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
+        updateFeatureGeometry( f );
+
+      return true;
+    }
+  }
+  // no more provider features
+
+  close();
+  return false;
+}
+
+bool QgsVectorLayerFeatureIterator::fetchNextProviderFeature( QgsFeature& f )
+{
+  if ( mHasDirectJoins )
+  {
+    // read ahead a block of features and query their joined features at once
+    if ( mJoinedFeatures.isEmpty() )
+    {
+      const int blockSize = filterBlockSize();
+      while ( mJoinedFeatures.count() < blockSize && !mustStop() && nextProviderFeature( f ) )
+        mJoinedFeatures << f;
+
+      if ( mJoinedFeatures.isEmpty() )
+        return false;
+
+      addVirtualAttributes( mJoinedFeatures );
+    }
+
+    f = mJoinedFeatures.takeFirst();
+    return true;
+  }
+
+  if ( !nextProviderFeature( f ) )
+    return false;
+
+  if ( mHasVirtualAttributes )
+    addVirtualAttributes( f );
+
+  return true;
+}
+
+bool QgsVectorLayerFeatureIterator::nextProviderFeature( QgsFeature& f )
+{
   while ( mProviderIterator.nextFeature( f ) )
   {
     if ( mFetchConsidered.contains( f.id() ) )
@@ -252,30 +350,9 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature& f )
     if ( mSource->mHasEditBuffer )
       updateChangedAttributes( f );
 
-    if ( mHasVirtualAttributes )
-      addVirtualAttributes( f );
-
-    if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && mProviderRequest.filterType() != QgsFeatureRequest::FilterExpression )
-    {
-      //filtering by expression, and couldn't do it on the provider side
-      mRequest.expressionContext()->setFeature( f );
-      if ( !mRequest.filterExpression()->evaluate( mRequest.expressionContext() ).toBool() )
-      {
-        //feature did not match filter
-        continue;
-      }
-    }
-
-    // update geometry
-    // TODO[MK]: FilterRect check after updating the geometry
-    if ( !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
-      updateFeatureGeometry( f );
-
     return true;
   }
-  // no more provider features
 
-  close();
   return false;
 }
 
@@ -293,6 +370,7 @@ bool QgsVectorLayerFeatureIterator::rewind()
   else
   {
     mProviderIterator.rewind();
+    mJoinedFeatures.clear();
     rewindEditBuffer();
   }
 
@@ -305,6 +383,7 @@ bool QgsVectorLayerFeatureIterator::close()
     return false;
 
   mProviderIterator.close();
+  mJoinedFeatures.clear();
 
   iteratorClosed();
 
@@ -507,6 +586,7 @@ void QgsVectorLayerFeatureIterator::prepareJoins()
       info.joinInfo = joinInfo;
       info.joinLayer = joinLayer;
       info.indexOffset = mSource->mJoinBuffer->joinedFieldsOffset( joinInfo, mSource->mFields );
+      info.lookupCache = mSource->mJoinBuffer->lookupCache( joinInfo->joinLayerId );
 
       if ( joinInfo->targetFieldName.isEmpty() )
         info.targetField = joinInfo->targetFieldIndex;    //for compatibility with 1.x
@@ -605,6 +685,28 @@ void QgsVectorLayerFeatureIterator::addJoinedAttributes( QgsFeature &f )
   }
 }
 
+void QgsVectorLayerFeatureIterator::addJoinedAttributes( QgsFeatureList& features )
+{
+  QMap<const QgsVectorJoinInfo*, FetchJoinInfo>::const_iterator joinIt = mFetchJoinInfo.constBegin();
+  for ( ; joinIt != mFetchJoinInfo.constEnd(); ++joinIt )
+  {
+    const FetchJoinInfo& info = joinIt.value();
+
+    if ( info.joinInfo->cachedAttributes.isEmpty() )
+    {
+      info.addJoinedAttributesBatch( features );
+      continue;
+    }
+
+    for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
+    {
+      QVariant targetFieldValue = it->attribute( info.targetField );
+      if ( targetFieldValue.isValid() )
+        info.addJoinedAttributesCached( *it, targetFieldValue );
+    }
+  }
+}
+
 void QgsVectorLayerFeatureIterator::addVirtualAttributes( QgsFeature& f )
 {
   // make sure we have space for newly added attributes
@@ -616,17 +718,40 @@ void QgsVectorLayerFeatureIterator::addVirtualAttributes( QgsFeature& f )
     addJoinedAttributes( f );
 
   if ( !mExpressionFieldInfo.isEmpty() )
+    addExpressionAttributes( f );
+}
+
+void QgsVectorLayerFeatureIterator::addVirtualAttributes( QgsFeatureList& features )
+{
+  for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
   {
-    QMap<int, QgsExpression*>::ConstIterator it = mExpressionFieldInfo.constBegin();
+    QgsAttributes attr = it->attributes();
+    attr.resize( mSource->mFields.count() );
+    it->setAttributes( attr );
+  }
 
-    for ( ; it != mExpressionFieldInfo.constEnd(); ++it )
-    {
-      QgsExpression* exp = it.value();
-      mExpressionContext->setFeature( f );
-      QVariant val = exp->evaluate( mExpressionContext.data() );
-      mSource->mFields.at( it.key() ).convertCompatible( val );
-      f.setAttribute( it.key(), val );
-    }
+  if ( !mFetchJoinInfo.isEmpty() )
+    addJoinedAttributes( features );
+
+  // expression fields may use the joined fields
+  if ( !mExpressionFieldInfo.isEmpty() )
+  {
+    for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
+      addExpressionAttributes( *it );
+  }
+}
+
+void QgsVectorLayerFeatureIterator::addExpressionAttributes( QgsFeature& f )
+{
+  QMap<int, QgsExpression*>::ConstIterator it = mExpressionFieldInfo.constBegin();
+
+  for ( ; it != mExpressionFieldInfo.constEnd(); ++it )
+  {
+    QgsExpression* exp = it.value();
+    mExpressionContext->setFeature( f );
+    QVariant val = exp->evaluate( mExpressionContext.data() );
+    mSource->mFields.at( it.key() ).convertCompatible( val );
+    f.setAttribute( it.key(), val );
   }
 }
 
@@ -689,13 +814,19 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesCached( Qg
 
 void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const
 {
-  // no memory cache, query the joined values by setting substring
-  QString subsetString = joinLayer->dataProvider()->subsetString(); // provider might already have a subset string
-  QString bkSubsetString = subsetString;
-  if ( !subsetString.isEmpty() )
-  {
-    subsetString.prepend( '(' ).append( ") AND " );
-  }
+  Q_UNUSED( joinValue );
+
+  // no memory cache, query the joined feature like for a block of features
+  QgsFeatureList features;
+  features << f;
+  addJoinedAttributesBatch( features );
+  f = features.first();
+}
+
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesBatch( QgsFeatureList& features ) const
+{
+  if ( joinField < 0 )
+    return;
 
   QString joinFieldName;
   if ( joinInfo->joinFieldName.isEmpty() && joinInfo->joinFieldIndex >= 0 && joinInfo->joinFieldIndex < joinLayer->fields().count() )
@@ -703,75 +834,122 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( Qg
   else
     joinFieldName = joinInfo->joinFieldName;
 
-  subsetString.append( QString( "\"%1\"" ).arg( joinFieldName ) );
+  // the cache is shared by all joins to the layer, its keys include the join field
+  const QString keyPrefix = QString::number( joinField ) + ':';
 
-  if ( joinValue.isNull() )
+  // joined attributes by join value, first the ones from the lookup cache
+  QHash<QString, QgsAttributes> joined;
+  QList<QVariant> missingValues;
+  bool missingNull = false;
+  for ( QgsFeatureList::const_iterator it = features.constBegin(); it != features.constEnd(); ++it )
   {
-    subsetString += " IS NULL";
+    QVariant targetFieldValue = it->attribute( targetField );
+    if ( !targetFieldValue.isValid() )
+      continue;
+
+    if ( targetFieldValue.isNull() )
+    {
+      missingNull = true;
+      continue;
+    }
+
+    QString key = targetFieldValue.toString();
+    if ( joined.contains( key ) )
+      continue;
+
+    QgsAttributes attr;
+    if ( !lookupCache || !lookupCache->lookup( keyPrefix + key, attr ) )
+      missingValues << targetFieldValue;
+    joined.insert( key, attr );
   }
-  else
+
+  QgsAttributes nullAttributes;
+  if ( !missingValues.isEmpty() || missingNull )
   {
-    QString v = joinValue.toString();
-    switch ( joinValue.type() )
+    // one request for all the values which are not cached
+    QStringList filters;
+    if ( !missingValues.isEmpty() )
     {
-      case QVariant::Int:
-      case QVariant::LongLong:
-      case QVariant::Double:
-        break;
+      QStringList values;
+      Q_FOREACH ( const QVariant& value, missingValues )
+        values << QgsExpression::quotedValue( value );
+      filters << QString( "%1 IN (%2)" ).arg( QgsExpression::quotedColumnRef( joinFieldName ), values.join( "," ) );
+    }
+    if ( missingNull )
+      filters << QString( "%1 IS NULL" ).arg( QgsExpression::quotedColumnRef( joinFieldName ) );
 
-      default:
-      case QVariant::String:
-        v.replace( '\'', "''" );
-        v.prepend( '\'' ).append( '\'' );
-        break;
+    // all the attributes are fetched, the cached features may be used by other iterators
+    QgsFeatureRequest request;
+    request.setFlags( QgsFeatureRequest::NoGeometry );
+    request.setFilterExpression( filters.join( " OR " ) );
+    QgsFeatureIterator fi = joinLayer->getFeatures( request );
+
+    QSet<QString> found;
+    QgsFeature fet;
+    while ( fi.nextFeature( fet ) )
+    {
+      QVariant joinValue = fet.attribute( joinField );
+      if ( joinValue.isNull() )
+      {
+        if ( nullAttributes.isEmpty() )
+          nullAttributes = fet.attributes();
+        continue;
+      }
+
+      // first joined feature wins
+      QString key = joinValue.toString();
+      if ( found.contains( key ) )
+        continue;
+      found << key;
+      joined[ key ] = fet.attributes();
     }
-    subsetString += '=' + v;
-  }
 
-  joinLayer->dataProvider()->setSubsetString( subsetString, false );
+    // values without joined feature are cached too
+    Q_FOREACH ( const QVariant& value, missingValues )
+    {
+      QString key = value.toString();
+      if ( lookupCache )
+        lookupCache->insert( keyPrefix + key, joined.value( key ) );
+    }
+  }
 
   // maybe user requested just a subset of layer's attributes
-  // so we do not have to cache everything
-  bool hasSubset = joinInfo->joinFieldNamesSubset();
   QVector<int> subsetIndices;
-  if ( hasSubset )
+  if ( joinInfo->joinFieldNamesSubset() )
     subsetIndices = QgsVectorLayerJoinBuffer::joinSubsetIndices( joinLayer, *joinInfo->joinFieldNamesSubset() );
 
-  // select (no geometry)
-  QgsFeatureRequest request;
-  request.setFlags( QgsFeatureRequest::NoGeometry );
-  request.setSubsetOfAttributes( attributes );
-  QgsFeatureIterator fi = joinLayer->getFeatures( request );
-
-  // get first feature
-  QgsFeature fet;
-  if ( fi.nextFeature( fet ) )
+  for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
   {
-    int index = indexOffset;
-    QgsAttributes attr = fet.attributes();
-    if ( hasSubset )
-    {
-      for ( int i = 0; i < subsetIndices.count(); ++i )
-        f.setAttribute( index++, attr.at( subsetIndices.at( i ) ) );
-    }
-    else
-    {
-      // use all fields except for the one used for join (has same value as exiting field in target layer)
-      for ( int i = 0; i < attr.count(); ++i )
-      {
-        if ( i == joinField )
-          continue;
+    QVariant targetFieldValue = it->attribute( targetField );
+    if ( !targetFieldValue.isValid() )
+      continue;
 
-        f.setAttribute( index++, attr.at( i ) );
-      }
-    }
+    const QgsAttributes& attr = targetFieldValue.isNull() ? nullAttributes : joined.value( targetFieldValue.toString() );
+    if ( !attr.isEmpty() )
+      setJoinedAttributes( *it, attr, joinInfo->joinFieldNamesSubset() ? &subsetIndices : nullptr );
+    // else no suitable join feature found, keeping empty (null) attributes
   }
-  else
+}
+
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::setJoinedAttributes( QgsFeature& f, const QgsAttributes& joinedAttributes, const QVector<int>* subsetIndices ) const
+{
+  int index = indexOffset;
+  if ( subsetIndices )
   {
-    // no suitable join feature found, keeping empty (null) attributes
+    for ( int i = 0; i < subsetIndices->count(); ++i )
+      f.setAttribute( index++, joinedAttributes.at( subsetIndices->at( i ) ) );
   }
+  else
+  {
+    // use all fields except for the one used for join (has same value as exiting field in target layer)
+    for ( int i = 0; i < joinedAttributes.count(); ++i )
+    {
+      if ( i == joinField )
+        continue;
 
-  joinLayer->dataProvider()->setSubsetString( bkSubsetString, false );
+      f.setAttribute( index++, joinedAttributes.at( i ) );
+    }
+  }
 }
 
 
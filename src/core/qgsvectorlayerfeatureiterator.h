@@ -25,6 +25,7 @@ class QgsExpressionFieldBuffer;
 class QgsVectorLayer;
 class QgsVectorLayerEditBuffer;
 class QgsVectorLayerJoinBuffer;
+class QgsVectorLayerJoinLookupCache;
 struct QgsVectorJoinInfo;
 class QgsExpressionContext;
 
@@ -33,7 +34,7 @@ class QgsVectorLayerFeatureIterator;
 /** Partial snapshot of vector layer's state (only the members necessary for access to features)
  * @note not available in Python bindings
 */
-class QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
+class CORE_EXPORT QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
 {
   public:
     explicit QgsVectorLayerFeatureSource( QgsVectorLayer* layer );
@@ -109,6 +110,12 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     bool fetchNextChangedGeomFeature( QgsFeature& f );
     //! @note not available in Python bindings
     bool fetchNextChangedAttributeFeature( QgsFeature& f );
+    /** Fetches the next feature from the provider which is not part of the edit buffer,
+     * with its attributes updated but before any filtering.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    bool fetchNextProviderFeature( QgsFeature& f );
     //! @note not available in Python bindings
     void useAddedFeature( const QgsFeature& src, QgsFeature& f );
     //! @note not available in Python bindings
@@ -118,6 +125,13 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     //! @note not available in Python bindings
     void addJoinedAttributes( QgsFeature &f );
 
+    /** Adds the joined attributes to a block of features, the joins which are not cached
+     * in memory are resolved with one request per block.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void addJoinedAttributes( QgsFeatureList& features );
+
     /**
      * Adds attributes that don't source from the provider but are added inside QGIS
      * Includes
@@ -129,6 +143,12 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
      */
     void addVirtualAttributes( QgsFeature &f );
 
+    /** Adds the virtual attributes to a block of features.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void addVirtualAttributes( QgsFeatureList& features );
+
     /** Update feature with uncommited attribute updates.
      * @note not available in Python bindings
      */
@@ -150,9 +170,18 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
       QgsVectorLayer* joinLayer;        //!< resolved pointer to the joined layer
       int targetField;                  //!< index of field (of this layer) that drives the join
       int joinField;                    //!< index of field (of the joined layer) must have equal value
+      QgsVectorLayerJoinLookupCache* lookupCache; //!< recently joined features, shared with the other iterators
 
       void addJoinedAttributesCached( QgsFeature& f, const QVariant& joinValue ) const;
       void addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const;
+
+      /** Queries the features joined to a block of features at once, using the lookup cache
+       * @note added in QGIS 2.16
+       */
+      void addJoinedAttributesBatch( QgsFeatureList& features ) const;
+
+      //! Copies the attributes of a joined feature to a feature, only the given subset of them if subsetIndices is set
+      void setJoinedAttributes( QgsFeature& f, const QgsAttributes& joinedAttributes, const QVector<int>* subsetIndices ) const;
     };
 
     QgsFeatureRequest mProviderRequest;
@@ -175,6 +204,12 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
 
     bool mHasVirtualAttributes;
 
+    //! whether some joins are queried from the joined layer, by blocks of features
+    bool mHasDirectJoins;
+
+    //! provider features with their virtual attributes, waiting to be returned
+    QgsFeatureList mJoinedFeatures;
+
   private:
     //! optional object to locally simplify edited (changed or added) geometries fetched by this feature iterator
     QgsAbstractGeometrySimplifier* mEditGeometrySimplifier;
@@ -183,6 +218,18 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
 
     QgsInterruptionChecker* mInterruptionChecker;
 
+    //! returns true if the interruption checker requests to stop reading features
+    bool mustStop() const { return mInterruptionChecker && mInterruptionChecker->mustStop(); }
+
+    //! opens the iterator of the provider, on a worker thread if requested with QgsFeatureRequest::PrefetchFeatures
+    QgsFeatureIterator providerFeatures();
+
+    //! fetches the next provider feature which is not part of the edit buffer, without its virtual attributes
+    bool nextProviderFeature( QgsFeature& f );
+
+    //! evaluates the expression fields of a feature
+    void addExpressionAttributes( QgsFeature& f );
+
     /**
      * Will always return true. We assume that ordering has been done on provider level already.
      *
@@ -22,6 +22,38 @@
 
 #include <QDomElement>
 
+//! Number of join values kept by the lookup cache of a join
+static const int LOOKUP_CACHE_SIZE = 100000;
+
+QgsVectorLayerJoinLookupCache::QgsVectorLayerJoinLookupCache( int maxValues )
+    : mCache( maxValues )
+{
+}
+
+bool QgsVectorLayerJoinLookupCache::lookup( const QString& value, QgsAttributes& attributes ) const
+{
+  QMutexLocker locker( &mMutex );
+  QgsAttributes* cached = mCache.object( value );
+  if ( !cached )
+    return false;
+
+  attributes = *cached;
+  return true;
+}
+
+void QgsVectorLayerJoinLookupCache::insert( const QString& value, const QgsAttributes& attributes )
+{
+  QMutexLocker locker( &mMutex );
+  mCache.insert( value, new QgsAttributes( attributes ) );
+}
+
+void QgsVectorLayerJoinLookupCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mCache.clear();
+}
+
+
 QgsVectorLayerJoinBuffer::QgsVectorLayerJoinBuffer( QgsVectorLayer* layer )
     : mLayer( layer )
 {
@@ -80,14 +112,14 @@ bool QgsVectorLayerJoinBuffer::addJoin( const QgsVectorJoinInfo& joinInfo )
     cacheJoinLayer( mVectorJoins.last() );
   }
 
+  // joins which are not cached in memory keep the recently used joined features
+  if ( !mLookupCaches.contains( joinInfo.joinLayerId ) )
+    mLookupCaches.insert( joinInfo.joinLayerId, QSharedPointer<QgsVectorLayerJoinLookupCache>( new QgsVectorLayerJoinLookupCache( LOOKUP_CACHE_SIZE ) ) );
+
   // Wait for notifications about changed fields in joined layer to propagate them.
   // During project load the joined layers possibly do not exist yet so the connection will not be created,
   // but then QgsProject makes sure to call createJoinCaches() which will do the connection.
-  // Unique connection makes sure we do not respond to one layer's update more times (in case of multiple join)
-  if ( QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinInfo.joinLayerId ) ) )
-  {
-    connect( vl, SIGNAL( updatedFields() ), this, SLOT( joinedLayerUpdatedFields() ), Qt::UniqueConnection );
-  }
+  connectJoinedLayer( joinInfo.joinLayerId );
 
   emit joinedFieldsChanged();
   return true;
@@ -106,15 +138,30 @@ bool QgsVectorLayerJoinBuffer::removeJoin( const QString& joinLayerId )
     }
   }
 
+  mLookupCaches.remove( joinLayerId );
+
   if ( QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinLayerId ) ) )
   {
     disconnect( vl, SIGNAL( updatedFields() ), this, SLOT( joinedLayerUpdatedFields() ) );
+    disconnect( vl, SIGNAL( layerModified() ), this, SLOT( joinedLayerModified() ) );
+    disconnect( vl, SIGNAL( dataChanged() ), this, SLOT( joinedLayerModified() ) );
   }
 
   emit joinedFieldsChanged();
   return res;
 }
 
+void QgsVectorLayerJoinBuffer::connectJoinedLayer( const QString& joinLayerId )
+{
+  // Unique connection makes sure we do not respond to one layer's update more times (in case of multiple join)
+  if ( QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinLayerId ) ) )
+  {
+    connect( vl, SIGNAL( updatedFields() ), this, SLOT( joinedLayerUpdatedFields() ), Qt::UniqueConnection );
+    connect( vl, SIGNAL( layerModified() ), this, SLOT( joinedLayerModified() ), Qt::UniqueConnection );
+    connect( vl, SIGNAL( dataChanged() ), this, SLOT( joinedLayerModified() ), Qt::UniqueConnection );
+  }
+}
+
 void QgsVectorLayerJoinBuffer::cacheJoinLayer( QgsVectorJoinInfo& joinInfo )
 {
   //memory cache not required or already done
@@ -263,8 +310,7 @@ void QgsVectorLayerJoinBuffer::createJoinCaches()
     cacheJoinLayer( *joinIt );
 
     // make sure we are connected to the joined layer
-    if ( QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( joinIt->joinLayerId ) ) )
-      connect( vl, SIGNAL( updatedFields() ), this, SLOT( joinedLayerUpdatedFields() ), Qt::UniqueConnection );
+    connectJoinedLayer( joinIt->joinLayerId );
   }
 }
 
@@ -317,6 +363,7 @@ void QgsVectorLayerJoinBuffer::writeXml( QDomNode& layer_node, QDomDocument& doc
 void QgsVectorLayerJoinBuffer::readXml( const QDomNode& layer_node )
 {
   mVectorJoins.clear();
+  mLookupCaches.clear();
   QDomElement vectorJoinsElem = layer_node.firstChildElement( "vectorjoins" );
   if ( !vectorJoinsElem.isNull() )
   {
@@ -392,9 +439,15 @@ QgsVectorLayerJoinBuffer* QgsVectorLayerJoinBuffer::clone() const
 {
   QgsVectorLayerJoinBuffer* cloned = new QgsVectorLayerJoinBuffer( mLayer );
   cloned->mVectorJoins = mVectorJoins;
+  cloned->mLookupCaches = mLookupCaches;
   return cloned;
 }
 
+QgsVectorLayerJoinLookupCache* QgsVectorLayerJoinBuffer::lookupCache( const QString& joinLayerId ) const
+{
+  return mLookupCaches.value( joinLayerId ).data();
+}
+
 void QgsVectorLayerJoinBuffer::joinedLayerUpdatedFields()
 {
   QgsVectorLayer* joinedLayer = qobject_cast<QgsVectorLayer*>( sender() );
@@ -410,5 +463,18 @@ void QgsVectorLayerJoinBuffer::joinedLayerUpdatedFields()
     }
   }
 
+  if ( QgsVectorLayerJoinLookupCache* cache = lookupCache( joinedLayer->id() ) )
+    cache->clear();
+
   emit joinedFieldsChanged();
 }
+
+void QgsVectorLayerJoinBuffer::joinedLayerModified()
+{
+  QgsVectorLayer* joinedLayer = qobject_cast<QgsVectorLayer*>( sender() );
+  Q_ASSERT( joinedLayer );
+
+  // the joined features may have changed
+  if ( QgsVectorLayerJoinLookupCache* cache = lookupCache( joinedLayer->id() ) )
+    cache->clear();
+}
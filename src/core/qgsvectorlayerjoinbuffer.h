@@ -21,13 +21,55 @@
 #include "qgsfeature.h"
 #include "qgsvectorlayer.h"
 
+#include <QCache>
 #include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
 #include <QString>
 
 
 typedef QList< QgsVectorJoinInfo > QgsVectorJoinList;
 
 
+/** \ingroup core
+ * Bounded least recently used cache of the attributes of joined features, by value of
+ * the join field. It is used for the joins which are not cached in memory and is shared
+ * by a join buffer and its clones, so that feature iterators running at the same time
+ * or one after another profit from each other's lookups.
+ *
+ * The class is thread-safe.
+ * @note added in QGIS 2.16
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsVectorLayerJoinLookupCache
+{
+  public:
+    //! Constructs a cache for the given number of join values
+    explicit QgsVectorLayerJoinLookupCache( int maxValues );
+
+    /** Looks up the attributes of the feature joined to a value.
+     * @param value value of the join field, as string
+     * @param attributes output: attributes of the joined feature, empty if no feature is joined to the value
+     * @return whether the value is in the cache
+     */
+    bool lookup( const QString& value, QgsAttributes& attributes ) const;
+
+    //! Stores the attributes of the feature joined to a value, empty if no feature is joined to it
+    void insert( const QString& value, const QgsAttributes& attributes );
+
+    //! Removes all values
+    void clear();
+
+  private:
+    mutable QMutex mMutex;
+    // lookups update the order of use
+    mutable QCache<QString, QgsAttributes> mCache;
+
+    QgsVectorLayerJoinLookupCache( const QgsVectorLayerJoinLookupCache& rh );
+    QgsVectorLayerJoinLookupCache& operator=( const QgsVectorLayerJoinLookupCache& rh );
+};
+
+
 /** Manages joined fields for a vector layer*/
 class CORE_EXPORT QgsVectorLayerJoinBuffer : public QObject
 {
@@ -82,6 +124,13 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer : public QObject
     //! @note added in 2.6
     QgsVectorLayerJoinBuffer* clone() const;
 
+    /** Returns the lookup cache of a join, shared with the clones of the join buffer
+     * @param joinLayerId id of the joined layer
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    QgsVectorLayerJoinLookupCache* lookupCache( const QString& joinLayerId ) const;
+
   signals:
     //! Emitted whenever the list of joined fields changes (e.g. added join or joined layer's fields change)
     //! @note added in 2.6
@@ -89,6 +138,7 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer : public QObject
 
   private slots:
     void joinedLayerUpdatedFields();
+    void joinedLayerModified();
 
   private:
 
@@ -97,6 +147,12 @@ class CORE_EXPORT QgsVectorLayerJoinBuffer : public QObject
     /** Joined vector layers*/
     QgsVectorJoinList mVectorJoins;
 
+    /** Lookup caches of the joins, by id of the joined layer*/
+    QHash< QString, QSharedPointer<QgsVectorLayerJoinLookupCache> > mLookupCaches;
+
+    /** Connects to the signals of a joined layer*/
+    void connectJoinedLayer( const QString& joinLayerId );
+
     /** Caches attributes of join layer in memory if QgsVectorJoinInfo.memoryCache is true (and the cache is not already there)*/
     void cacheJoinLayer( QgsVectorJoinInfo& joinInfo );
 };
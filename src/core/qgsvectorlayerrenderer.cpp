@@ -36,6 +36,7 @@
 
 #include <QSettings>
 #include <QPicture>
+#include <QThread>
 
 // TODO:
 // - passing of cache to QgsVectorLayer
@@ -54,6 +55,7 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
     , mLabelProvider( nullptr )
     , mDiagramProvider( nullptr )
     , mLayerTransparency( 0 )
+    , mPrefetchFeatures( false )
 {
   mSource = new QgsVectorLayerFeatureSource( layer );
 
@@ -89,6 +91,9 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
 
   mVertexMarkerSize = settings.value( "/qgis/digitizing/marker_size", 3 ).toInt();
 
+  // overlap reading the features with drawing them, if enabled and there is a spare core
+  mPrefetchFeatures = QThread::idealThreadCount() > 1 && settings.value( "/qgis/prefetch_features", false ).toBool();
+
   if ( !mRendererV2 )
     return;
 
@@ -246,6 +251,9 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
+  if ( mPrefetchFeatures )
+    featureRequest.setFlags( featureRequest.flags() | QgsFeatureRequest::PrefetchFeatures );
+
   QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
   // Attach an interruption checker so that iterators that have potentially
   // slow fetchFeature() implementations, such as in the WFS provider, can
@@ -296,9 +304,28 @@ void QgsVectorLayerRenderer::drawRendererV2( QgsFeatureIterator& fit )
   QgsExpressionContextScope* symbolScope = QgsExpressionContextUtils::updateSymbolScope( nullptr, new QgsExpressionContextScope() );
   mContext.expressionContext().appendScope( symbolScope );
 
+  // features are fetched by blocks, which lets the renderer evaluate its expressions for all of them at once
+  const int blockSize = 1024;
+  QgsFeatureList block;
+  int blockRow = 0;
+
   QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  Q_FOREVER
   {
+    if ( blockRow == block.count() )
+    {
+      block.clear();
+      blockRow = 0;
+      while ( block.count() < blockSize && !mContext.renderingStopped() && fit.nextFeature( fet ) )
+        block << fet;
+
+      if ( block.isEmpty() )
+        break;
+
+      mRendererV2->prepareFeatureBlock( block, mContext );
+    }
+    fet = block.at( blockRow++ );
+
     try
     {
       if ( mContext.renderingStopped() )
@@ -140,6 +140,9 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     QgsVectorSimplifyMethod mSimplifyMethod;
     bool mSimplifyGeometry;
+
+    //! read the features on a worker thread while drawing
+    bool mPrefetchFeatures;
 };
 
 
@@ -143,6 +143,14 @@ QgsRasterBlock * QgsBrightnessContrastFilter::block( int bandNo, QgsRectangle  c
     return outputBlock;
   }
 
+  if ( !QgsRasterBlock::typeIsColor( inputBlock->dataType() ) )
+  {
+    QgsDebugMsg( "Input is not a rendered image" );
+    outputBlock->setIsNoData();
+    delete inputBlock;
+    return outputBlock;
+  }
+
   // adjust image
   QRgb myNoDataColor = qRgba( 0, 0, 0, 0 );
   QRgb myColor;
@@ -150,22 +158,36 @@ QgsRasterBlock * QgsBrightnessContrastFilter::block( int bandNo, QgsRectangle  c
   int r, g, b, alpha;
   double f = qPow(( mContrast + 100 ) / 100.0, 2 );
 
+  // opaque pixels only depend on the component value
+  int opaqueComponents[256];
+  for ( int i = 0; i < 256; i++ )
+  {
+    opaqueComponents[i] = adjustColorComponent( i, 255, mBrightness, f );
+  }
+
+  const QRgb *inputColors = inputBlock->typedData<QRgb>();
+  QRgb *outputColors = outputBlock->typedData<QRgb>();
   for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
   {
-    if ( inputBlock->color( i ) == myNoDataColor )
+    myColor = inputColors[i];
+    if ( myColor == myNoDataColor )
     {
-      outputBlock->setColor( i, myNoDataColor );
+      outputColors[i] = myNoDataColor;
       continue;
     }
 
-    myColor = inputBlock->color( i );
     alpha = qAlpha( myColor );
+    if ( alpha == 255 )
+    {
+      outputColors[i] = qRgba( opaqueComponents[ qRed( myColor )], opaqueComponents[ qGreen( myColor )], opaqueComponents[ qBlue( myColor )], alpha );
+      continue;
+    }
 
     r = adjustColorComponent( qRed( myColor ), alpha, mBrightness, f );
     g = adjustColorComponent( qGreen( myColor ), alpha, mBrightness, f );
     b = adjustColorComponent( qBlue( myColor ), alpha, mBrightness, f );
 
-    outputBlock->setColor( i, qRgba( r, g, b, alpha ) );
+    outputColors[i] = qRgba( r, g, b, alpha );
   }
 
   delete inputBlock;
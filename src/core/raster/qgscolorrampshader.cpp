@@ -22,17 +22,24 @@ originally part of the larger QgsRasterLayer class
 #include "qgslogger.h"
 #include "qgis.h"
 #include "qgscolorrampshader.h"
+#include "qgsrasterblock.h"
 
+#include <algorithm>
 #include <cmath>
 
+//! Number of intervals of the quantized lookup table
+#define QUANTIZED_LOOKUP_TABLE_SIZE 4096
+
 QgsColorRampShader::QgsColorRampShader( double theMinimumValue, double theMaximumValue )
     : QgsRasterShaderFunction( theMinimumValue, theMaximumValue )
     , mColorRampType( INTERPOLATED )
+    , mLookupTableType( QGis::UnknownDataType )
+    , mLookupMinimum( 0.0 )
+    , mLookupScale( 0.0 )
     , mClip( false )
 {
   QgsDebugMsgLevel( "called.", 4 );
   mMaximumColorCacheSize = 1024; //good starting value
-  mCurrentColorRampItemIndex = 0;
 }
 
 QString QgsColorRampShader::colorRampTypeAsQString()
@@ -49,172 +56,240 @@ QString QgsColorRampShader::colorRampTypeAsQString()
   return QString( "Unknown" );
 }
 
-bool QgsColorRampShader::discreteColor( double theValue, int* theReturnRedValue, int* theReturnGreenValue, int* theReturnBlueValue, int* theReturnAlphaValue )
+static bool itemValueLessThan( const QgsColorRampShader::ColorRampItem& item, double value )
 {
-  int myColorRampItemCount = mColorRampItemList.count();
-  if ( myColorRampItemCount <= 0 )
-  {
-    return false;
-  }
+  return item.value < value;
+}
 
-  double myTinyDiff = 0.0;
-  QgsColorRampShader::ColorRampItem myColorRampItem;
-  while ( mCurrentColorRampItemIndex >= 0 && mCurrentColorRampItemIndex < myColorRampItemCount )
+int QgsColorRampShader::itemIndex( double value ) const
+{
+  int index = std::lower_bound( mColorRampItemList.constBegin(), mColorRampItemList.constEnd(), value, itemValueLessThan ) - mColorRampItemList.constBegin();
+  if ( index > 0 && value - mColorRampItemList.at( index - 1 ).value <= DOUBLE_DIFF_THRESHOLD )
   {
-    //Start searching from the last index - assumtion is that neighboring pixels tend to be similar values
-    myColorRampItem = mColorRampItemList.value( mCurrentColorRampItemIndex );
-    myTinyDiff = qAbs( theValue - myColorRampItem.value );
-    //If the previous entry is less, then search closer to the top of the list (assumes mColorRampItemList is sorted)
-    if ( mCurrentColorRampItemIndex != 0 &&
-         theValue <= mColorRampItemList.at( mCurrentColorRampItemIndex - 1 ).value )
-    {
-      mCurrentColorRampItemIndex--;
-    }
-    else if ( theValue <= myColorRampItem.value || myTinyDiff <= DOUBLE_DIFF_THRESHOLD )
-    {
-      *theReturnRedValue = myColorRampItem.color.red();
-      *theReturnGreenValue = myColorRampItem.color.green();
-      *theReturnBlueValue = myColorRampItem.color.blue();
-      *theReturnAlphaValue = myColorRampItem.color.alpha();
-      //Cache the shaded value
-      if ( mMaximumColorCacheSize >= mColorCache.size() )
-      {
-        mColorCache.insert( theValue, myColorRampItem.color );
-      }
-      return true;
-    }
-    //Search deeper into the color ramp list
-    else
-    {
-      mCurrentColorRampItemIndex++;
-    }
+    index--;
   }
-
-  return false; // value not found
+  return index;
 }
 
-bool QgsColorRampShader::exactColor( double theValue, int* theReturnRedValue, int* theReturnGreenValue, int* theReturnBlueValue, int *theReturnAlphaValue )
+bool QgsColorRampShader::itemColor( double theValue, int* theReturnRedValue, int* theReturnGreenValue, int* theReturnBlueValue, int* theReturnAlphaValue ) const
 {
   int myColorRampItemCount = mColorRampItemList.count();
-  if ( myColorRampItemCount <= 0 )
+  if ( myColorRampItemCount <= 0 || qIsNaN( theValue ) )
   {
     return false;
   }
 
-  double myTinyDiff = 0.0;
-  QgsColorRampShader::ColorRampItem myColorRampItem;
-  while ( mCurrentColorRampItemIndex >= 0 && mCurrentColorRampItemIndex < myColorRampItemCount )
+  int myIndex = itemIndex( theValue );
+  QColor myColor;
+  if ( QgsColorRampShader::EXACT == mColorRampType )
   {
-    //Start searching from the last index - assumtion is that neighboring pixels tend to be similar values
-    myColorRampItem = mColorRampItemList.value( mCurrentColorRampItemIndex );
-    myTinyDiff = qAbs( theValue - myColorRampItem.value );
-    if ( qgsDoubleNear( theValue, myColorRampItem.value ) || myTinyDiff <= DOUBLE_DIFF_THRESHOLD )
-    {
-      *theReturnRedValue = myColorRampItem.color.red();
-      *theReturnGreenValue = myColorRampItem.color.green();
-      *theReturnBlueValue = myColorRampItem.color.blue();
-      *theReturnAlphaValue = myColorRampItem.color.alpha();
-      //Cache the shaded value
-      if ( mMaximumColorCacheSize >= mColorCache.size() )
-      {
-        mColorCache.insert( theValue, myColorRampItem.color );
-      }
-      return true;
-    }
-    //pixel value sits between ramp entries so bail
-    else if ( mCurrentColorRampItemIndex != myColorRampItemCount - 1 &&
-              theValue > myColorRampItem.value && theValue < mColorRampItemList.at(
-                mCurrentColorRampItemIndex + 1 ).value )
-    {
+    //pixel value has to match a ramp entry
+    if ( myIndex == myColorRampItemCount )
       return false;
-    }
-    //Search deeper into the color ramp list
-    else if ( theValue > myColorRampItem.value )
-    {
-      mCurrentColorRampItemIndex++;
-    }
-    //Search back toward the beginning of the list
-    else
-    {
-      mCurrentColorRampItemIndex--;
-    }
+
+    const QgsColorRampShader::ColorRampItem& myColorRampItem = mColorRampItemList.at( myIndex );
+    if ( !qgsDoubleNear( theValue, myColorRampItem.value ) && qAbs( theValue - myColorRampItem.value ) > DOUBLE_DIFF_THRESHOLD )
+      return false;
+
+    myColor = myColorRampItem.color;
+  }
+  else if ( QgsColorRampShader::DISCRETE == mColorRampType )
+  {
+    //color of the upper break of the class
+    if ( myIndex == myColorRampItemCount )
+      return false;
+
+    myColor = mColorRampItemList.at( myIndex ).color;
+  }
+  else if ( myIndex == 0 || myIndex == myColorRampItemCount )
+  {
+    // Values outside total range are rendered if mClip is false
+    const QgsColorRampShader::ColorRampItem& myColorRampItem = mColorRampItemList.at( myIndex == 0 ? 0 : myColorRampItemCount - 1 );
+    if ( mClip && qAbs( theValue - myColorRampItem.value ) > DOUBLE_DIFF_THRESHOLD )
+      return false;
+
+    myColor = myColorRampItem.color;
+  }
+  else
+  {
+    const QgsColorRampShader::ColorRampItem& myColorRampItem = mColorRampItemList.at( myIndex );
+    const QgsColorRampShader::ColorRampItem& myPreviousColorRampItem = mColorRampItemList.at( myIndex - 1 );
+    double myCurrentRampRange = myColorRampItem.value - myPreviousColorRampItem.value; //difference between two consecutive entry values
+    double myOffsetInRange = theValue - myPreviousColorRampItem.value; //difference between the previous entry value and value
+    double scale = myOffsetInRange / myCurrentRampRange;
+
+    *theReturnRedValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.red() ) + ( static_cast< double >( myColorRampItem.color.red() - myPreviousColorRampItem.color.red() ) * scale ) );
+    *theReturnGreenValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.green() ) + ( static_cast< double >( myColorRampItem.color.green() - myPreviousColorRampItem.color.green() ) * scale ) );
+    *theReturnBlueValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.blue() ) + ( static_cast< double >( myColorRampItem.color.blue() - myPreviousColorRampItem.color.blue() ) * scale ) );
+    *theReturnAlphaValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.alpha() ) + ( static_cast< double >( myColorRampItem.color.alpha() - myPreviousColorRampItem.color.alpha() ) * scale ) );
+    return true;
   }
 
-  return false; // value not found
+  *theReturnRedValue = myColor.red();
+  *theReturnGreenValue = myColor.green();
+  *theReturnBlueValue = myColor.blue();
+  *theReturnAlphaValue = myColor.alpha();
+  return true;
 }
 
-bool QgsColorRampShader::interpolatedColor( double theValue, int*
-    theReturnRedValue, int* theReturnGreenValue, int* theReturnBlueValue, int* theReturnAlphaValue )
+QRgb QgsColorRampShader::premultipliedColor( double value ) const
 {
-  int myColorRampItemCount = mColorRampItemList.count();
-  if ( myColorRampItemCount <= 0 )
+  int red, green, blue, alpha;
+  if ( !itemColor( value, &red, &green, &blue, &alpha ) )
   {
-    return false;
+    return qRgba( 0, 0, 0, 0 );
   }
 
-  double myTinyDiff = 0.0;
-  double myCurrentRampRange; //difference between two consecutive entry values
-  double myOffsetInRange; //difference between the previous entry value and value
-  QgsColorRampShader::ColorRampItem myColorRampItem;
-  while ( mCurrentColorRampItemIndex >= 0 && mCurrentColorRampItemIndex < myColorRampItemCount )
+  // same rounding as QgsSingleBandPseudoColorRenderer used to do per pixel
+  if ( alpha < 255 )
   {
-    //Start searching from the last index - assumtion is that neighboring pixels tend to be similar values
-    myColorRampItem = mColorRampItemList.value( mCurrentColorRampItemIndex );
-    myTinyDiff = qAbs( theValue - myColorRampItem.value );
-    //If the previous entry is less, then search closer to the top of the list (assumes mColorRampItemList is sorted)
-    if ( mCurrentColorRampItemIndex != 0 && theValue <= mColorRampItemList.at( mCurrentColorRampItemIndex - 1 ).value )
+    red *= ( alpha / 255.0 );
+    blue *= ( alpha / 255.0 );
+    green *= ( alpha / 255.0 );
+  }
+  return qRgba( red, green, blue, alpha );
+}
+
+void QgsColorRampShader::prepareLookupTable( QGis::DataType type )
+{
+  if ( type == mLookupTableType )
+    return;
+
+  mLookupTable.clear();
+  mLookupUniform.clear();
+  mLookupTableType = type;
+
+  switch ( type )
+  {
+    case QGis::Byte:
+    case QGis::UInt16:
+    case QGis::Int16:
     {
-      mCurrentColorRampItemIndex--;
+      // one color per raw value
+      int size = type == QGis::Byte ? 256 : 65536;
+      int first = type == QGis::Int16 ? -32768 : 0;
+      mLookupTable.resize( size );
+      for ( int i = 0; i < size; ++i )
+        mLookupTable[i] = premultipliedColor( first + i );
+      break;
     }
-    else if ( mCurrentColorRampItemIndex != 0 && ( theValue <= myColorRampItem.value || myTinyDiff <= DOUBLE_DIFF_THRESHOLD ) )
+
+    default:
     {
-      QgsColorRampShader::ColorRampItem myPreviousColorRampItem = mColorRampItemList.value( mCurrentColorRampItemIndex - 1 );
-      myCurrentRampRange = myColorRampItem.value - myPreviousColorRampItem.value;
-      myOffsetInRange = theValue - myPreviousColorRampItem.value;
-      double scale = myOffsetInRange / myCurrentRampRange;
-
-      *theReturnRedValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.red() ) + ( static_cast< double >( myColorRampItem.color.red() - myPreviousColorRampItem.color.red() ) * scale ) );
-      *theReturnGreenValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.green() ) + ( static_cast< double >( myColorRampItem.color.green() - myPreviousColorRampItem.color.green() ) * scale ) );
-      *theReturnBlueValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.blue() ) + ( static_cast< double >( myColorRampItem.color.blue() - myPreviousColorRampItem.color.blue() ) * scale ) );
-      *theReturnAlphaValue = static_cast< int >( static_cast< double >( myPreviousColorRampItem.color.alpha() ) + ( static_cast< double >( myColorRampItem.color.alpha() - myPreviousColorRampItem.color.alpha() ) * scale ) );
-      if ( mMaximumColorCacheSize >= mColorCache.size() )
+      // quantized over the range of the items, exact ramps have no intervals of constant color
+      int myColorRampItemCount = mColorRampItemList.count();
+      if ( mColorRampType == EXACT || myColorRampItemCount < 2 )
+        break;
+
+      mLookupMinimum = mColorRampItemList.first().value;
+      double range = mColorRampItemList.last().value - mLookupMinimum;
+      if ( !( range > 0 ) || qIsInf( range ) )
+        break;
+
+      mLookupScale = QUANTIZED_LOOKUP_TABLE_SIZE / range;
+      mLookupTable.resize( QUANTIZED_LOOKUP_TABLE_SIZE );
+      mLookupUniform.resize( QUANTIZED_LOOKUP_TABLE_SIZE );
+
+      // the intervals are slightly enlarged, values may fall in a neighbour interval by rounding
+      double margin = 0.001 / mLookupScale;
+      for ( int i = 0; i < QUANTIZED_LOOKUP_TABLE_SIZE; ++i )
       {
-        QColor myNewColor( *theReturnRedValue, *theReturnGreenValue, *theReturnBlueValue, *theReturnAlphaValue );
-        mColorCache.insert( theValue, myNewColor );
+        double low = mLookupMinimum + i / mLookupScale - margin;
+        double high = mLookupMinimum + ( i + 1 ) / mLookupScale + margin;
+        QRgb color = premultipliedColor( low );
+
+        // colors are constant or monotonic between two items, equal colors at both ends
+        // of an interval within the same items are equal over the whole interval
+        mLookupTable[i] = color;
+        mLookupUniform[i] = itemIndex( low ) == itemIndex( high ) && premultipliedColor( high ) == color;
       }
-      return true;
+      break;
     }
-    // Values outside total range are rendered if mClip is false
-    else if (( mCurrentColorRampItemIndex == 0 && ( myTinyDiff <= DOUBLE_DIFF_THRESHOLD || ( !mClip && theValue <= myColorRampItem.value ) ) )
-             || ( mCurrentColorRampItemIndex == myColorRampItemCount - 1 && ( myTinyDiff <= DOUBLE_DIFF_THRESHOLD || ( !mClip && theValue >= myColorRampItem.value ) ) ) )
+  }
+}
+
+template <typename T> void QgsColorRampShader::shadeQuantized( const T* values, qgssize count, QRgb* colors ) const
+{
+  const int size = mLookupTable.size();
+  const QRgb* table = mLookupTable.constData();
+  const bool* uniform = mLookupUniform.constData();
+  for ( qgssize i = 0; i < count; ++i )
+  {
+    double value = values[i];
+    double position = ( value - mLookupMinimum ) * mLookupScale;
+    if ( position >= 0 && position < size )
     {
-      //QgsColorRampShader::ColorRampItem myPreviousColorRampItem = mColorRampItemList.value( mCurrentColorRampItemIndex - 1 );
-      //myCurrentRampRange = myColorRampItem.value - myPreviousColorRampItem.value;
-      //myOffsetInRange = theValue - myPreviousColorRampItem.value;
-
-      *theReturnRedValue = myColorRampItem.color.red();
-      *theReturnGreenValue = myColorRampItem.color.green();
-      *theReturnBlueValue = myColorRampItem.color.blue();
-      *theReturnAlphaValue = myColorRampItem.color.alpha();
-      if ( mMaximumColorCacheSize >= mColorCache.size() )
+      int index = static_cast< int >( position );
+      if ( uniform[index] )
       {
-        QColor myNewColor( *theReturnRedValue, *theReturnGreenValue, *theReturnBlueValue, *theReturnAlphaValue );
-        mColorCache.insert( theValue, myNewColor );
+        colors[i] = table[index];
+        continue;
       }
-      return true;
-    }
-    //Search deeper into the color ramp list
-    else if ( theValue > myColorRampItem.value )
-    {
-      mCurrentColorRampItemIndex++;
-    }
-    else
-    {
-      return false;
     }
+    colors[i] = premultipliedColor( value );
   }
+}
 
-  return false;
+template <typename T> static void shadeWithLookupTable( const T* values, qgssize count, const QRgb* table, QRgb* colors )
+{
+  for ( qgssize i = 0; i < count; ++i )
+    colors[i] = table[ values[i] ];
+}
+
+void QgsColorRampShader::shadeBlock( QgsRasterBlock* block, QRgb* colors )
+{
+  qgssize count = static_cast< qgssize >( block->width() ) * block->height();
+  const char* data = block->bits();
+  if ( !data )
+  {
+    std::fill( colors, colors + count, qRgba( 0, 0, 0, 0 ) );
+    return;
+  }
+
+  QGis::DataType type = block->dataType();
+  switch ( type )
+  {
+    case QGis::Byte:
+      prepareLookupTable( type );
+      shadeWithLookupTable( reinterpret_cast< const quint8* >( data ), count, mLookupTable.constData(), colors );
+      break;
+
+    case QGis::UInt16:
+      prepareLookupTable( type );
+      shadeWithLookupTable( reinterpret_cast< const quint16* >( data ), count, mLookupTable.constData(), colors );
+      break;
+
+    case QGis::Int16:
+      // the table starts at the lowest value
+      prepareLookupTable( type );
+      shadeWithLookupTable( reinterpret_cast< const qint16* >( data ), count, mLookupTable.constData() + 32768, colors );
+      break;
+
+    case QGis::UInt32:
+      prepareLookupTable( QGis::Float64 );
+      shadeQuantized( reinterpret_cast< const quint32* >( data ), count, colors );
+      break;
+
+    case QGis::Int32:
+      prepareLookupTable( QGis::Float64 );
+      shadeQuantized( reinterpret_cast< const qint32* >( data ), count, colors );
+      break;
+
+    case QGis::Float32:
+      prepareLookupTable( QGis::Float64 );
+      shadeQuantized( reinterpret_cast< const float* >( data ), count, colors );
+      break;
+
+    case QGis::Float64:
+      prepareLookupTable( QGis::Float64 );
+      shadeQuantized( reinterpret_cast< const double* >( data ), count, colors );
+      break;
+
+    default:
+      for ( qgssize i = 0; i < count; ++i )
+        colors[i] = premultipliedColor( block->value( i ) );
+      break;
+  }
 }
 
 void QgsColorRampShader::setColorRampItemList( const QList<QgsColorRampShader::ColorRampItem>& theList )
@@ -222,12 +297,14 @@ void QgsColorRampShader::setColorRampItemList( const QList<QgsColorRampShader::C
   mColorRampItemList = theList;
   //Clear the cache
   mColorCache.clear();
+  mLookupTableType = QGis::UnknownDataType;
 }
 
 void QgsColorRampShader::setColorRampType( QgsColorRampShader::ColorRamp_TYPE theColorRampType )
 {
   //When the ramp type changes we need to clear out the cache
   mColorCache.clear();
+  mLookupTableType = QGis::UnknownDataType;
   mColorRampType = theColorRampType;
 }
 
@@ -235,6 +312,7 @@ void QgsColorRampShader::setColorRampType( const QString& theType )
 {
   //When the type of the ramp changes we need to clear out the cache
   mColorCache.clear();
+  mLookupTableType = QGis::UnknownDataType;
   if ( theType == "INTERPOLATED" )
   {
     mColorRampType = INTERPOLATED;
@@ -264,27 +342,18 @@ bool QgsColorRampShader::shade( double theValue, int* theReturnRedValue, int* th
   }
 
   //pixel value not in cache so generate new value
-
-  //Check to be sure mCurrentColorRampItemIndex is within the valid range.
-  if ( mCurrentColorRampItemIndex < 0 )
-  {
-    mCurrentColorRampItemIndex = 0;
-  }
-  else if ( mCurrentColorRampItemIndex >= mColorRampItemList.size() )
+  if ( !itemColor( theValue, theReturnRedValue, theReturnGreenValue, theReturnBlueValue, theReturnAlphaValue ) )
   {
-    mCurrentColorRampItemIndex = mColorRampItemList.size() - 1;
+    return false;
   }
 
-  if ( QgsColorRampShader::EXACT == mColorRampType )
+  //Cache the shaded value
+  if ( mMaximumColorCacheSize >= mColorCache.size() )
   {
-    return exactColor( theValue, theReturnRedValue, theReturnGreenValue, theReturnBlueValue, theReturnAlphaValue );
+    QColor myNewColor( *theReturnRedValue, *theReturnGreenValue, *theReturnBlueValue, *theReturnAlphaValue );
+    mColorCache.insert( theValue, myNewColor );
   }
-  else if ( QgsColorRampShader::INTERPOLATED == mColorRampType )
-  {
-    return interpolatedColor( theValue, theReturnRedValue, theReturnGreenValue, theReturnBlueValue, theReturnAlphaValue );
-  }
-
-  return discreteColor( theValue, theReturnRedValue, theReturnGreenValue, theReturnBlueValue, theReturnAlphaValue );
+  return true;
 }
 
 bool QgsColorRampShader::shade( double theRedValue, double theGreenValue,
@@ -23,9 +23,13 @@ originally part of the larger QgsRasterLayer class
 
 #include <QColor>
 #include <QMap>
+#include <QVector>
 
+#include "qgis.h"
 #include "qgsrastershaderfunction.h"
 
+class QgsRasterBlock;
+
 /** \ingroup core
  * A ramp shader will color a raster pixel based on a list of values ranges in a ramp.
  */
@@ -95,13 +99,27 @@ class CORE_EXPORT QgsColorRampShader : public QgsRasterShaderFunction
     /** \brief Generates and new RGB value based on original RGB value */
     bool shade( double, double, double, double, int*, int*, int*, int* ) override;
 
+    /** Shades all the values of a raster block, much faster than calling shade() for each of them.
+     * Blocks of 8 and 16 bit integers use a lookup table from the raw values to the colors.
+     * Other blocks use a lookup table over the range of the color ramp items, quantized in
+     * intervals, for the intervals where the color is constant and search the color ramp
+     * items for the other values. The colors are the same as those of shade().
+     * @param block raster block with the values to shade
+     * @param colors output: one color per value of the block, premultiplied by its alpha.
+     * Values which cannot be shaded get a transparent color, no data values are shaded
+     * like any other value.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    void shadeBlock( QgsRasterBlock* block, QRgb* colors );
+
     void legendSymbologyItems( QList< QPair< QString, QColor > >& symbolItems ) const override;
 
     /** Sets whether the shader should not render values out of range.
      * @param clip set to true to clip values which are out of range.
      * @see clip()
      */
-    void setClip( bool clip ) { mClip = clip; }
+    void setClip( bool clip ) { mClip = clip; mLookupTableType = QGis::UnknownDataType; }
 
     /** Returns whether the shader will clip values which are out of range.
      * @see setClip()
@@ -109,9 +127,6 @@ class CORE_EXPORT QgsColorRampShader : public QgsRasterShaderFunction
     bool clip() const { return mClip; }
 
   private:
-    /** Current index from which to start searching the color table*/
-    int mCurrentColorRampItemIndex;
-
     //TODO: Consider pulling this out as a separate class and internally storing as a QMap rather than a QList
     /** This vector holds the information for classification based on values.
      * Each item holds a value, a label and a color. The member
@@ -130,20 +145,42 @@ class CORE_EXPORT QgsColorRampShader : public QgsRasterShaderFunction
      * memory if you have 32-bit data */
     int mMaximumColorCacheSize;
 
-    /** Gets the color for a pixel value from the classification vector
-     * mValueClassification. Assigns the color of the lower class for every
-     * pixel between two class breaks.*/
-    bool discreteColor( double, int*, int*, int*, int* );
+    /** Lookup table of premultiplied colors used by shadeBlock(), by raw value for
+     * 8 and 16 bit integers, by quantized interval of the color ramp otherwise */
+    QVector<QRgb> mLookupTable;
+
+    /** Whether the color is constant over the intervals of a quantized lookup table */
+    QVector<bool> mLookupUniform;
+
+    /** Data type of the lookup table, QGis::Float64 for the quantized table and
+     * QGis::UnknownDataType if it has to be built again */
+    QGis::DataType mLookupTableType;
+
+    /** Start and inverse width of the intervals of a quantized lookup table */
+    double mLookupMinimum;
+    double mLookupScale;
+
+    /** Returns the index of the first color ramp item with a value greater than or
+     * equal to a value, items less than the value by a tiny difference included.
+     * The color ramp item list is assumed to be sorted. */
+    int itemIndex( double value ) const;
+
+    /** Gets the color for a pixel value from the classification vector,
+     * by binary search of the color ramp items. Discrete ramps assign the color
+     * of the lower class for every pixel between two class breaks, exact ramps the
+     * color of the exact matching value and interpolated ramps interpolate the color
+     * between two class breaks linearly. */
+    bool itemColor( double value, int* red, int* green, int* blue, int* alpha ) const;
+
+    /** Returns the color of a value premultiplied by its alpha, transparent if the
+     * value cannot be shaded */
+    QRgb premultipliedColor( double value ) const;
 
-    /** Gets the color for a pixel value from the classification vector
-     * mValueClassification. Assigns the color of the exact matching value in
-     * the color ramp item list */
-    bool exactColor( double, int*, int*, int*, int* );
+    /** Builds the lookup table for a data type if it is not up to date */
+    void prepareLookupTable( QGis::DataType type );
 
-    /** Gets the color for a pixel value from the classification vector
-     * mValueClassification. Interpolates the color between two class breaks
-     * linearly.*/
-    bool interpolatedColor( double, int*, int*, int*, int* );
+    /** Shades values using the quantized lookup table */
+    template <typename T> void shadeQuantized( const T* values, qgssize count, QRgb* colors ) const;
 
     /** Do not render values out of range */
     bool mClip;
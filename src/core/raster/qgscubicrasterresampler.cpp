@@ -17,21 +17,39 @@
 
 #include "qgscubicrasterresampler.h"
 #include <QImage>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
 #include <qmath.h>
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define QGS_RESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+
+//! number of output rows resampled by a thread at once
+static const int RESAMPLE_CHUNK_ROWS = 32;
+
+//! Resamples chunks of output rows, chunks are resampled in parallel
+struct QgsCubicResampleRows
+{
+  typedef void result_type;
+
+  explicit QgsCubicResampleRows( const QgsCubicRasterResampler::ResampleData& data, int nRows )
+      : mData( data )
+      , mNRows( nRows )
+  {}
+
+  void operator()( int startRow ) const
+  {
+    QgsCubicRasterResampler::resampleRows( mData, startRow, qMin( startRow + RESAMPLE_CHUNK_ROWS, mNRows ) );
+  }
+
+  const QgsCubicRasterResampler::ResampleData& mData;
+  int mNRows;
+};
+
 QgsCubicRasterResampler::QgsCubicRasterResampler()
-// red
-    : cRed00( 0.0 ), cRed10( 0.0 ), cRed20( 0.0 ), cRed30( 0.0 ), cRed01( 0.0 ), cRed11( 0.0 ), cRed21( 0.0 ), cRed31( 0.0 )
-    , cRed02( 0.0 ), cRed12( 0.0 ), cRed22( 0.0 ), cRed32( 0.0 ), cRed03( 0.0 ), cRed13( 0.0 ), cRed23( 0.0 ), cRed33( 0.0 )
-    // green
-    , cGreen00( 0.0 ), cGreen10( 0.0 ), cGreen20( 0.0 ), cGreen30( 0.0 ), cGreen01( 0.0 ), cGreen11( 0.0 ), cGreen21( 0.0 ), cGreen31( 0.0 )
-    , cGreen02( 0.0 ), cGreen12( 0.0 ), cGreen22( 0.0 ), cGreen32( 0.0 ), cGreen03( 0.0 ), cGreen13( 0.0 ), cGreen23( 0.0 ), cGreen33( 0.0 )
-    // blue
-    , cBlue00( 0.0 ), cBlue10( 0.0 ), cBlue20( 0.0 ), cBlue30( 0.0 ), cBlue01( 0.0 ), cBlue11( 0.0 ), cBlue21( 0.0 ), cBlue31( 0.0 )
-    , cBlue02( 0.0 ), cBlue12( 0.0 ), cBlue22( 0.0 ), cBlue32( 0.0 ), cBlue03( 0.0 ), cBlue13( 0.0 ), cBlue23( 0.0 ), cBlue33( 0.0 )
-    // alpha
-    , cAlpha00( 0.0 ), cAlpha10( 0.0 ), cAlpha20( 0.0 ), cAlpha30( 0.0 ), cAlpha01( 0.0 ), cAlpha11( 0.0 ), cAlpha21( 0.0 ), cAlpha31( 0.0 )
-    , cAlpha02( 0.0 ), cAlpha12( 0.0 ), cAlpha22( 0.0 ), cAlpha32( 0.0 ), cAlpha03( 0.0 ), cAlpha13( 0.0 ), cAlpha23( 0.0 ), cAlpha33( 0.0 )
 {
 }
 
@@ -48,80 +66,124 @@ void QgsCubicRasterResampler::resample( const QImage& srcImage, QImage& dstImage
 {
   int nCols = srcImage.width();
   int nRows = srcImage.height();
+  int dstWidth = dstImage.width();
+  int dstHeight = dstImage.height();
+  if ( nCols < 1 || nRows < 1 || dstWidth < 1 || dstHeight < 1 )
+  {
+    return;
+  }
 
-  int pos = 0;
-  QRgb px;
-  int *redMatrix = new int[ nCols * nRows ];
-  int *greenMatrix = new int[ nCols * nRows ];
-  int *blueMatrix = new int[ nCols * nRows ];
-  int *alphaMatrix = new int[ nCols * nRows ];
-
+  //red, green, blue and alpha of each pixel
+  QVector<int> colorMatrix( nCols * nRows * 4 );
+  int* colors = colorMatrix.data();
   for ( int heightIndex = 0; heightIndex < nRows; ++heightIndex )
   {
-    QRgb* scanLine = ( QRgb* )srcImage.constScanLine( heightIndex );
+    const QRgb* scanLine = ( const QRgb* )srcImage.constScanLine( heightIndex );
     for ( int widthIndex = 0; widthIndex < nCols; ++widthIndex )
     {
-      px = scanLine[widthIndex];
-      int alpha = qAlpha( px );
-      alphaMatrix[pos] = alpha;
-      redMatrix[pos] = qRed( px );
-      greenMatrix[pos] = qGreen( px );
-      blueMatrix[pos] = qBlue( px );
-
-      pos++;
+      QRgb px = scanLine[widthIndex];
+      colors[0] = qRed( px );
+      colors[1] = qGreen( px );
+      colors[2] = qBlue( px );
+      colors[3] = qAlpha( px );
+      colors += 4;
     }
   }
 
-  //derivative x
-  double* xDerivativeMatrixRed = new double[ nCols * nRows ];
-  xDerivativeMatrix( nCols, nRows, xDerivativeMatrixRed, redMatrix );
-  double* xDerivativeMatrixGreen = new double[ nCols * nRows ];
-  xDerivativeMatrix( nCols, nRows, xDerivativeMatrixGreen, greenMatrix );
-  double* xDerivativeMatrixBlue = new double[ nCols * nRows ];
-  xDerivativeMatrix( nCols, nRows, xDerivativeMatrixBlue, blueMatrix );
-  double* xDerivativeMatrixAlpha = new double[ nCols * nRows ];
-  xDerivativeMatrix( nCols, nRows, xDerivativeMatrixAlpha, alphaMatrix );
-
-  //derivative y
-  double* yDerivativeMatrixRed = new double[ nCols * nRows ];
-  yDerivativeMatrix( nCols, nRows, yDerivativeMatrixRed, redMatrix );
-  double* yDerivativeMatrixGreen = new double[ nCols * nRows ];
-  yDerivativeMatrix( nCols, nRows, yDerivativeMatrixGreen, greenMatrix );
-  double* yDerivativeMatrixBlue = new double[ nCols * nRows ];
-  yDerivativeMatrix( nCols, nRows, yDerivativeMatrixBlue, blueMatrix );
-  double* yDerivativeMatrixAlpha = new double[ nCols * nRows ];
-  yDerivativeMatrix( nCols, nRows, yDerivativeMatrixAlpha, alphaMatrix );
-
-  //compute output
-  double nSrcPerDstX = ( double ) srcImage.width() / ( double ) dstImage.width();
-  double nSrcPerDstY = ( double ) srcImage.height() / ( double ) dstImage.height();
+  QVector<double> xDerivatives( nCols * nRows * 4 );
+  xDerivativeMatrix( nCols, nRows, xDerivatives.data(), colorMatrix.constData() );
+  QVector<double> yDerivatives( nCols * nRows * 4 );
+  yDerivativeMatrix( nCols, nRows, yDerivatives.data(), colorMatrix.constData() );
 
-  double currentSrcRow = nSrcPerDstY / 2.0 - 0.5;
-  double currentSrcCol;
-  int currentSrcColInt;
-  int currentSrcRowInt;
-  int lastSrcColInt = -100;
-  int lastSrcRowInt = -100;
+  //positions of the output pixels in the source, accumulated like in a single pass over the output
+  double nSrcPerDstX = ( double ) nCols / ( double ) dstWidth;
+  double nSrcPerDstY = ( double ) nRows / ( double ) dstHeight;
 
-  //bernstein polynomials
-  double bp0u, bp1u, bp2u, bp3u, bp0v, bp1v, bp2v, bp3v;
-  double u, v;
+  QVector<int> dstColInts( dstWidth );
+  QVector<double> dstColPolys( dstWidth * 4 );
+  double currentSrcCol = nSrcPerDstX / 2.0 - 0.5;
+  for ( int x = 0; x < dstWidth; ++x )
+  {
+    int currentSrcColInt = floor( currentSrcCol );
+    double u = currentSrcCol - currentSrcColInt;
+    dstColInts[x] = currentSrcColInt;
+    for ( int i = 0; i < 4; ++i )
+    {
+      dstColPolys[x * 4 + i] = calcBernsteinPolyN3( i, u );
+    }
+    currentSrcCol += nSrcPerDstX;
+  }
 
-  for ( int y = 0; y < dstImage.height(); ++y )
+  QVector<int> dstRowInts( dstHeight );
+  QVector<double> dstRowPolys( dstHeight * 4 );
+  double currentSrcRow = nSrcPerDstY / 2.0 - 0.5;
+  for ( int y = 0; y < dstHeight; ++y )
   {
-    currentSrcRowInt = floor( currentSrcRow );
-    v = currentSrcRow - currentSrcRowInt;
+    int currentSrcRowInt = floor( currentSrcRow );
+    double v = currentSrcRow - currentSrcRowInt;
+    dstRowInts[y] = currentSrcRowInt;
+    for ( int i = 0; i < 4; ++i )
+    {
+      dstRowPolys[y * 4 + i] = calcBernsteinPolyN3( i, v );
+    }
+    currentSrcRow += nSrcPerDstY;
+  }
+
+  ResampleData data;
+  data.srcImage = &srcImage;
+  data.nCols = nCols;
+  data.nRows = nRows;
+  data.colors = colorMatrix.constData();
+  data.xDerivatives = xDerivatives.constData();
+  data.yDerivatives = yDerivatives.constData();
+  data.dstColInts = dstColInts.constData();
+  data.dstColPolys = dstColPolys.constData();
+  data.dstRowInts = dstRowInts.constData();
+  data.dstRowPolys = dstRowPolys.constData();
+  data.dstBits = dstImage.bits(); // detaches the image before the threads write into it
+  data.dstBytesPerLine = dstImage.bytesPerLine();
+  data.dstWidth = dstWidth;
+
+  if ( dstHeight > RESAMPLE_CHUNK_ROWS && QThreadPool::globalInstance()->maxThreadCount() > 1 )
+  {
+    QVector<int> chunks;
+    for ( int y = 0; y < dstHeight; y += RESAMPLE_CHUNK_ROWS )
+    {
+      chunks << y;
+    }
+    QtConcurrent::blockingMap( chunks, QgsCubicResampleRows( data, dstHeight ) );
+  }
+  else
+  {
+    resampleRows( data, 0, dstHeight );
+  }
+}
+
+void QgsCubicRasterResampler::resampleRows( const ResampleData& data, int startRow, int endRow )
+{
+  const QImage& srcImage = *data.srcImage;
+  int nCols = data.nCols;
+  int nRows = data.nRows;
+  const double* xDerivatives = data.xDerivatives;
+  const double* yDerivatives = data.yDerivatives;
+
+  //control points of the current source cell, 16 points with 4 channels
+  double controlPoints[64];
 
-    currentSrcCol = nSrcPerDstX / 2.0 - 0.5;
+  for ( int y = startRow; y < endRow; ++y )
+  {
+    int currentSrcRowInt = data.dstRowInts[y];
+    const double* bpv = data.dstRowPolys + y * 4;
+    int lastSrcColInt = -100;
 
-    QRgb* scanLine = ( QRgb* )dstImage.scanLine( y );
-    for ( int x = 0; x < dstImage.width(); ++x )
+    QRgb* scanLine = ( QRgb* )( data.dstBits + y * data.dstBytesPerLine );
+    for ( int x = 0; x < data.dstWidth; ++x )
     {
-      currentSrcColInt = floor( currentSrcCol );
-      u = currentSrcCol - currentSrcColInt;
+      int currentSrcColInt = data.dstColInts[x];
+      const double* bpu = data.dstColPolys + x * 4;
 
       //handle eight edge-cases
-      if (( currentSrcRowInt < 0 || currentSrcRowInt >= ( srcImage.height() - 1 ) || currentSrcColInt < 0 || currentSrcColInt >= ( srcImage.width() - 1 ) ) )
+      if (( currentSrcRowInt < 0 || currentSrcRowInt >= ( nRows - 1 ) || currentSrcColInt < 0 || currentSrcColInt >= ( nCols - 1 ) ) )
       {
         QRgb px1, px2;
         //pixels at the border of the source image needs to be handled in a special way
@@ -129,194 +191,90 @@ void QgsCubicRasterResampler::resample( const QImage& srcImage, QImage& dstImage
         {
           scanLine[x] = srcImage.pixel( 0, 0 );
         }
-        else if ( currentSrcRowInt < 0 && currentSrcColInt >= ( srcImage.width() - 1 ) )
+        else if ( currentSrcRowInt < 0 && currentSrcColInt >= ( nCols - 1 ) )
         {
-          scanLine[x] = srcImage.pixel( srcImage.width() - 1, 0 );
+          scanLine[x] = srcImage.pixel( nCols - 1, 0 );
         }
-        else if ( currentSrcRowInt >= ( srcImage.height() - 1 ) && currentSrcColInt >= ( srcImage.width() - 1 ) )
+        else if ( currentSrcRowInt >= ( nRows - 1 ) && currentSrcColInt >= ( nCols - 1 ) )
         {
-          scanLine[x] = srcImage.pixel( srcImage.width() - 1, srcImage.height() - 1 );
+          scanLine[x] = srcImage.pixel( nCols - 1, nRows - 1 );
         }
-        else if ( currentSrcRowInt >= ( srcImage.height() - 1 ) && currentSrcColInt < 0 )
+        else if ( currentSrcRowInt >= ( nRows - 1 ) && currentSrcColInt < 0 )
         {
-          scanLine[x] = srcImage.pixel( 0, srcImage.height() - 1 );
+          scanLine[x] = srcImage.pixel( 0, nRows - 1 );
         }
         else if ( currentSrcRowInt < 0 )
         {
           px1 = srcImage.pixel( currentSrcColInt, 0 );
           px2 = srcImage.pixel( currentSrcColInt + 1, 0 );
-          scanLine[x] = curveInterpolation( px1, px2, u, xDerivativeMatrixRed[ currentSrcColInt ], xDerivativeMatrixGreen[ currentSrcColInt ],
-                                            xDerivativeMatrixBlue[ currentSrcColInt ], xDerivativeMatrixAlpha[ currentSrcColInt ], xDerivativeMatrixRed[ currentSrcColInt + 1 ], xDerivativeMatrixGreen[ currentSrcColInt + 1 ],
-                                            xDerivativeMatrixBlue[ currentSrcColInt + 1 ], xDerivativeMatrixAlpha[ currentSrcColInt + 1 ] );
+          scanLine[x] = curveInterpolation( px1, px2, bpu, xDerivatives + currentSrcColInt * 4, xDerivatives + ( currentSrcColInt + 1 ) * 4 );
         }
-        else if ( currentSrcRowInt >= ( srcImage.height() - 1 ) )
+        else if ( currentSrcRowInt >= ( nRows - 1 ) )
         {
-          int idx = ( srcImage.height() - 1 ) * srcImage.width() + currentSrcColInt;
-          px1 = srcImage.pixel( currentSrcColInt, srcImage.height() - 1 );
-          px2 = srcImage.pixel( currentSrcColInt + 1, srcImage.height() - 1 );
-          scanLine[x] = curveInterpolation( px1, px2, u, xDerivativeMatrixRed[ idx ], xDerivativeMatrixGreen[ idx ], xDerivativeMatrixBlue[idx],
-                                            xDerivativeMatrixAlpha[idx], xDerivativeMatrixRed[ idx + 1 ], xDerivativeMatrixGreen[ idx + 1 ], xDerivativeMatrixBlue[idx + 1],
-                                            xDerivativeMatrixAlpha[idx + 1] );
+          int idx = ( nRows - 1 ) * nCols + currentSrcColInt;
+          px1 = srcImage.pixel( currentSrcColInt, nRows - 1 );
+          px2 = srcImage.pixel( currentSrcColInt + 1, nRows - 1 );
+          scanLine[x] = curveInterpolation( px1, px2, bpu, xDerivatives + idx * 4, xDerivatives + ( idx + 1 ) * 4 );
         }
         else if ( currentSrcColInt < 0 )
         {
-          int idx1 = currentSrcRowInt * srcImage.width();
-          int idx2 = idx1 + srcImage.width();
+          int idx1 = currentSrcRowInt * nCols;
+          int idx2 = idx1 + nCols;
           px1 = srcImage.pixel( 0, currentSrcRowInt );
           px2 = srcImage.pixel( 0, currentSrcRowInt + 1 );
-          scanLine[x] = curveInterpolation( px1, px2, v, yDerivativeMatrixRed[ idx1 ], yDerivativeMatrixGreen[ idx1 ], yDerivativeMatrixBlue[ idx1],
-                                            yDerivativeMatrixAlpha[ idx1], yDerivativeMatrixRed[ idx2 ], yDerivativeMatrixGreen[ idx2 ], yDerivativeMatrixBlue[ idx2],
-                                            yDerivativeMatrixAlpha[ idx2] );
+          scanLine[x] = curveInterpolation( px1, px2, bpv, yDerivatives + idx1 * 4, yDerivatives + idx2 * 4 );
         }
-        else if ( currentSrcColInt >= ( srcImage.width() - 1 ) )
+        else if ( currentSrcColInt >= ( nCols - 1 ) )
         {
-          int idx1 = currentSrcRowInt * srcImage.width() + srcImage.width() - 1;
-          int idx2 = idx1 + srcImage.width();
-          px1 = srcImage.pixel( srcImage.width() - 1, currentSrcRowInt );
-          px2 = srcImage.pixel( srcImage.width() - 1, currentSrcRowInt + 1 );
-          scanLine[x] = curveInterpolation( px1, px2, v, yDerivativeMatrixRed[ idx1 ], yDerivativeMatrixGreen[ idx1 ], yDerivativeMatrixBlue[ idx1],
-                                            yDerivativeMatrixAlpha[ idx1], yDerivativeMatrixRed[ idx2 ], yDerivativeMatrixGreen[ idx2 ], yDerivativeMatrixBlue[ idx2],
-                                            yDerivativeMatrixAlpha[ idx2] );
+          int idx1 = currentSrcRowInt * nCols + nCols - 1;
+          int idx2 = idx1 + nCols;
+          px1 = srcImage.pixel( nCols - 1, currentSrcRowInt );
+          px2 = srcImage.pixel( nCols - 1, currentSrcRowInt + 1 );
+          scanLine[x] = curveInterpolation( px1, px2, bpv, yDerivatives + idx1 * 4, yDerivatives + idx2 * 4 );
         }
-        currentSrcCol += nSrcPerDstX;
         continue;
       }
 
       //first update the control points if necessary
-      if ( currentSrcColInt != lastSrcColInt || currentSrcRowInt != lastSrcRowInt )
+      if ( currentSrcColInt != lastSrcColInt )
       {
-        calculateControlPoints( nCols, nRows, currentSrcRowInt, currentSrcColInt, redMatrix, greenMatrix, blueMatrix, alphaMatrix,
-                                xDerivativeMatrixRed, xDerivativeMatrixGreen, xDerivativeMatrixBlue, xDerivativeMatrixAlpha,
-                                yDerivativeMatrixRed, yDerivativeMatrixGreen, yDerivativeMatrixBlue, yDerivativeMatrixAlpha );
+        calculateControlPoints( data, currentSrcRowInt, currentSrcColInt, controlPoints );
+        lastSrcColInt = currentSrcColInt;
       }
 
-      //bernstein polynomials
-      bp0u = calcBernsteinPolyN3( 0, u );
-      bp1u = calcBernsteinPolyN3( 1, u );
-      bp2u = calcBernsteinPolyN3( 2, u );
-      bp3u = calcBernsteinPolyN3( 3, u );
-      bp0v = calcBernsteinPolyN3( 0, v );
-      bp1v = calcBernsteinPolyN3( 1, v );
-      bp2v = calcBernsteinPolyN3( 2, v );
-      bp3v = calcBernsteinPolyN3( 3, v );
-
-      //then calculate value based on bernstein form of Bezier patch
-      //todo: move into function
-      int r = bp0u * bp0v * cRed00 +
-              bp1u * bp0v * cRed10 +
-              bp2u * bp0v * cRed20 +
-              bp3u * bp0v * cRed30 +
-              bp0u * bp1v * cRed01 +
-              bp1u * bp1v * cRed11 +
-              bp2u * bp1v * cRed21 +
-              bp3u * bp1v * cRed31 +
-              bp0u * bp2v * cRed02 +
-              bp1u * bp2v * cRed12 +
-              bp2u * bp2v * cRed22 +
-              bp3u * bp2v * cRed32 +
-              bp0u * bp3v * cRed03 +
-              bp1u * bp3v * cRed13 +
-              bp2u * bp3v * cRed23 +
-              bp3u * bp3v * cRed33;
-
-      int g = bp0u * bp0v * cGreen00 +
-              bp1u * bp0v * cGreen10 +
-              bp2u * bp0v * cGreen20 +
-              bp3u * bp0v * cGreen30 +
-              bp0u * bp1v * cGreen01 +
-              bp1u * bp1v * cGreen11 +
-              bp2u * bp1v * cGreen21 +
-              bp3u * bp1v * cGreen31 +
-              bp0u * bp2v * cGreen02 +
-              bp1u * bp2v * cGreen12 +
-              bp2u * bp2v * cGreen22 +
-              bp3u * bp2v * cGreen32 +
-              bp0u * bp3v * cGreen03 +
-              bp1u * bp3v * cGreen13 +
-              bp2u * bp3v * cGreen23 +
-              bp3u * bp3v * cGreen33;
-
-      int b = bp0u * bp0v * cBlue00 +
-              bp1u * bp0v * cBlue10 +
-              bp2u * bp0v * cBlue20 +
-              bp3u * bp0v * cBlue30 +
-              bp0u * bp1v * cBlue01 +
-              bp1u * bp1v * cBlue11 +
-              bp2u * bp1v * cBlue21 +
-              bp3u * bp1v * cBlue31 +
-              bp0u * bp2v * cBlue02 +
-              bp1u * bp2v * cBlue12 +
-              bp2u * bp2v * cBlue22 +
-              bp3u * bp2v * cBlue32 +
-              bp0u * bp3v * cBlue03 +
-              bp1u * bp3v * cBlue13 +
-              bp2u * bp3v * cBlue23 +
-              bp3u * bp3v * cBlue33;
-
-      int a = bp0u * bp0v * cAlpha00 +
-              bp1u * bp0v * cAlpha10 +
-              bp2u * bp0v * cAlpha20 +
-              bp3u * bp0v * cAlpha30 +
-              bp0u * bp1v * cAlpha01 +
-              bp1u * bp1v * cAlpha11 +
-              bp2u * bp1v * cAlpha21 +
-              bp3u * bp1v * cAlpha31 +
-              bp0u * bp2v * cAlpha02 +
-              bp1u * bp2v * cAlpha12 +
-              bp2u * bp2v * cAlpha22 +
-              bp3u * bp2v * cAlpha32 +
-              bp0u * bp3v * cAlpha03 +
-              bp1u * bp3v * cAlpha13 +
-              bp2u * bp3v * cAlpha23 +
-              bp3u * bp3v * cAlpha33;
-
-      scanLine[x] = createPremultipliedColor( r, g, b, a );
-
-      lastSrcColInt = currentSrcColInt;
-      currentSrcCol += nSrcPerDstX;
+      scanLine[x] = patchValue( controlPoints, bpu, bpv );
     }
-    lastSrcRowInt = currentSrcRowInt;
-    currentSrcRow += nSrcPerDstY;
   }
-
-
-  //cleanup memory
-  delete[] redMatrix;
-  delete[] greenMatrix;
-  delete[] blueMatrix;
-  delete[] alphaMatrix;
-  delete[] xDerivativeMatrixRed;
-  delete[] xDerivativeMatrixGreen;
-  delete[] xDerivativeMatrixBlue;
-  delete[] xDerivativeMatrixAlpha;
-  delete[] yDerivativeMatrixRed;
-  delete[] yDerivativeMatrixGreen;
-  delete[] yDerivativeMatrixBlue;
-  delete[] yDerivativeMatrixAlpha;
 }
 
 void QgsCubicRasterResampler::xDerivativeMatrix( int nCols, int nRows, double* matrix, const int* colorMatrix )
 {
-  double val = 0;
   int index = 0;
 
   for ( int y = 0; y < nRows; ++y )
   {
     for ( int x = 0; x < nCols; ++x )
     {
-      if ( x == 0 )
-      {
-        val = colorMatrix[index + 1] - colorMatrix[index];
-      }
-      else if ( x == ( nCols - 1 ) )
-      {
-        val = colorMatrix[index] - colorMatrix[ index - 1 ];
-      }
-      else
+      for ( int c = 0; c < 4; ++c )
       {
-        val = ( colorMatrix[index + 1] - colorMatrix[index - 1] ) / 2.0;
+        int i = index * 4 + c;
+        if ( nCols == 1 )
+        {
+          matrix[i] = 0;
+        }
+        else if ( x == 0 )
+        {
+          matrix[i] = colorMatrix[i + 4] - colorMatrix[i];
+        }
+        else if ( x == ( nCols - 1 ) )
+        {
+          matrix[i] = colorMatrix[i] - colorMatrix[i - 4];
+        }
+        else
+        {
+          matrix[i] = ( colorMatrix[i + 4] - colorMatrix[i - 4] ) / 2.0;
+        }
       }
-      matrix[index] = val;
       ++index;
     }
   }
@@ -324,149 +282,160 @@ void QgsCubicRasterResampler::xDerivativeMatrix( int nCols, int nRows, double* m
 
 void QgsCubicRasterResampler::yDerivativeMatrix( int nCols, int nRows, double* matrix, const int* colorMatrix )
 {
-  double val = 0;
   int index = 0;
+  int rowOffset = nCols * 4;
 
   for ( int y = 0; y < nRows; ++y )
   {
     for ( int x = 0; x < nCols; ++x )
     {
-      if ( y == 0 )
-      {
-        val = colorMatrix[ index + nCols ] - colorMatrix[ index ];
-      }
-      else if ( y == ( nRows - 1 ) )
+      for ( int c = 0; c < 4; ++c )
       {
-        val = colorMatrix[ index ] - colorMatrix[ index - nCols ];
-      }
-      else
-      {
-        val = ( colorMatrix[ index + nCols ] - colorMatrix[ index - nCols ] ) / 2.0;
+        int i = index * 4 + c;
+        if ( nRows == 1 )
+        {
+          matrix[i] = 0;
+        }
+        else if ( y == 0 )
+        {
+          matrix[i] = colorMatrix[i + rowOffset] - colorMatrix[i];
+        }
+        else if ( y == ( nRows - 1 ) )
+        {
+          matrix[i] = colorMatrix[i] - colorMatrix[i - rowOffset];
+        }
+        else
+        {
+          matrix[i] = ( colorMatrix[i + rowOffset] - colorMatrix[i - rowOffset] ) / 2.0;
+        }
       }
-      matrix[index] = val;
       ++index;
     }
   }
 }
 
-void QgsCubicRasterResampler::calculateControlPoints( int nCols, int nRows, int currentRow, int currentCol, int* redMatrix, int* greenMatrix, int* blueMatrix,
-    int* alphaMatrix, double* xDerivativeMatrixRed, double* xDerivativeMatrixGreen, double* xDerivativeMatrixBlue, double* xDerivativeMatrixAlpha,
-    double* yDerivativeMatrixRed, double* yDerivativeMatrixGreen, double* yDerivativeMatrixBlue, double* yDerivativeMatrixAlpha )
+void QgsCubicRasterResampler::calculateControlPoints( const ResampleData& data, int currentRow, int currentCol, double* controlPoints )
 {
-  Q_UNUSED( nRows );
-  int idx00 = currentRow * nCols + currentCol;
+  int idx00 = currentRow * data.nCols + currentCol;
   int idx10 = idx00 + 1;
-  int idx01 = idx00 + nCols;
+  int idx01 = idx00 + data.nCols;
   int idx11 = idx01 + 1;
 
-  //corner points
-  cRed00 = redMatrix[idx00];
-  cGreen00 = greenMatrix[idx00];
-  cBlue00 = blueMatrix[idx00];
-  cAlpha00 = alphaMatrix[idx00];
-  cRed30 = redMatrix[idx10];
-  cGreen30 = greenMatrix[idx10];
-  cBlue30 = blueMatrix[idx10];
-  cAlpha30 = alphaMatrix[idx10];
-  cRed03 = redMatrix[idx01];
-  cGreen03 = greenMatrix[idx01];
-  cBlue03 = blueMatrix[idx01];
-  cAlpha03 = alphaMatrix[idx01];
-  cRed33 = redMatrix[idx11];
-  cGreen33 = greenMatrix[idx11];
-  cBlue33 = blueMatrix[idx11];
-  cAlpha33 = alphaMatrix[idx11];
-
-  //control points near c00
-  cRed10 = cRed00 + 0.333 * xDerivativeMatrixRed[idx00];
-  cGreen10 = cGreen00 + 0.333 * xDerivativeMatrixGreen[idx00];
-  cBlue10 = cBlue00 + 0.333 * xDerivativeMatrixBlue[idx00];
-  cAlpha10 = cAlpha00 + 0.333 * xDerivativeMatrixAlpha[idx00];
-  cRed01 = cRed00 + 0.333 * yDerivativeMatrixRed[idx00];
-  cGreen01 = cGreen00 + 0.333 * yDerivativeMatrixGreen[idx00];
-  cBlue01 = cBlue00 + 0.333 * yDerivativeMatrixBlue[idx00];
-  cAlpha01 = cAlpha00 + 0.333 * yDerivativeMatrixAlpha[idx00];
-  cRed11 = cRed10 + 0.333 * yDerivativeMatrixRed[idx00];
-  cGreen11 = cGreen10 + 0.333 * yDerivativeMatrixGreen[idx00];
-  cBlue11 = cBlue10 + 0.333 * yDerivativeMatrixBlue[idx00];
-  cAlpha11 = cAlpha10 + 0.333 * yDerivativeMatrixAlpha[idx00];
-
-  //control points near c30
-  cRed20 = cRed30 - 0.333 * xDerivativeMatrixRed[idx10];
-  cGreen20 = cGreen30 - 0.333 * xDerivativeMatrixGreen[idx10];
-  cBlue20 = cBlue30 - 0.333 * xDerivativeMatrixBlue[idx10];
-  cAlpha20 = cAlpha30 - 0.333 * xDerivativeMatrixAlpha[idx10];
-  cRed31 = cRed30 + 0.333 * yDerivativeMatrixRed[idx10];
-  cGreen31 = cGreen30 + 0.333 * yDerivativeMatrixGreen[idx10];
-  cBlue31 = cBlue30 + 0.333 * yDerivativeMatrixBlue[idx10];
-  cAlpha31 = cAlpha30 + 0.333 * yDerivativeMatrixAlpha[idx10];
-  cRed21 = cRed20 + 0.333 * yDerivativeMatrixRed[idx10];
-  cGreen21 = cGreen20 + 0.333 * yDerivativeMatrixGreen[idx10];
-  cBlue21 = cBlue20 + 0.333 * yDerivativeMatrixBlue[idx10];
-  cAlpha21 = cAlpha20 + 0.333 * yDerivativeMatrixAlpha[idx10];
-
-  //control points near c03
-  cRed13 = cRed03 + 0.333 * xDerivativeMatrixRed[idx01];
-  cGreen13 = cGreen03 + 0.333 * xDerivativeMatrixGreen[idx01];
-  cBlue13 = cBlue03 + 0.333 * xDerivativeMatrixBlue[idx01];
-  cAlpha13 = cAlpha03 + 0.333 * xDerivativeMatrixAlpha[idx01];
-  cRed02 = cRed03 - 0.333 * yDerivativeMatrixRed[idx01];
-  cGreen02 = cGreen03 - 0.333 * yDerivativeMatrixGreen[idx01];
-  cBlue02 = cBlue03 - 0.333 * yDerivativeMatrixBlue[idx01];
-  cAlpha02 = cAlpha03 - 0.333 * yDerivativeMatrixAlpha[idx01];
-  cRed12 = cRed02 + 0.333 * xDerivativeMatrixRed[idx01];
-  cGreen12 = cGreen02 + 0.333 * xDerivativeMatrixGreen[idx01];
-  cBlue12 = cBlue02 + 0.333 * xDerivativeMatrixBlue[idx01];
-  cAlpha12 = cAlpha02 + 0.333 * xDerivativeMatrixAlpha[idx01];
-
-  //control points near c33
-  cRed23 = cRed33 - 0.333 * xDerivativeMatrixRed[idx11];
-  cGreen23 = cGreen33 - 0.333 * xDerivativeMatrixGreen[idx11];
-  cBlue23 = cBlue33 - 0.333 * xDerivativeMatrixBlue[idx11];
-  cAlpha23 = cAlpha33 - 0.333 * xDerivativeMatrixAlpha[idx11];
-  cRed32 = cRed33 - 0.333 * yDerivativeMatrixRed[idx11];
-  cGreen32 = cGreen33 - 0.333 * yDerivativeMatrixGreen[idx11];
-  cBlue32 = cBlue33 - 0.333 * yDerivativeMatrixBlue[idx11];
-  cAlpha32 = cAlpha33 - 0.333 * yDerivativeMatrixAlpha[idx11];
-  cRed22 = cRed32 - 0.333 * xDerivativeMatrixRed[idx11];
-  cGreen22 = cGreen32 - 0.333 * xDerivativeMatrixGreen[idx11];
-  cBlue22 = cBlue32 - 0.333 * xDerivativeMatrixBlue[idx11];
-  cAlpha22 = cAlpha32 - 0.333 * xDerivativeMatrixAlpha[idx11];
+  const int* color00 = data.colors + idx00 * 4;
+  const int* color10 = data.colors + idx10 * 4;
+  const int* color01 = data.colors + idx01 * 4;
+  const int* color11 = data.colors + idx11 * 4;
+  const double* xDer00 = data.xDerivatives + idx00 * 4;
+  const double* xDer10 = data.xDerivatives + idx10 * 4;
+  const double* xDer01 = data.xDerivatives + idx01 * 4;
+  const double* xDer11 = data.xDerivatives + idx11 * 4;
+  const double* yDer00 = data.yDerivatives + idx00 * 4;
+  const double* yDer10 = data.yDerivatives + idx10 * 4;
+  const double* yDer01 = data.yDerivatives + idx01 * 4;
+  const double* yDer11 = data.yDerivatives + idx11 * 4;
+
+  //control point cij is stored at ( j * 4 + i ) * 4, followed by its four channels
+  double* c00 = controlPoints;
+  double* c10 = controlPoints + 4;
+  double* c20 = controlPoints + 8;
+  double* c30 = controlPoints + 12;
+  double* c01 = controlPoints + 16;
+  double* c11 = controlPoints + 20;
+  double* c21 = controlPoints + 24;
+  double* c31 = controlPoints + 28;
+  double* c02 = controlPoints + 32;
+  double* c12 = controlPoints + 36;
+  double* c22 = controlPoints + 40;
+  double* c32 = controlPoints + 44;
+  double* c03 = controlPoints + 48;
+  double* c13 = controlPoints + 52;
+  double* c23 = controlPoints + 56;
+  double* c33 = controlPoints + 60;
+
+  for ( int c = 0; c < 4; ++c )
+  {
+    //corner points
+    c00[c] = color00[c];
+    c30[c] = color10[c];
+    c03[c] = color01[c];
+    c33[c] = color11[c];
+
+    //control points near c00
+    c10[c] = c00[c] + 0.333 * xDer00[c];
+    c01[c] = c00[c] + 0.333 * yDer00[c];
+    c11[c] = c10[c] + 0.333 * yDer00[c];
+
+    //control points near c30
+    c20[c] = c30[c] - 0.333 * xDer10[c];
+    c31[c] = c30[c] + 0.333 * yDer10[c];
+    c21[c] = c20[c] + 0.333 * yDer10[c];
+
+    //control points near c03
+    c13[c] = c03[c] + 0.333 * xDer01[c];
+    c02[c] = c03[c] - 0.333 * yDer01[c];
+    c12[c] = c02[c] + 0.333 * xDer01[c];
+
+    //control points near c33
+    c23[c] = c33[c] - 0.333 * xDer11[c];
+    c32[c] = c33[c] - 0.333 * yDer11[c];
+    c22[c] = c32[c] - 0.333 * xDer11[c];
+  }
+}
+
+QRgb QgsCubicRasterResampler::patchValue( const double* controlPoints, const double* bpu, const double* bpv )
+{
+  //bernstein form of Bezier patch, the terms are summed in the same order for all channels
+  double value[4];
+#ifdef QGS_RESAMPLER_SSE2
+  __m128d redGreen = _mm_setzero_pd();
+  __m128d blueAlpha = _mm_setzero_pd();
+  for ( int j = 0; j < 4; ++j )
+  {
+    for ( int i = 0; i < 4; ++i )
+    {
+      const double* point = controlPoints + ( j * 4 + i ) * 4;
+      __m128d weight = _mm_set1_pd( bpu[i] * bpv[j] );
+      redGreen = _mm_add_pd( redGreen, _mm_mul_pd( weight, _mm_loadu_pd( point ) ) );
+      blueAlpha = _mm_add_pd( blueAlpha, _mm_mul_pd( weight, _mm_loadu_pd( point + 2 ) ) );
+    }
+  }
+  _mm_storeu_pd( value, redGreen );
+  _mm_storeu_pd( value + 2, blueAlpha );
+#else
+  value[0] = value[1] = value[2] = value[3] = 0.0;
+  for ( int j = 0; j < 4; ++j )
+  {
+    for ( int i = 0; i < 4; ++i )
+    {
+      const double* point = controlPoints + ( j * 4 + i ) * 4;
+      double weight = bpu[i] * bpv[j];
+      for ( int c = 0; c < 4; ++c )
+      {
+        value[c] += weight * point[c];
+      }
+    }
+  }
+#endif
+
+  return createPremultipliedColor( static_cast< int >( value[0] ), static_cast< int >( value[1] ),
+                                   static_cast< int >( value[2] ), static_cast< int >( value[3] ) );
 }
 
-QRgb QgsCubicRasterResampler::curveInterpolation( QRgb pt1, QRgb pt2, double t, double d1red, double d1green, double d1blue, double d1alpha,
-    double d2red, double d2green, double d2blue, double d2alpha )
+QRgb QgsCubicRasterResampler::curveInterpolation( QRgb pt1, QRgb pt2, const double* bp, const double* d1, const double* d2 )
 {
   //control points
-  double p0r = qRed( pt1 );
-  double p1r = p0r + 0.333 * d1red;
-  double p3r = qRed( pt2 );
-  double p2r = p3r - 0.333 * d2red;
-  double p0g = qGreen( pt1 );
-  double p1g = p0g + 0.333 * d1green;
-  double p3g = qGreen( pt2 );
-  double p2g = p3g - 0.333 * d2green;
-  double p0b = qBlue( pt1 );
-  double p1b = p0b + 0.333 * d1blue;
-  double p3b = qBlue( pt2 );
-  double p2b = p3b - 0.333 * d2blue;
-  double p0a = qAlpha( pt1 );
-  double p1a = p0a + 0.333 * d1alpha;
-  double p3a = qAlpha( pt2 );
-  double p2a = p3a - 0.333 * d2alpha;
-
-  //bernstein polynomials
-  double bp0 = calcBernsteinPolyN3( 0, t );
-  double bp1 = calcBernsteinPolyN3( 1, t );
-  double bp2 = calcBernsteinPolyN3( 2, t );
-  double bp3 = calcBernsteinPolyN3( 3, t );
-
-  int red = bp0 * p0r + bp1 * p1r + bp2 * p2r + bp3 * p3r;
-  int green = bp0 * p0g + bp1 * p1g + bp2 * p2g + bp3 * p3g;
-  int blue = bp0 * p0b + bp1 * p1b + bp2 * p2b + bp3 * p3b;
-  int alpha = bp0 * p0a + bp1 * p1a + bp2 * p2a + bp3 * p3a;
-
-  return createPremultipliedColor( red, green, blue, alpha );
+  double p0[4] = { ( double ) qRed( pt1 ), ( double ) qGreen( pt1 ), ( double ) qBlue( pt1 ), ( double ) qAlpha( pt1 ) };
+  double p3[4] = { ( double ) qRed( pt2 ), ( double ) qGreen( pt2 ), ( double ) qBlue( pt2 ), ( double ) qAlpha( pt2 ) };
+
+  int value[4];
+  for ( int c = 0; c < 4; ++c )
+  {
+    double p1 = p0[c] + 0.333 * d1[c];
+    double p2 = p3[c] - 0.333 * d2[c];
+    value[c] = static_cast< int >( bp[0] * p0[c] + bp[1] * p1 + bp[2] * p2 + bp[3] * p3[c] );
+  }
+
+  return createPremultipliedColor( value[0], value[1], value[2], value[3] );
 }
 
 double QgsCubicRasterResampler::calcBernsteinPolyN3( int i, double t )
@@ -152,6 +152,14 @@ QgsRasterBlock * QgsHueSaturationFilter::block( int bandNo, QgsRectangle  const
     return outputBlock;
   }
 
+  if ( !QgsRasterBlock::typeIsColor( inputBlock->dataType() ) )
+  {
+    QgsDebugMsg( "Input is not a rendered image" );
+    outputBlock->setIsNoData();
+    delete inputBlock;
+    return outputBlock;
+  }
+
   // adjust image
   QRgb myNoDataColor = qRgba( 0, 0, 0, 0 );
   QRgb myRgb;
@@ -160,15 +168,17 @@ QgsRasterBlock * QgsHueSaturationFilter::block( int bandNo, QgsRectangle  const
   int r, g, b, alpha;
   double alphaFactor = 1.0;
 
+  const QRgb *inputColors = inputBlock->typedData<QRgb>();
+  QRgb *outputColors = outputBlock->typedData<QRgb>();
   for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
   {
-    if ( inputBlock->color( i ) == myNoDataColor )
+    myRgb = inputColors[i];
+    if ( myRgb == myNoDataColor )
     {
-      outputBlock->setColor( i, myNoDataColor );
+      outputColors[i] = myNoDataColor;
       continue;
     }
 
-    myRgb = inputBlock->color( i );
     myColor = QColor( myRgb );
 
     // Alpha must be taken from QRgb, since conversion from QRgb->QColor loses alpha
@@ -177,7 +187,7 @@ QgsRasterBlock * QgsHueSaturationFilter::block( int bandNo, QgsRectangle  const
     if ( alpha == 0 )
     {
       // totally transparent, no changes required
-      outputBlock->setColor( i, myRgb );
+      outputColors[i] = myRgb;
       continue;
     }
 
@@ -217,7 +227,7 @@ QgsRasterBlock * QgsHueSaturationFilter::block( int bandNo, QgsRectangle  const
       b *= alphaFactor;
     }
 
-    outputBlock->setColor( i, qRgba( r, g, b, alpha ) );
+    outputColors[i] = qRgba( r, g, b, alpha );
   }
 
   delete inputBlock;
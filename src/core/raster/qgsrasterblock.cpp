@@ -19,10 +19,102 @@
 
 #include <QByteArray>
 #include <QColor>
+#include <QVector>
 
 #include "qgslogger.h"
 #include "qgsrasterblock.h"
 
+// Typed loops over the values of numeric blocks, without a switch on the data type per value.
+// Each of them is instantiated for the C++ types of the numeric data types.
+
+template <typename Src, typename Dest>
+static void convertValues( const Src *src, Dest *dest, qgssize size )
+{
+  // through double like writeValue( readValue() )
+  for ( qgssize i = 0; i < size; ++i )
+    dest[i] = static_cast< Dest >( static_cast< double >( src[i] ) );
+}
+
+template <typename Src>
+static bool convertValues( const Src *src, void *dest, QGis::DataType destDataType, qgssize size )
+{
+  switch ( destDataType )
+  {
+    case QGis::Byte:
+      convertValues( src, static_cast< quint8 * >( dest ), size );
+      return true;
+    case QGis::UInt16:
+      convertValues( src, static_cast< quint16 * >( dest ), size );
+      return true;
+    case QGis::Int16:
+      convertValues( src, static_cast< qint16 * >( dest ), size );
+      return true;
+    case QGis::UInt32:
+      convertValues( src, static_cast< quint32 * >( dest ), size );
+      return true;
+    case QGis::Int32:
+      convertValues( src, static_cast< qint32 * >( dest ), size );
+      return true;
+    case QGis::Float32:
+      convertValues( src, static_cast< float * >( dest ), size );
+      return true;
+    case QGis::Float64:
+      convertValues( src, static_cast< double * >( dest ), size );
+      return true;
+    default:
+      return false;
+  }
+}
+
+static inline bool isNoDataBit( const char *bitmapRow, int column )
+{
+  return bitmapRow && ( bitmapRow[column / 8] & ( 0x80 >> ( column % 8 ) ) );
+}
+
+template <typename T>
+static void scaleOffsetValues( T *values, int width, const char *bitmapRow, bool hasNoDataValue, double noDataValue, double scale, double offset )
+{
+  for ( int i = 0; i < width; ++i )
+  {
+    if ( isNoDataBit( bitmapRow, i ) )
+      continue;
+    double value = values[i];
+    if ( hasNoDataValue && ( qIsNaN( value ) || qgsDoubleNear( value, noDataValue ) ) )
+      continue;
+    values[i] = static_cast< T >( value * scale + offset );
+  }
+}
+
+template <typename T>
+static void minimumMaximumValues( const T *values, int width, const char *bitmapRow, bool hasNoDataValue, double noDataValue, double &minimum, double &maximum, bool &found )
+{
+  for ( int i = 0; i < width; ++i )
+  {
+    if ( isNoDataBit( bitmapRow, i ) )
+      continue;
+    double value = values[i];
+    if ( hasNoDataValue && ( qIsNaN( value ) || qgsDoubleNear( value, noDataValue ) ) )
+      continue;
+    if ( qIsNaN( value ) )
+      continue;
+    if ( !found || value < minimum )
+      minimum = value;
+    if ( !found || value > maximum )
+      maximum = value;
+    found = true;
+  }
+}
+
+template <typename T>
+static void rangeNoDataValues( const T *values, qgssize size, const QgsRasterRangeList &rangeList, QVector<qgssize> &indexes )
+{
+  for ( qgssize i = 0; i < size; ++i )
+  {
+    if ( QgsRasterRange::contains( static_cast< double >( values[i] ), rangeList ) )
+      indexes << i;
+  }
+}
+
 // See #9101 before any change of NODATA_COLOR!
 const QRgb QgsRasterBlock::mNoDataColor = qRgba( 0, 0, 0, 0 );
 
@@ -700,6 +792,72 @@ char * QgsRasterBlock::bits()
   return nullptr;
 }
 
+const char * QgsRasterBlock::constBits() const
+{
+  if ( mData )
+  {
+    return reinterpret_cast< const char* >( mData );
+  }
+  if ( mImage && mImage->constBits() )
+  {
+    return reinterpret_cast< const char* >( mImage->constBits() );
+  }
+
+  return nullptr;
+}
+
+const char * QgsRasterBlock::noDataBitmapRow( int row ) const
+{
+  // the no data value takes precedence over the bitmap, see isNoData()
+  if ( mHasNoDataValue || !mNoDataBitmap )
+  {
+    return nullptr;
+  }
+  return mNoDataBitmap + static_cast< qgssize >( row ) * mNoDataBitmapWidth;
+}
+
+bool QgsRasterBlock::minimumMaximum( double &minimum, double &maximum ) const
+{
+  if ( !mData )
+  {
+    return false;
+  }
+
+  bool found = false;
+  for ( int row = 0; row < mHeight; ++row )
+  {
+    const char *bitmapRow = noDataBitmapRow( row );
+    switch ( mDataType )
+    {
+      case QGis::Byte:
+        minimumMaximumValues( typedRow<quint8>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      case QGis::UInt16:
+        minimumMaximumValues( typedRow<quint16>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      case QGis::Int16:
+        minimumMaximumValues( typedRow<qint16>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      case QGis::UInt32:
+        minimumMaximumValues( typedRow<quint32>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      case QGis::Int32:
+        minimumMaximumValues( typedRow<qint32>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      case QGis::Float32:
+        minimumMaximumValues( typedRow<float>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      case QGis::Float64:
+        minimumMaximumValues( typedRow<double>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, minimum, maximum, found );
+        break;
+      default:
+        QgsDebugMsg( QString( "Data type %1 is not supported" ).arg( mDataType ) );
+        return false;
+    }
+  }
+  return found;
+}
+
 bool QgsRasterBlock::convert( QGis::DataType destDataType )
 {
   if ( isEmpty() ) return false;
@@ -741,10 +899,41 @@ void QgsRasterBlock::applyScaleOffset( double scale, double offset )
   if ( !typeIsNumeric( mDataType ) ) return;
   if ( scale == 1.0 && offset == 0.0 ) return;
 
-  qgssize size = static_cast< qgssize >( mWidth ) * mHeight;
-  for ( qgssize i = 0; i < size; ++i )
+  for ( int row = 0; row < mHeight; ++row )
   {
-    if ( !isNoData( i ) ) setValue( i, value( i ) * scale + offset );
+    const char *bitmapRow = noDataBitmapRow( row );
+    switch ( mDataType )
+    {
+      case QGis::Byte:
+        scaleOffsetValues( typedRow<quint8>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      case QGis::UInt16:
+        scaleOffsetValues( typedRow<quint16>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      case QGis::Int16:
+        scaleOffsetValues( typedRow<qint16>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      case QGis::UInt32:
+        scaleOffsetValues( typedRow<quint32>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      case QGis::Int32:
+        scaleOffsetValues( typedRow<qint32>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      case QGis::Float32:
+        scaleOffsetValues( typedRow<float>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      case QGis::Float64:
+        scaleOffsetValues( typedRow<double>( row ), mWidth, bitmapRow, mHasNoDataValue, mNoDataValue, scale, offset );
+        break;
+      default:
+        // complex types
+        for ( int column = 0; column < mWidth; ++column )
+        {
+          qgssize i = static_cast< qgssize >( row ) * mWidth + column;
+          if ( !isNoData( i ) ) setValue( i, value( i ) * scale + offset );
+        }
+        break;
+    }
   }
   return;
 }
@@ -756,15 +945,44 @@ void QgsRasterBlock::applyNoDataValues( const QgsRasterRangeList & rangeList )
     return;
   }
 
+  // find the values first, setting no data may change them
   qgssize size = static_cast< qgssize >( mWidth ) * static_cast< qgssize >( mHeight );
-  for ( qgssize i = 0; i < size; ++i )
+  QVector<qgssize> indexes;
+  switch ( mDataType )
   {
-    double val = value( i );
-    if ( QgsRasterRange::contains( val, rangeList ) )
-    {
-      //setValue( i, mNoDataValue );
-      setIsNoData( i );
-    }
+    case QGis::Byte:
+      rangeNoDataValues( typedData<quint8>(), size, rangeList, indexes );
+      break;
+    case QGis::UInt16:
+      rangeNoDataValues( typedData<quint16>(), size, rangeList, indexes );
+      break;
+    case QGis::Int16:
+      rangeNoDataValues( typedData<qint16>(), size, rangeList, indexes );
+      break;
+    case QGis::UInt32:
+      rangeNoDataValues( typedData<quint32>(), size, rangeList, indexes );
+      break;
+    case QGis::Int32:
+      rangeNoDataValues( typedData<qint32>(), size, rangeList, indexes );
+      break;
+    case QGis::Float32:
+      rangeNoDataValues( typedData<float>(), size, rangeList, indexes );
+      break;
+    case QGis::Float64:
+      rangeNoDataValues( typedData<double>(), size, rangeList, indexes );
+      break;
+    default:
+      for ( qgssize i = 0; i < size; ++i )
+      {
+        if ( QgsRasterRange::contains( value( i ), rangeList ) )
+          indexes << i;
+      }
+      break;
+  }
+
+  Q_FOREACH ( qgssize i, indexes )
+  {
+    setIsNoData( i );
   }
 }
 
@@ -835,12 +1053,43 @@ void * QgsRasterBlock::convert( void *srcData, QGis::DataType srcDataType, QGis:
 {
   int destDataTypeSize = typeSize( destDataType );
   void *destData = qgsMalloc( destDataTypeSize * size );
-  for ( qgssize i = 0; i < size; i++ )
+
+  bool converted = false;
+  switch ( srcDataType )
   {
-    double value = readValue( srcData, srcDataType, i );
-    writeValue( destData, destDataType, i, value );
-    //double newValue = readValue( destData, destDataType, i );
-    //QgsDebugMsg( QString("convert %1 type %2 to %3: %4 -> %5").arg(i).arg(srcDataType).arg(destDataType).arg( value ).arg( newValue ) );
+    case QGis::Byte:
+      converted = convertValues( static_cast< const quint8 * >( srcData ), destData, destDataType, size );
+      break;
+    case QGis::UInt16:
+      converted = convertValues( static_cast< const quint16 * >( srcData ), destData, destDataType, size );
+      break;
+    case QGis::Int16:
+      converted = convertValues( static_cast< const qint16 * >( srcData ), destData, destDataType, size );
+      break;
+    case QGis::UInt32:
+      converted = convertValues( static_cast< const quint32 * >( srcData ), destData, destDataType, size );
+      break;
+    case QGis::Int32:
+      converted = convertValues( static_cast< const qint32 * >( srcData ), destData, destDataType, size );
+      break;
+    case QGis::Float32:
+      converted = convertValues( static_cast< const float * >( srcData ), destData, destDataType, size );
+      break;
+    case QGis::Float64:
+      converted = convertValues( static_cast< const double * >( srcData ), destData, destDataType, size );
+      break;
+    default:
+      break;
+  }
+
+  if ( !converted )
+  {
+    // complex types
+    for ( qgssize i = 0; i < size; i++ )
+    {
+      double value = readValue( srcData, srcDataType, i );
+      writeValue( destData, destDataType, i, value );
+    }
   }
   return destData;
 }
@@ -280,6 +280,45 @@ class CORE_EXPORT QgsRasterBlock
      */
     char * bits();
 
+    /** \brief Get the values of the block as an array of T. Rows follow each other
+     *  without padding. T has to be the C++ type of the data type of the block: quint8,
+     *  quint16, qint16, quint32, qint32, float or double for the numeric types and QRgb
+     *  for the color types. Complex types are not supported.
+     *  @return pointer to the values, nullptr if the block is empty
+     *  @note added in QGIS 2.16
+     *  @note not available in python bindings
+     */
+    template <typename T> T* typedData() { return reinterpret_cast< T* >( bits() ); }
+
+    /** \brief Get the values of the block as an array of T, see the non-const variant
+     *  @note added in QGIS 2.16
+     *  @note not available in python bindings
+     */
+    template <typename T> const T* typedData() const { return reinterpret_cast< const T* >( constBits() ); }
+
+    /** \brief Get the values of a row of the block as an array of T, see typedData()
+     *  @param row row index
+     *  @note added in QGIS 2.16
+     *  @note not available in python bindings
+     */
+    template <typename T> T* typedRow( int row ) { T* data = typedData<T>(); return data ? data + static_cast< qgssize >( row ) * mWidth : nullptr; }
+
+    /** \brief Get the values of a row of the block as an array of T, see typedData()
+     *  @param row row index
+     *  @note added in QGIS 2.16
+     *  @note not available in python bindings
+     */
+    template <typename T> const T* typedRow( int row ) const { const T* data = typedData<T>(); return data ? data + static_cast< qgssize >( row ) * mWidth : nullptr; }
+
+    /** \brief Get the minimum and the maximum of the values which are not no data.
+     *  @param minimum output: minimum value
+     *  @param maximum output: maximum value
+     *  @return false if the block is not numeric or all its values are no data
+     *  @note added in QGIS 2.16
+     *  @note not available in python bindings
+     */
+    bool minimumMaximum( double &minimum, double &maximum ) const;
+
     /** \brief Print double value with all necessary significant digits.
      *         It is ensured that conversion back to double gives the same number.
      *  @param value the value to be printed
@@ -345,6 +384,12 @@ class CORE_EXPORT QgsRasterBlock
 
   private:
     static QImage::Format imageFormat( QGis::DataType theDataType );
+
+    /** Pointer to the data for read only access */
+    const char * constBits() const;
+
+    /** Row of the no data bitmap, nullptr if the no data value or no bitmap is used */
+    const char * noDataBitmapRow( int row ) const;
     static QGis::DataType dataType( QImage::Format theFormat );
 
     /** Test if value is nodata comparing to noDataValue
@@ -21,8 +21,113 @@
 #include "qgsrasterviewport.h"
 #include "qgsmaptopixel.h"
 #include <QImage>
+#include <QMutex>
 #include <QPainter>
 #include <QPrinter>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+/** Clones of the pipe, each one used by one thread at a time
+ */
+class QgsRasterPipeClones
+{
+  public:
+    QgsRasterPipeClones( const QgsRasterInterface* last, int count )
+    {
+      // interfaces from the source to the last one
+      QList<const QgsRasterInterface*> interfaces;
+      for ( const QgsRasterInterface* iface = last; iface; iface = iface->input() )
+        interfaces.prepend( iface );
+
+      for ( int i = 0; i < count; ++i )
+      {
+        QList<QgsRasterInterface*> chain;
+        Q_FOREACH ( const QgsRasterInterface* iface, interfaces )
+        {
+          QgsRasterInterface* clone = iface->clone();
+          if ( !clone )
+            break;
+          if ( !chain.isEmpty() && !clone->setInput( chain.last() ) )
+          {
+            delete clone;
+            break;
+          }
+          chain << clone;
+        }
+        if ( chain.size() != interfaces.size() )
+        {
+          qDeleteAll( chain );
+          continue;
+        }
+        mChains << chain;
+        mFree << chain.last();
+      }
+    }
+
+    ~QgsRasterPipeClones()
+    {
+      Q_FOREACH ( const QList<QgsRasterInterface*>& chain, mChains )
+        qDeleteAll( chain );
+    }
+
+    //! Returns the number of complete clones of the pipe
+    int count() const { return mChains.size(); }
+
+    //! Takes a free clone, there is always one as there are as many clones as threads
+    QgsRasterInterface* acquire()
+    {
+      QMutexLocker locker( &mMutex );
+      return mFree.isEmpty() ? nullptr : mFree.takeLast();
+    }
+
+    void release( QgsRasterInterface* iface )
+    {
+      QMutexLocker locker( &mMutex );
+      mFree << iface;
+    }
+
+  private:
+    QList< QList<QgsRasterInterface*> > mChains;
+    QList<QgsRasterInterface*> mFree;
+    QMutex mMutex;
+};
+
+//! Raster part rendered by a worker thread
+struct QgsRasterDrawerTile
+{
+  QgsRectangle extent;
+  int width;
+  int height;
+  int topLeftCol;
+  int topLeftRow;
+  QImage image;
+};
+
+//! Renders a tile with a free clone of the pipe
+struct QgsRasterDrawerRenderTile
+{
+  explicit QgsRasterDrawerRenderTile( QgsRasterPipeClones* clones ) : mClones( clones ) {}
+
+  void operator()( QgsRasterDrawerTile& tile )
+  {
+    QgsRasterInterface* iface = mClones->acquire();
+    if ( !iface )
+      return;
+
+    QgsRasterBlock* block = iface->block( 1, tile.extent, tile.width, tile.height );
+    mClones->release( iface );
+    if ( !block )
+    {
+      QgsDebugMsg( "Cannot get block" );
+      return;
+    }
+
+    tile.image = block->image();
+    delete block;
+  }
+
+  QgsRasterPipeClones* mClones;
+};
 
 QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator* iterator ): mIterator( iterator )
 {
@@ -38,6 +143,13 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
 
   // last pipe filter has only 1 band
   int bandNumber = 1;
+
+  if ( QThreadPool::globalInstance()->maxThreadCount() > 1 && mIterator->input() && mIterator->input()->supportsConcurrentClones() )
+  {
+    if ( drawParallel( p, viewPort, theQgsMapToPixel ) )
+      return;
+  }
+
   mIterator->startRasterRead( bandNumber, viewPort->mWidth, viewPort->mHeight, viewPort->mDrawnExtent );
 
   //number of cols/rows in output pixels
@@ -62,32 +174,80 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
     }
 
     QImage img = block->image();
+    fixPdfTransparency( p, img );
+    drawImage( p, viewPort, img, topLeftCol, topLeftRow, theQgsMapToPixel );
 
-    // Because of bug in Acrobat Reader we must use "white" transparent color instead
-    // of "black" for PDF. See #9101.
-    QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
-    if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
-    {
-      QgsDebugMsgLevel( "PdfFormat", 4 );
+    delete block;
+  }
+}
+
+bool QgsRasterDrawer::drawParallel( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel )
+{
+  int bandNumber = 1;
+
+  // the tiles are the same as in the serial rendering, so that the output does not change,
+  // nothing to share if the view port fits in one tile
+  if ( viewPort->mWidth <= mIterator->maximumTileWidth() && viewPort->mHeight <= mIterator->maximumTileHeight() )
+    return false;
+
+  // split the view port in tiles, without reading them
+  mIterator->startRasterRead( bandNumber, viewPort->mWidth, viewPort->mHeight, viewPort->mDrawnExtent );
+
+  QList<QgsRasterDrawerTile> tiles;
+  QgsRasterDrawerTile tile;
+  while ( mIterator->nextRasterPart( bandNumber, tile.width, tile.height, tile.extent, tile.topLeftCol, tile.topLeftRow ) )
+  {
+    tiles << tile;
+  }
+  mIterator->stopRasterRead( bandNumber );
 
-      img = img.convertToFormat( QImage::Format_ARGB32 );
-      QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
-      QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
-      for ( int x = 0; x < img.width(); x++ )
+  if ( tiles.size() < 2 )
+    return false;
+
+  // clones are created here, data providers may not be opened from other threads,
+  // the calling thread takes part in the work too
+  int threads = qMin( tiles.size(), QThreadPool::globalInstance()->maxThreadCount() + 1 );
+  QgsRasterPipeClones clones( mIterator->input(), threads );
+  if ( clones.count() < threads )
+    return false;
+
+  QtConcurrent::blockingMap( tiles, QgsRasterDrawerRenderTile( &clones ) );
+
+  // tiles are painted in the same order as the serial rendering
+  for ( int i = 0; i < tiles.size(); ++i )
+  {
+    QImage& img = tiles[i].image;
+    if ( img.isNull() )
+      continue;
+
+    fixPdfTransparency( p, img );
+    drawImage( p, viewPort, img, tiles.at( i ).topLeftCol, tiles.at( i ).topLeftRow, theQgsMapToPixel );
+  }
+  return true;
+}
+
+void QgsRasterDrawer::fixPdfTransparency( QPainter* p, QImage& img ) const
+{
+  // Because of bug in Acrobat Reader we must use "white" transparent color instead
+  // of "black" for PDF. See #9101.
+  QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
+  if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+  {
+    QgsDebugMsgLevel( "PdfFormat", 4 );
+
+    img = img.convertToFormat( QImage::Format_ARGB32 );
+    QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
+    QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
+    for ( int x = 0; x < img.width(); x++ )
+    {
+      for ( int y = 0; y < img.height(); y++ )
       {
-        for ( int y = 0; y < img.height(); y++ )
+        if ( img.pixel( x, y ) == transparentBlack )
         {
-          if ( img.pixel( x, y ) == transparentBlack )
-          {
-            img.setPixel( x, y, transparentWhite );
-          }
+          img.setPixel( x, y, transparentWhite );
         }
       }
     }
-
-    drawImage( p, viewPort, img, topLeftCol, topLeftRow, theQgsMapToPixel );
-
-    delete block;
   }
 }
 
@@ -29,6 +29,10 @@ class QgsRasterIterator;
 
 /** \ingroup core
  * The drawing pipe for raster layers.
+ *
+ * If the pipe supports concurrent clones (see QgsRasterInterface::supportsConcurrentClones())
+ * and the global thread pool has several threads, the view port is split in tiles which are
+ * rendered in parallel, each thread with its own clone of the pipe.
  */
 class CORE_EXPORT QgsRasterDrawer
 {
@@ -50,6 +54,15 @@ class CORE_EXPORT QgsRasterDrawer
     void drawImage( QPainter* p, QgsRasterViewPort* viewPort, const QImage& img, int topLeftCol, int topLeftRow, const QgsMapToPixel* mapToPixel = nullptr ) const;
 
   private:
+    /** Renders the tiles on the global thread pool, each thread with its own clone of the pipe,
+     * and draws them in order. Returns false if the view port is not rendered, e.g. if it fits
+     * in one tile.
+     */
+    bool drawParallel( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel );
+
+    //! Replaces transparent black by transparent white when drawing to PDF
+    void fixPdfTransparency( QPainter* p, QImage& img ) const;
+
     QgsRasterIterator* mIterator;
 };
 
@@ -105,6 +105,9 @@ class CORE_EXPORT QgsRasterInterface
     /** Read block of data using given extent and size.
      *  Returns pointer to data.
      *  Caller is responsible to free the memory returned.
+     *  The method of one instance is never called from several threads at the same time,
+     *  blocks are computed in parallel with one clone of the whole pipe per thread,
+     *  see supportsConcurrentClones().
      * @param bandNo band number
      * @param extent extent of block
      * @param width pixel width of block
@@ -112,6 +115,15 @@ class CORE_EXPORT QgsRasterInterface
      */
     virtual QgsRasterBlock *block( int bandNo, const QgsRectangle &extent, int width, int height ) = 0;
 
+    /** Returns whether clones of the interface and of its inputs may compute blocks at the
+     * same time on different threads, each clone being used by one thread. Filters, which
+     * only depend on their own state, follow their input. Data providers have to return
+     * true explicitly if their clones share no state, e.g. each one opens its own dataset,
+     * and if parallel reads do not overload the source, e.g. a remote server.
+     * @note added in QGIS 2.16
+     */
+    virtual bool supportsConcurrentClones() const { return mInput && mInput->supportsConcurrentClones(); }
+
     /** Set input.
       * Returns true if set correctly, false if cannot use that input */
     virtual bool setInput( QgsRasterInterface* input ) { mInput = input; return true; }
@@ -55,6 +55,19 @@ class CORE_EXPORT QgsRasterIterator
                              QgsRasterBlock **block,
                              int& topLeftCol, int& topLeftRow );
 
+    /** Returns the position of the next part of raster data without reading it, the part
+     * is then considered as read. Parts can so be read independently, e.g. on several threads.
+       @param bandNumber band to read
+       @param nCols number of columns of the part
+       @param nRows number of rows of the part
+       @param extent extent of the part
+       @param topLeftCol top left column
+       @param topLeftRow top left row
+       @return false if the last part was already returned
+       @note added in QGIS 2.16
+     */
+    bool nextRasterPart( int bandNumber, int& nCols, int& nRows, QgsRectangle& extent, int& topLeftCol, int& topLeftRow );
+
     void stopRasterRead( int bandNumber );
 
     const QgsRasterInterface* input() const { return mInput; }
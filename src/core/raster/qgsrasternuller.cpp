@@ -18,6 +18,8 @@
 #include "qgsrasterdataprovider.h"
 #include "qgsrasternuller.h"
 
+#include <cstring>
+
 QgsRasterNuller::QgsRasterNuller( QgsRasterInterface* input )
     : QgsRasterInterface( input )
 {
@@ -109,28 +111,31 @@ QgsRasterBlock * QgsRasterNuller::block( int bandNo, QgsRectangle  const & exten
     outputBlock = new QgsRasterBlock( inputBlock->dataType(), width, height );
   }
 
-  for ( int i = 0; i < height; i++ )
+  // copy the values at once, then mark the no data
+  qgssize size = static_cast< qgssize >( width ) * height;
+  char *outputData = outputBlock->bits();
+  const char *inputData = inputBlock->bits();
+  if ( outputData && inputData )
   {
-    for ( int j = 0; j < width; j++ )
-    {
-      double value = inputBlock->value( i, j );
+    memcpy( outputData, inputData, size * inputBlock->dataTypeSize() );
+  }
 
-      bool isNoData = inputBlock->isNoData( i, j );
-      if ( QgsRasterRange::contains( value, mNoData.value( bandNo - 1 ) ) )
-      {
-        isNoData = true;
-      }
-      outputBlock->setValue( i, j, inputBlock->value( i, j ) );
-      if ( isNoData )
-      {
-        outputBlock->setIsNoData( i, j );
-      }
-      else
+  // input no data already are output no data if both use the same no data value
+  bool sameNoDataValue = inputBlock->hasNoDataValue() && outputBlock->hasNoDataValue()
+                         && qgsDoubleNear( inputBlock->noDataValue(), outputBlock->noDataValue() );
+  if ( inputBlock->hasNoData() && !sameNoDataValue )
+  {
+    for ( qgssize i = 0; i < size; i++ )
+    {
+      if ( inputBlock->isNoData( i ) )
       {
-        outputBlock->setValue( i, j, value );
+        outputBlock->setIsNoData( i );
       }
     }
   }
+
+  outputBlock->applyNoDataValues( mNoData.value( bandNo - 1 ) );
+
   delete inputBlock;
 
   return outputBlock;
@@ -22,6 +22,58 @@
 #include "qgsrasterprojector.h"
 #include "qgscoordinatetransform.h"
 
+#include <QCache>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+//! Maximum memory used by the cached mappings, in bytes
+static const int MAPPING_CACHE_SIZE = 64 * 1024 * 1024;
+
+//! Number of destination rows transformed by a thread at once in exact mode
+static const int EXACT_CHUNK_ROWS = 64;
+
+/** Source extent and size for a destination extent and size, with the index of the source
+ * cell of each destination cell (-1 if outside of the source) */
+struct QgsRasterProjectorMapping
+{
+  QgsRectangle srcExtent;
+  int srcRows;
+  int srcCols;
+  bool approximate;
+  QVector<int> srcIndexes;
+};
+
+//! Mappings shared by all projectors, the cost of a mapping is its size in bytes
+typedef QCache< QString, QSharedPointer<const QgsRasterProjectorMapping> > QgsRasterProjectorMappingCache;
+Q_GLOBAL_STATIC_WITH_ARGS( QgsRasterProjectorMappingCache, sMappingCache, ( MAPPING_CACHE_SIZE ) )
+Q_GLOBAL_STATIC( QMutex, sMappingCacheMutex )
+
+//! Calculates chunks of destination rows with exact transformation, each with its own transform
+struct QgsRasterProjectorExactRows
+{
+  typedef void result_type;
+
+  QgsRasterProjectorExactRows( QgsRasterProjector* projector, const QgsCoordinateTransform* ct, int* srcIndexes )
+      : mProjector( projector )
+      , mCt( ct )
+      , mSrcIndexes( srcIndexes )
+  {}
+
+  void operator()( int startRow ) const
+  {
+    // transforms are not safe to share between threads
+    QgsCoordinateTransform* ct = mCt ? mCt->clone() : nullptr;
+    mProjector->calcExactRows( startRow, qMin( startRow + EXACT_CHUNK_ROWS, mProjector->mDestRows ), ct, mSrcIndexes );
+    delete ct;
+  }
+
+  QgsRasterProjector* mProjector;
+  const QgsCoordinateTransform* mCt;
+  int* mSrcIndexes;
+};
+
 QgsRasterProjector::QgsRasterProjector(
   const QgsCoordinateReferenceSystem& theSrcCRS,
   const QgsCoordinateReferenceSystem& theDestCRS,
@@ -232,26 +284,7 @@ void QgsRasterProjector::calc()
   delete[] pHelperBottom;
   pHelperBottom = nullptr;
 
-  // Get max source resolution and extent if possible
-  mMaxSrcXRes = 0;
-  mMaxSrcYRes = 0;
-  if ( mInput )
-  {
-    QgsRasterDataProvider *provider = dynamic_cast<QgsRasterDataProvider*>( mInput->srcInput() );
-    if ( provider )
-    {
-      if ( provider->capabilities() & QgsRasterDataProvider::Size )
-      {
-        mMaxSrcXRes = provider->extent().width() / provider->xSize();
-        mMaxSrcYRes = provider->extent().height() / provider->ySize();
-      }
-      // Get source extent
-      if ( mExtent.isEmpty() )
-      {
-        mExtent = provider->extent();
-      }
-    }
-  }
+  calcInputLimits();
 
   mDestXRes = mDestExtent.width() / ( mDestCols );
   mDestYRes = mDestExtent.height() / ( mDestRows );
@@ -344,6 +377,30 @@ void QgsRasterProjector::calc()
   mSrcXRes = mSrcExtent.width() / mSrcCols;
 }
 
+void QgsRasterProjector::calcInputLimits()
+{
+  // Get max source resolution and extent if possible
+  mMaxSrcXRes = 0;
+  mMaxSrcYRes = 0;
+  if ( mInput )
+  {
+    QgsRasterDataProvider *provider = dynamic_cast<QgsRasterDataProvider*>( mInput->srcInput() );
+    if ( provider )
+    {
+      if ( provider->capabilities() & QgsRasterDataProvider::Size )
+      {
+        mMaxSrcXRes = provider->extent().width() / provider->xSize();
+        mMaxSrcYRes = provider->extent().height() / provider->ySize();
+      }
+      // Get source extent
+      if ( mExtent.isEmpty() )
+      {
+        mExtent = provider->extent();
+      }
+    }
+  }
+}
+
 void QgsRasterProjector::calcSrcExtent()
 {
   /* Run around the mCPMatrix and find source extent */
@@ -603,28 +660,7 @@ bool QgsRasterProjector::preciseSrcRowCol( int theDestRow, int theDestCol, int *
   QgsDebugMsgLevel( QString( "x = %1 y = %2" ).arg( x ).arg( y ), 5 );
 #endif
 
-  if ( !mExtent.contains( QgsPoint( x, y ) ) )
-  {
-    return false;
-  }
-  // Get source row col
-  *theSrcRow = static_cast< int >( floor(( mSrcExtent.yMaximum() - y ) / mSrcYRes ) );
-  *theSrcCol = static_cast< int >( floor(( x - mSrcExtent.xMinimum() ) / mSrcXRes ) );
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QString( "mSrcExtent.yMinimum() = %1 mSrcExtent.yMaximum() = %2 mSrcYRes = %3" ).arg( mSrcExtent.yMinimum() ).arg( mSrcExtent.yMaximum() ).arg( mSrcYRes ), 5 );
-  QgsDebugMsgLevel( QString( "theSrcRow = %1 theSrcCol = %2" ).arg( *theSrcRow ).arg( *theSrcCol ), 5 );
-#endif
-
-  // With epsg 32661 (Polar Stereographic) it was happening that *theSrcCol == mSrcCols
-  // For now silently correct limits to avoid crashes
-  // TODO: review
-  // should not happen
-  if ( *theSrcRow >= mSrcRows ) return false;
-  if ( *theSrcRow < 0 ) return false;
-  if ( *theSrcCol >= mSrcCols ) return false;
-  if ( *theSrcCol < 0 ) return false;
-
-  return true;
+  return srcPointRowCol( x, y, theSrcRow, theSrcCol );
 }
 
 bool QgsRasterProjector::approximateSrcRowCol( int theDestRow, int theDestCol, int *theSrcRow, int *theSrcCol )
@@ -663,16 +699,26 @@ bool QgsRasterProjector::approximateSrcRowCol( int theDestRow, int theDestCol, i
   double mySrcX = bx + ( tx - bx ) * yfrac;
   double mySrcY = by + ( ty - by ) * yfrac;
 
-  if ( !mExtent.contains( QgsPoint( mySrcX, mySrcY ) ) )
+  // TODO: check again cell selection (coor is in the middle)
+  return srcPointRowCol( mySrcX, mySrcY, theSrcRow, theSrcCol );
+}
+
+inline bool QgsRasterProjector::srcPointRowCol( double theX, double theY, int *theSrcRow, int *theSrcCol ) const
+{
+  if ( !mExtent.contains( QgsPoint( theX, theY ) ) )
   {
     return false;
   }
 
-  // TODO: check again cell selection (coor is in the middle)
-
-  *theSrcRow = static_cast< int >( floor(( mSrcExtent.yMaximum() - mySrcY ) / mSrcYRes ) );
-  *theSrcCol = static_cast< int >( floor(( mySrcX - mSrcExtent.xMinimum() ) / mSrcXRes ) );
+  // Get source row col
+  *theSrcRow = static_cast< int >( floor(( mSrcExtent.yMaximum() - theY ) / mSrcYRes ) );
+  *theSrcCol = static_cast< int >( floor(( theX - mSrcExtent.xMinimum() ) / mSrcXRes ) );
+#ifdef QGISDEBUG
+  QgsDebugMsgLevel( QString( "mSrcExtent.yMinimum() = %1 mSrcExtent.yMaximum() = %2 mSrcYRes = %3" ).arg( mSrcExtent.yMinimum() ).arg( mSrcExtent.yMaximum() ).arg( mSrcYRes ), 5 );
+  QgsDebugMsgLevel( QString( "theSrcRow = %1 theSrcCol = %2" ).arg( *theSrcRow ).arg( *theSrcCol ), 5 );
+#endif
 
+  // With epsg 32661 (Polar Stereographic) it was happening that *theSrcCol == mSrcCols
   // For now silently correct limits to avoid crashes
   // TODO: review
   // should not happen
@@ -894,13 +940,13 @@ QgsRasterBlock * QgsRasterProjector::block( int bandNo, QgsRectangle  const & ex
   mDestExtent = extent;
   mDestRows = height;
   mDestCols = width;
-  calc();
+  QSharedPointer<const QgsRasterProjectorMapping> destMapping = mapping();
 
   QgsDebugMsgLevel( QString( "srcExtent:\n%1" ).arg( srcExtent().toString() ), 4 );
   QgsDebugMsgLevel( QString( "srcCols = %1 srcRows = %2" ).arg( srcCols() ).arg( srcRows() ), 4 );
 
   // If we zoom out too much, projector srcRows / srcCols maybe 0, which can cause problems in providers
-  if ( srcRows() <= 0 || srcCols() <= 0 )
+  if ( srcRows() <= 0 || srcCols() <= 0 || destMapping->srcIndexes.isEmpty() )
   {
     QgsDebugMsgLevel( "Zero srcRows or srcCols", 4 );
     return new QgsRasterBlock();
@@ -947,27 +993,20 @@ QgsRasterBlock * QgsRasterProjector::block( int bandNo, QgsRectangle  const & ex
   // we cannot fill output block with no data because we use memcpy for data, not setValue().
   bool doNoData = !QgsRasterBlock::typeIsNumeric( inputBlock->dataType() ) && inputBlock->hasNoData() && !inputBlock->hasNoDataValue();
 
-  const QgsCoordinateTransform* inverseCt = nullptr;
-  if ( !mApproximate )
-  {
-    inverseCt = QgsCoordinateTransformCache::instance()->transform( mDestCRS.authid(), mSrcCRS.authid(), mDestDatumTransform, mSrcDatumTransform );
-  }
-
   outputBlock->setIsNoData();
 
-  int srcRow, srcCol;
+  const int* srcIndexes = destMapping->srcIndexes.constData();
   for ( int i = 0; i < height; ++i )
   {
     for ( int j = 0; j < width; ++j )
     {
-      bool inside = srcRowCol( i, j, &srcRow, &srcCol, inverseCt );
-      if ( !inside ) continue; // we have everything set to no data
+      int srcIndex = srcIndexes[ i * width + j ];
+      if ( srcIndex < 0 ) continue; // we have everything set to no data
 
-      qgssize srcIndex = static_cast< qgssize >( srcRow ) * mSrcCols + srcCol;
-      QgsDebugMsgLevel( QString( "row = %1 col = %2 srcRow = %3 srcCol = %4" ).arg( i ).arg( j ).arg( srcRow ).arg( srcCol ), 5 );
+      QgsDebugMsgLevel( QString( "row = %1 col = %2 srcRow = %3 srcCol = %4" ).arg( i ).arg( j ).arg( srcIndex / mSrcCols ).arg( srcIndex % mSrcCols ), 5 );
 
       // isNoData() may be slow so we check doNoData first
-      if ( doNoData && inputBlock->isNoData( srcRow, srcCol ) )
+      if ( doNoData && inputBlock->isNoData( static_cast< qgssize >( srcIndex ) ) )
       {
         outputBlock->setIsNoData( i, j );
         continue;
@@ -983,7 +1022,7 @@ QgsRasterBlock * QgsRasterProjector::block( int bandNo, QgsRectangle  const & ex
       }
       if ( !destBits )
       {
-        QgsDebugMsg( QString( "Cannot set output block data: srcRow = %1 srcCol = %2" ).arg( srcRow ).arg( srcCol ) );
+        QgsDebugMsg( QString( "Cannot set output block data: srcRow = %1 srcCol = %2" ).arg( srcIndex / mSrcCols ).arg( srcIndex % mSrcCols ) );
         continue;
       }
       memcpy( destBits, srcBits, pixelSize );
@@ -996,6 +1035,183 @@ QgsRasterBlock * QgsRasterProjector::block( int bandNo, QgsRectangle  const & ex
   return outputBlock;
 }
 
+QSharedPointer<const QgsRasterProjectorMapping> QgsRasterProjector::mapping()
+{
+  // the key depends on the source extent and resolution of the input
+  calcInputLimits();
+  QString key = mappingKey();
+
+  QSharedPointer<const QgsRasterProjectorMapping> destMapping;
+  {
+    QMutexLocker locker( sMappingCacheMutex() );
+    QSharedPointer<const QgsRasterProjectorMapping>* cached = sMappingCache()->object( key );
+    if ( cached )
+    {
+      destMapping = *cached;
+    }
+  }
+
+  if ( destMapping )
+  {
+    QgsDebugMsgLevel( "Cached mapping", 4 );
+  }
+  else
+  {
+    destMapping = QSharedPointer<const QgsRasterProjectorMapping>( calcMapping() );
+    int cost = destMapping->srcIndexes.size() * sizeof( int ) + sizeof( QgsRasterProjectorMapping );
+    QMutexLocker locker( sMappingCacheMutex() );
+    sMappingCache()->insert( key, new QSharedPointer<const QgsRasterProjectorMapping>( destMapping ), cost );
+  }
+
+  mSrcExtent = destMapping->srcExtent;
+  mSrcRows = destMapping->srcRows;
+  mSrcCols = destMapping->srcCols;
+  mSrcYRes = mSrcExtent.height() / mSrcRows;
+  mSrcXRes = mSrcExtent.width() / mSrcCols;
+  mApproximate = destMapping->approximate;
+  return destMapping;
+}
+
+QgsRasterProjectorMapping* QgsRasterProjector::calcMapping()
+{
+  calc();
+
+  QgsRasterProjectorMapping* destMapping = new QgsRasterProjectorMapping;
+  destMapping->srcExtent = mSrcExtent;
+  destMapping->srcRows = mSrcRows;
+  destMapping->srcCols = mSrcCols;
+  destMapping->approximate = mApproximate;
+
+  // source indexes are stored as int, larger source blocks could not be allocated anyway
+  if ( mSrcRows <= 0 || mSrcCols <= 0 || static_cast< qgssize >( mSrcRows ) * mSrcCols > static_cast< qgssize >( std::numeric_limits<int>::max() ) )
+  {
+    return destMapping;
+  }
+
+  destMapping->srcIndexes.fill( -1, mDestRows * mDestCols );
+  int* srcIndexes = destMapping->srcIndexes.data();
+
+  if ( mApproximate )
+  {
+    // the helper points are calculated for sequential rows
+    int srcRow, srcCol;
+    for ( int i = 0; i < mDestRows; ++i )
+    {
+      for ( int j = 0; j < mDestCols; ++j )
+      {
+        if ( approximateSrcRowCol( i, j, &srcRow, &srcCol ) )
+        {
+          srcIndexes[ i * mDestCols + j ] = srcRow * mSrcCols + srcCol;
+        }
+      }
+    }
+  }
+  else
+  {
+    const QgsCoordinateTransform* inverseCt = QgsCoordinateTransformCache::instance()->transform( mDestCRS.authid(), mSrcCRS.authid(), mDestDatumTransform, mSrcDatumTransform );
+    if ( mDestRows > EXACT_CHUNK_ROWS && QThreadPool::globalInstance()->maxThreadCount() > 1 )
+    {
+      QVector<int> chunks;
+      for ( int i = 0; i < mDestRows; i += EXACT_CHUNK_ROWS )
+      {
+        chunks << i;
+      }
+      QtConcurrent::blockingMap( chunks, QgsRasterProjectorExactRows( this, inverseCt, srcIndexes ) );
+    }
+    else
+    {
+      calcExactRows( 0, mDestRows, inverseCt, srcIndexes );
+    }
+  }
+
+  return destMapping;
+}
+
+void QgsRasterProjector::calcExactRows( int startRow, int endRow, const QgsCoordinateTransform* ct, int* srcIndexes )
+{
+  QVector<double> x( mDestCols );
+  QVector<double> y( mDestCols );
+  QVector<double> z( mDestCols );
+
+  int srcRow, srcCol;
+  for ( int i = startRow; i < endRow; ++i )
+  {
+    // Get coordinates of centers of destination cells, like preciseSrcRowCol()
+    double destY = mDestExtent.yMaximum() - ( i + 0.5 ) * mDestYRes;
+    for ( int j = 0; j < mDestCols; ++j )
+    {
+      x[j] = mDestExtent.xMinimum() + ( j + 0.5 ) * mDestXRes;
+      y[j] = destY;
+      z[j] = 0;
+    }
+
+    bool transformed = true;
+    if ( ct )
+    {
+      try
+      {
+        ct->transformCoords( mDestCols, x.data(), y.data(), z.data() );
+      }
+      catch ( QgsCsException &e )
+      {
+        Q_UNUSED( e );
+        transformed = false;
+      }
+    }
+
+    int* rowIndexes = srcIndexes + i * mDestCols;
+    for ( int j = 0; j < mDestCols; ++j )
+    {
+      bool inside = false;
+      if ( transformed )
+      {
+        inside = srcPointRowCol( x[j], y[j], &srcRow, &srcCol );
+      }
+      else
+      {
+        // a point of the row failed, transform the points one by one
+        try
+        {
+          inside = preciseSrcRowCol( i, j, &srcRow, &srcCol, ct );
+        }
+        catch ( QgsCsException &e )
+        {
+          Q_UNUSED( e );
+        }
+      }
+      if ( inside )
+      {
+        rowIndexes[j] = srcRow * mSrcCols + srcCol;
+      }
+    }
+  }
+}
+
+QString QgsRasterProjector::mappingKey() const
+{
+  QStringList key;
+  // the definitions are part of the key, in case a custom crs is changed
+  key << mSrcCRS.authid() << mSrcCRS.toProj4() << mDestCRS.authid() << mDestCRS.toProj4()
+  << QString::number( mSrcDatumTransform ) << QString::number( mDestDatumTransform )
+  << QString::number( mPrecision ) << QString::number( mDestCols ) << QString::number( mDestRows );
+
+  double values[] = { mDestExtent.xMinimum(), mDestExtent.yMinimum(), mDestExtent.xMaximum(), mDestExtent.yMaximum(),
+                      mExtent.xMinimum(), mExtent.yMinimum(), mExtent.xMaximum(), mExtent.yMaximum(),
+                      mMaxSrcXRes, mMaxSrcYRes
+                    };
+  for ( unsigned int i = 0; i < sizeof( values ) / sizeof( double ); ++i )
+  {
+    key << QString::number( values[i], 'g', 17 );
+  }
+  return key.join( "|" );
+}
+
+void QgsRasterProjector::clearMappingCache()
+{
+  QMutexLocker locker( sMappingCacheMutex() );
+  sMappingCache()->clear();
+}
+
 bool QgsRasterProjector::destExtentSize( const QgsRectangle& theSrcExtent, int theSrcXSize, int theSrcYSize,
     QgsRectangle& theDestExtent, int& theDestXSize, int& theDestYSize )
 {
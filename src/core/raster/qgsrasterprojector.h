@@ -25,6 +25,7 @@
 
 #include <QVector>
 #include <QList>
+#include <QSharedPointer>
 
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
@@ -34,6 +35,7 @@
 #include <cmath>
 
 class QgsPoint;
+struct QgsRasterProjectorMapping;
 
 class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
 {
@@ -124,7 +126,32 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
                             const QgsRectangle& theSrcExtent, int theSrcXSize, int theSrcYSize,
                             QgsRectangle& theDestExtent, int& theDestXSize, int& theDestYSize );
 
+    /** Removes all the cached mappings of destination cells to source cells. The mappings
+     * are shared by all projectors and reused by block() for the same CRS, datum transforms,
+     * precision, destination extent and size and source extent and resolution.
+     * @note added in QGIS 2.16
+     */
+    static void clearMappingCache();
+
   private:
+    friend struct QgsRasterProjectorExactRows;
+
+    /** Returns the mapping for the current destination extent and size, from the cache if possible */
+    QSharedPointer<const QgsRasterProjectorMapping> mapping();
+
+    /** Calculates the mapping for the current destination extent and size */
+    QgsRasterProjectorMapping* calcMapping();
+
+    /** Key of the current mapping in the cache */
+    QString mappingKey() const;
+
+    /** Calculates the source cells of destination rows from startRow to endRow (excluded)
+     * with exact transformation, rows are calculated in parallel */
+    void calcExactRows( int startRow, int endRow, const QgsCoordinateTransform* ct, int* srcIndexes );
+
+    /** Get maximum source resolution and extent from the input if possible */
+    void calcInputLimits();
+
     /** Get source extent */
     QgsRectangle srcExtent() { return mSrcExtent; }
 
@@ -159,6 +186,11 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
     /** \brief Get approximate source row and column indexes for current source extent and resolution */
     inline bool approximateSrcRowCol( int theDestRow, int theDestCol, int *theSrcRow, int *theSrcCol );
 
+    /** \brief Get source row and column indexes of a point in source CRS
+        @return true if inside source
+     */
+    inline bool srcPointRowCol( double theX, double theY, int *theSrcRow, int *theSrcCol ) const;
+
     /** \brief Calculate matrix */
     void calc();
 
@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgssinglebandpseudocolorrenderer.h"
+#include "qgscolorrampshader.h"
 #include "qgsrastershader.h"
 #include "qgsrastertransparency.h"
 #include "qgsrasterviewport.h"
@@ -157,47 +158,88 @@ QgsRasterBlock* QgsSingleBandPseudoColorRenderer::block( int bandNo, QgsRectangl
 
   QRgb myDefaultColor = NODATA_COLOR;
 
-  for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
+  // color ramps shade the whole block at once with a lookup table
+  QgsColorRampShader* rampShader = dynamic_cast<QgsColorRampShader*>( mShader->rasterShaderFunction() );
+  if ( rampShader )
   {
-    if ( inputBlock->isNoData( i ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-    double val = inputBlock->value( i );
-    int red, green, blue, alpha;
-    if ( !mShader->shade( val, &red, &green, &blue, &alpha ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
+    QRgb* colors = reinterpret_cast< QRgb* >( outputBlock->bits() );
+    rampShader->shadeBlock( inputBlock, colors );
 
-    if ( alpha < 255 )
+    // values which cannot be shaded are already transparent, as NODATA_COLOR
+    bool hasNoData = inputBlock->hasNoData();
+    if ( hasNoData || hasTransparency )
     {
-      // Working with premultiplied colors, so multiply values by alpha
-      red *= ( alpha / 255.0 );
-      blue *= ( alpha / 255.0 );
-      green *= ( alpha / 255.0 );
-    }
-
-    if ( !hasTransparency )
-    {
-      outputBlock->setColor( i, qRgba( red, green, blue, alpha ) );
+      for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
+      {
+        if ( hasNoData && inputBlock->isNoData( i ) )
+        {
+          colors[i] = myDefaultColor;
+          continue;
+        }
+
+        if ( !hasTransparency )
+          continue;
+
+        //opacity
+        double currentOpacity = mOpacity;
+        if ( mRasterTransparency )
+        {
+          currentOpacity = mRasterTransparency->alphaValue( inputBlock->value( i ), mOpacity * 255 ) / 255.0;
+        }
+        if ( mAlphaBand > 0 )
+        {
+          currentOpacity *= alphaBlock->value( i ) / 255.0;
+        }
+
+        QRgb c = colors[i];
+        colors[i] = qRgba( currentOpacity * qRed( c ), currentOpacity * qGreen( c ), currentOpacity * qBlue( c ), currentOpacity * qAlpha( c ) );
+      }
     }
-    else
+  }
+  else
+  {
+    for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
     {
-      //opacity
-      double currentOpacity = mOpacity;
-      if ( mRasterTransparency )
+      if ( inputBlock->isNoData( i ) )
       {
-        currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
+        outputBlock->setColor( i, myDefaultColor );
+        continue;
       }
-      if ( mAlphaBand > 0 )
+      double val = inputBlock->value( i );
+      int red, green, blue, alpha;
+      if ( !mShader->shade( val, &red, &green, &blue, &alpha ) )
+      {
+        outputBlock->setColor( i, myDefaultColor );
+        continue;
+      }
+
+      if ( alpha < 255 )
       {
-        currentOpacity *= alphaBlock->value( i ) / 255.0;
+        // Working with premultiplied colors, so multiply values by alpha
+        red *= ( alpha / 255.0 );
+        blue *= ( alpha / 255.0 );
+        green *= ( alpha / 255.0 );
       }
 
-      outputBlock->setColor( i, qRgba( currentOpacity * red, currentOpacity * green, currentOpacity * blue, currentOpacity * alpha ) );
+      if ( !hasTransparency )
+      {
+        outputBlock->setColor( i, qRgba( red, green, blue, alpha ) );
+      }
+      else
+      {
+        //opacity
+        double currentOpacity = mOpacity;
+        if ( mRasterTransparency )
+        {
+          currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
+        }
+        if ( mAlphaBand > 0 )
+        {
+          currentOpacity *= alphaBlock->value( i ) / 255.0;
+        }
+
+        outputBlock->setColor( i, qRgba( currentOpacity * red, currentOpacity * green, currentOpacity * blue, currentOpacity * alpha ) );
+      }
     }
   }
 
@@ -185,6 +185,17 @@ class CORE_EXPORT QgsFeatureRendererV2
      */
     virtual bool renderFeature( QgsFeature& feature, QgsRenderContext& context, int layer = -1, bool selected = false, bool drawVertexMarker = false );
 
+    /**
+     * Called with a block of features before they are rendered with renderFeature(), in the
+     * same order. Renderers may use it to evaluate their expressions for all the features of
+     * the block at once. Features of the block may be skipped by the caller.
+     * Must be called between startRender() and stopRender() calls.
+     * The default implementation does nothing.
+     * @note added in QGIS 2.16
+     * @note not available in Python bindings
+     */
+    virtual void prepareFeatureBlock( const QgsFeatureList& features, QgsRenderContext& context ) { Q_UNUSED( features ); Q_UNUSED( context ); }
+
     //! for debugging
     virtual QString dump() const;
 
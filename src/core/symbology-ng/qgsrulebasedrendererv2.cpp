@@ -534,7 +534,10 @@ void QgsRuleBasedRendererV2::Rule::setNormZLevels( const QMap<int, int>& zLevels
 
 QgsRuleBasedRendererV2::Rule::RenderResult QgsRuleBasedRendererV2::Rule::renderFeature( QgsRuleBasedRendererV2::FeatureToRender& featToRender, QgsRenderContext& context, QgsRuleBasedRendererV2::RenderQueue& renderQueue )
 {
-  if ( !isFilterOK( featToRender.feat, &context ) )
+  bool filterOK = featToRender.blockRow >= 0 && featToRender.blockRow < mBlockFilterResults.count()
+                  ? mBlockFilterResults.at( featToRender.blockRow )
+                  : isFilterOK( featToRender.feat, &context );
+  if ( !filterOK )
     return Filtered;
 
   bool rendered = false;
@@ -642,8 +645,43 @@ QgsRuleBasedRendererV2::RuleList QgsRuleBasedRendererV2::Rule::rulesForFeature(
   return lst;
 }
 
+void QgsRuleBasedRendererV2::Rule::prepareFeatureBlock( const QgsFeatureList& features, const QList<int>& rows, QgsRenderContext& context )
+{
+  mBlockFilterResults.fill( false, features.count() );
+
+  QList<int> matchingRows;
+  if ( !mFilter || mElseRule )
+  {
+    matchingRows = rows;
+  }
+  else if ( !rows.isEmpty() )
+  {
+    QgsFeatureList rowFeatures;
+    rowFeatures.reserve( rows.count() );
+    Q_FOREACH ( int row, rows )
+      rowFeatures << features.at( row );
+
+    QVariantList results = mFilter->evaluateBlock( &context.expressionContext(), rowFeatures );
+    for ( int i = 0; i < rows.count(); ++i )
+    {
+      // same test as in isFilterOK()
+      if ( results.at( i ).toInt() != 0 )
+        matchingRows << rows.at( i );
+    }
+  }
+
+  Q_FOREACH ( int row, matchingRows )
+    mBlockFilterResults[row] = true;
+
+  // children are only evaluated for the features which can reach them
+  Q_FOREACH ( Rule* rule, mActiveChildren )
+    rule->prepareFeatureBlock( features, matchingRows, context );
+}
+
 void QgsRuleBasedRendererV2::Rule::stopRender( QgsRenderContext& context )
 {
+  mBlockFilterResults.clear();
+
   if ( mSymbol )
     mSymbol->stopRender( context );
 
@@ -824,11 +862,13 @@ QgsRuleBasedRendererV2::Rule* QgsRuleBasedRendererV2::Rule::createFromSld( QDomE
 QgsRuleBasedRendererV2::QgsRuleBasedRendererV2( QgsRuleBasedRendererV2::Rule* root )
     : QgsFeatureRendererV2( "RuleRenderer" )
     , mRootRule( root )
+    , mNextBlockRow( 0 )
 {
 }
 
 QgsRuleBasedRendererV2::QgsRuleBasedRendererV2( QgsSymbolV2* defaultSymbol )
     : QgsFeatureRendererV2( "RuleRenderer" )
+    , mNextBlockRow( 0 )
 {
   mRootRule = new Rule( nullptr ); // root has no symbol, no filter etc - just a container
   mRootRule->appendChild( new Rule( defaultSymbol ) );
@@ -856,9 +896,35 @@ bool QgsRuleBasedRendererV2::renderFeature( QgsFeature& feature,
 
   int flags = ( selected ? FeatIsSelected : 0 ) | ( drawVertexMarker ? FeatDrawMarkers : 0 );
   mCurrentFeatures.append( FeatureToRender( feature, flags ) );
+  FeatureToRender& featToRender = mCurrentFeatures.last();
+
+  // use the filter results of the prepared block if the feature is part of it
+  for ( int row = mNextBlockRow; row < mBlockFeatureIds.count(); ++row )
+  {
+    if ( mBlockFeatureIds.at( row ) == feature.id() )
+    {
+      featToRender.blockRow = row;
+      mNextBlockRow = row + 1;
+      break;
+    }
+  }
 
   // check each active rule
-  return mRootRule->renderFeature( mCurrentFeatures.last(), context, mRenderQueue ) == Rule::Rendered;
+  return mRootRule->renderFeature( featToRender, context, mRenderQueue ) == Rule::Rendered;
+}
+
+void QgsRuleBasedRendererV2::prepareFeatureBlock( const QgsFeatureList& features, QgsRenderContext& context )
+{
+  mBlockFeatureIds.resize( features.count() );
+  QList<int> rows;
+  for ( int row = 0; row < features.count(); ++row )
+  {
+    mBlockFeatureIds[row] = features.at( row ).id();
+    rows << row;
+  }
+  mNextBlockRow = 0;
+
+  mRootRule->prepareFeatureBlock( features, rows, context );
 }
 
 
@@ -919,6 +985,8 @@ void QgsRuleBasedRendererV2::stopRender( QgsRenderContext& context )
 
   // clean current features
   mCurrentFeatures.clear();
+  mBlockFeatureIds.clear();
+  mNextBlockRow = 0;
 
   // clean render queue
   mRenderQueue.clear();
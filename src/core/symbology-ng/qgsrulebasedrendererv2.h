@@ -44,9 +44,11 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
       FeatureToRender( QgsFeature& _f, int _flags )
           : feat( _f )
           , flags( _flags )
+          , blockRow( -1 )
       {}
       QgsFeature feat;
       int flags; // selected and/or draw markers
+      int blockRow; // index in the block passed to prepareFeatureBlock() or -1
     };
 
     // rendering job: a feature to be rendered with a particular symbol
@@ -283,6 +285,18 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
          */
         RenderResult renderFeature( FeatureToRender& featToRender, QgsRenderContext& context, RenderQueue& renderQueue );
 
+        /**
+         * Evaluate the filters of this rule and its children for a block of features at once.
+         * The results are used by renderFeature() for features with a block row.
+         *
+         * @param features The block of features
+         * @param rows     The rows of the block which reach this rule, ie which match the parent rules
+         * @param context  The rendering context
+         * @note added in QGIS 2.16
+         * @note not available in python bindings
+         */
+        void prepareFeatureBlock( const QgsFeatureList& features, const QList<int>& rows, QgsRenderContext& context );
+
         //! only tell whether a feature will be rendered without actually rendering it
         bool willRenderFeature( QgsFeature& feat, QgsRenderContext* context = nullptr );
 
@@ -397,6 +411,7 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
         // temporary while rendering
         QSet<int> mSymbolNormZLevels;
         RuleList mActiveChildren;
+        QVector<bool> mBlockFilterResults;
 
       private:
 
@@ -420,6 +435,11 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
 
     virtual bool renderFeature( QgsFeature& feature, QgsRenderContext& context, int layer = -1, bool selected = false, bool drawVertexMarker = false ) override;
 
+    //! Evaluates the filters of all rules for a block of features at once
+    //! @note added in QGIS 2.16
+    //! @note not available in python bindings
+    virtual void prepareFeatureBlock( const QgsFeatureList& features, QgsRenderContext& context ) override;
+
     virtual void startRender( QgsRenderContext& context, const QgsFields& fields ) override;
 
     virtual void stopRender( QgsRenderContext& context ) override;
@@ -512,6 +532,8 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
     // temporary
     RenderQueue mRenderQueue;
     QList<FeatureToRender> mCurrentFeatures;
+    QVector<QgsFeatureId> mBlockFeatureIds;
+    int mNextBlockRow;
 
     QString mFilter;
 };
@@ -34,6 +34,7 @@
 #include "qgsgeometry.h"
 #include "qgsmultipointv2.h"
 #include "qgswkbptr.h"
+#include "qgswkbview.h"
 #include "qgsgeometrycollectionv2.h"
 #include "qgsclipper.h"
 
@@ -169,11 +170,7 @@ QgsConstWkbPtr QgsSymbolV2::_getLineString( QPolygonF& pts, QgsRenderContext& co
     ct->transformPolygon( pts );
   }
 
-  QPointF *ptr = pts.data();
-  for ( int i = 0; i < pts.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( pts );
 
   return wkbPtr;
 }
@@ -199,6 +196,10 @@ QgsConstWkbPtr QgsSymbolV2::_getPolygon( QPolygonF &pts, QList<QPolygonF> &holes
   int skipZM = ( QgsWKBTypes::coordDimensions( wkbType ) - 2 ) * sizeof( double );
   Q_ASSERT( skipZM >= 0 );
 
+  // the rings are transformed together once they are all read
+  QList<QPolygonF> rings;
+  bool hasExterior = false;
+
   for ( unsigned int idx = 0; idx < numRings; idx++ )
   {
     unsigned int nPoints;
@@ -230,19 +231,23 @@ QgsConstWkbPtr QgsSymbolV2::_getPolygon( QPolygonF &pts, QList<QPolygonF> &holes
       QgsClipper::trimPolygon( poly, clipRect );
     }
 
-    //transform the QPolygonF to screen coordinates
-    if ( ct )
-    {
-      ct->transformPolygon( poly );
-    }
+    if ( idx == 0 )
+      hasExterior = true;
+    rings.append( poly );
+  }
 
-    ptr = poly.data();
-    for ( int i = 0; i < poly.size(); ++i, ++ptr )
-    {
-      mtp.transformInPlace( ptr->rx(), ptr->ry() );
-    }
+  //transform the QPolygonF to screen coordinates
+  if ( ct )
+  {
+    ct->transformPolygons( rings );
+  }
 
-    if ( idx == 0 )
+  for ( int i = 0; i < rings.size(); ++i )
+  {
+    QPolygonF& poly = rings[i];
+    mtp.transformInPlace( poly );
+
+    if ( i == 0 && hasExterior )
       pts = poly;
     else
       holes.append( poly );
@@ -710,30 +715,40 @@ bool QgsSymbolV2::hasDataDefinedProperties() const
 void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker, int currentVertexMarkerType, int currentVertexMarkerSize )
 {
   const QgsGeometry* geom = feature.constGeometry();
-  if ( !geom || !geom->geometry() )
+  if ( !geom || geom->isEmpty() )
   {
     return;
   }
 
   const QgsGeometry *segmentizedGeometry = geom;
   bool deleteSegmentizedGeometry = false;
-  context.setGeometry( geom->geometry() );
+
+  // the geometry objects are only built if the wkb cannot be read directly, ie for curved
+  // geometries, otherwise the render context builds it if a symbol layer asks for it
+  QgsWkbView view( geom->asWkb(), geom->wkbSize() );
+  const QgsAbstractGeometryV2* original = view.isValid() ? nullptr : geom->geometry();
+  if ( original )
+    context.setGeometry( original );
+  else
+    context.setFeatureGeometry( geom );
 
   bool tileMapRendering = context.testFlag( QgsRenderContext::RenderMapTile );
 
   //convert curve types to normal point/line/polygon ones
-  if ( QgsWKBTypes::isCurvedType( geom->geometry()->wkbType() ) )
+  if ( original && QgsWKBTypes::isCurvedType( original->wkbType() ) )
   {
-    QgsAbstractGeometryV2 *g = geom->geometry()->segmentize();
+    QgsAbstractGeometryV2 *g = original->segmentize();
     if ( !g )
     {
       return;
     }
     segmentizedGeometry = new QgsGeometry( g );
     deleteSegmentizedGeometry = true;
+    view = QgsWkbView( segmentizedGeometry->asWkb(), segmentizedGeometry->wkbSize() );
   }
 
-  mSymbolRenderContext->setGeometryPartCount( segmentizedGeometry->geometry()->partCount() );
+  QgsWKBTypes::Type wkbType = view.isValid() ? view.wkbType() : segmentizedGeometry->geometry()->wkbType();
+  mSymbolRenderContext->setGeometryPartCount( view.isValid() ? view.partCount() : segmentizedGeometry->geometry()->partCount() );
   mSymbolRenderContext->setGeometryPartNum( 1 );
 
   if ( mSymbolRenderContext->expressionContextScope() )
@@ -747,7 +762,7 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
   // Collection of markers to paint
   QPolygonF markers;
 
-  switch ( QgsWKBTypes::flatType( segmentizedGeometry->geometry()->wkbType() ) )
+  switch ( QgsWKBTypes::flatType( wkbType ) )
   {
     case QgsWKBTypes::Point:
     {
@@ -758,8 +773,8 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
         break;
       }
 
-      const QgsPointV2* point = static_cast< const QgsPointV2* >( segmentizedGeometry->geometry() );
-      _getPoint( pt, context, point );
+      QgsPointV2 point = view.isValid() ? view.point( 0 ) : *static_cast< const QgsPointV2* >( segmentizedGeometry->geometry() );
+      _getPoint( pt, context, &point );
       static_cast<QgsMarkerSymbolV2*>( this )->renderPoint( pt, &feature, context, layer, selected );
 
       if ( context.testFlag( QgsRenderContext::DrawSymbolBounds ) )
@@ -827,20 +842,33 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
         break;
       }
 
-      QgsMultiPointV2* mp = static_cast< QgsMultiPointV2* >( segmentizedGeometry->geometry() );
+      const QgsMultiPointV2* mp = view.isValid() ? nullptr : static_cast< const QgsMultiPointV2* >( segmentizedGeometry->geometry() );
+      int numPoints = mp ? mp->numGeometries() : view.partCount();
 
       if ( drawVertexMarker )
       {
-        markers.reserve( mp->numGeometries() );
+        markers.reserve( numPoints );
       }
 
-      for ( int i = 0; i < mp->numGeometries(); ++i )
+      // all the points are transformed at once
+      QPolygonF points( numPoints );
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        QgsPointV2 point = mp ? *static_cast< const QgsPointV2* >( mp->geometryN( i ) ) : view.part( i ).point( 0 );
+        points[i] = QPointF( point.x(), point.y() );
+      }
+      if ( context.coordinateTransform() )
+      {
+        context.coordinateTransform()->transformPolygon( points );
+      }
+      context.mapToPixel().transformInPlace( points );
+
+      for ( int i = 0; i < numPoints; ++i )
       {
         mSymbolRenderContext->setGeometryPartNum( i + 1 );
         mSymbolRenderContext->expressionContextScope()->setVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_NUM, i + 1 );
 
-        const QgsPointV2* point = static_cast< const QgsPointV2* >( mp->geometryN( i ) );
-        _getPoint( pt, context, point );
+        pt = points.at( i );
         static_cast<QgsMarkerSymbolV2*>( this )->renderPoint( pt, &feature, context, layer, selected );
 
         if ( drawVertexMarker )
@@ -868,7 +896,7 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
       unsigned int num;
       wkbPtr >> num;
 
-      const QgsGeometryCollectionV2* geomCollection = dynamic_cast<const QgsGeometryCollectionV2*>( geom->geometry() );
+      const QgsGeometryCollectionV2* geomCollection = dynamic_cast<const QgsGeometryCollectionV2*>( original );
 
       for ( unsigned int i = 0; i < num && wkbPtr; ++i )
       {
@@ -879,6 +907,10 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
         {
           context.setGeometry( geomCollection->geometryN( i ) );
         }
+        else if ( !original )
+        {
+          context.setFeatureGeometry( geom, i );
+        }
         wkbPtr = _getLineString( pts, context, wkbPtr, !tileMapRendering && clipFeaturesToExtent() );
         static_cast<QgsLineSymbolV2*>( this )->renderPolyline( pts, &feature, context, layer, selected );
 
@@ -915,7 +947,7 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
       QPolygonF pts;
       QList<QPolygonF> holes;
 
-      const QgsGeometryCollectionV2* geomCollection = dynamic_cast<const QgsGeometryCollectionV2*>( geom->geometry() );
+      const QgsGeometryCollectionV2* geomCollection = dynamic_cast<const QgsGeometryCollectionV2*>( original );
 
       for ( unsigned int i = 0; i < num && wkbPtr; ++i )
       {
@@ -926,6 +958,10 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
         {
           context.setGeometry( geomCollection->geometryN( i ) );
         }
+        else if ( !original )
+        {
+          context.setFeatureGeometry( geom, i );
+        }
 
         wkbPtr = _getPolygon( pts, holes, context, wkbPtr, !tileMapRendering && clipFeaturesToExtent() );
         static_cast<QgsFillSymbolV2*>( this )->renderPolygon( pts, ( !holes.isEmpty() ? &holes : nullptr ), &feature, context, layer, selected );
@@ -968,7 +1004,7 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
     default:
       QgsDebugMsg( QString( "feature %1: unsupported wkb type %2/%3 for rendering" )
                    .arg( feature.id() )
-                   .arg( QgsWKBTypes::displayString( geom->geometry()->wkbType() ) )
+                   .arg( QgsWKBTypes::displayString( wkbType ) )
                    .arg( geom->wkbType(), 0, 16 ) );
   }
 
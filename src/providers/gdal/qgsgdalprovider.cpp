@@ -184,6 +184,23 @@ QgsGdalProvider* QgsGdalProvider::clone() const
   return provider;
 }
 
+bool QgsGdalProvider::supportsConcurrentClones() const
+{
+  if ( !mGdalBaseDataset )
+    return false;
+
+  // virtual datasets may reference remote sources
+  if ( strcmp( GDALGetDriverShortName( GDALGetDatasetDriver( mGdalBaseDataset ) ), "VRT" ) == 0 )
+    return false;
+
+  // GDAL virtual file systems (/vsicurl/, /vsizip/, ...) and connection strings are not plain files
+  QString path = FROM8( GDALGetDescription( mGdalBaseDataset ) );
+  if ( path.startsWith( "/vsi" ) )
+    return false;
+
+  return QFileInfo( path ).isFile();
+}
+
 bool QgsGdalProvider::crsFromWkt( const char *wkt )
 {
 
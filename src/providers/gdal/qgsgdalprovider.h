@@ -75,6 +75,11 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
 
     QgsGdalProvider * clone() const override;
 
+    /** Clones open their own dataset, they can read blocks in parallel if the dataset
+     * is a local file. Remote and database datasets are read serially.
+     */
+    bool supportsConcurrentClones() const override;
+
     /** \brief   Renders the layer as an image
      */
     QImage* draw( QgsRectangle  const & viewExtent, int pixelWidth, int pixelHeight ) override;
@@ -32,6 +32,7 @@
 #include <QThread>
 
 #include <climits>
+#include <cstring>
 
 // for htonl
 #ifdef Q_OS_WIN
@@ -1106,6 +1107,19 @@ PGresult *QgsPostgresConn::PQgetResult()
   return ::PQgetResult( mConn );
 }
 
+int QgsPostgresConn::PQgetCopyData( char **buffer, bool async )
+{
+  Q_ASSERT( mConn );
+  if ( async && !::PQconsumeInput( mConn ) )
+    return -2;
+  return ::PQgetCopyData( mConn, buffer, async ? 1 : 0 );
+}
+
+void QgsPostgresConn::PQfreemem( void *ptr )
+{
+  ::PQfreemem( ptr );
+}
+
 PGresult *QgsPostgresConn::PQprepare( const QString& stmtName, const QString& query, int nParams, const Oid *paramTypes )
 {
   return ::PQprepare( mConn, stmtName.toUtf8(), query.toUtf8(), nParams, paramTypes );
@@ -1197,10 +1211,14 @@ bool QgsPostgresConn::rollback()
 }
 
 qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, int col )
+{
+  return getBinaryInt( PQgetvalue( queryResult.result(), row, col ), PQgetlength( queryResult.result(), row, col ) );
+}
+
+qint64 QgsPostgresConn::getBinaryInt( const char *p, int size )
 {
   quint64 oid;
-  char *p = PQgetvalue( queryResult.result(), row, col );
-  size_t s = PQgetlength( queryResult.result(), row, col );
+  size_t s = size;
 
 #ifdef QGISDEBUG
   if ( QgsLogger::debugLevel() >= 4 )
@@ -1280,6 +1298,51 @@ qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, i
   return oid;
 }
 
+double QgsPostgresConn::getBinaryDouble( const char *p, int size )
+{
+  if ( size == 4 )
+  {
+    quint32 bits = *( quint32 * ) p;
+    if ( mSwapEndian )
+      bits = ntohl( bits );
+
+    float value;
+    memcpy( &value, &bits, sizeof( value ) );
+    return value;
+  }
+
+  if ( size != 8 )
+  {
+    QgsDebugMsg( QString( "unexpected size %1" ).arg( size ) );
+    return 0.0;
+  }
+
+  quint32 bits0 = *( quint32 * ) p;
+  quint32 bits1 = *( quint32 * )( p + sizeof( quint32 ) );
+  if ( mSwapEndian )
+  {
+    bits0 = ntohl( bits0 );
+    bits1 = ntohl( bits1 );
+  }
+
+  quint64 bits = bits0;
+  bits <<= 32;
+  bits |= bits1;
+
+  double value;
+  memcpy( &value, &bits, sizeof( value ) );
+  return value;
+}
+
+bool QgsPostgresConn::isBinaryField( const QgsField &fld )
+{
+  // float4 is left to the text output, which rounds to its precision
+  const QString &type = fld.typeName();
+  return ( fld.type() == QVariant::Int && ( type == "int2" || type == "int4" ) ) ||
+         ( fld.type() == QVariant::LongLong && type == "int8" ) ||
+         ( fld.type() == QVariant::Double && type == "float8" );
+}
+
 QString QgsPostgresConn::fieldExpression( const QgsField &fld, QString expr )
 {
   const QString &type = fld.typeName();
@@ -249,6 +249,10 @@ class QgsPostgresConn : public QObject
     int PQsendQuery( const QString& query );
     int PQstatus();
     PGresult *PQgetResult();
+    /** Reads a row of a COPY TO STDOUT. Without waiting for the server if async is true
+     * (0 is then returned if no complete row was received yet).*/
+    int PQgetCopyData( char **buffer, bool async = false );
+    static void PQfreemem( void *ptr );
     PGresult *PQprepare( const QString& stmtName, const QString& query, int nParams, const Oid *paramTypes );
     PGresult *PQexecPrepared( const QString& stmtName, const QStringList &params );
 
@@ -305,6 +309,18 @@ class QgsPostgresConn : public QObject
 
     qint64 getBinaryInt( QgsPostgresResult &queryResult, int row, int col );
 
+    //! decode a binary integer of size bytes, as returned by binary cursors and binary COPY
+    qint64 getBinaryInt( const char *p, int size );
+
+    //! decode a binary float4 or float8 of size bytes
+    double getBinaryDouble( const char *p, int size );
+
+    /** Returns true if values of the field are fetched without conversion to text,
+     * ie the column can be selected as is in binary cursors and decoded with
+     * getBinaryInt() or getBinaryDouble().
+     */
+    static bool isBinaryField( const QgsField &fld );
+
     QString fieldExpression( const QgsField &fld, QString expr = "%1" );
 
     QString connInfo() const { return mConnInfo; }
@@ -24,13 +24,25 @@
 
 #include <QObject>
 #include <QSettings>
+#include <QTime>
+#include <QtEndian>
 
 
 const int QgsPostgresFeatureIterator::sFeatureQueueSize = 2000;
+const int QgsPostgresFeatureIterator::sMinFeatureQueueSize = 100;
+const int QgsPostgresFeatureIterator::sMaxFeatureQueueSize = 50000;
+const int QgsPostgresFeatureIterator::sFetchTime = 250;
+const int QgsPostgresFeatureIterator::sFetchBytes = 32 * 1024 * 1024;
+
+//! signature starting the header of binary COPY streams
+static const char sCopySignature[] = "PGCOPY\n\377\r\n";
+static const int sCopySignatureSize = 11;
 
 
 QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource<QgsPostgresFeatureSource>( source, ownSource, request )
+    , mCopyActive( false )
+    , mCopyHeaderRead( false )
     , mFeatureQueueSize( sFeatureQueueSize )
     , mFetched( 0 )
     , mFetchGeometry( false )
@@ -225,60 +237,251 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature& feature )
 
   if ( mFeatureQueue.empty() && !mLastFetch )
   {
-    QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
-    QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
+    if ( mCopyQuery.isEmpty() )
+      fetchFromCursor();
+    else
+      fetchFromCopy();
+  }
+
+  if ( mFeatureQueue.empty() )
+  {
+    QgsDebugMsg( QString( "Finished after %1 features" ).arg( mFetched ) );
+    close();
+
+    mSource->mShared->ensureFeaturesCountedAtLeast( mFetched );
+
+    return false;
+  }
+
+  feature = mFeatureQueue.dequeue();
+  mFetched++;
+
+  feature.setValid( true );
+  feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+
+  return true;
+}
+
+void QgsPostgresFeatureIterator::fetchFromCursor()
+{
+  QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
+  QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
+
+  QTime time;
+  time.start();
+
+  lock();
+  if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+  }
+
+  int fetched = 0;
+  qint64 bytes = 0;
+  Row row;
+  QgsPostgresResult queryResult;
+  for ( ;; )
+  {
+    queryResult = mConn->PQgetResult();
+    if ( !queryResult.result() )
+      break;
 
-    lock();
-    if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+    if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
     {
       QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+      break;
     }
 
-    QgsPostgresResult queryResult;
-    for ( ;; )
+    int rows = queryResult.PQntuples();
+    if ( rows == 0 )
+      continue;
+
+    mLastFetch = rows < mFeatureQueueSize;
+
+    PGresult *res = queryResult.result();
+    int columns = queryResult.PQnfields();
+    row.values.resize( columns );
+    row.lengths.resize( columns );
+
+    for ( int r = 0; r < rows; r++ )
     {
-      queryResult = mConn->PQgetResult();
-      if ( !queryResult.result() )
-        break;
+      for ( int col = 0; col < columns; col++ )
+      {
+        bool isNull = ::PQgetisnull( res, r, col );
+        row.values[col] = isNull ? nullptr : ::PQgetvalue( res, r, col );
+        row.lengths[col] = isNull ? 0 : ::PQgetlength( res, r, col );
+        bytes += row.lengths.at( col );
+      }
+
+      mFeatureQueue.enqueue( QgsFeature() );
+      getFeature( row, mFeatureQueue.back() );
+    } // for each row in queue
 
-      if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
+    fetched += rows;
+  }
+  unlock();
+
+  adjustFeatureQueueSize( fetched, time.elapsed(), bytes );
+}
+
+void QgsPostgresFeatureIterator::fetchFromCopy()
+{
+  QTime time;
+  time.start();
+
+  int fetched = 0;
+  qint64 bytes = 0;
+  Row row;
+  while ( mCopyActive && fetched < mFeatureQueueSize )
+  {
+    char *buffer = nullptr;
+    int size = mConn->PQgetCopyData( &buffer );
+    if ( size < 0 )
+    {
+      // -1 at the end of the stream, -2 on errors
+      QgsPostgresResult res( mConn->PQgetResult() );
+      if ( size == -2 || res.PQresultStatus() != PGRES_COMMAND_OK )
       {
-        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-        break;
+        QgsMessageLog::logMessage( QObject::tr( "Streaming features failed\nDatabase error: %1" ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
       }
+      while ( res.result() )
+        res = mConn->PQgetResult();
 
-      int rows = queryResult.PQntuples();
-      if ( rows == 0 )
-        continue;
+      mCopyActive = false;
+      break;
+    }
 
-      mLastFetch = rows < mFeatureQueueSize;
+    const char *p = buffer;
+    const char *end = buffer + size;
+    bool valid = true;
 
-      for ( int row = 0; row < rows; row++ )
+    if ( !mCopyHeaderRead )
+    {
+      // signature, flags and header extension precede the first tuple
+      valid = size >= sCopySignatureSize + 8 && memcmp( p, sCopySignature, sCopySignatureSize ) == 0;
+      if ( valid )
+      {
+        p += sCopySignatureSize + 4;
+        qint32 extension = qFromBigEndian<qint32>( reinterpret_cast<const uchar *>( p ) );
+        p += 4;
+        valid = extension >= 0 && extension <= end - p;
+        p += extension;
+      }
+      mCopyHeaderRead = true;
+    }
+
+    // each tuple starts with its number of fields, -1 for the trailer
+    qint16 columns = -1;
+    if ( valid && end - p >= 2 )
+    {
+      columns = qFromBigEndian<qint16>( reinterpret_cast<const uchar *>( p ) );
+      p += 2;
+    }
+
+    if ( valid && columns >= 0 )
+    {
+      row.values.resize( columns );
+      row.lengths.resize( columns );
+      for ( int col = 0; valid && col < columns; col++ )
+      {
+        valid = end - p >= 4;
+        if ( !valid )
+          break;
+
+        qint32 length = qFromBigEndian<qint32>( reinterpret_cast<const uchar *>( p ) );
+        p += 4;
+        valid = length <= end - p;
+        row.values[col] = length < 0 ? nullptr : p;
+        row.lengths[col] = qMax( length, 0 );
+        p += row.lengths.at( col );
+      }
+
+      if ( valid )
       {
         mFeatureQueue.enqueue( QgsFeature() );
-        getFeature( queryResult, row, mFeatureQueue.back() );
-      } // for each row in queue
+        getFeature( row, mFeatureQueue.back() );
+        bytes += size;
+        fetched++;
+      }
+    }
+
+    mConn->PQfreemem( buffer );
+
+    if ( !valid )
+    {
+      QgsMessageLog::logMessage( QObject::tr( "Streaming features failed\nInvalid data received" ), QObject::tr( "PostGIS" ) );
+      endCopy();
     }
-    unlock();
   }
 
-  if ( mFeatureQueue.empty() )
-  {
-    QgsDebugMsg( QString( "Finished after %1 features" ).arg( mFetched ) );
-    close();
+  mLastFetch = !mCopyActive;
 
-    mSource->mShared->ensureFeaturesCountedAtLeast( mFetched );
+  adjustFeatureQueueSize( fetched, time.elapsed(), bytes );
+}
 
+bool QgsPostgresFeatureIterator::startCopy()
+{
+  mCopyHeaderRead = false;
+
+  if ( mConn->PQsendQuery( mCopyQuery ) == 0 )
     return false;
+
+  QgsPostgresResult res( mConn->PQgetResult() );
+  mCopyActive = res.PQresultStatus() == PGRES_COPY_OUT;
+  if ( !mCopyActive )
+  {
+    QgsDebugMsg( QString( "Streaming with %1 failed: %2" ).arg( mCopyQuery, res.PQresultErrorMessage() ) );
+    while ( res.result() )
+      res = mConn->PQgetResult();
   }
 
-  feature = mFeatureQueue.dequeue();
-  mFetched++;
+  return mCopyActive;
+}
 
-  feature.setValid( true );
-  feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+void QgsPostgresFeatureIterator::endCopy()
+{
+  if ( !mCopyActive )
+    return;
 
-  return true;
+  // skip the rows already received: the server may have sent the whole result
+  char *buffer = nullptr;
+  int size;
+  while ( ( size = mConn->PQgetCopyData( &buffer, true ) ) > 0 )
+    mConn->PQfreemem( buffer );
+
+  if ( size == 0 )
+  {
+    // the COPY is still running: stop the server and skip the rows sent meanwhile, so that
+    // the connection can be reused. PQcancel() only returns once the server got the request,
+    // which is ignored if the COPY completed meanwhile: it can not hit a later query.
+    mConn->cancel();
+    while ( mConn->PQgetCopyData( &buffer ) >= 0 )
+      mConn->PQfreemem( buffer );
+  }
+
+  QgsPostgresResult res( mConn->PQgetResult() );
+  while ( res.result() )
+    res = mConn->PQgetResult();
+
+  mCopyActive = false;
+}
+
+void QgsPostgresFeatureIterator::adjustFeatureQueueSize( int rows, int elapsed, qint64 bytes )
+{
+  // only complete batches tell something about the throughput
+  if ( rows < mFeatureQueueSize )
+    return;
+
+  qint64 size = elapsed > 0 ? qint64( rows ) * sFetchTime / elapsed : qint64( rows ) * 2;
+  if ( bytes > 0 )
+    size = qMin( size, qint64( rows ) * sFetchBytes / bytes );
+  size = qMin( size, qint64( sMaxFeatureQueueSize ) );
+
+  // change gradually, a single slow fetch should not collapse the batch size
+  mFeatureQueueSize = qBound( qMax( sMinFeatureQueueSize, mFeatureQueueSize / 2 ),
+                              static_cast<int>( size ),
+                              qMin( sMaxFeatureQueueSize, mFeatureQueueSize * 2 ) );
+  QgsDebugMsgLevel( QString( "next fetch: %1 features" ).arg( mFeatureQueueSize ), 4 );
 }
 
 bool QgsPostgresFeatureIterator::nextFeatureFilterExpression( QgsFeature& f )
@@ -339,14 +542,23 @@ bool QgsPostgresFeatureIterator::rewind()
   if ( mClosed )
     return false;
 
+  mFeatureQueue.clear();
+  mFetched = 0;
+  mLastFetch = false;
+
+  if ( !mCopyQuery.isEmpty() )
+  {
+    // streams cannot be rewound, restart it
+    endCopy();
+    mLastFetch = !startCopy();
+    return !mLastFetch;
+  }
+
   // move cursor to first record
 
   lock();
   mConn->PQexecNR( QString( "move absolute 0 in %1" ).arg( mCursorName ) );
   unlock();
-  mFeatureQueue.clear();
-  mFetched = 0;
-  mLastFetch = false;
 
   return true;
 }
@@ -357,7 +569,10 @@ bool QgsPostgresFeatureIterator::close()
     return false;
 
   lock();
-  mConn->closeCursor( mCursorName );
+  if ( mCopyQuery.isEmpty() )
+    mConn->closeCursor( mCursorName );
+  else
+    endCopy();
   unlock();
 
   if ( !mIsTransactionConnection )
@@ -594,13 +809,24 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause, long
       return false;
   }
 
+  // numeric columns are decoded from their binary representation, others are converted to text
+  mBinaryAttributes.fill( false, mSource->mFields.count() );
   bool subsetOfAttributes = mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes;
   Q_FOREACH ( int idx, subsetOfAttributes ? mRequest.subsetOfAttributes() : mSource->mFields.allAttributesList() )
   {
     if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
       continue;
 
-    query += delim + mConn->fieldExpression( mSource->mFields.at( idx ) );
+    const QgsField &fld = mSource->mFields.at( idx );
+    if ( QgsPostgresConn::isBinaryField( fld ) )
+    {
+      query += delim + QgsPostgresConn::quotedIdentifier( fld.name() );
+      mBinaryAttributes[idx] = true;
+    }
+    else
+    {
+      query += delim + mConn->fieldExpression( fld );
+    }
   }
 
   query += " FROM " + mSource->mQuery;
@@ -614,6 +840,26 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause, long
   if ( !orderBy.isEmpty() )
     query += QString( " ORDER BY %1 " ).arg( orderBy );
 
+  mLastFetch = false;
+
+  // full scans on a connection of our own are streamed with COPY, which avoids the
+  // round trips of the cursor fetches (binary COPY needs PostgreSQL 9.0)
+  mCopyQuery.clear();
+  if ( !mIsTransactionConnection && limit < 0 && mRequest.limit() < 0 &&
+       mRequest.filterRect().isNull() &&
+       mRequest.filterType() != QgsFeatureRequest::FilterFid &&
+       mRequest.filterType() != QgsFeatureRequest::FilterFids &&
+       mConn->pgVersion() >= 90000 &&
+       QSettings().value( "/PostgreSQL/streamWithCopy", true ).toBool() )
+  {
+    mCopyQuery = QString( "COPY (%1) TO STDOUT (FORMAT binary)" ).arg( query );
+    if ( startCopy() )
+      return true;
+
+    // try again with a cursor
+    mCopyQuery.clear();
+  }
+
   lock();
   if ( !mConn->openCursor( mCursorName, query ) )
   {
@@ -626,12 +872,17 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause, long
   }
   unlock();
 
-  mLastFetch = false;
   return true;
 }
 
 
-bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int row, QgsFeature &feature )
+QString QgsPostgresFeatureIterator::textValue( const Row &row, int col )
+{
+  const char *value = row.values.at( col );
+  return value ? QString::fromUtf8( value, row.lengths.at( col ) ) : QString::null;
+}
+
+bool QgsPostgresFeatureIterator::getFeature( const Row &row, QgsFeature &feature )
 {
   feature.initAttributes( mSource->mFields.count() );
 
@@ -639,11 +890,11 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
 
   if ( mFetchGeometry )
   {
-    int returnedLength = ::PQgetlength( queryResult.result(), row, col );
+    int returnedLength = row.lengths.at( col );
     if ( returnedLength > 0 )
     {
       unsigned char *featureGeom = new unsigned char[returnedLength + 1];
-      memcpy( featureGeom, PQgetvalue( queryResult.result(), row, col ), returnedLength );
+      memcpy( featureGeom, row.values.at( col ), returnedLength );
       memset( featureGeom + returnedLength, 0, 1 );
 
       unsigned int wkbType;
@@ -708,7 +959,8 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
     case pktOid:
     case pktTid:
     case pktInt:
-      fid = mConn->getBinaryInt( queryResult, row, col++ );
+      fid = mConn->getBinaryInt( row.values.at( col ), row.lengths.at( col ) );
+      col++;
       if ( mSource->mPrimaryKeyType == pktInt &&
            ( !subsetOfAttributes || fetchAttributes.contains( mSource->mPrimaryKeyAttrs.at( 0 ) ) ) )
         feature.setAttribute( mSource->mPrimaryKeyAttrs[0], fid );
@@ -722,7 +974,7 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
       {
         const QgsField &fld = mSource->mFields.at( idx );
 
-        QVariant v = QgsPostgresProvider::convertValue( fld.type(), queryResult.PQgetvalue( row, col ) );
+        QVariant v = QgsPostgresProvider::convertValue( fld.type(), textValue( row, col ) );
         primaryKeyVals << v;
 
         if ( !subsetOfAttributes || fetchAttributes.contains( idx ) )
@@ -748,23 +1000,41 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
   if ( subsetOfAttributes )
   {
     Q_FOREACH ( int idx, fetchAttributes )
-      getFeatureAttribute( idx, queryResult, row, col, feature );
+      getFeatureAttribute( idx, row, col, feature );
   }
   else
   {
     for ( int idx = 0; idx < mSource->mFields.count(); ++idx )
-      getFeatureAttribute( idx, queryResult, row, col, feature );
+      getFeatureAttribute( idx, row, col, feature );
   }
 
   return true;
 }
 
-void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult& queryResult, int row, int& col, QgsFeature& feature )
+void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, const Row &row, int& col, QgsFeature& feature )
 {
   if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
     return;
 
-  QVariant v = QgsPostgresProvider::convertValue( mSource->mFields.at( idx ).type(), queryResult.PQgetvalue( row, col ) );
+  QVariant::Type type = mSource->mFields.at( idx ).type();
+  const char *value = row.values.at( col );
+  QVariant v;
+  if ( !value || !mBinaryAttributes.at( idx ) )
+  {
+    v = QgsPostgresProvider::convertValue( type, textValue( row, col ) );
+  }
+  else if ( type == QVariant::Double )
+  {
+    v = QVariant( mConn->getBinaryDouble( value, row.lengths.at( col ) ) );
+  }
+  else if ( type == QVariant::LongLong )
+  {
+    v = QVariant( mConn->getBinaryInt( value, row.lengths.at( col ) ) );
+  }
+  else
+  {
+    v = QVariant( static_cast<int>( mConn->getBinaryInt( value, row.lengths.at( col ) ) ) );
+  }
   feature.setAttribute( idx, v );
 
   col++;
@@ -18,6 +18,7 @@
 #include "qgsfeatureiterator.h"
 
 #include <QQueue>
+#include <QVector>
 
 #include "qgspostgresprovider.h"
 
@@ -94,20 +95,59 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
     QgsPostgresConn* mConn;
 
 
+    /** Binary values of the columns of a fetched row, pointing into a cursor result
+     * or a COPY buffer
+     */
+    struct Row
+    {
+      QVector<const char *> values; //!< nullptr for NULL values
+      QVector<int> lengths;
+    };
+
+    //! text value of a column, null for NULL values
+    static QString textValue( const Row &row, int col );
+
     QString whereClauseRect();
-    bool getFeature( QgsPostgresResult &queryResult, int row, QgsFeature &feature );
-    void getFeatureAttribute( int idx, QgsPostgresResult& queryResult, int row, int& col, QgsFeature& feature );
+    bool getFeature( const Row &row, QgsFeature &feature );
+    void getFeatureAttribute( int idx, const Row &row, int& col, QgsFeature& feature );
     bool declareCursor( const QString& whereClause, long limit = -1, bool closeOnFail = true , const QString& orderBy = QString() );
 
+    //! fetch the next batch of features from the cursor into the queue
+    void fetchFromCursor();
+
+    //! read the next batch of rows of the COPY stream into the queue
+    void fetchFromCopy();
+
+    //! start streaming the rows of mCopyQuery
+    bool startCopy();
+
+    //! stop streaming, discarding the remaining rows
+    void endCopy();
+
+    //! scale the batch size so that fetches take about sFetchTime ms and sFetchBytes bytes
+    void adjustFeatureQueueSize( int rows, int elapsed, qint64 bytes );
+
     QString mCursorName;
 
+    //! COPY statement streaming the features, empty if features are fetched from the cursor
+    QString mCopyQuery;
+
+    //! whether the COPY stream is active
+    bool mCopyActive;
+
+    //! whether the header of the COPY stream was read
+    bool mCopyHeaderRead;
+
+    //! attributes selected without text conversion, see QgsPostgresConn::isBinaryField()
+    QVector<bool> mBinaryAttributes;
+
     /**
      * Feature queue that GetNextFeature will retrieve from
      * before the next fetch from PostgreSQL
      */
     QQueue<QgsFeature> mFeatureQueue;
 
-    //! Maximal size of the feature queue
+    //! Number of features to fetch at once, adjusted to the fetch times and row sizes
     int mFeatureQueueSize;
 
     //! Number of retrieved features
@@ -118,7 +158,16 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
 
     bool mIsTransactionConnection;
 
+    //! Initial number of features to fetch at once
     static const int sFeatureQueueSize;
+    static const int sMinFeatureQueueSize;
+    static const int sMaxFeatureQueueSize;
+
+    //! Targeted duration of a fetch in milliseconds
+    static const int sFetchTime;
+
+    //! Targeted size of a fetch in bytes
+    static const int sFetchBytes;
 
   private:
     //! returns whether the iterator supports simplify geometries on provider side
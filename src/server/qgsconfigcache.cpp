@@ -25,6 +25,7 @@
 #include "qgsaccesscontrol.h"
 
 #include <QFile>
+#include <QFileInfo>
 
 QgsConfigCache* QgsConfigCache::instance()
 {
@@ -157,6 +158,19 @@ QgsWMSConfigParser *QgsConfigCache::wmsConfiguration(
   return p;
 }
 
+QString QgsConfigCache::fileVersion( const QString& filePath ) const
+{
+  QHash<QString, QString>::const_iterator it = mFileVersions.constFind( filePath );
+  return it != mFileVersions.constEnd() ? it.value() : currentFileVersion( filePath );
+}
+
+QString QgsConfigCache::currentFileVersion( const QString& filePath )
+{
+  //the size catches changes within the resolution of the modification time
+  QFileInfo fileInfo( filePath );
+  return QString::number( fileInfo.lastModified().toMSecsSinceEpoch() ) + '-' + QString::number( fileInfo.size() );
+}
+
 QDomDocument* QgsConfigCache::xmlDocument( const QString& filePath )
 {
   //first open file
@@ -178,6 +192,7 @@ QDomDocument* QgsConfigCache::xmlDocument( const QString& filePath )
   if ( !xmlDoc )
   {
     //then create xml document
+    QString version = currentFileVersion( filePath );
     xmlDoc = new QDomDocument();
     QString errorMsg;
     int line, column;
@@ -189,6 +204,7 @@ QDomDocument* QgsConfigCache::xmlDocument( const QString& filePath )
       return nullptr;
     }
     mXmlDocumentCache.insert( filePath, xmlDoc );
+    mFileVersions.insert( filePath, version );
     mFileSystemWatcher.addPath( filePath );
     xmlDoc = mXmlDocumentCache.object( filePath );
     Q_ASSERT( xmlDoc );
@@ -204,6 +220,9 @@ void QgsConfigCache::removeChangedEntry( const QString& path )
 
   //xml document must be removed last, as other config cache destructors may require it
   mXmlDocumentCache.remove( path );
+  mFileVersions.remove( path );
 
   mFileSystemWatcher.removePath( path );
+
+  emit projectFileChanged( path );
 }
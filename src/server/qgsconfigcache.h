@@ -22,6 +22,7 @@
 
 #include <QCache>
 #include <QFileSystemWatcher>
+#include <QHash>
 #include <QMap>
 #include <QObject>
 
@@ -61,6 +62,21 @@ class SERVER_EXPORT QgsConfigCache : public QObject
       , const QMap<QString, QString>& parameterMap = ( QMap< QString, QString >() )
     );
 
+    /** Returns an identifier of the version of the file the cached configuration was read
+     * from (its modification time and size), or of the current file if it is not cached.
+     * It stays the same until the changed file is removed from the cache, so it
+     * identifies the project version the configuration was read from.
+     * @note added in QGIS 2.16
+     */
+    QString fileVersion( const QString& filePath ) const;
+
+  signals:
+    /** Emitted when a cached project or SLD file has changed and its configuration was removed
+     * from the cache, so that other caches can drop their entries for the file
+     * @note added in QGIS 2.16
+     */
+    void projectFileChanged( const QString& path );
+
   private:
     QgsConfigCache();
 
@@ -75,6 +91,12 @@ class SERVER_EXPORT QgsConfigCache : public QObject
     QCache<QString, QgsWFSProjectParser> mWFSConfigCache;
     QCache<QString, QgsWCSProjectParser> mWCSConfigCache;
 
+    /** Versions of the files of the cached xml documents, see fileVersion()*/
+    QHash<QString, QString> mFileVersions;
+
+    /** Returns the modification time and size of a file*/
+    static QString currentFileVersion( const QString& filePath );
+
   private slots:
     /** Removes changed entry from this cache*/
     void removeChangedEntry( const QString& path );
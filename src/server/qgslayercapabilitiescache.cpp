@@ -0,0 +1,72 @@
+/***************************************************************************
+                              qgslayercapabilitiescache.cpp
+                              -----------------------------
+  begin                : May 2016
+  copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslayercapabilitiescache.h"
+
+#include <QMutexLocker>
+
+#include <stdlib.h>
+
+QgsLayerCapabilitiesCache* QgsLayerCapabilitiesCache::instance()
+{
+  static QgsLayerCapabilitiesCache *instance = nullptr;
+
+  if ( !instance )
+    instance = new QgsLayerCapabilitiesCache();
+
+  return instance;
+}
+
+QgsLayerCapabilitiesCache::QgsLayerCapabilitiesCache()
+{
+  int maxLayers = 4000;
+  char* sizeEnv = getenv( "QGIS_SERVER_CAPABILITIES_LAYER_CACHE_SIZE" );
+  if ( sizeEnv )
+  {
+    bool conversionOk = false;
+    int sizeInt = QString( sizeEnv ).toInt( &conversionOk );
+    if ( conversionOk && sizeInt >= 0 )
+    {
+      maxLayers = sizeInt;
+    }
+  }
+  mLayerElements.setMaxCost( maxLayers );
+}
+
+QgsLayerCapabilitiesCache::~QgsLayerCapabilitiesCache()
+{
+}
+
+QDomElement QgsLayerCapabilitiesCache::layerElement( const QString& key, QDomDocument& doc )
+{
+  QMutexLocker locker( &mMutex );
+
+  QDomDocument* layerDoc = mLayerElements.object( key );
+  if ( !layerDoc )
+  {
+    return QDomElement();
+  }
+  return doc.importNode( layerDoc->documentElement(), true ).toElement();
+}
+
+void QgsLayerCapabilitiesCache::insertLayerElement( const QString& key, const QDomElement& layerElem )
+{
+  QMutexLocker locker( &mMutex );
+
+  QDomDocument* layerDoc = new QDomDocument();
+  layerDoc->appendChild( layerDoc->importNode( layerElem, true ) );
+  mLayerElements.insert( key, layerDoc, 1 );
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+                              qgslayercapabilitiescache.h
+                              ---------------------------
+  begin                : May 2016
+  copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLAYERCAPABILITIESCACHE_H
+#define QGSLAYERCAPABILITIESCACHE_H
+
+#include <QCache>
+#include <QDomDocument>
+#include <QMutex>
+#include <QString>
+
+/** A singleton cache for the <Layer> elements of WMS capabilities documents.
+ *
+ * QgsCapabilitiesCache holds whole documents and drops them when the project file changes.
+ * The elements of the individual layers are kept here across project reloads: their key
+ * contains a hash of everything they are computed from (the layer definition and the
+ * properties of the project, the modification time of file based data sources, the WMS
+ * version and the access control cache key), so after a change only the capabilities of the
+ * modified layers are computed again. Outdated entries are never hit and expire with the
+ * least recently used ones.
+ *
+ * QGIS_SERVER_CAPABILITIES_LAYER_CACHE_SIZE sets the maximum number of cached layer
+ * elements (default 4000).
+ */
+class QgsLayerCapabilitiesCache
+{
+  public:
+    static QgsLayerCapabilitiesCache* instance();
+    ~QgsLayerCapabilitiesCache();
+
+    /** Returns a copy of a cached layer element created in doc, or a null element
+      @param key key of the layer element (see QgsWMSProjectParser)
+      @param doc the capabilities document the element is imported into*/
+    QDomElement layerElement( const QString& key, QDomDocument& doc );
+
+    /** Inserts a copy of a layer element into the cache
+      @param key key of the layer element (see QgsWMSProjectParser)
+      @param layerElem the <Layer> element*/
+    void insertLayerElement( const QString& key, const QDomElement& layerElem );
+
+  private:
+    /** Private singleton constructor*/
+    QgsLayerCapabilitiesCache();
+
+    QMutex mMutex;
+    /** Layer elements, each one in its own document*/
+    QCache<QString, QDomDocument> mLayerElements;
+};
+
+#endif // QGSLAYERCAPABILITIESCACHE_H
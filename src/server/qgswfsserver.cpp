@@ -65,6 +65,9 @@ static const QString GML_NAMESPACE = "http://www.opengis.net/gml";
 static const QString OGC_NAMESPACE = "http://www.opengis.net/ogc";
 static const QString QGS_NAMESPACE = "http://www.qgis.org/gml";
 
+//! GetFeature output is sent to the request handler by chunks of this size
+static const int GET_FEATURE_CHUNK_SIZE = 64 * 1024;
+
 QgsWFSServer::QgsWFSServer(
   const QString& configFilePath
   , QMap<QString, QString> &parameters
@@ -1186,6 +1189,10 @@ int QgsWFSServer::getFeature( QgsRequestHandler& request, const QString& format
 
 void QgsWFSServer::startGetFeature( QgsRequestHandler& request, const QString& format, int prec, QgsCoordinateReferenceSystem& crs, QgsRectangle* rect )
 {
+  flushGetFeature( request );
+  //keeps its capacity when the chunks are sent
+  mGetFeatureBuffer.reserve( GET_FEATURE_CHUNK_SIZE + 4096 );
+
   QByteArray result;
   QString fcString;
   if ( format == "GeoJSON" )
@@ -1323,44 +1330,43 @@ void QgsWFSServer::setGetFeature( QgsRequestHandler& request, const QString& for
   if ( !feat->isValid() )
     return;
 
-  QByteArray result;
   if ( format == "GeoJSON" )
   {
-    QString fcString;
     if ( featIdx == 0 )
-      fcString += "  ";
+      mGetFeatureBuffer += "  ";
     else
-      fcString += " ,";
-    fcString += createFeatureGeoJSON( feat, prec, crs, attrIndexes, excludedAttributes );
-    fcString += "\n";
-
-    result = fcString.toUtf8();
-    request.setGetFeatureResponse( &result );
-    fcString = "";
+      mGetFeatureBuffer += " ,";
+    writeFeatureGeoJSON( mGetFeatureBuffer, feat, prec, crs, attrIndexes, excludedAttributes );
+    mGetFeatureBuffer += "\n";
+  }
+  else if ( format == "GML3" )
+  {
+    writeFeatureGML( mGetFeatureBuffer, feat, true, prec, crs, attrIndexes, excludedAttributes );
   }
   else
   {
-    QDomDocument gmlDoc;
-    QDomElement featureElement;
-    if ( format == "GML3" )
-    {
-      featureElement = createFeatureGML3( feat, gmlDoc, prec, crs, attrIndexes, excludedAttributes );
-      gmlDoc.appendChild( featureElement );
-    }
-    else
-    {
-      featureElement = createFeatureGML2( feat, gmlDoc, prec, crs, attrIndexes, excludedAttributes );
-      gmlDoc.appendChild( featureElement );
-    }
+    writeFeatureGML( mGetFeatureBuffer, feat, false, prec, crs, attrIndexes, excludedAttributes );
+  }
 
-    result = gmlDoc.toByteArray();
-    request.setGetFeatureResponse( &result );
-    gmlDoc.removeChild( featureElement );
+  if ( mGetFeatureBuffer.size() >= GET_FEATURE_CHUNK_SIZE )
+  {
+    flushGetFeature( request );
   }
 }
 
+void QgsWFSServer::flushGetFeature( QgsRequestHandler& request )
+{
+  if ( mGetFeatureBuffer.isEmpty() )
+    return;
+
+  request.setGetFeatureResponse( &mGetFeatureBuffer );
+  mGetFeatureBuffer.resize( 0 );
+}
+
 void QgsWFSServer::endGetFeature( QgsRequestHandler& request, const QString& format )
 {
+  flushGetFeature( request );
+
   QByteArray result;
   QString fcString;
   if ( format == "GeoJSON" )
@@ -1855,41 +1861,138 @@ QgsFeatureIds QgsWFSServer::getFeatureIdsFromFilter( const QDomElement& filterEl
   return fids;
 }
 
-QString QgsWFSServer::createFeatureGeoJSON( QgsFeature* feat, int prec, QgsCoordinateReferenceSystem &, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/
+/** Escapes a text or an attribute value the way QDomDocument does when it is saved: quotes and
+  whitespace are only escaped in attribute values, carriage returns in both*/
+static QByteArray xmlEscaped( const QString& text, bool attribute = false )
 {
-  QString fStr = "{\"type\": \"Feature\",\n";
+  QString escaped;
+  escaped.reserve( text.size() );
+  for ( int i = 0; i < text.size(); ++i )
+  {
+    QChar c = text.at( i );
+    if ( c == '<' )
+      escaped += "&lt;";
+    else if ( attribute && c == '"' )
+      escaped += "&quot;";
+    else if ( c == '&' )
+      escaped += "&amp;";
+    else if ( c == '>' && i >= 2 && text.at( i - 1 ) == ']' && text.at( i - 2 ) == ']' )
+      escaped += "&gt;";
+    else if ( attribute && c == '\n' )
+      escaped += "&#xa;";
+    else if ( c == '\r' )
+      escaped += "&#xd;";
+    else if ( attribute && c == '\t' )
+      escaped += "&#x9;";
+    else
+      escaped += c;
+  }
+  return escaped.toUtf8();
+}
 
-  fStr += "   \"id\": ";
-  fStr += "\"" + mTypeName + "." + QString::number( feat->id() ) + "\"";
-  fStr += ",\n";
+//! Writes the indentation of an element, one space per level like QDomDocument::toByteArray()
+static void writeIndent( QByteArray& out, int depth )
+{
+  out.append( QByteArray( depth, ' ' ) );
+}
+
+//! Writes a DOM node (e.g. a geometry from QgsOgcUtils) with the formatting of QDomDocument::toByteArray()
+static void writeDomNode( QByteArray& out, const QDomNode& node, int depth )
+{
+  if ( node.isText() )
+  {
+    out += xmlEscaped( node.nodeValue() );
+    return;
+  }
+  if ( !node.isElement() )
+  {
+    return;
+  }
+
+  QByteArray name = node.nodeName().toUtf8();
+  if ( !node.previousSibling().isText() )
+    writeIndent( out, depth );
+  out += '<';
+  out += name;
+  QDomNamedNodeMap attributes = node.attributes();
+  for ( int i = 0; i < attributes.count(); ++i )
+  {
+    QDomNode attribute = attributes.item( i );
+    out += ' ';
+    out += attribute.nodeName().toUtf8();
+    out += "=\"";
+    out += xmlEscaped( attribute.nodeValue(), true );
+    out += '"';
+  }
+
+  QDomNode child = node.firstChild();
+  if ( child.isNull() )
+  {
+    out += "/>";
+  }
+  else
+  {
+    out += '>';
+    if ( !child.isText() )
+      out += '\n';
+    for ( ; !child.isNull(); child = child.nextSibling() )
+      writeDomNode( out, child, depth + 1 );
+    if ( !node.lastChild().isText() )
+      writeIndent( out, depth );
+    out += "</";
+    out += name;
+    out += '>';
+  }
+
+  if ( !node.nextSibling().isText() )
+    out += '\n';
+}
+
+void QgsWFSServer::writeFeatureGeoJSON( QByteArray& out, QgsFeature* feat, int prec, QgsCoordinateReferenceSystem &, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/
+{
+  out += "{\"type\": \"Feature\",\n";
+
+  out += "   \"id\": \"";
+  out += mTypeName.toUtf8();
+  out += '.';
+  out += QByteArray::number( feat->id() );
+  out += "\",\n";
 
   const QgsGeometry* geom = feat->constGeometry();
   if ( geom && mWithGeom && mGeometryName != "NONE" )
   {
     QgsRectangle box = geom->boundingBox();
 
-    fStr += " \"bbox\": [ " + qgsDoubleToString( box.xMinimum(), prec ) + ", " + qgsDoubleToString( box.yMinimum(), prec ) + ", " + qgsDoubleToString( box.xMaximum(), prec ) + ", " + qgsDoubleToString( box.yMaximum(), prec ) + "],\n";
-
-    fStr += "  \"geometry\": ";
+    out += " \"bbox\": [ ";
+    out += qgsDoubleToString( box.xMinimum(), prec ).toUtf8();
+    out += ", ";
+    out += qgsDoubleToString( box.yMinimum(), prec ).toUtf8();
+    out += ", ";
+    out += qgsDoubleToString( box.xMaximum(), prec ).toUtf8();
+    out += ", ";
+    out += qgsDoubleToString( box.yMaximum(), prec ).toUtf8();
+    out += "],\n";
+
+    out += "  \"geometry\": ";
     if ( mGeometryName == "EXTENT" )
     {
       QgsGeometry* bbox = QgsGeometry::fromRect( box );
-      fStr += bbox->exportToGeoJSON( prec );
+      out += bbox->exportToGeoJSON( prec ).toUtf8();
       delete bbox;
     }
     else if ( mGeometryName == "CENTROID" )
     {
       QgsGeometry* centroid = geom->centroid();
-      fStr += centroid->exportToGeoJSON( prec );
+      out += centroid->exportToGeoJSON( prec ).toUtf8();
       delete centroid;
     }
     else
-      fStr += geom->exportToGeoJSON( prec );
-    fStr += ",\n";
+      out += geom->exportToGeoJSON( prec ).toUtf8();
+    out += ",\n";
   }
 
   //read all attribute values from the feature
-  fStr += "   \"properties\": {\n";
+  out += "   \"properties\": {\n";
   QgsAttributes featureAttributes = feat->attributes();
   const QgsFields* fields = feat->fields();
   int attributeCounter = 0;
@@ -1900,157 +2003,81 @@ QString QgsWFSServer::createFeatureGeoJSON( QgsFeature* feat, int prec, QgsCoord
     {
       continue;
     }
-    QString attributeName = fields->at( idx ).name();
+    const QString& attributeName = fields->at( idx ).name();
     //skip attribute if it is excluded from WFS publication
     if ( excludedAttributes.contains( attributeName ) )
     {
       continue;
     }
-    QVariant val = featureAttributes[idx];
+    const QVariant& val = featureAttributes.at( idx );
 
     if ( attributeCounter == 0 )
-      fStr += "    \"";
+      out += "    \"";
     else
-      fStr += "   ,\"";
-    fStr += attributeName;
-    fStr += "\": ";
+      out += "   ,\"";
+    out += attributeName.toUtf8();
+    out += "\": ";
     if ( val.type() == 6 || val.type() == 2 )
     {
-      fStr +=  val.toString();
+      out += val.toString().toUtf8();
     }
     else
     {
-      fStr += "\"";
-      fStr +=  val.toString()
-               .replace( '"', "\\\"" )
-               .replace( '\r', "\\r" )
-               .replace( '\n', "\\n" );
-      fStr += "\"";
+      out += '"';
+      out += val.toString()
+             .replace( '"', "\\\"" )
+             .replace( '\r', "\\r" )
+             .replace( '\n', "\\n" ).toUtf8();
+      out += '"';
     }
-    fStr += "\n";
+    out += '\n';
     ++attributeCounter;
   }
 
-  fStr += "   }\n";
-
-  fStr += "  }";
-
-  return fStr;
-}
-
-QDomElement QgsWFSServer::createFeatureGML2( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/
-{
-  //gml:FeatureMember
-  QDomElement featureElement = doc.createElement( "gml:featureMember"/*wfs:FeatureMember*/ );
-
-  //qgs:%TYPENAME%
-  QDomElement typeNameElement = doc.createElement( "qgs:" + mTypeName /*qgs:%TYPENAME%*/ );
-  typeNameElement.setAttribute( "fid", mTypeName + "." + QString::number( feat->id() ) );
-  featureElement.appendChild( typeNameElement );
-
-  if ( mWithGeom && mGeometryName != "NONE" )
-  {
-    //add geometry column (as gml)
-    const QgsGeometry* geom = feat->constGeometry();
-
-    QDomElement geomElem = doc.createElement( "qgs:geometry" );
-    QDomElement gmlElem;
-    if ( mGeometryName == "EXTENT" )
-    {
-      QgsGeometry* bbox = QgsGeometry::fromRect( geom->boundingBox() );
-      gmlElem = QgsOgcUtils::geometryToGML( bbox , doc, prec );
-      delete bbox;
-    }
-    else if ( mGeometryName == "CENTROID" )
-    {
-      QgsGeometry* centroid = geom->centroid();
-      gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, prec );
-      delete centroid;
-    }
-    else
-      gmlElem = QgsOgcUtils::geometryToGML( geom, doc, prec );
-    if ( !gmlElem.isNull() )
-    {
-      QgsRectangle box = geom->boundingBox();
-      QDomElement bbElem = doc.createElement( "gml:boundedBy" );
-      QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( &box, doc, prec );
-
-      if ( crs.isValid() )
-      {
-        boxElem.setAttribute( "srsName", crs.authid() );
-        gmlElem.setAttribute( "srsName", crs.authid() );
-      }
-
-      bbElem.appendChild( boxElem );
-      typeNameElement.appendChild( bbElem );
-
-      geomElem.appendChild( gmlElem );
-      typeNameElement.appendChild( geomElem );
-    }
-  }
-
-  //read all attribute values from the feature
-  QgsAttributes featureAttributes = feat->attributes();
-  const QgsFields* fields = feat->fields();
-  for ( int i = 0; i < attrIndexes.count(); ++i )
-  {
-    int idx = attrIndexes[i];
-    if ( idx >= fields->count() )
-    {
-      continue;
-    }
-    QString attributeName = fields->at( idx ).name();
-    //skip attribute if it is excluded from WFS publication
-    if ( excludedAttributes.contains( attributeName ) )
-    {
-      continue;
-    }
-
-    QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( QString( " " ), QString( "_" ) ) );
-    QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-    fieldElem.appendChild( fieldText );
-    typeNameElement.appendChild( fieldElem );
-  }
+  out += "   }\n";
 
-  return featureElement;
+  out += "  }";
 }
 
-QDomElement QgsWFSServer::createFeatureGML3( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/
+void QgsWFSServer::writeFeatureGML( QByteArray& out, QgsFeature* feat, bool gml3, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/
 {
   //gml:FeatureMember
-  QDomElement featureElement = doc.createElement( "gml:featureMember"/*wfs:FeatureMember*/ );
+  out += "<gml:featureMember>\n";
 
   //qgs:%TYPENAME%
-  QDomElement typeNameElement = doc.createElement( "qgs:" + mTypeName /*qgs:%TYPENAME%*/ );
-  typeNameElement.setAttribute( "gml:id", mTypeName + "." + QString::number( feat->id() ) );
-  featureElement.appendChild( typeNameElement );
+  QByteArray typeName = "qgs:" + mTypeName.toUtf8();
+  writeIndent( out, 1 );
+  out += '<';
+  out += typeName;
+  out += gml3 ? " gml:id=\"" : " fid=\"";
+  out += xmlEscaped( mTypeName + "." + QString::number( feat->id() ), true );
+  out += "\">\n";
 
-  if ( mWithGeom && mGeometryName != "NONE" )
+  const QgsGeometry* geom = feat->constGeometry();
+  if ( geom && mWithGeom && mGeometryName != "NONE" )
   {
-    //add geometry column (as gml)
-    const QgsGeometry* geom = feat->constGeometry();
-
-    QDomElement geomElem = doc.createElement( "qgs:geometry" );
+    //add geometry column (as gml), only the geometry itself is built with DOM elements
+    QDomDocument doc;
     QDomElement gmlElem;
+    QString gmlFormat = gml3 ? "GML3" : "GML2";
     if ( mGeometryName == "EXTENT" )
     {
       QgsGeometry* bbox = QgsGeometry::fromRect( geom->boundingBox() );
-      gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, "GML3", prec );
+      gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, gmlFormat, prec );
       delete bbox;
     }
     else if ( mGeometryName == "CENTROID" )
     {
       QgsGeometry* centroid = geom->centroid();
-      gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, "GML3", prec );
+      gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, gmlFormat, prec );
       delete centroid;
     }
     else
-      gmlElem = QgsOgcUtils::geometryToGML( geom, doc, "GML3", prec );
+      gmlElem = QgsOgcUtils::geometryToGML( geom, doc, gmlFormat, prec );
     if ( !gmlElem.isNull() )
     {
       QgsRectangle box = geom->boundingBox();
-      QDomElement bbElem = doc.createElement( "gml:boundedBy" );
-      QDomElement boxElem = QgsOgcUtils::rectangleToGMLEnvelope( &box, doc, prec );
+      QDomElement boxElem = gml3 ? QgsOgcUtils::rectangleToGMLEnvelope( &box, doc, prec ) : QgsOgcUtils::rectangleToGMLBox( &box, doc, prec );
 
       if ( crs.isValid() )
       {
@@ -2058,11 +2085,17 @@ QDomElement QgsWFSServer::createFeatureGML3( QgsFeature* feat, QDomDocument& doc
         gmlElem.setAttribute( "srsName", crs.authid() );
       }
 
-      bbElem.appendChild( boxElem );
-      typeNameElement.appendChild( bbElem );
-
-      geomElem.appendChild( gmlElem );
-      typeNameElement.appendChild( geomElem );
+      writeIndent( out, 2 );
+      out += "<gml:boundedBy>\n";
+      writeDomNode( out, boxElem, 3 );
+      writeIndent( out, 2 );
+      out += "</gml:boundedBy>\n";
+
+      writeIndent( out, 2 );
+      out += "<qgs:geometry>\n";
+      writeDomNode( out, gmlElem, 3 );
+      writeIndent( out, 2 );
+      out += "</qgs:geometry>\n";
     }
   }
 
@@ -2083,13 +2116,22 @@ QDomElement QgsWFSServer::createFeatureGML3( QgsFeature* feat, QDomDocument& doc
       continue;
     }
 
-    QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( QString( " " ), QString( "_" ) ) );
-    QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-    fieldElem.appendChild( fieldText );
-    typeNameElement.appendChild( fieldElem );
+    QByteArray fieldName = "qgs:" + attributeName.replace( QString( " " ), QString( "_" ) ).toUtf8();
+    writeIndent( out, 2 );
+    out += '<';
+    out += fieldName;
+    out += '>';
+    out += xmlEscaped( featureAttributes.at( idx ).toString() );
+    out += "</";
+    out += fieldName;
+    out += ">\n";
   }
 
-  return featureElement;
+  writeIndent( out, 1 );
+  out += "</";
+  out += typeName;
+  out += ">\n";
+  out += "</gml:featureMember>\n";
 }
 
 QString QgsWFSServer::serviceUrl() const
@@ -18,6 +18,7 @@
 #ifndef QGSWFSSERVER_H
 #define QGSWFSSERVER_H
 
+#include <QByteArray>
 #include <QDomDocument>
 #include <QMap>
 #include <QString>
@@ -109,23 +110,25 @@ class QgsWFSServer: public QgsOWSServer
 
     QgsWFSProjectParser* mConfigParser;
 
+    /** GetFeature output not sent yet, features are sent by chunks*/
+    QByteArray mGetFeatureBuffer;
+
   protected:
 
     void startGetFeature( QgsRequestHandler& request, const QString& format, int prec, QgsCoordinateReferenceSystem& crs, QgsRectangle* rect );
     void setGetFeature( QgsRequestHandler& request, const QString& format, QgsFeature* feat, int featIdx, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes );
     void endGetFeature( QgsRequestHandler& request, const QString& format );
+    /** Sends the buffered GetFeature output to the request handler*/
+    void flushGetFeature( QgsRequestHandler& request );
 
     //method for transaction
     QgsFeatureIds getFeatureIdsFromFilter( const QDomElement& filter, QgsVectorLayer* layer );
 
     //methods to write GeoJSON
-    QString createFeatureGeoJSON( QgsFeature* feat, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/;
-
-    //methods to write GML2
-    QDomElement createFeatureGML2( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/;
+    void writeFeatureGeoJSON( QByteArray& out, QgsFeature* feat, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/;
 
-    //methods to write GML3
-    QDomElement createFeatureGML3( QgsFeature* feat, QDomDocument& doc, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/;
+    //methods to write GML2 and GML3, formatted like QDomDocument::toByteArray() without building a document per feature
+    void writeFeatureGML( QByteArray& out, QgsFeature* feat, bool gml3, int prec, QgsCoordinateReferenceSystem& crs, const QgsAttributeList& attrIndexes, const QSet<QString>& excludedAttributes ) /*const*/;
 
     void addTransactionResult( QDomDocument& responseDoc, QDomElement& responseElem, const QString& status, const QString& locator, const QString& message );
 };
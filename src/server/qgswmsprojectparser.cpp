@@ -18,6 +18,7 @@
 #include "qgswmsprojectparser.h"
 #include "qgsconfigcache.h"
 #include "qgsconfigparserutils.h"
+#include "qgslayercapabilitiescache.h"
 #include "qgslogger.h"
 #include "qgsmaplayer.h"
 #include "qgsmaplayerregistry.h"
@@ -43,8 +44,10 @@
 #include "qgslayertreelayer.h"
 #include "qgsaccesscontrol.h"
 
+#include <QCryptographicHash>
 #include <QFileInfo>
 #include <QTextDocument>
+#include <QTextStream>
 
 // style name to use for the unnamed style of layers (must not be empty name in WMS)
 // this implies that a layer style called "default" will not be usable in WMS server
@@ -127,7 +130,17 @@ void QgsWMSProjectParser::layersAndStylesCapabilities( QDomElement& parentElemen
   QHash<QString, QString> idNameMap;
   QStringList layerIDList;
 
-  addLayers( doc, layerParentElem, legendElem, projectLayerTreeGroup(), layerMap, nonIdentifiableLayers, version, fullProjectSettings, idNameMap, layerIDList );
+  //layer elements depend on the request url (legend urls) and on the access control plugins,
+  //they are not cached if a plugin has no cache key
+  QStringList cacheKeyList;
+  cacheKeyList << version << ( fullProjectSettings ? "projectSettings" : "capabilities" ) << getCapaServiceUrl( doc );
+  bool cache = true;
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+  cache = mAccessControl->fillCacheKey( cacheKeyList );
+#endif
+  QString cacheKey = cache ? cacheKeyList.join( "-" ) : QString();
+
+  addLayers( doc, layerParentElem, legendElem, projectLayerTreeGroup(), layerMap, nonIdentifiableLayers, version, fullProjectSettings, idNameMap, layerIDList, cacheKey );
 
   parentElement.appendChild( layerParentElem );
   mProjectParser->combineExtentAndCrsOfGroupChildren( layerParentElem, doc, true );
@@ -1106,7 +1119,8 @@ void QgsWMSProjectParser::addLayers( QDomDocument &doc,
                                      QString version, //1.1.1 or 1.3.0
                                      bool fullProjectSettings,
                                      QHash<QString, QString> &idNameMap,
-                                     QStringList &layerIDList ) const
+                                     QStringList &layerIDList,
+                                     const QString& cacheKey ) const
 {
   QDomNodeList legendChildren = legendElem.childNodes();
   QList< QgsLayerTreeNode * > layerTreeGroupChildren = layerTreeGroup->children();
@@ -1221,12 +1235,12 @@ void QgsWMSProjectParser::addLayers( QDomDocument &doc,
             pLayerMap.insert( pp->layerId( elem ), pp->createLayerFromElement( elem ) );
           }
 
-          p->addLayers( doc, layerElem, embeddedGroupElem, embeddedLayerTreeGroup->findGroup( name ), pLayerMap, pIdDisabled, version, fullProjectSettings, idNameMap, layerIDList );
+          p->addLayers( doc, layerElem, embeddedGroupElem, embeddedLayerTreeGroup->findGroup( name ), pLayerMap, pIdDisabled, version, fullProjectSettings, idNameMap, layerIDList, cacheKey );
         }
       }
       else //normal (not embedded) legend group
       {
-        addLayers( doc, layerElem, currentChildElem, ltGroup, layerMap, nonIdentifiableLayers, version, fullProjectSettings, idNameMap, layerIDList );
+        addLayers( doc, layerElem, currentChildElem, ltGroup, layerMap, nonIdentifiableLayers, version, fullProjectSettings, idNameMap, layerIDList, cacheKey );
       }
 
       // combine bounding boxes of children (groups/layers)
@@ -1265,6 +1279,28 @@ void QgsWMSProjectParser::addLayers( QDomDocument &doc,
       }
 #endif
 
+      //extents, CRS and styles are only computed again if the layer or the project settings changed
+      QString layerCacheKey;
+      if ( !cacheKey.isEmpty() )
+      {
+        layerCacheKey = layerCapabilitiesCacheKey( currentLayer, cacheKey );
+      }
+      if ( !layerCacheKey.isEmpty() )
+      {
+        QDomElement cachedLayerElem = QgsLayerCapabilitiesCache::instance()->layerElement( layerCacheKey, doc );
+        if ( !cachedLayerElem.isNull() )
+        {
+          if ( fullProjectSettings )
+          {
+            cachedLayerElem.setAttribute( "visible", currentChildElem.attribute( "checked" ) != "Qt::Unchecked" );
+          }
+          layerIDList << id;
+          idNameMap.insert( id, currentLayer->name() );
+          parentLayer.appendChild( cachedLayerElem );
+          continue;
+        }
+      }
+
       // queryable layer
       if ( nonIdentifiableLayers.contains( currentLayer->id() ) )
       {
@@ -1460,6 +1496,11 @@ void QgsWMSProjectParser::addLayers( QDomDocument &doc,
       {
         mProjectParser->addLayerProjectSettings( layerElem, doc, currentLayer );
       }
+
+      if ( !layerCacheKey.isEmpty() )
+      {
+        QgsLayerCapabilitiesCache::instance()->insertLayerElement( layerCacheKey, layerElem );
+      }
     }
     else
     {
@@ -1471,6 +1512,40 @@ void QgsWMSProjectParser::addLayers( QDomDocument &doc,
   }
 }
 
+//! Returns a hash of the xml of an element
+static QString elementHash( const QDomElement& elem )
+{
+  QString xml;
+  QTextStream xmlStream( &xml );
+  elem.save( xmlStream, -1 );
+  return QString( QCryptographicHash::hash( xml.toUtf8(), QCryptographicHash::Md5 ).toHex() );
+}
+
+QString QgsWMSProjectParser::layerCapabilitiesCacheKey( QgsMapLayer* layer, const QString& cacheKey ) const
+{
+  //layers defined in another project (embedded ones) are not cached
+  QDomElement layerElem = mProjectParser->projectLayerElementsById().value( layer->id() );
+  if ( layerElem.isNull() || layerElem.attribute( "embedded" ) == "1" )
+  {
+    return QString();
+  }
+
+  if ( mPropertiesHash.isEmpty() )
+  {
+    mPropertiesHash = elementHash( mProjectParser->propertiesElem() );
+  }
+
+  QStringList keyList;
+  keyList << cacheKey << mProjectParser->projectPath() << mPropertiesHash << layer->id() << elementHash( layerElem );
+
+  //data in files may change without the project file
+  QFileInfo sourceInfo( layer->source().section( '|', 0, 0 ) );
+  if ( sourceInfo.isFile() )
+  {
+    keyList << sourceInfo.lastModified().toString( Qt::ISODate ) << QString::number( sourceInfo.size() );
+  }
+  return keyList.join( "\n" );
+}
 
 void QgsWMSProjectParser::addOWSLayerStyles( QgsMapLayer* currentLayer, QDomDocument& doc, QDomElement& layerElem ) const
 {
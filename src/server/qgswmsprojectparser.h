@@ -130,6 +130,9 @@ class SERVER_EXPORT QgsWMSProjectParser : public QgsWMSConfigParser
     const QgsAccessControl* mAccessControl;
 #endif
 
+    /** Hash of the <properties> element of the project, part of the layer capabilities cache keys*/
+    mutable QString mPropertiesHash;
+
     mutable QFont mLegendLayerFont;
     mutable QFont mLegendItemFont;
 
@@ -155,7 +158,13 @@ class SERVER_EXPORT QgsWMSProjectParser : public QgsWMSConfigParser
                     QString version, //1.1.1 or 1.3.0
                     bool fullProjectSettings,
                     QHash<QString, QString> &idNameMap,
-                    QStringList &layerIDList ) const;
+                    QStringList &layerIDList,
+                    const QString& cacheKey ) const;
+
+    /** Returns the key of the <Layer> element of a layer in QgsLayerCapabilitiesCache
+      @param layer the map layer
+      @param cacheKey WMS version and access control part of the key, common to all the layers of the request*/
+    QString layerCapabilitiesCacheKey( QgsMapLayer* layer, const QString& cacheKey ) const;
 
     void addOWSLayerStyles( QgsMapLayer* currentLayer, QDomDocument& doc, QDomElement& layerElem ) const;
 
@@ -17,6 +17,7 @@
 
 #include "qgswmsserver.h"
 #include "qgscapabilitiescache.h"
+#include "qgsconfigcache.h"
 #include "qgscrscache.h"
 #include "qgsdxfexport.h"
 #include "qgsfield.h"
@@ -29,7 +30,9 @@
 #include "qgsmaplayerlegend.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaprenderer.h"
+#include "qgsmaprendererparalleljob.h"
 #include "qgsmaptopixel.h"
+#include "qgspallabeling.h"
 #include "qgsproject.h"
 #include "qgsrasteridentifyresult.h"
 #include "qgsrasterlayer.h"
@@ -50,6 +53,7 @@
 #include "qgsserverstreamingdevice.h"
 #include "qgsaccesscontrol.h"
 #include "qgsfeaturerequest.h"
+#include "qgswmstilecache.h"
 
 #include <QImage>
 #include <QPainter>
@@ -57,6 +61,7 @@
 #include <QTemporaryFile>
 #include <QTextStream>
 #include <QDir>
+#include <QFileInfo>
 
 //for printing
 #include "qgscomposition.h"
@@ -66,6 +71,8 @@
 #include <QUrl>
 #include <QPaintEngine>
 
+#include <cmath>
+
 QgsWMSServer::QgsWMSServer(
   const QString& configFilePath
   , QMap<QString, QString> &parameters
@@ -225,7 +232,11 @@ void QgsWMSServer::executeRequest()
     QImage* result = nullptr;
     try
     {
-      result = getMap();
+      result = getMapTile();
+      if ( !result )
+      {
+        result = getMap();
+      }
     }
     catch ( QgsMapServiceException& ex )
     {
@@ -1427,7 +1438,7 @@ QImage* QgsWMSServer::getMap( HitTest* hitTest )
     runHitTest( &thePainter, *hitTest );
   else
   {
-    mMapRenderer->render( &thePainter );
+    renderLayers( &thePainter, theImage );
   }
 
   if ( mConfigParser )
@@ -1451,6 +1462,228 @@ QImage* QgsWMSServer::getMap( HitTest* hitTest )
   return theImage;
 }
 
+QImage* QgsWMSServer::getMapTile()
+{
+  QgsWMSTileCache* tileCache = QgsWMSTileCache::instance();
+  int metaTileSize = tileCache->metaTileSize();
+  if ( metaTileSize < 1 )
+  {
+    return nullptr;
+  }
+
+  //only tiles of usual sizes
+  int width = mParameters.value( "WIDTH" ).toInt();
+  int height = mParameters.value( "HEIGHT" ).toInt();
+  if ( width < 1 || height < 1 || width > 1024 || height > 1024 )
+  {
+    return nullptr;
+  }
+
+  bool bboxOk;
+  QgsRectangle tileExtent = _parseBBOX( mParameters.value( "BBOX" ), bboxOk );
+  if ( !bboxOk || tileExtent.isEmpty() )
+  {
+    return nullptr;
+  }
+
+  //the grid is computed in x/y order
+  QString crs = mParameters.value( "CRS", mParameters.value( "SRS" ) );
+  bool axisInverted = !crs.isEmpty() && mParameters.value( "VERSION", "1.3.0" ) != "1.1.1"
+                      && QgsCRSCache::instance()->crsByAuthId( crs ).axisInverted();
+  if ( axisInverted )
+  {
+    tileExtent.invert();
+  }
+
+  //the tile must be on a grid with the origin at 0,0
+  double tileWidth = tileExtent.width();
+  double tileHeight = tileExtent.height();
+  double col = tileExtent.xMinimum() / tileWidth;
+  double row = tileExtent.yMinimum() / tileHeight;
+  qint64 tileCol = qRound64( col );
+  qint64 tileRow = qRound64( row );
+  if ( qAbs( col - tileCol ) > 1E-6 || qAbs( row - tileRow ) > 1E-6 )
+  {
+    return nullptr;
+  }
+
+  //smaller metatiles if they would exceed the maximum image size
+  while ( metaTileSize > 1 && (( mConfigParser->maxWidth() != -1 && metaTileSize * width > mConfigParser->maxWidth() )
+                                || ( mConfigParser->maxHeight() != -1 && metaTileSize * height > mConfigParser->maxHeight() ) ) )
+  {
+    --metaTileSize;
+  }
+
+  //all the parameters but the extent and size identify the tiles of a grid
+  QStringList keyList;
+  QMap<QString, QString>::const_iterator paramIt = mParameters.constBegin();
+  for ( ; paramIt != mParameters.constEnd(); ++paramIt )
+  {
+    if ( paramIt.key() != "BBOX" && paramIt.key() != "WIDTH" && paramIt.key() != "HEIGHT" )
+    {
+      keyList << paramIt.key() + "=" + paramIt.value();
+    }
+  }
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+  if ( !mAccessControl->fillCacheKey( keyList ) )
+  {
+    return nullptr;
+  }
+#endif
+  //tiles stored on disk by a previous version of the project are not used
+  keyList << QgsConfigCache::instance()->fileVersion( mConfigFilePath );
+  keyList << QString( "%1x%2" ).arg( width ).arg( height );
+  keyList << QString::number( tileWidth, 'g', 17 ) << QString::number( tileHeight, 'g', 17 );
+  keyList << QString::number( metaTileSize );
+  QString gridKey = keyList.join( "&" );
+
+  QImage tile = tileCache->tile( mConfigFilePath, gridKey + QString( "&%1,%2" ).arg( tileCol ).arg( tileRow ) );
+  if ( !tile.isNull() )
+  {
+    QgsMessageLog::logMessage( "Found tile in cache" );
+    return new QImage( tile );
+  }
+
+  //render the metatile containing the tile
+  qint64 metaCol = static_cast< qint64 >( floor( static_cast< double >( tileCol ) / metaTileSize ) ) * metaTileSize;
+  qint64 metaRow = static_cast< qint64 >( floor( static_cast< double >( tileRow ) / metaTileSize ) ) * metaTileSize;
+  QgsRectangle metaExtent( metaCol * tileWidth, metaRow * tileHeight, ( metaCol + metaTileSize ) * tileWidth, ( metaRow + metaTileSize ) * tileHeight );
+  if ( axisInverted )
+  {
+    metaExtent.invert();
+  }
+
+  QMap<QString, QString> tileParameters = mParameters;
+  mParameters.insert( "BBOX", QString( "%1,%2,%3,%4" ).arg( metaExtent.xMinimum(), 0, 'g', 17 ).arg( metaExtent.yMinimum(), 0, 'g', 17 )
+                      .arg( metaExtent.xMaximum(), 0, 'g', 17 ).arg( metaExtent.yMaximum(), 0, 'g', 17 ) );
+  mParameters.insert( "WIDTH", QString::number( metaTileSize * width ) );
+  mParameters.insert( "HEIGHT", QString::number( metaTileSize * height ) );
+
+  QImage* metaTile = nullptr;
+  try
+  {
+    metaTile = getMap();
+  }
+  catch ( QgsMapServiceException& )
+  {
+    mParameters = tileParameters;
+    throw;
+  }
+  mParameters = tileParameters;
+
+  if ( !metaTile )
+  {
+    return nullptr;
+  }
+
+  //slice the metatile, rows of the grid go upwards
+  QImage* result = nullptr;
+  for ( int r = 0; r < metaTileSize; ++r )
+  {
+    for ( int c = 0; c < metaTileSize; ++c )
+    {
+      QImage slice = metaTile->copy( c * width, r * height, width, height );
+      qint64 sliceCol = metaCol + c;
+      qint64 sliceRow = metaRow + metaTileSize - 1 - r;
+      tileCache->insertTile( mConfigFilePath, gridKey + QString( "&%1,%2" ).arg( sliceCol ).arg( sliceRow ), slice );
+      if ( sliceCol == tileCol && sliceRow == tileRow )
+      {
+        result = new QImage( slice );
+      }
+    }
+  }
+  delete metaTile;
+  return result;
+}
+
+//! Returns false if the QGIS_SERVER_PARALLEL_RENDERING environment variable switches the parallel rendering off
+static bool parallelRendering()
+{
+  char* parallelEnv = getenv( "QGIS_SERVER_PARALLEL_RENDERING" );
+  if ( parallelEnv )
+  {
+    QString parallel( parallelEnv );
+    return parallel.compare( "0" ) != 0 && parallel.compare( "false", Qt::CaseInsensitive ) != 0;
+  }
+  return true;
+}
+
+//! Returns the maximum number of threads rendering the layers of a request, 0 for all the threads of the pool
+static int maxRenderThreads()
+{
+  int maxThreads = 0;
+  char* maxThreadsEnv = getenv( "QGIS_SERVER_MAX_RENDER_THREADS" );
+  if ( maxThreadsEnv )
+  {
+    bool conversionOk = false;
+    int maxThreadsInt = QString( maxThreadsEnv ).toInt( &conversionOk );
+    if ( conversionOk && maxThreadsInt >= 0 )
+    {
+      maxThreads = maxThreadsInt;
+    }
+  }
+  return maxThreads;
+}
+
+void QgsWMSServer::renderLayers( QPainter* painter, const QImage* image )
+{
+  //SLD units are in pixels, which only the legacy renderer supports
+  if ( !parallelRendering() || mMapRenderer->outputUnits() != QgsMapRenderer::Millimeters )
+  {
+    mMapRenderer->render( painter );
+    return;
+  }
+
+  if ( mMapRenderer->extent().isEmpty() )
+  {
+    return;
+  }
+
+  //the default flags (antialiasing, advanced effects, labels and selection) match the legacy renderer
+  QgsMapSettings mapSettings = mMapRenderer->mapSettings();
+  mapSettings.setBackgroundColor( image->hasAlphaChannel() ? QColor( 0, 0, 0, 0 ) : QColor( 255, 255, 255 ) );
+
+  //same selection color as QgsMapRenderer
+  QgsProject* prj = QgsProject::instance();
+  int myRed = prj->readNumEntry( "Gui", "/SelectionColorRedPart", 255 );
+  int myGreen = prj->readNumEntry( "Gui", "/SelectionColorGreenPart", 255 );
+  int myBlue = prj->readNumEntry( "Gui", "/SelectionColorBluePart", 0 );
+  int myAlpha = prj->readNumEntry( "Gui", "/SelectionColorAlphaPart", 255 );
+  mapSettings.setSelectionColor( QColor( myRed, myGreen, myBlue, myAlpha ) );
+
+  //datum transformations of the layers (from the project or the DEFAULT_DATUM_TRANSFORM environment variable)
+  if ( mMapRenderer->hasCrsTransformEnabled() )
+  {
+    Q_FOREACH ( const QString& layerId, mapSettings.layers() )
+    {
+      QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+      const QgsCoordinateTransform* ct = layer ? mMapRenderer->transformation( layer ) : nullptr;
+      if ( ct && ( ct->sourceDatumTransform() != -1 || ct->destinationDatumTransform() != -1 ) )
+      {
+        mapSettings.datumTransformStore().addEntry( layerId, ct->sourceCrs().authid(), ct->destCRS().authid(),
+            ct->sourceDatumTransform(), ct->destinationDatumTransform() );
+      }
+    }
+  }
+
+  QgsMapRendererParallelJob job( mapSettings );
+  job.setMaxThreadCount( maxRenderThreads() );
+  //labeling settings of the project loaded by the config parser
+  job.setLabelingEngineSettings( dynamic_cast<QgsPalLabeling*>( mMapRenderer->labelingEngine() ) );
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+  job.setFeatureFilterProvider( mAccessControl );
+#endif
+  job.start();
+  job.waitForFinished();
+
+  Q_FOREACH ( const QgsMapRendererJob::Error& error, job.errors() )
+  {
+    QgsMessageLog::logMessage( QString( "Error rendering layer %1: %2" ).arg( error.layerID, error.message ), "Server", QgsMessageLog::WARNING );
+  }
+
+  painter->drawImage( 0, 0, job.renderedImage() );
+}
+
 void QgsWMSServer::getMapAsDxf()
 {
   QgsServerStreamingDevice d( "application/dxf" , mRequestHandler );
@@ -173,6 +173,16 @@ class QgsWMSServer: public QgsOWSServer
        @param scaleDenominator Filter out layer if scale based visibility does not match (or use -1 if no scale restriction)*/
     QStringList layerSet( const QStringList& layersList, const QStringList& stylesList, const QgsCoordinateReferenceSystem& destCRS, double scaleDenominator = -1 ) const;
 
+    /** Returns the requested tile from the tile cache, rendering and caching its metatile if needed
+      (see QgsWMSTileCache). Returns a null pointer if the tile mode is disabled or the request is not for
+      a tile of a regular grid*/
+    QImage* getMapTile();
+
+    /** Renders the layers in the current configuration of mMapRenderer with a parallel rendering job.
+     * The number of threads of a request is limited by the QGIS_SERVER_MAX_RENDER_THREADS environment variable,
+     * QGIS_SERVER_PARALLEL_RENDERING=0 renders with the legacy renderer*/
+    void renderLayers( QPainter* painter, const QImage* image );
+
     /** Record which symbols would be used if the map was in the current configuration of mMapRenderer. This is useful for content-based legend*/
     void runHitTest( QPainter* painter, HitTest& hitTest );
     /** Record which symbols within one layer would be rendered with the given renderer context*/
@@ -0,0 +1,247 @@
+/***************************************************************************
+                              qgswmstilecache.cpp
+                              -------------------
+  begin                : May 2016
+  copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswmstilecache.h"
+#include "qgsconfigcache.h"
+#include "qgsmessagelog.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStringList>
+
+//! Returns a file name for a string (project path or tile key)
+static QString hashedName( const QString& s )
+{
+  return QString( QCryptographicHash::hash( s.toUtf8(), QCryptographicHash::Md5 ).toHex() );
+}
+
+//! Reads an integer from an environment variable, returns the default value if it is not set or invalid
+static int intFromEnvironment( const char* name, int defaultValue )
+{
+  char* env = getenv( name );
+  if ( env )
+  {
+    bool conversionOk = false;
+    int value = QString( env ).toInt( &conversionOk );
+    if ( conversionOk && value >= 0 )
+    {
+      return value;
+    }
+  }
+  return defaultValue;
+}
+
+//! Returns the tile files of the disk cache, in the directories of all the projects
+static QFileInfoList tileFiles( const QString& directory )
+{
+  QFileInfoList files;
+  QDirIterator it( directory, QStringList() << "*.png", QDir::Files, QDirIterator::Subdirectories );
+  while ( it.hasNext() )
+  {
+    it.next();
+    files << it.fileInfo();
+  }
+  return files;
+}
+
+//! Orders tile files by modification time, the oldest first
+static bool modifiedBefore( const QFileInfo& f1, const QFileInfo& f2 )
+{
+  return f1.lastModified() < f2.lastModified();
+}
+
+QgsWMSTileCache* QgsWMSTileCache::instance()
+{
+  static QgsWMSTileCache *instance = nullptr;
+
+  if ( !instance )
+    instance = new QgsWMSTileCache();
+
+  return instance;
+}
+
+QgsWMSTileCache::QgsWMSTileCache()
+    : mMaxDirectorySize( 0 )
+    , mDirectorySize( 0 )
+{
+  mTiles.setMaxCost( intFromEnvironment( "QGIS_SERVER_TILE_CACHE_SIZE", 64 ) * 1024 );
+
+  char* dirEnv = getenv( "QGIS_SERVER_TILE_CACHE_DIR" );
+  if ( dirEnv )
+  {
+    QDir dir( QString::fromLocal8Bit( dirEnv ) );
+    if ( dir.exists() || dir.mkpath( "." ) )
+    {
+      mDirectory = dir.absolutePath();
+      mMaxDirectorySize = qint64( intFromEnvironment( "QGIS_SERVER_TILE_CACHE_DIR_SIZE", 1024 ) ) * 1024 * 1024;
+      //tiles of previous processes count as well
+      Q_FOREACH ( const QFileInfo& file, tileFiles( mDirectory ) )
+      {
+        mDirectorySize += file.size();
+      }
+      if ( mMaxDirectorySize > 0 && mDirectorySize > mMaxDirectorySize )
+      {
+        pruneDirectory();
+      }
+    }
+    else
+    {
+      QgsMessageLog::logMessage( "Tile cache directory '" + dir.path() + "' cannot be created, tiles are only cached in memory", "Server", QgsMessageLog::WARNING );
+    }
+  }
+
+  QObject::connect( QgsConfigCache::instance(), SIGNAL( projectFileChanged( const QString& ) ), this, SLOT( removeProjectTiles( const QString& ) ) );
+}
+
+QgsWMSTileCache::~QgsWMSTileCache()
+{
+}
+
+int QgsWMSTileCache::metaTileSize() const
+{
+  //read for each request like the other rendering settings of the server
+  return intFromEnvironment( "QGIS_SERVER_METATILE_SIZE", 0 );
+}
+
+QImage QgsWMSTileCache::tile( const QString& configFilePath, const QString& key )
+{
+  QMutexLocker locker( &mMutex );
+
+  QString cacheKey = configFilePath + '\n' + key;
+  QImage* cachedTile = mTiles.object( cacheKey );
+  if ( cachedTile )
+  {
+    return *cachedTile;
+  }
+
+  QString filePath = tileFilePath( configFilePath, key );
+  if ( filePath.isEmpty() || !QFile::exists( filePath ) )
+  {
+    return QImage();
+  }
+
+  QImage image( filePath, "PNG" );
+  if ( image.isNull() )
+  {
+    return image;
+  }
+  if ( image.hasAlphaChannel() )
+  {
+    image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+  }
+  mTiles.insert( cacheKey, new QImage( image ), image.byteCount() / 1024 );
+  return image;
+}
+
+void QgsWMSTileCache::insertTile( const QString& configFilePath, const QString& key, const QImage& tile )
+{
+  QMutexLocker locker( &mMutex );
+
+  mTiles.insert( configFilePath + '\n' + key, new QImage( tile ), tile.byteCount() / 1024 );
+
+  QString filePath = tileFilePath( configFilePath, key );
+  if ( !filePath.isEmpty() )
+  {
+    QDir().mkpath( projectDirectory( configFilePath ) );
+    mDirectorySize -= QFileInfo( filePath ).size();
+    if ( !tile.save( filePath, "PNG" ) )
+    {
+      QgsMessageLog::logMessage( "Could not write tile file '" + filePath + "'", "Server", QgsMessageLog::WARNING );
+    }
+    mDirectorySize += QFileInfo( filePath ).size();
+    if ( mMaxDirectorySize > 0 && mDirectorySize > mMaxDirectorySize )
+    {
+      pruneDirectory();
+    }
+  }
+}
+
+QString QgsWMSTileCache::projectDirectory( const QString& configFilePath ) const
+{
+  if ( mDirectory.isEmpty() )
+  {
+    return QString();
+  }
+  return mDirectory + '/' + hashedName( configFilePath );
+}
+
+QString QgsWMSTileCache::tileFilePath( const QString& configFilePath, const QString& key ) const
+{
+  if ( mDirectory.isEmpty() )
+  {
+    return QString();
+  }
+  return projectDirectory( configFilePath ) + '/' + hashedName( key ) + ".png";
+}
+
+void QgsWMSTileCache::pruneDirectory()
+{
+  QFileInfoList files = tileFiles( mDirectory );
+  qSort( files.begin(), files.end(), modifiedBefore );
+
+  //the sizes are read again, files may have been removed by other processes
+  mDirectorySize = 0;
+  Q_FOREACH ( const QFileInfo& file, files )
+  {
+    mDirectorySize += file.size();
+  }
+
+  //prune below the limit, so that the directory is not scanned again for each new tile
+  qint64 targetSize = mMaxDirectorySize / 4 * 3;
+  int removed = 0;
+  for ( int i = 0; i < files.size() && mDirectorySize > targetSize; ++i )
+  {
+    if ( QFile::remove( files.at( i ).filePath() ) )
+    {
+      mDirectorySize -= files.at( i ).size();
+      ++removed;
+    }
+  }
+  QgsMessageLog::logMessage( QString( "Removed %1 tile files from the tile cache directory" ).arg( removed ), "Server", QgsMessageLog::INFO );
+}
+
+void QgsWMSTileCache::removeProjectTiles( const QString& configFilePath )
+{
+  QMutexLocker locker( &mMutex );
+
+  QgsMessageLog::logMessage( "Removing cached tiles of project file: " + configFilePath, "Server", QgsMessageLog::INFO );
+  QString prefix = configFilePath + '\n';
+  Q_FOREACH ( const QString& key, mTiles.keys() )
+  {
+    if ( key.startsWith( prefix ) )
+    {
+      mTiles.remove( key );
+    }
+  }
+
+  QString directory = projectDirectory( configFilePath );
+  if ( !directory.isEmpty() )
+  {
+    QDir dir( directory );
+    Q_FOREACH ( const QFileInfo& file, dir.entryInfoList( QStringList() << "*.png", QDir::Files ) )
+    {
+      if ( dir.remove( file.fileName() ) )
+      {
+        mDirectorySize -= file.size();
+      }
+    }
+  }
+}
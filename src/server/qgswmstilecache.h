@@ -0,0 +1,90 @@
+/***************************************************************************
+                              qgswmstilecache.h
+                              -----------------
+  begin                : May 2016
+  copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSWMSTILECACHE_H
+#define QGSWMSTILECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+/** A singleton cache for the tiles of WMS GetMap requests, in memory and optionally on disk.
+ *
+ * The tile mode is enabled with the QGIS_SERVER_METATILE_SIZE environment variable, the
+ * number N of tiles per side of the metatiles: a GetMap request on a regular tile grid renders
+ * the N x N tiles around the requested one at once, so that labels are consistent across tile
+ * edges, and stores all of them in the cache.
+ *
+ * QGIS_SERVER_TILE_CACHE_SIZE sets the size of the memory cache in MB (default 64) and
+ * QGIS_SERVER_TILE_CACHE_DIR an optional directory where tiles are also stored as PNG files.
+ * QGIS_SERVER_TILE_CACHE_DIR_SIZE limits the size of the tiles in that directory in MB
+ * (default 1024, 0 for no limit): when it is exceeded, the oldest tile files are removed,
+ * including the ones written by previous server processes.
+ * The tiles of a project are removed when QgsConfigCache detects that the project file changed.
+ */
+class QgsWMSTileCache: public QObject
+{
+    Q_OBJECT
+  public:
+    static QgsWMSTileCache* instance();
+    ~QgsWMSTileCache();
+
+    /** Returns the number of tiles per side of the metatiles, 0 if the tile mode is disabled*/
+    int metaTileSize() const;
+
+    /** Returns a cached tile or a null image
+      @param configFilePath path of the project file
+      @param key key of the tile in the project (parameters of the request and position on the tile grid)*/
+    QImage tile( const QString& configFilePath, const QString& key );
+
+    /** Inserts a tile into the cache
+      @param configFilePath path of the project file
+      @param key key of the tile in the project (parameters of the request and position on the tile grid)
+      @param tile the tile image*/
+    void insertTile( const QString& configFilePath, const QString& key, const QImage& tile );
+
+  private:
+    /** Private singleton constructor*/
+    QgsWMSTileCache();
+
+    /** Returns the directory of the tiles of a project on disk, empty if tiles are not stored on disk*/
+    QString projectDirectory( const QString& configFilePath ) const;
+
+    /** Returns the path of a tile on disk, empty if tiles are not stored on disk*/
+    QString tileFilePath( const QString& configFilePath, const QString& key ) const;
+
+    /** Removes the oldest tile files until the disk cache uses less than three quarters of its maximum size*/
+    void pruneDirectory();
+
+    /** Directory of the disk cache, empty if tiles are only kept in memory*/
+    QString mDirectory;
+    /** Maximum size of the tile files in bytes, 0 if not limited*/
+    qint64 mMaxDirectorySize;
+    /** Size of the tile files in bytes*/
+    qint64 mDirectorySize;
+
+    QMutex mMutex;
+    /** Tiles in memory, by project file and key. The cost is the size in KB*/
+    QCache<QString, QImage> mTiles;
+
+  private slots:
+    /** Removes the tiles of a project (e.g. if the project file has changed)*/
+    void removeProjectTiles( const QString& configFilePath );
+};
+
+#endif // QGSWMSTILECACHE_H
@@ -0,0 +1,150 @@
+/***************************************************************************
+                 benchqgsexpression.cpp
+                 ----------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QString>
+
+#include "qgsapplication.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsfeature.h"
+#include "qgsfield.h"
+
+/** Compares evaluation of prepared expressions by the node tree walker and by the
+ * compiled instruction stream, over a block of synthetic features, both feature by
+ * feature and by blocks of features.
+ *
+ * Run with e.g. "qgis_bench_expression -iterations 5" or "-callgrind", see README.
+ */
+class BenchQgsExpression : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void evaluate_data();
+    void evaluate();
+
+    void evaluateBlock_data();
+    void evaluateBlock();
+
+  private:
+    QgsFields mFields;
+    QList<QgsFeature> mFeatures;
+};
+
+void BenchQgsExpression::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mFields.append( QgsField( "pop", QVariant::Int ) );
+  mFields.append( QgsField( "area", QVariant::Double ) );
+  mFields.append( QgsField( "type", QVariant::String ) );
+
+  const char* types[] = { "city", "town", "village", "hamlet" };
+  for ( int i = 0; i < 10000; ++i )
+  {
+    QgsFeature f( mFields, i );
+    f.setAttributes( QgsAttributes()
+                     << ( i % 97 == 0 ? QVariant( QVariant::Int ) : QVariant( i * 37 % 100000 ) )
+                     << QVariant( 1.5 + i % 1000 )
+                     << QVariant( types[i % 4] ) );
+    mFeatures << f;
+  }
+}
+
+void BenchQgsExpression::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void BenchQgsExpression::evaluate_data()
+{
+  QTest::addColumn<QString>( "expression" );
+  QTest::addColumn<bool>( "compiled" );
+
+  QStringList expressions;
+  expressions << "pop"
+  << "pop / area > 50"
+  << "\"pop\" / (1000 * 1000) > 0.01 and type in ('city', 'town')"
+  << "case when pop > 50000 then 1 when pop > 10000 then 2 when pop is null then 0 else 3 end"
+  << "pop * 2 + area ^ 2 - (pop % 7)"
+  << "upper(type) || ' ' || to_string(pop)"
+  << "type like 'c%' or abs(area - 500) < 100";
+
+  Q_FOREACH ( const QString& expression, expressions )
+  {
+    QTest::newRow( QString( "tree: %1" ).arg( expression ).toUtf8().constData() ) << expression << false;
+    QTest::newRow( QString( "compiled: %1" ).arg( expression ).toUtf8().constData() ) << expression << true;
+  }
+}
+
+void BenchQgsExpression::evaluate()
+{
+  QFETCH( QString, expression );
+  QFETCH( bool, compiled );
+
+  QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( QgsFeature(), mFields );
+
+  QgsExpression exp( expression );
+  exp.setCompilationEnabled( compiled );
+  QVERIFY( exp.prepare( &context ) );
+  QCOMPARE( exp.isCompiled(), compiled );
+
+  QBENCHMARK
+  {
+    Q_FOREACH ( const QgsFeature& f, mFeatures )
+    {
+      context.setFeature( f );
+      exp.evaluate( &context );
+    }
+  }
+}
+
+void BenchQgsExpression::evaluateBlock_data()
+{
+  evaluate_data();
+}
+
+void BenchQgsExpression::evaluateBlock()
+{
+  QFETCH( QString, expression );
+  QFETCH( bool, compiled );
+
+  QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( QgsFeature(), mFields );
+
+  QgsExpression exp( expression );
+  exp.setCompilationEnabled( compiled );
+  QVERIFY( exp.prepare( &context ) );
+
+  // same block size as the feature iterators
+  QList<QgsFeatureList> blocks;
+  for ( int i = 0; i < mFeatures.count(); i += 1024 )
+    blocks << mFeatures.mid( i, 1024 );
+
+  QBENCHMARK
+  {
+    Q_FOREACH ( const QgsFeatureList& block, blocks )
+      exp.filterBlock( &context, block );
+  }
+}
+
+QTEST_MAIN( BenchQgsExpression )
+#include "benchqgsexpression.moc"
@@ -0,0 +1,184 @@
+/***************************************************************************
+                 benchqgslabeling.cpp
+                 --------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QElapsedTimer>
+
+#include "qgsapplication.h"
+#include "qgsgeos.h"
+#include "qgslabelfeature.h"
+#include "qgslabelingenginev2.h"
+#include "qgspointv2.h"
+#include "pal/labelposition.h"
+#include "pal/layer.h"
+#include "pal/pal.h"
+#include "pal/problem.h"
+
+//! Label provider for the synthetic features, nothing is drawn
+class BenchLabelProvider : public QgsAbstractLabelProvider
+{
+  public:
+    explicit BenchLabelProvider( const QString& id )
+        : QgsAbstractLabelProvider( id )
+    {
+      mPlacement = QgsPalLayerSettings::AroundPoint;
+    }
+
+    QList<QgsLabelFeature*> labelFeatures( QgsRenderContext& ) override { return QList<QgsLabelFeature*>(); }
+    void drawLabel( QgsRenderContext&, pal::LabelPosition* ) const override {}
+};
+
+/** Times the two phases of the labeling engine separately, over dense synthetic point
+ * layers: extraction of the problem (candidate generation, obstacles, overlaps) and
+ * the search of the solution, for each search method.
+ *
+ * Run with e.g. "qgis_bench_labeling -iterations 5", see README.
+ */
+class BenchQgsLabeling : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void extract_data();
+    void extract();
+
+    void solve_data();
+    void solve();
+
+  private:
+    QList<BenchLabelProvider*> mProviders;
+    QList<QgsLabelFeature*> mFeatures;
+
+    void addLayers( pal::Pal& p, int layers );
+};
+
+static double sBBox[] = { 0, 0, 1000, 1000 };
+
+void BenchQgsLabeling::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void BenchQgsLabeling::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void BenchQgsLabeling::cleanup()
+{
+  // the pal layers are gone, the features can be deleted
+  qDeleteAll( mFeatures );
+  mFeatures.clear();
+  qDeleteAll( mProviders );
+  mProviders.clear();
+}
+
+void BenchQgsLabeling::addLayers( pal::Pal& p, int layers )
+{
+  // same pseudo random points on every run
+  unsigned int state = 1;
+  for ( int l = 0; l < layers; ++l )
+  {
+    BenchLabelProvider* provider = new BenchLabelProvider( QString( "layer%1" ).arg( l ) );
+    mProviders << provider;
+    pal::Layer* layer = p.addLayer( provider, provider->name(), provider->placement(), provider->priority(), true, true );
+
+    for ( int i = 0; i < 2000; ++i )
+    {
+      state = state * 1103515245 + 12345;
+      double x = ( state >> 8 ) % 10000 / 10.0;
+      state = state * 1103515245 + 12345;
+      double y = ( state >> 8 ) % 10000 / 10.0;
+
+      QgsPointV2 point( x, y );
+      QgsLabelFeature* feature = new QgsLabelFeature( i, QgsGeos::asGeos( &point ), QSizeF( 24, 6 ) );
+      mFeatures << feature;
+      layer->registerFeature( feature );
+    }
+  }
+}
+
+void BenchQgsLabeling::extract_data()
+{
+  QTest::addColumn<int>( "layers" );
+
+  QTest::newRow( "1 layer" ) << 1;
+  QTest::newRow( "4 layers" ) << 4;
+  QTest::newRow( "8 layers" ) << 8;
+}
+
+void BenchQgsLabeling::extract()
+{
+  QFETCH( int, layers );
+
+  pal::Pal p;
+  addLayers( p, layers );
+
+  QBENCHMARK
+  {
+    pal::Problem* problem = p.extractProblem( sBBox );
+    QVERIFY( problem );
+    delete problem;
+  }
+}
+
+void BenchQgsLabeling::solve_data()
+{
+  QTest::addColumn<int>( "method" );
+
+  QTest::newRow( "chain" ) << static_cast< int >( pal::CHAIN );
+  QTest::newRow( "popmusic tabu" ) << static_cast< int >( pal::POPMUSIC_TABU );
+  QTest::newRow( "popmusic chain" ) << static_cast< int >( pal::POPMUSIC_CHAIN );
+  QTest::newRow( "popmusic tabu chain" ) << static_cast< int >( pal::POPMUSIC_TABU_CHAIN );
+}
+
+void BenchQgsLabeling::solve()
+{
+  QFETCH( int, method );
+
+  pal::Pal p;
+  p.setSearch( static_cast< pal::SearchMethod >( method ) );
+  addLayers( p, 4 );
+
+  // a problem can only be solved once, only the search itself is timed
+  const int runs = 3;
+  qint64 elapsed = 0;
+  for ( int i = 0; i < runs; ++i )
+  {
+    pal::Problem* problem = p.extractProblem( sBBox );
+    QVERIFY( problem );
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<pal::LabelPosition*>* labels = p.solveProblem( problem, false );
+    elapsed += timer.elapsed();
+
+    QVERIFY( !labels->isEmpty() );
+    delete labels;
+    delete problem;
+  }
+
+  QTest::setBenchmarkResult( static_cast< qreal >( elapsed ) / runs, QTest::WalltimeMilliseconds );
+}
+
+QTEST_MAIN( BenchQgsLabeling )
+#include "benchqgslabeling.moc"
@@ -0,0 +1,147 @@
+/***************************************************************************
+                 benchqgsrasterrenderer.cpp
+                 --------------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QElapsedTimer>
+
+#include <cstring>
+
+#include "qgsapplication.h"
+#include "qgscolorrampshader.h"
+#include "qgsrasterblock.h"
+#include "qgsrasterinterface.h"
+#include "qgsrastershader.h"
+#include "qgssinglebandpseudocolorrenderer.h"
+
+//! Raster input returning copies of one synthetic block
+class BenchRasterInput : public QgsRasterInterface
+{
+  public:
+    explicit BenchRasterInput( QGis::DataType type )
+        : mBlock( type, WIDTH, HEIGHT )
+    {
+      // smooth values over the range of the color ramp, as for an elevation model
+      for ( int row = 0; row < HEIGHT; ++row )
+      {
+        for ( int col = 0; col < WIDTH; ++col )
+        {
+          double value = ( row + col ) * 255.0 / ( WIDTH + HEIGHT );
+          if ( type == QGis::Float32 || type == QGis::Float64 )
+            value += ( col % 10 ) * 0.01;
+          mBlock.setValue( row, col, value );
+        }
+      }
+    }
+
+    QgsRasterInterface* clone() const override { return new BenchRasterInput( mBlock.dataType() ); }
+    QGis::DataType dataType( int ) const override { return mBlock.dataType(); }
+    int bandCount() const override { return 1; }
+
+    QgsRasterBlock* block( int, const QgsRectangle&, int width, int height ) override
+    {
+      QgsRasterBlock* block = new QgsRasterBlock( mBlock.dataType(), width, height );
+      memcpy( block->bits(), mBlock.bits(), static_cast< size_t >( width ) * height * mBlock.dataTypeSize() );
+      return block;
+    }
+
+    static const int WIDTH = 1000;
+    static const int HEIGHT = 1000;
+
+  private:
+    QgsRasterBlock mBlock;
+};
+
+/** Renders one megapixel blocks with a single band pseudocolor renderer and an
+ * interpolated color ramp, for each data type of the input, and reports the
+ * throughput in megapixels per second.
+ *
+ * Run with e.g. "qgis_bench_rasterrenderer -iterations 10", see README.
+ */
+class BenchQgsRasterRenderer : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void pseudoColor_data();
+    void pseudoColor();
+};
+
+void BenchQgsRasterRenderer::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void BenchQgsRasterRenderer::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void BenchQgsRasterRenderer::pseudoColor_data()
+{
+  QTest::addColumn<int>( "type" );
+  QTest::addColumn<int>( "rampType" );
+
+  QTest::newRow( "byte" ) << static_cast< int >( QGis::Byte ) << static_cast< int >( QgsColorRampShader::INTERPOLATED );
+  QTest::newRow( "uint16" ) << static_cast< int >( QGis::UInt16 ) << static_cast< int >( QgsColorRampShader::INTERPOLATED );
+  QTest::newRow( "int16" ) << static_cast< int >( QGis::Int16 ) << static_cast< int >( QgsColorRampShader::INTERPOLATED );
+  QTest::newRow( "int32" ) << static_cast< int >( QGis::Int32 ) << static_cast< int >( QgsColorRampShader::INTERPOLATED );
+  QTest::newRow( "float32" ) << static_cast< int >( QGis::Float32 ) << static_cast< int >( QgsColorRampShader::INTERPOLATED );
+  QTest::newRow( "float64" ) << static_cast< int >( QGis::Float64 ) << static_cast< int >( QgsColorRampShader::INTERPOLATED );
+  QTest::newRow( "float32 discrete" ) << static_cast< int >( QGis::Float32 ) << static_cast< int >( QgsColorRampShader::DISCRETE );
+}
+
+void BenchQgsRasterRenderer::pseudoColor()
+{
+  QFETCH( int, type );
+  QFETCH( int, rampType );
+
+  QList<QgsColorRampShader::ColorRampItem> items;
+  for ( int i = 0; i <= 10; ++i )
+    items << QgsColorRampShader::ColorRampItem( i * 25.5, QColor::fromHsv( i * 30, 255, 255 ) );
+
+  QgsColorRampShader* rampShader = new QgsColorRampShader( 0, 255 );
+  rampShader->setColorRampItemList( items );
+  rampShader->setColorRampType( static_cast< QgsColorRampShader::ColorRamp_TYPE >( rampType ) );
+  QgsRasterShader* shader = new QgsRasterShader( 0, 255 );
+  shader->setRasterShaderFunction( rampShader );
+
+  BenchRasterInput input( static_cast< QGis::DataType >( type ) );
+  QgsSingleBandPseudoColorRenderer renderer( &input, 1, shader );
+  QgsRectangle extent( 0, 0, BenchRasterInput::WIDTH, BenchRasterInput::HEIGHT );
+
+  const int runs = 20;
+  QElapsedTimer timer;
+  timer.start();
+  for ( int i = 0; i < runs; ++i )
+  {
+    QgsRasterBlock* block = renderer.block( 1, extent, BenchRasterInput::WIDTH, BenchRasterInput::HEIGHT );
+    QVERIFY( block && !block->isEmpty() );
+    delete block;
+  }
+  double seconds = timer.elapsed() / 1000.0;
+  double megapixels = runs * BenchRasterInput::WIDTH * BenchRasterInput::HEIGHT / 1e6;
+
+  qDebug( "%s: %.1f megapixels/s", QTest::currentDataTag(), seconds > 0 ? megapixels / seconds : 0.0 );
+  QTest::setBenchmarkResult( seconds * 1000.0 / megapixels, QTest::WalltimeMilliseconds );
+}
+
+QTEST_MAIN( BenchQgsRasterRenderer )
+#include "benchqgsrasterrenderer.moc"
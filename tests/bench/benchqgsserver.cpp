@@ -0,0 +1,89 @@
+/***************************************************************************
+                 benchqgsserver.cpp
+                 --------------------
+    begin                : May 2016
+    copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+
+#include "qgsserver.h"
+
+/** Times WMS GetMap requests rendering several layers, with a single rendering
+ * thread per request and with all the threads of the pool.
+ *
+ * The layer of the server test project is requested several times to get
+ * projects with more layers. Run with e.g. "qgis_bench_server -iterations 5", see README.
+ */
+class BenchQgsServer : public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit BenchQgsServer( QgsServer* server ) : mServer( server ) {}
+
+  private slots:
+    void getMap_data();
+    void getMap();
+
+  private:
+    QgsServer* mServer;
+};
+
+void BenchQgsServer::getMap_data()
+{
+  QTest::addColumn<int>( "layers" );
+  QTest::addColumn<int>( "threads" );
+
+  QTest::newRow( "4 layers, 1 thread" ) << 4 << 1;
+  QTest::newRow( "4 layers, all threads" ) << 4 << 0;
+  QTest::newRow( "16 layers, 1 thread" ) << 16 << 1;
+  QTest::newRow( "16 layers, all threads" ) << 16 << 0;
+  QTest::newRow( "24 layers, 1 thread" ) << 24 << 1;
+  QTest::newRow( "24 layers, all threads" ) << 24 << 0;
+}
+
+void BenchQgsServer::getMap()
+{
+  QFETCH( int, layers );
+  QFETCH( int, threads );
+
+  qputenv( "QGIS_SERVER_MAX_RENDER_THREADS", QByteArray::number( threads ) );
+
+  QStringList layerNames;
+  for ( int i = 0; i < layers; ++i )
+    layerNames << QString::fromUtf8( QUrl::toPercentEncoding( QString::fromUtf8( "testlayer èé" ) ) );
+
+  QString projectFile = QString( TEST_DATA_DIR ) + "/qgis_server/test+project.qgs";
+  QString query = QString( "MAP=%1&SERVICE=WMS&VERSION=1.3.0&REQUEST=GetMap&LAYERS=%2&STYLES=&FORMAT=image/png"
+                           "&CRS=EPSG:4326&BBOX=44.90128,8.20315,44.90155,8.20416&WIDTH=1024&HEIGHT=1024" )
+                  .arg( QString::fromUtf8( QUrl::toPercentEncoding( projectFile ) ), layerNames.join( "," ) );
+
+  QBENCHMARK
+  {
+    QPair<QByteArray, QByteArray> response = mServer->handleRequest( query );
+    QVERIFY( !response.second.isEmpty() );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  // the server creates its own application
+  QgsServer server;
+  BenchQgsServer bench( &server );
+  return QTest::qExec( &bench, argc, argv );
+}
+
+#include "benchqgsserver.moc"
@@ -0,0 +1,201 @@
+/***************************************************************************
+     testqgsidwinterpolator.cpp
+     --------------------------------------
+    Date                 : May 2016
+    Copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include "qgsapplication.h"
+#include "qgsgeometry.h"
+#include "qgsidwinterpolator.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** \ingroup UnitTests
+ * This is a unit test for the inverse distance weighting interpolator
+ */
+class TestQgsIDWInterpolator : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsIDWInterpolator();
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init() {}
+    void cleanup() {}
+
+    void allPoints();
+    void nearestPoints();
+    void searchRadius();
+
+  private:
+    QgsVectorLayer* mSquareLayer;
+    QgsVectorLayer* mRandomLayer;
+    QList<QgsPoint> mRandomPoints;
+    QList<double> mRandomValues;
+
+    QgsVectorLayer* createLayer( const QList<QgsPoint>& points, const QList<double>& values );
+    QList<QgsInterpolator::LayerData> layerData( QgsVectorLayer* layer );
+};
+
+TestQgsIDWInterpolator::TestQgsIDWInterpolator()
+    : mSquareLayer( nullptr )
+    , mRandomLayer( nullptr )
+{
+
+}
+
+void TestQgsIDWInterpolator::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  // corners of the unit square
+  mSquareLayer = createLayer( QList<QgsPoint>() << QgsPoint( 0, 0 ) << QgsPoint( 1, 0 ) << QgsPoint( 1, 1 ) << QgsPoint( 0, 1 ),
+                              QList<double>() << 1 << 2 << 3 << 4 );
+
+  // same pseudo random points on every run
+  unsigned int state = 1;
+  for ( int i = 0; i < 500; ++i )
+  {
+    state = state * 1103515245 + 12345;
+    double x = ( state >> 8 ) % 10000 / 100.0;
+    state = state * 1103515245 + 12345;
+    double y = ( state >> 8 ) % 10000 / 100.0;
+    mRandomPoints << QgsPoint( x, y );
+    mRandomValues << ( x * 3 + y ) / 10.0;
+  }
+  mRandomLayer = createLayer( mRandomPoints, mRandomValues );
+}
+
+void TestQgsIDWInterpolator::cleanupTestCase()
+{
+  delete mSquareLayer;
+  delete mRandomLayer;
+  QgsApplication::exitQgis();
+}
+
+QgsVectorLayer* TestQgsIDWInterpolator::createLayer( const QList<QgsPoint>& points, const QList<double>& values )
+{
+  QgsVectorLayer* layer = new QgsVectorLayer( "Point?field=value:double", "points", "memory" );
+  QgsFeatureList features;
+  for ( int i = 0; i < points.count(); ++i )
+  {
+    QgsFeature f( layer->fields() );
+    f.setGeometry( QgsGeometry::fromPoint( points.at( i ) ) );
+    f.setAttribute( 0, values.at( i ) );
+    features << f;
+  }
+  layer->dataProvider()->addFeatures( features );
+  return layer;
+}
+
+QList<QgsInterpolator::LayerData> TestQgsIDWInterpolator::layerData( QgsVectorLayer* layer )
+{
+  QgsInterpolator::LayerData data;
+  data.vectorLayer = layer;
+  data.zCoordInterpolation = false;
+  data.interpolationAttribute = 0;
+  data.mInputType = QgsInterpolator::POINTS;
+  return QList<QgsInterpolator::LayerData>() << data;
+}
+
+void TestQgsIDWInterpolator::allPoints()
+{
+  QgsIDWInterpolator interpolator( layerData( mSquareLayer ) );
+  double result;
+
+  // same distance to all points
+  QCOMPARE( interpolator.interpolatePoint( 0.5, 0.5, result ), 0 );
+  QVERIFY( qgsDoubleNear( result, 2.5 ) );
+
+  // on a point
+  QCOMPARE( interpolator.interpolatePoint( 1, 1, result ), 0 );
+  QCOMPARE( result, 3.0 );
+
+  // integer and non integer coefficients give the same weights
+  double weights[4] = { 1 / pow( 0.5, 3 ), 1 / pow( 1.5, 3 ), 1 / pow( 3.25, 1.5 ), 1 / pow( 1.25, 1.5 ) };
+  double expected = ( weights[0] * 1 + weights[1] * 2 + weights[2] * 3 + weights[3] * 4 ) / ( weights[0] + weights[1] + weights[2] + weights[3] );
+  interpolator.setDistanceCoefficient( 3 );
+  QCOMPARE( interpolator.interpolatePoint( -0.5, 0, result ), 0 );
+  QVERIFY( qgsDoubleNear( result, expected, 1e-12 ) );
+  interpolator.setDistanceCoefficient( 3.0000001 );
+  QCOMPARE( interpolator.interpolatePoint( -0.5, 0, result ), 0 );
+  QVERIFY( qgsDoubleNear( result, expected, 1e-6 ) );
+}
+
+void TestQgsIDWInterpolator::nearestPoints()
+{
+  QgsIDWInterpolator interpolator( layerData( mRandomLayer ) );
+  interpolator.setMaxPoints( 1 );
+  double result;
+
+  QCOMPARE( interpolator.interpolatePoint( mRandomPoints.at( 10 ).x() + 0.001, mRandomPoints.at( 10 ).y(), result ), 0 );
+  QCOMPARE( result, mRandomValues.at( 10 ) );
+
+  // compare with the weighted mean of the 5 nearest points, found by brute force
+  interpolator.setMaxPoints( 5 );
+  for ( int i = 0; i < 20; ++i )
+  {
+    QgsPoint point( i * 5.3, 100 - i * 4.1 );
+    QList< QPair<double, int> > distances;
+    for ( int j = 0; j < mRandomPoints.count(); ++j )
+      distances << qMakePair( point.sqrDist( mRandomPoints.at( j ) ), j );
+    std::sort( distances.begin(), distances.end() );
+
+    double sumCounter = 0;
+    double sumDenominator = 0;
+    for ( int j = 0; j < 5; ++j )
+    {
+      double weight = 1 / distances.at( j ).first;
+      sumCounter += weight * mRandomValues.at( distances.at( j ).second );
+      sumDenominator += weight;
+    }
+
+    QCOMPARE( interpolator.interpolatePoint( point.x(), point.y(), result ), 0 );
+    QVERIFY( qgsDoubleNear( result, sumCounter / sumDenominator, 1e-9 ) );
+  }
+}
+
+void TestQgsIDWInterpolator::searchRadius()
+{
+  QgsIDWInterpolator interpolator( layerData( mSquareLayer ) );
+  double result;
+
+  // only the nearest corner is within the radius
+  interpolator.setSearchRadius( 0.5 );
+  QCOMPARE( interpolator.interpolatePoint( 0.9, 0.9, result ), 0 );
+  QCOMPARE( result, 3.0 );
+
+  // no point within the radius
+  QCOMPARE( interpolator.interpolatePoint( 0.5, 0.5, result ), 1 );
+
+  // two points within the radius, at the same distance
+  interpolator.setSearchRadius( 0.6 );
+  QCOMPARE( interpolator.interpolatePoint( 0.5, 0, result ), 0 );
+  QVERIFY( qgsDoubleNear( result, 1.5 ) );
+
+  // the search radius limits the nearest points
+  interpolator.setMaxPoints( 3 );
+  QVERIFY( interpolator.prepareConcurrentInterpolation() );
+  QCOMPARE( interpolator.interpolatePoint( 0.5, 0, result ), 0 );
+  QVERIFY( qgsDoubleNear( result, 1.5 ) );
+}
+
+QTEST_MAIN( TestQgsIDWInterpolator )
+#include "testqgsidwinterpolator.moc"
@@ -0,0 +1,240 @@
+/***************************************************************************
+     testqgsninecellfilter.cpp
+     --------------------------------------
+    Date                 : May 2016
+    Copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QThreadPool>
+#include <QVector>
+
+#include "qgsapplication.h"
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsruggednessfilter.h"
+#include "qgsslopefilter.h"
+
+#include <gdal.h>
+
+//! Exposes the window method of the ruggedness filter
+class TestRuggednessFilter : public QgsRuggednessFilter
+{
+  public:
+    TestRuggednessFilter( const QString& inputFile, const QString& outputFile )
+        : QgsRuggednessFilter( inputFile, outputFile, "GTiff" )
+    {}
+
+    float window( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
+    {
+      return processNineCellWindow( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+    }
+};
+
+/** \ingroup UnitTests
+ * This is a unit test for the nine cell filters. The rows processed by strips, possibly in parallel,
+ * must give the same values as the filter applied on each 3x3 window.
+ */
+class TestQgsNineCellFilter : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init() {}
+    void cleanup() {}
+
+    void slope();
+    void aspect();
+    void hillshade();
+    void ruggedness();
+    void singleThread();
+
+  private:
+    QString mInputFile;
+    int mWidth;
+    int mHeight;
+    QVector<float> mValues;
+
+    QString tempFile( const QString& name ) const;
+    bool readOutput( const QString& file, QVector<float>& values ) const;
+
+    //! Compares the output file with the filter applied on each window of the input
+    template <typename F> void compareWithWindows( const QString& outputFile, F& filter );
+};
+
+static const float INPUT_NODATA = -9999;
+
+QString TestQgsNineCellFilter::tempFile( const QString& name ) const
+{
+  return QString( "%1/ninecelltest-%2.tif" ).arg( QDir::tempPath(), name );
+}
+
+void TestQgsNineCellFilter::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  GDALAllRegister();
+
+  // wide enough to use several strips of less than 256 rows
+  mWidth = 8192;
+  mHeight = 300;
+  mValues.resize( mWidth * mHeight );
+  unsigned int state = 1;
+  for ( int i = 0; i < mHeight; ++i )
+  {
+    for ( int j = 0; j < mWidth; ++j )
+    {
+      state = state * 1103515245 + 12345;
+      mValues[i * mWidth + j] = 100.0f + 0.05f * j + 0.2f * i + ( state >> 16 ) % 100 / 10.0f;
+    }
+  }
+  // holes on a few rows, including the first one and at strip boundaries
+  int holes[] = { 0, 5, 127, 128, 200, 299 };
+  for ( unsigned int h = 0; h < sizeof( holes ) / sizeof( int ); ++h )
+  {
+    for ( int j = h * 7; j < mWidth; j += 997 )
+      mValues[holes[h] * mWidth + j] = INPUT_NODATA;
+  }
+
+  mInputFile = tempFile( "dem" );
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  GDALDatasetH dataset = GDALCreate( driver, mInputFile.toUtf8().constData(), mWidth, mHeight, 1, GDT_Float32, nullptr );
+  QVERIFY( dataset );
+  double geoTransform[6] = { 1000, 10, 0, 5000, 0, -10 };
+  GDALSetGeoTransform( dataset, geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, INPUT_NODATA );
+  QCOMPARE( GDALRasterIO( band, GF_Write, 0, 0, mWidth, mHeight, mValues.data(), mWidth, mHeight, GDT_Float32, 0, 0 ), CE_None );
+  GDALClose( dataset );
+}
+
+void TestQgsNineCellFilter::cleanupTestCase()
+{
+  QFile::remove( mInputFile );
+  QgsApplication::exitQgis();
+}
+
+bool TestQgsNineCellFilter::readOutput( const QString& file, QVector<float>& values ) const
+{
+  GDALDatasetH dataset = GDALOpen( file.toUtf8().constData(), GA_ReadOnly );
+  if ( !dataset )
+    return false;
+
+  values.resize( mWidth * mHeight );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  bool ok = GDALRasterIO( band, GF_Read, 0, 0, mWidth, mHeight, values.data(), mWidth, mHeight, GDT_Float32, 0, 0 ) == CE_None;
+  GDALClose( dataset );
+  return ok;
+}
+
+template <typename F> void TestQgsNineCellFilter::compareWithWindows( const QString& outputFile, F& filter )
+{
+  QVector<float> output;
+  QVERIFY( readOutput( outputFile, output ) );
+  QFile::remove( outputFile );
+
+  // cells outside of the raster are nodata
+  int stride = mWidth + 2;
+  QVector<float> padded( ( mHeight + 2 ) * stride, INPUT_NODATA );
+  for ( int i = 0; i < mHeight; ++i )
+    memcpy( padded.data() + ( i + 1 ) * stride + 1, mValues.constData() + i * mWidth, mWidth * sizeof( float ) );
+
+  for ( int i = 0; i < mHeight; ++i )
+  {
+    float* r1 = padded.data() + i * stride + 1;
+    float* r2 = r1 + stride;
+    float* r3 = r2 + stride;
+    for ( int j = 0; j < mWidth; ++j )
+    {
+      float expected = filter.window( &r1[j-1], &r1[j], &r1[j+1], &r2[j-1], &r2[j], &r2[j+1], &r3[j-1], &r3[j], &r3[j+1] );
+      if ( output.at( i * mWidth + j ) != expected )
+      {
+        QFAIL( QString( "Cell %1,%2: %3 instead of %4" ).arg( j ).arg( i ).arg( output.at( i * mWidth + j ) ).arg( expected ).toUtf8().constData() );
+      }
+    }
+  }
+}
+
+//! Calls the window method of a filter for compareWithWindows()
+template <typename T> class WindowFilter
+{
+  public:
+    explicit WindowFilter( T& filter ) : mFilter( filter ) {}
+
+    float window( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
+    {
+      return mFilter.processNineCellWindow( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+    }
+
+  private:
+    T& mFilter;
+};
+
+void TestQgsNineCellFilter::slope()
+{
+  QString outputFile = tempFile( "slope" );
+  QgsSlopeFilter filter( mInputFile, outputFile, "GTiff" );
+  filter.setZFactor( 2.0 );
+  QCOMPARE( filter.processRaster( nullptr ), 0 );
+
+  WindowFilter<QgsSlopeFilter> windows( filter );
+  compareWithWindows( outputFile, windows );
+}
+
+void TestQgsNineCellFilter::aspect()
+{
+  QString outputFile = tempFile( "aspect" );
+  QgsAspectFilter filter( mInputFile, outputFile, "GTiff" );
+  QCOMPARE( filter.processRaster( nullptr ), 0 );
+
+  WindowFilter<QgsAspectFilter> windows( filter );
+  compareWithWindows( outputFile, windows );
+}
+
+void TestQgsNineCellFilter::hillshade()
+{
+  QString outputFile = tempFile( "hillshade" );
+  QgsHillshadeFilter filter( mInputFile, outputFile, "GTiff", 315, 45 );
+  QCOMPARE( filter.processRaster( nullptr ), 0 );
+
+  WindowFilter<QgsHillshadeFilter> windows( filter );
+  compareWithWindows( outputFile, windows );
+}
+
+void TestQgsNineCellFilter::ruggedness()
+{
+  // default row implementation
+  QString outputFile = tempFile( "ruggedness" );
+  TestRuggednessFilter filter( mInputFile, outputFile );
+  QCOMPARE( filter.processRaster( nullptr ), 0 );
+
+  compareWithWindows( outputFile, filter );
+}
+
+void TestQgsNineCellFilter::singleThread()
+{
+  int threads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+
+  QString outputFile = tempFile( "slope1" );
+  QgsSlopeFilter filter( mInputFile, outputFile, "GTiff" );
+  int res = filter.processRaster( nullptr );
+  QThreadPool::globalInstance()->setMaxThreadCount( threads );
+  QCOMPARE( res, 0 );
+
+  WindowFilter<QgsSlopeFilter> windows( filter );
+  compareWithWindows( outputFile, windows );
+}
+
+QTEST_MAIN( TestQgsNineCellFilter )
+#include "testqgsninecellfilter.moc"
@@ -56,6 +56,9 @@ class TestQgsRasterCalculator : public QObject
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
+    void calcWithTiles();
+
+    void calculateBlock(); // whole block evaluation gives the same values as the matrices
 
   private:
 
@@ -528,5 +531,100 @@ void TestQgsRasterCalculator::calcWithReprojectedLayers()
   delete block;
 }
 
+void TestQgsRasterCalculator::calcWithTiles()
+{
+  QgsRasterCalculatorEntry entry1;
+  entry1.bandNumber = 1;
+  entry1.raster = mpLandsatRasterLayer;
+  entry1.ref = "landsat@1";
+
+  QgsRasterCalculatorEntry entry2;
+  entry2.bandNumber = 2;
+  entry2.raster = mpLandsatRasterLayer;
+  entry2.ref = "landsat@2";
+
+  QVector<QgsRasterCalculatorEntry> entries;
+  entries << entry1 << entry2;
+
+  QgsCoordinateReferenceSystem crs;
+  crs.createFromId( 32633, QgsCoordinateReferenceSystem::EpsgCrsId );
+  QgsRectangle extent( 783235, 3348110, 783350, 3347960 );
+
+  QTemporaryFile tmpFile;
+  tmpFile.open(); // fileName is no avialable until open
+  QString tmpName = tmpFile.fileName();
+  tmpFile.close();
+
+  //one tile per pixel, same result as the whole extent
+  QgsRasterCalculator rc( QString( "\"landsat@1\" + \"landsat@2\"" ),
+                          tmpName,
+                          "GTiff",
+                          extent, crs, 2, 3, entries );
+  QCOMPARE( rc.tileSize(), 512 );
+  rc.setTileSize( 1 );
+  QCOMPARE( rc.tileSize(), 1 );
+  QCOMPARE( rc.processCalculation(), 0 );
+
+  QgsRasterLayer* result = new QgsRasterLayer( tmpName, "result" );
+  QgsRasterBlock* block = result->dataProvider()->block( 1, extent, 2, 3 );
+  QCOMPARE( block->value( 0, 0 ), 265.0 );
+  QCOMPARE( block->value( 0, 1 ), 263.0 );
+  QCOMPARE( block->value( 1, 0 ), 263.0 );
+  QCOMPARE( block->value( 1, 1 ), 264.0 );
+  QCOMPARE( block->value( 2, 0 ), 266.0 );
+  QCOMPARE( block->value( 2, 1 ), 261.0 );
+  delete result;
+  delete block;
+}
+
+void TestQgsRasterCalculator::calculateBlock()
+{
+  QgsRasterBlock m1( QGis::Float32, 2, 3, -1.0 );
+  m1.setValue( 0, 0, 1.0 );
+  m1.setValue( 0, 1, 2.0 );
+  m1.setValue( 1, 0, -2.0 );
+  m1.setValue( 1, 1, -1.0 ); //nodata
+  m1.setValue( 2, 0, 0.0 );
+  m1.setValue( 2, 1, 4.0 );
+  QgsRasterBlock m2( QGis::Float32, 2, 3, -2.0 );
+  m2.setValue( 0, 0, 3.0 );
+  m2.setValue( 0, 1, -2.0 ); //nodata
+  m2.setValue( 1, 0, 0.5 );
+  m2.setValue( 1, 1, 7.0 );
+  m2.setValue( 2, 0, 0.0 );
+  m2.setValue( 2, 1, 2.0 );
+  QMap<QString, QgsRasterBlock*> rasterData;
+  rasterData.insert( "raster1", &m1 );
+  rasterData.insert( "raster2", &m2 );
+
+  QStringList formulas;
+  formulas << "\"raster1\" + 2 * \"raster2\""
+  << "\"raster1\" / \"raster2\""
+  << "\"raster1\" ^ \"raster2\" - sqrt( \"raster1\" )"
+  << "log10( \"raster2\" ) > \"raster1\" OR \"raster1\" = 0"
+  << "-\"raster1\" * ( 3 + 4 )"
+  << "5";
+
+  Q_FOREACH ( const QString& formula, formulas )
+  {
+    QString error;
+    QgsRasterCalcNode* node = QgsRasterCalcNode::parseRasterCalcString( formula, error );
+    QVERIFY( node );
+
+    QgsRasterMatrix expected;
+    expected.setNodataValue( -9999 );
+    QVERIFY( node->calculate( rasterData, expected ) );
+
+    QVector<double> values( 6 );
+    QVector<double> scratch( node->scratchSize( 6 ) );
+    QVERIFY( node->calculateBlock( rasterData, values.data(), 6, -9999, scratch.data() ) );
+    for ( int i = 0; i < 6; ++i )
+    {
+      QCOMPARE( values.at( i ), expected.isNumber() ? expected.number() : expected.data()[i] );
+    }
+    delete node;
+  }
+}
+
 QTEST_MAIN( TestQgsRasterCalculator )
 #include "testqgsrastercalculator.moc"
@@ -38,6 +38,7 @@ class TestQgsZonalStatistics : public QObject
     void cleanup() {}
 
     void testStatistics();
+    void testAllStatistics();
 
   private:
     QgsVectorLayer* mVectorLayer;
@@ -135,5 +136,46 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "myqgis2_me" ).toDouble(), 0.833333333333333 );
 }
 
+void TestQgsZonalStatistics::testAllStatistics()
+{
+  QgsZonalStatistics zs( mVectorLayer, mRasterPath, "a", 1, QgsZonalStatistics::All );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  QgsFeature f;
+  QgsFeatureRequest request;
+  request.setFilterFid( 0 );
+  bool fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
+  QVERIFY( fetched );
+  QCOMPARE( f.attribute( "acount" ).toDouble(), 12.0 );
+  QCOMPARE( f.attribute( "asum" ).toDouble(), 8.0 );
+  QCOMPARE( f.attribute( "amedian" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "astdev" ).toDouble(), 0.471404520791032 );
+  QCOMPARE( f.attribute( "amin" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "amax" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "arange" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "aminority" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "amajority" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "avariety" ).toInt(), 2 );
+
+  request.setFilterFid( 1 );
+  fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
+  QVERIFY( fetched );
+  QCOMPARE( f.attribute( "acount" ).toDouble(), 9.0 );
+  QCOMPARE( f.attribute( "asum" ).toDouble(), 5.0 );
+  QCOMPARE( f.attribute( "amedian" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "amajority" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "avariety" ).toInt(), 2 );
+
+  request.setFilterFid( 2 );
+  fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
+  QVERIFY( fetched );
+  QCOMPARE( f.attribute( "acount" ).toDouble(), 6.0 );
+  QCOMPARE( f.attribute( "asum" ).toDouble(), 5.0 );
+  QCOMPARE( f.attribute( "amedian" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "aminority" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "amajority" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "avariety" ).toInt(), 2 );
+}
+
 QTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
@@ -16,7 +16,11 @@
  ***************************************************************************/
 #include "qgscoordinatetransform.h"
 #include "qgsapplication.h"
+#include "qgsgeometry.h"
+#include "qgsgeometrycollectionv2.h"
+#include "qgspointv2.h"
 #include <QObject>
+#include <QPolygonF>
 #include <QtTest/QtTest>
 
 class TestQgsCoordinateTransform: public QObject
@@ -27,6 +31,8 @@ class TestQgsCoordinateTransform: public QObject
     void initTestCase();
     void cleanupTestCase();
     void transformBoundingBox();
+    void linearTransform();
+    void transformPolygons();
 
   private:
 
@@ -73,5 +79,70 @@ void TestQgsCoordinateTransform::transformBoundingBox()
   QVERIFY( qgsDoubleNear( resultRect.yMaximum(), expectedRect.yMaximum(), 0.001 ) );
 }
 
+void TestQgsCoordinateTransform::linearTransform()
+{
+  // New York Long Island, in US feet and in meters
+  QgsCoordinateReferenceSystem feetSrs;
+  feetSrs.createFromSrid( 2263 );
+  QgsCoordinateReferenceSystem metersSrs;
+  metersSrs.createFromSrid( 32118 );
+  QgsCoordinateReferenceSystem wgs84Srs;
+  wgs84Srs.createFromSrid( 4326 );
+
+  QgsCoordinateTransform tr( feetSrs, metersSrs );
+  QVERIFY( tr.isLinear() );
+  QVERIFY( !QgsCoordinateTransform( feetSrs, wgs84Srs ).isLinear() );
+  QVERIFY( !QgsCoordinateTransform( metersSrs, wgs84Srs ).isLinear() );
+
+  // same result as through geographic coordinates with PROJ.4
+  QgsCoordinateTransform toWgs84( feetSrs, wgs84Srs );
+  QgsCoordinateTransform fromWgs84( wgs84Srs, metersSrs );
+  QgsPoint feetPoint( 988000, 200000 );
+  QgsPoint expected = fromWgs84.transform( toWgs84.transform( feetPoint ) );
+  QgsPoint metersPoint = tr.transform( feetPoint );
+  QVERIFY( qgsDoubleNear( metersPoint.x(), expected.x(), 0.001 ) );
+  QVERIFY( qgsDoubleNear( metersPoint.y(), expected.y(), 0.001 ) );
+
+  QgsPoint reversed = tr.transform( metersPoint, QgsCoordinateTransform::ReverseTransform );
+  QVERIFY( qgsDoubleNear( reversed.x(), feetPoint.x(), 0.000001 ) );
+  QVERIFY( qgsDoubleNear( reversed.y(), feetPoint.y(), 0.000001 ) );
+}
+
+void TestQgsCoordinateTransform::transformPolygons()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  QList<QPolygonF> polygons;
+  polygons << ( QPolygonF() << QPointF( 0, 0 ) << QPointF( 10, 0 ) << QPointF( 10, 10 ) << QPointF( 0, 0 ) );
+  polygons << QPolygonF();
+  polygons << ( QPolygonF() << QPointF( -120, 45 ) << QPointF( -110, 50 ) );
+
+  QList<QPolygonF> expected = polygons;
+  for ( int i = 0; i < expected.size(); ++i )
+    tr.transformPolygon( expected[i] );
+
+  tr.transformPolygons( polygons );
+  QCOMPARE( polygons, expected );
+
+  // multi geometries transform all their vertices at once
+  QScopedPointer<QgsGeometry> multiPolygon( QgsGeometry::fromWkt( "MultiPolygon(((0 0, 10 0, 10 10, 0 0),(2 1, 8 1, 8 7, 2 1)),((20 20, 30 20, 30 30, 20 20)))" ) );
+  QScopedPointer<QgsGeometry> part( QgsGeometry::fromWkt( "Polygon((20 20, 30 20, 30 30, 20 20))" ) );
+  QCOMPARE( multiPolygon->transform( tr ), 0 );
+  QCOMPARE( part->transform( tr ), 0 );
+  const QgsGeometryCollectionV2* parts = static_cast< const QgsGeometryCollectionV2* >( multiPolygon->geometry() );
+  QCOMPARE( parts->geometryN( 1 )->asWkt( 2 ), part->geometry()->asWkt( 2 ) );
+
+  QScopedPointer<QgsGeometry> multiPoint( QgsGeometry::fromWkt( "MultiPoint((0 0),(10 20),(-120 45))" ) );
+  QCOMPARE( multiPoint->transform( tr ), 0 );
+  QgsPoint expectedPoint = tr.transform( QgsPoint( -120, 45 ) );
+  const QgsPointV2* point = static_cast< const QgsPointV2* >( static_cast< const QgsGeometryCollectionV2* >( multiPoint->geometry() )->geometryN( 2 ) );
+  QVERIFY( qgsDoubleNear( point->x(), expectedPoint.x(), 0.000001 ) );
+  QVERIFY( qgsDoubleNear( point->y(), expectedPoint.y(), 0.000001 ) );
+}
+
 QTEST_MAIN( TestQgsCoordinateTransform )
 #include "testqgscoordinatetransform.moc"
@@ -382,6 +382,9 @@ class TestQgsExpression: public QObject
       QTest::newRow( "invalid and" ) << "'foo' and 2=3" << true << QVariant();
       QTest::newRow( "invalid or" ) << "'foo' or 2=3" << true << QVariant();
       QTest::newRow( "invalid not" ) << "not 'foo'" << true << QVariant();
+      QTest::newRow( "short-circuit and" ) << "2=3 and 'foo'" << false << QVariant( 0 );
+      QTest::newRow( "short-circuit or" ) << "1=1 or 'foo'" << false << QVariant( 1 );
+      QTest::newRow( "invalid right and" ) << "1=1 and 'foo'" << true << QVariant();
 
       // in, not in
       QTest::newRow( "in 1" ) << "1 in (1,2,3)" << false << QVariant( 1 );
@@ -942,6 +945,271 @@ class TestQgsExpression: public QObject
       run_evaluation_test( exp4, evalError, result );
     }
 
+    void compiled_evaluation_data()
+    {
+      evaluation_data();
+    }
+
+    void compiled_evaluation()
+    {
+      QFETCH( QString, string );
+
+      QgsExpressionContext context;
+
+      QgsExpression tree( string );
+      tree.setCompilationEnabled( false );
+      tree.prepare( &context );
+      QVERIFY( !tree.isCompiled() );
+      QVariant treeResult = tree.evaluate( &context );
+
+      QgsExpression compiled( string );
+      compiled.prepare( &context );
+      QVariant compiledResult = compiled.evaluate( &context );
+
+      QCOMPARE( compiled.hasEvalError(), tree.hasEvalError() );
+      QCOMPARE( compiled.evalErrorString(), tree.evalErrorString() );
+      QCOMPARE( compiledResult.type(), treeResult.type() );
+      if ( compiledResult.type() != QVariant::UserType )
+        QCOMPARE( compiledResult, treeResult );
+    }
+
+    void compiled_columns_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      QTest::newRow( "column" ) << "int";
+      QTest::newRow( "int arithmetic" ) << "int * 2 + int % 3 - 1";
+      QTest::newRow( "double arithmetic" ) << "dbl / 2 + int ^ 2";
+      QTest::newRow( "int division" ) << "int // 2 + dbl // 0";
+      QTest::newRow( "mixed division" ) << "int / dbl";
+      QTest::newRow( "string concat" ) << "str || '_' || int";
+      QTest::newRow( "string plus" ) << "str + str";
+      QTest::newRow( "string arithmetic" ) << "str * 2";
+      QTest::newRow( "numeric string comparison" ) << "numstr > int";
+      QTest::newRow( "comparison" ) << "int > 2 and dbl <= 5.5 or str = 'b'";
+      QTest::newRow( "is" ) << "int is null or str is not 'a'";
+      QTest::newRow( "not" ) << "not int and -dbl < 0";
+      QTest::newRow( "like" ) << "str like 'a%' or str ilike 'B'";
+      QTest::newRow( "in" ) << "int in (1, 3, null) or str not in ('a', 'c')";
+      QTest::newRow( "in empty" ) << "int / 0 not in ()";
+      QTest::newRow( "case" ) << "case when int > 2 then 'big' when int is null then dbl else str end";
+      QTest::newRow( "case no else" ) << "case when str = 'a' then int * 10 end";
+      QTest::newRow( "function" ) << "upper(str) || abs(-int) || coalesce(int, dbl, 0)";
+      QTest::newRow( "function null arg" ) << "left(str, to_int('x'))";
+      QTest::newRow( "lazy function" ) << "'x' || if(int > 1, str, dbl)";
+      QTest::newRow( "eval error" ) << "int + to_real('x')";
+      QTest::newRow( "boolean literal" ) << "true and int";
+      QTest::newRow( "short-circuit" ) << "int <= 0 or numstr * 2 > 3";
+      QTest::newRow( "nested short-circuit" ) << "int > 0 and ( dbl > 0 or str * 2 > 1 )";
+      QTest::newRow( "common subexpression" ) << "int * ( 1000 * 1000 ) + int * ( 1000 * 1000 )";
+    }
+
+    void compiled_columns()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( "int", QVariant::Int ) );
+      fields.append( QgsField( "dbl", QVariant::Double ) );
+      fields.append( QgsField( "str", QVariant::String ) );
+      fields.append( QgsField( "numstr", QVariant::String ) );
+
+      QList<QgsAttributes> rows;
+      rows << ( QgsAttributes() << 1 << 2.5 << "a" << "1" );
+      rows << ( QgsAttributes() << 3 << 0.0 << "b" << "10.5" );
+      rows << ( QgsAttributes() << 0 << -7.25 << "c" << "x" );
+      rows << ( QgsAttributes() << QVariant( QVariant::Int ) << QVariant( QVariant::Double ) << QVariant( QVariant::String ) << QVariant() );
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( QgsFeature(), fields );
+
+      QgsExpression tree( string );
+      tree.setCompilationEnabled( false );
+      QVERIFY( tree.prepare( &context ) );
+
+      QgsExpression compiled( string );
+      QVERIFY( compiled.prepare( &context ) );
+      QVERIFY( compiled.isCompiled() );
+
+      Q_FOREACH ( const QgsAttributes& attributes, rows )
+      {
+        QgsFeature f( fields );
+        f.setAttributes( attributes );
+        context.setFeature( f );
+
+        QVariant treeResult = tree.evaluate( &context );
+        QVariant compiledResult = compiled.evaluate( &context );
+        QCOMPARE( compiled.hasEvalError(), tree.hasEvalError() );
+        QCOMPARE( compiled.evalErrorString(), tree.evalErrorString() );
+        QCOMPARE( compiledResult.type(), treeResult.type() );
+        QCOMPARE( compiledResult.isNull(), treeResult.isNull() );
+        QCOMPARE( compiledResult, treeResult );
+      }
+    }
+
+    void block_evaluation_data()
+    {
+      compiled_columns_data();
+    }
+
+    void block_evaluation()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( "int", QVariant::Int ) );
+      fields.append( QgsField( "dbl", QVariant::Double ) );
+      fields.append( QgsField( "str", QVariant::String ) );
+      fields.append( QgsField( "numstr", QVariant::String ) );
+
+      // blocks without NULL values have numeric columns evaluated by the typed loops
+      QgsFeatureList numbers;
+      QgsFeatureList mixed;
+      for ( int i = 0; i < 50; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttributes( QgsAttributes() << i % 7 - 3 << 0.5 * ( i % 11 ) - 2.0 << QString( "s%1" ).arg( i % 3 ) << QString::number( i ) );
+        numbers << f;
+        QgsFeature g( f );
+        if ( i % 5 == 0 )
+          g.setAttributes( QgsAttributes() << QVariant( QVariant::Int ) << QVariant( QVariant::Double ) << QVariant( QVariant::String ) << "x" );
+        mixed << g;
+      }
+
+      QList<QgsFeatureList> blocks;
+      blocks << numbers << mixed << QgsFeatureList();
+
+      Q_FOREACH ( const QgsFeatureList& block, blocks )
+      {
+        QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( QgsFeature(), fields );
+
+        QgsExpression tree( string );
+        tree.setCompilationEnabled( false );
+        QVERIFY( tree.prepare( &context ) );
+
+        QVariantList expected;
+        QString expectedError;
+        Q_FOREACH ( const QgsFeature& f, block )
+        {
+          context.setFeature( f );
+          expected << tree.evaluate( &context );
+          if ( tree.hasEvalError() )
+            expectedError = tree.evalErrorString();
+        }
+
+        QgsExpression compiled( string );
+        QVERIFY( compiled.prepare( &context ) );
+
+        QVariantList results = compiled.evaluateBlock( &context, block );
+        QCOMPARE( results.count(), block.count() );
+        QCOMPARE( compiled.hasEvalError(), !expectedError.isNull() );
+        QCOMPARE( compiled.evalErrorString(), expectedError );
+        for ( int i = 0; i < results.count(); ++i )
+        {
+          QCOMPARE( results.at( i ).type(), expected.at( i ).type() );
+          QCOMPARE( results.at( i ).isNull(), expected.at( i ).isNull() );
+          QCOMPARE( results.at( i ), expected.at( i ) );
+        }
+
+        QVector<bool> mask = compiled.filterBlock( &context, block );
+        QCOMPARE( mask.count(), block.count() );
+        for ( int i = 0; i < mask.count(); ++i )
+          QCOMPARE( mask.at( i ), expected.at( i ).toBool() );
+
+        // not compiled expressions are evaluated feature by feature
+        QVariantList treeResults = tree.evaluateBlock( &context, block );
+        QCOMPARE( treeResults, expected );
+        QCOMPARE( tree.evalErrorString(), expectedError );
+      }
+    }
+
+    void compiled_optimizations()
+    {
+      QgsFields fields;
+      fields.append( QgsField( "int", QVariant::Int ) );
+      QgsFeature f( fields );
+      f.setAttributes( QgsAttributes() << 3 );
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+      QgsExpressionContextScope* scope = new QgsExpressionContextScope();
+      scope->addVariable( QgsExpressionContextScope::StaticVariable( "factor", 2, false, true ) );
+      scope->setVariable( "offset", 5 );
+      context << scope;
+
+      // constant subtrees and variables of static scopes are folded
+      QgsExpression folded( "int * ( 1000 * 1000 ) + @factor * 2" );
+      QVERIFY( folded.prepare( &context ) );
+      QVERIFY( folded.dumpCompiled().contains( "const 1000000 (folded" ) );
+      QVERIFY( folded.dumpCompiled().contains( "const 4 (folded" ) );
+      QCOMPARE( folded.evaluate( &context ), QVariant( 3000004 ) );
+
+      // other variables may change between evaluations
+      QgsExpression notFolded( "@offset * 2" );
+      QVERIFY( notFolded.prepare( &context ) );
+      QVERIFY( !notFolded.dumpCompiled().contains( "folded" ) );
+      scope->setVariable( "offset", 6 );
+      QCOMPARE( notFolded.evaluate( &context ), QVariant( 12 ) );
+
+      // folded variables shadowed by a scope pushed after the preparation
+      QgsExpressionContextScope* shadowing = new QgsExpressionContextScope();
+      shadowing->setVariable( "factor", 10 );
+      context << shadowing;
+      QCOMPARE( folded.evaluate( &context ), QVariant( 3000020 ) );
+      QgsExpression shadowed( "@factor * 2" );
+      QVERIFY( shadowed.prepare( &context ) );
+      QVERIFY( !shadowed.dumpCompiled().contains( "folded" ) );
+      delete context.popScope();
+      QCOMPARE( folded.evaluate( &context ), QVariant( 3000004 ) );
+
+      // overwriting a static variable makes it variable
+      scope->setVariable( "factor", 3 );
+      QVERIFY( !scope->isStatic( "factor" ) );
+      QCOMPARE( folded.evaluate( &context ), QVariant( 3000006 ) );
+
+      // identical subexpressions are computed once
+      QgsExpression shared( "abs( int - 10 ) + abs( int - 10 )" );
+      QVERIFY( shared.prepare( &context ) );
+      QVERIFY( shared.dumpCompiled().contains( "reuse" ) );
+      QCOMPARE( shared.evaluate( &context ), QVariant( 14 ) );
+
+      // but not if the first one is only evaluated conditionally
+      QgsExpression conditional( "int > 5 and abs( int - 10 ) > 1 or abs( int - 10 ) > 2" );
+      QVERIFY( conditional.prepare( &context ) );
+      QVERIFY( !conditional.dumpCompiled().contains( "reuse" ) );
+      QCOMPARE( conditional.evaluate( &context ), QVariant( 1 ) );
+
+      // nor for volatile functions
+      QgsExpression random( "rand( 1, 1000000 ) = rand( 1, 1000000 )" );
+      QVERIFY( random.prepare( &context ) );
+      QVERIFY( !random.dumpCompiled().contains( "reuse" ) );
+    }
+
+    void compiled_copy()
+    {
+      QgsFields fields;
+      fields.append( QgsField( "int", QVariant::Int ) );
+      QgsFeature f( fields );
+      f.setAttributes( QgsAttributes() << 5 );
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+
+      QgsExpression exp( "int * 2" );
+      QVERIFY( exp.prepare( &context ) );
+      QVERIFY( exp.isCompiled() );
+
+      // copies share the parsed tree, but are compiled again when prepared
+      QgsExpression copy( exp );
+      QCOMPARE( copy.evaluate( &context ).toInt(), 10 );
+      copy.setCompilationEnabled( false );
+      QVERIFY( !copy.isCompiled() );
+      QVERIFY( exp.isCompiled() );
+      QVERIFY( copy.prepare( &context ) );
+      QVERIFY( !copy.isCompiled() );
+      QCOMPARE( copy.evaluate( &context ).toInt(), 10 );
+      QCOMPARE( exp.evaluate( &context ).toInt(), 10 );
+
+      // column references without a feature in the context are not evaluated from the compiled code
+      QgsExpressionContext noFeature;
+      QCOMPARE( exp.evaluate( &noFeature ), copy.evaluate( &noFeature ) );
+    }
+
     void eval_precedence()
     {
       QCOMPARE( QgsExpression::BinaryOperatorText[QgsExpression::boDiv], "/" );
@@ -24,6 +24,7 @@
 #include <QPointF>
 #include <QImage>
 #include <QPainter>
+#include <limits>
 
 //qgis includes...
 #include <qgsapplication.h>
@@ -35,6 +36,7 @@
 #include "qgspolygonv2.h"
 #include "qgscircularstringv2.h"
 #include "qgsgeometrycollectionv2.h"
+#include "qgswkbview.h"
 
 //qgs unit test utility class
 #include "qgsrenderchecker.h"
@@ -60,6 +62,9 @@ class TestQgsGeometry : public QObject
     void isEmpty();
     void pointV2(); //test QgsPointV2
     void lineStringV2(); //test QgsLineStringV2
+    void lineStringV2Arrays(); //test whole array operations of QgsLineStringV2 against point by point results
+    void wkbView(); //test QgsWkbView against the geometry objects
+    void deferredWkb(); //test geometries built from wkb only when needed
     void polygonV2(); //test QgsPolygonV2
 
     void fromQgsPoint();
@@ -2139,6 +2144,180 @@ void TestQgsGeometry::lineStringV2()
   QVERIFY( l39.numPoints() == 0 );
 }
 
+void TestQgsGeometry::lineStringV2Arrays()
+{
+  // odd and even counts, to cover both the vectorized and the remaining points
+  for ( int n = 0; n < 12; ++n )
+  {
+    QgsPointSequenceV2 pts;
+    for ( int i = 0; i < n; ++i )
+      pts << QgsPointV2( 0.1 * i * i - 3.7, 1.3 * ( i % 5 ) + 0.01 * i );
+    if ( n > 3 )
+      pts << pts.at( 0 );
+    QgsLineStringV2 l;
+    l.setPoints( pts );
+
+    double length = 0;
+    double area = 0;
+    double xMin = std::numeric_limits<double>::max(), yMin = std::numeric_limits<double>::max();
+    double xMax = -std::numeric_limits<double>::max(), yMax = -std::numeric_limits<double>::max();
+    for ( int i = 0; i < pts.count(); ++i )
+    {
+      xMin = qMin( xMin, pts.at( i ).x() );
+      yMin = qMin( yMin, pts.at( i ).y() );
+      xMax = qMax( xMax, pts.at( i ).x() );
+      yMax = qMax( yMax, pts.at( i ).y() );
+      if ( i > 0 )
+      {
+        double dx = pts.at( i ).x() - pts.at( i - 1 ).x();
+        double dy = pts.at( i ).y() - pts.at( i - 1 ).y();
+        length += sqrt( dx * dx + dy * dy );
+        area += 0.5 * ( pts.at( i - 1 ).x() * pts.at( i ).y() - pts.at( i - 1 ).y() * pts.at( i ).x() );
+      }
+    }
+    if ( pts.count() == 2 )
+      area = 0;
+
+    QCOMPARE( l.length(), length );
+    double sum = 0;
+    l.sumUpArea( sum );
+    QCOMPARE( sum, area );
+    if ( n > 0 )
+    {
+      QCOMPARE( l.boundingBox().xMinimum(), xMin );
+      QCOMPARE( l.boundingBox().yMinimum(), yMin );
+      QCOMPARE( l.boundingBox().xMaximum(), xMax );
+      QCOMPARE( l.boundingBox().yMaximum(), yMax );
+    }
+
+    QPolygonF poly = l.asQPolygonF();
+    QCOMPARE( poly.count(), pts.count() );
+    for ( int i = 0; i < pts.count(); ++i )
+      QCOMPARE( poly.at( i ), QPointF( pts.at( i ).x(), pts.at( i ).y() ) );
+
+    QList< QTransform > transforms;
+    transforms << QTransform() << QTransform::fromTranslate( 3, -5 ) << QTransform::fromScale( 2, -0.5 ).translate( 1, 7 )
+    << QTransform().rotate( 30 ).translate( 4, 2 ) << QTransform().shear( 0.3, 0.1 )
+    << QTransform( 1, 0, 0.001, 0, 1, 0.002, 0, 0, 1 );
+    Q_FOREACH ( const QTransform& t, transforms )
+    {
+      QgsLineStringV2 transformed( l );
+      transformed.transform( t );
+      for ( int i = 0; i < pts.count(); ++i )
+      {
+        qreal x, y;
+        t.map( pts.at( i ).x(), pts.at( i ).y(), &x, &y );
+        QCOMPARE( transformed.xAt( i ), x );
+        QCOMPARE( transformed.yAt( i ), y );
+      }
+    }
+  }
+}
+
+void TestQgsGeometry::wkbView()
+{
+  QStringList wkts;
+  wkts << "Point (1 2)" << "PointZM (1 2 3 4)" << "LineString (0 0, 1 1, 2 0.5)" << "LineStringM (0 0 1, 3 4 2)"
+  << "Polygon ((0 0, 10 0, 10 10, 0 0),(1 1, 2 1, 2 2, 1 1))" << "PolygonZ ((0 0 1, 1 0 2, 1 1 3, 0 0 1))"
+  << "MultiPoint ((1 2),(-3 4))" << "MultiLineString ((0 0, 1 1),(5 5, 6 -1, 7 2))"
+  << "MultiPolygon (((0 0, 1 0, 1 1, 0 0)),((5 5, 6 5, 6 6, 5 5),(5.1 5.1, 5.2 5.1, 5.2 5.2, 5.1 5.1)))"
+  << "GeometryCollection (Point (1 1), LineString (2 2, 3 3), Polygon ((0 0, 4 0, 4 4, 0 0)))";
+
+  Q_FOREACH ( const QString& wkt, wkts )
+  {
+    QScopedPointer<QgsGeometry> g( QgsGeometry::fromWkt( wkt ) );
+    QVERIFY( g.data() );
+    const QgsAbstractGeometryV2* geom = g->geometry();
+
+    QgsWkbView view( g->asWkb(), g->wkbSize() );
+    QVERIFY( view.isValid() );
+    QCOMPARE( view.wkbType(), geom->wkbType() );
+    QCOMPARE( view.wkbSize(), g->wkbSize() );
+    QCOMPARE( view.partCount(), geom->partCount() );
+    QCOMPARE( view.vertexCount(), geom->nCoordinates() );
+    QCOMPARE( view.boundingBox().toString( 12 ), geom->boundingBox().toString( 12 ) );
+
+    // all vertices in the order of the geometry
+    QgsPointSequenceV2 points;
+    for ( int part = 0; part < view.partCount(); ++part )
+    {
+      QgsWkbView partView = view.part( part );
+      QVERIFY( partView.isValid() );
+      if ( QgsWKBTypes::flatType( partView.wkbType() ) == QgsWKBTypes::Point )
+      {
+        QCOMPARE( partView.pointCount(), 1 );
+        points << partView.point( 0 );
+        continue;
+      }
+      for ( int ring = 0; ring < partView.ringCount(); ++ring )
+      {
+        QPolygonF ringPoints;
+        partView.ringPoints( ring, ringPoints );
+        QCOMPARE( ringPoints.count(), partView.pointCount( ring ) );
+        for ( int i = 0; i < partView.pointCount( ring ); ++i )
+        {
+          points << partView.point( i, ring );
+          QCOMPARE( ringPoints.at( i ), QPointF( points.last().x(), points.last().y() ) );
+        }
+      }
+    }
+    QgsCoordinateSequenceV2 coords = geom->coordinateSequence();
+    QgsPointSequenceV2 expected;
+    Q_FOREACH ( const QgsRingSequenceV2& part, coords )
+      Q_FOREACH ( const QgsPointSequenceV2& ring, part )
+        expected << ring;
+    QCOMPARE( points, expected );
+  }
+
+  // truncated wkb
+  QScopedPointer<QgsGeometry> g( QgsGeometry::fromWkt( "LineString (0 0, 1 1, 2 0.5)" ) );
+  QVERIFY( !QgsWkbView( g->asWkb(), g->wkbSize() - 1 ).isValid() );
+  QVERIFY( !QgsWkbView( g->asWkb(), 4 ).isValid() );
+  QVERIFY( !QgsWkbView().isValid() );
+  QCOMPARE( QgsWkbView().partCount(), 0 );
+
+  // curved types are not supported
+  g.reset( QgsGeometry::fromWkt( "CircularString (0 0, 1 1, 2 0)" ) );
+  QVERIFY( !QgsWkbView( g->asWkb(), g->wkbSize() ).isValid() );
+}
+
+void TestQgsGeometry::deferredWkb()
+{
+  QScopedPointer<QgsGeometry> source( QgsGeometry::fromWkt( "MultiPolygon (((0 0, 1 0, 1 1, 0 0)),((5 5, 6 5, 6 6, 5 5)))" ) );
+  int size = source->wkbSize();
+  unsigned char* wkb = new unsigned char[size];
+  memcpy( wkb, source->asWkb(), size );
+
+  QgsGeometry g;
+  g.fromWkb( wkb, size );
+  QVERIFY( !g.isEmpty() );
+  QCOMPARE( g.wkbType(), QGis::WKBMultiPolygon );
+  QCOMPARE( g.type(), QGis::Polygon );
+  QVERIFY( g.isMultipart() );
+  QCOMPARE( g.boundingBox(), source->boundingBox() );
+  QCOMPARE( g.asWkb(), static_cast<const unsigned char*>( wkb ) );
+  QCOMPARE( g.wkbSize(), size );
+
+  // shared copies build the same geometry
+  QgsGeometry copy( g );
+  QCOMPARE( copy.exportToWkt(), source->exportToWkt() );
+  QCOMPARE( g.exportToWkt(), source->exportToWkt() );
+
+  // modifying builds the geometry before the wkb is released
+  QgsGeometry moved( g );
+  QCOMPARE( moved.translate( 1, 2 ), 0 );
+  QCOMPARE( moved.boundingBox(), QgsRectangle( 1, 2, 7, 8 ) );
+  QCOMPARE( g.exportToWkt(), source->exportToWkt() );
+
+  // invalid wkb still gives an empty geometry
+  unsigned char* truncated = new unsigned char[size - 1];
+  memcpy( truncated, source->asWkb(), size - 1 );
+  QgsGeometry invalid;
+  invalid.fromWkb( truncated, size - 1 );
+  QVERIFY( invalid.isEmpty() );
+  QVERIFY( !invalid.geometry() );
+}
+
 void TestQgsGeometry::polygonV2()
 {
   //test constructor
@@ -17,6 +17,7 @@
 
 #include <qgsapplication.h>
 #include <qgslabelingenginev2.h>
+#include <qgslabelplacementcache.h>
 #include <qgsmaplayerregistry.h>
 #include <qgsmaprenderersequentialjob.h>
 #include <qgsrulebasedlabeling.h>
@@ -39,6 +40,7 @@ class TestQgsLabelingEngineV2 : public QObject
     void init();// will be called before each testfunction is executed.
     void cleanup();// will be called after every testfunction.
     void testBasic();
+    void testPlacementCache();
     void testDiagrams();
     void testRuleBased();
     void zOrder(); //test that labels are stacked correctly
@@ -148,6 +150,57 @@ void TestQgsLabelingEngineV2::testBasic()
 }
 
 
+void TestQgsLabelingEngineV2::testPlacementCache()
+{
+  QSize size( 640, 480 );
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( size );
+  mapSettings.setExtent( vl->extent() );
+  mapSettings.setLayers( QStringList() << vl->id() );
+  mapSettings.setOutputDpi( 96 );
+  // labels are only drawn by the engine below
+  mapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+
+  vl->setCustomProperty( "labeling", "pal" );
+  vl->setCustomProperty( "labeling/enabled", true );
+  vl->setCustomProperty( "labeling/fieldName", "Class" );
+  setDefaultLabelParams( vl );
+
+  QgsLabelPlacementCache cache;
+  QImage images[2];
+
+  // the second run takes the candidates and placements from the cache
+  for ( int i = 0; i < 2; ++i )
+  {
+    QgsMapRendererSequentialJob job( mapSettings );
+    job.start();
+    job.waitForFinished();
+
+    images[i] = job.renderedImage();
+    QPainter p( &images[i] );
+    QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+    context.setPainter( &p );
+
+    QgsLabelingEngineV2 engine;
+    engine.setMapSettings( mapSettings );
+    engine.setPlacementCache( &cache );
+    engine.addProvider( new QgsVectorLayerLabelProvider( vl, QString() ) );
+    engine.run( context );
+
+    p.end();
+
+    QVERIFY( cache.count() > 0 );
+  }
+
+  vl->setCustomProperty( "labeling/enabled", false );
+
+  QVERIFY( imageCheck( "labeling_basic", images[0], 20 ) );
+  QVERIFY( imageCheck( "labeling_basic", images[1], 20 ) );
+
+  cache.clearLayer( vl->id() );
+  QCOMPARE( cache.count(), 0 );
+}
+
 void TestQgsLabelingEngineV2::testDiagrams()
 {
   QSize size( 640, 480 );
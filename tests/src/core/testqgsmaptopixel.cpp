@@ -15,6 +15,7 @@
 #include <QtTest/QtTest>
 #include <QObject>
 #include <QString>
+#include <QPolygonF>
 //header for class being tested
 #include <qgsrectangle.h>
 #include <qgsmaptopixel.h>
@@ -27,6 +28,7 @@ class TestQgsMapToPixel: public QObject
   private slots:
     void legacy();
     void rotation();
+    void transformPolygon();
 };
 
 void TestQgsMapToPixel::legacy()
@@ -107,6 +109,28 @@ void TestQgsMapToPixel::rotation()
   QCOMPARE( d, QgsPoint( 10, 0 ) );
 
 }
+void TestQgsMapToPixel::transformPolygon()
+{
+  QList<QgsMapToPixel> mtps;
+  mtps << QgsMapToPixel( 0.1, 5, 5, 10, 10, 0 ) << QgsMapToPixel( 0.3, -2, 7, 640, 480, 33 );
+  Q_FOREACH ( const QgsMapToPixel& m2p, mtps )
+  {
+    QPolygonF poly;
+    for ( int i = 0; i < 7; ++i )
+      poly << QPointF( 1.7 * i - 3, 0.4 * i * i + 2 );
+
+    QPolygonF transformed( poly );
+    m2p.transformInPlace( transformed );
+    QCOMPARE( transformed.count(), poly.count() );
+    for ( int i = 0; i < poly.count(); ++i )
+    {
+      double x = poly.at( i ).x(), y = poly.at( i ).y();
+      m2p.transformInPlace( x, y );
+      QCOMPARE( transformed.at( i ).x(), x );
+      QCOMPARE( transformed.at( i ).y(), y );
+    }
+  }
+}
 
 QTEST_MAIN( TestQgsMapToPixel )
 #include "testqgsmaptopixel.moc"
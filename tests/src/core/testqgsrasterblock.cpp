@@ -0,0 +1,160 @@
+/***************************************************************************
+     testqgsrasterblock.cpp
+     ----------------------
+    Date                 : May 2016
+    Copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+
+#include "qgsrasterblock.h"
+#include "qgsrasterrange.h"
+
+/** Tests the bulk operations of raster blocks, which use typed loops, against the
+ * per value accessors */
+class TestQgsRasterBlock: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void typedData();
+    void convert();
+    void applyScaleOffset();
+    void applyNoDataValues();
+    void minimumMaximum();
+
+  private:
+    static QList<QGis::DataType> numericTypes();
+    static void fill( QgsRasterBlock& block );
+};
+
+QList<QGis::DataType> TestQgsRasterBlock::numericTypes()
+{
+  return QList<QGis::DataType>() << QGis::Byte << QGis::UInt16 << QGis::Int16 << QGis::UInt32 << QGis::Int32 << QGis::Float32 << QGis::Float64;
+}
+
+void TestQgsRasterBlock::fill( QgsRasterBlock& block )
+{
+  for ( int row = 0; row < block.height(); ++row )
+  {
+    for ( int column = 0; column < block.width(); ++column )
+      block.setValue( row, column, row * 10 + column + 0.5 );
+  }
+}
+
+void TestQgsRasterBlock::typedData()
+{
+  QgsRasterBlock block( QGis::Int16, 4, 3 );
+  fill( block );
+
+  const qint16* values = block.typedData<qint16>();
+  QVERIFY( values );
+  QCOMPARE( static_cast< int >( values[5] ), static_cast< int >( block.value( 1, 1 ) ) );
+  QCOMPARE( block.typedRow<qint16>( 2 ), block.typedData<qint16>() + 8 );
+
+  block.typedRow<qint16>( 2 )[3] = 42;
+  QCOMPARE( block.value( 2, 3 ), 42.0 );
+
+  QgsRasterBlock empty;
+  QVERIFY( !empty.typedData<double>() );
+}
+
+void TestQgsRasterBlock::convert()
+{
+  Q_FOREACH ( QGis::DataType srcType, numericTypes() )
+  {
+    Q_FOREACH ( QGis::DataType destType, numericTypes() )
+    {
+      QgsRasterBlock block( srcType, 5, 4 );
+      fill( block );
+
+      QgsRasterBlock expected( destType, 5, 4 );
+      for ( qgssize i = 0; i < 20; ++i )
+        expected.setValue( i, block.value( i ) );
+
+      QVERIFY( block.convert( destType ) );
+      QCOMPARE( block.dataType(), destType );
+      for ( qgssize i = 0; i < 20; ++i )
+        QCOMPARE( block.value( i ), expected.value( i ) );
+    }
+  }
+}
+
+void TestQgsRasterBlock::applyScaleOffset()
+{
+  Q_FOREACH ( QGis::DataType type, numericTypes() )
+  {
+    // no data value
+    QgsRasterBlock block( type, 5, 4, 11.5 );
+    fill( block );
+    bool noData = block.isNoData( 1, 1 );
+    block.applyScaleOffset( 2, 1 );
+    QCOMPARE( block.value( 0, 2 ), block.dataType() == QGis::Float32 || block.dataType() == QGis::Float64 ? 6.0 : 5.0 );
+    if ( noData )
+      QCOMPARE( block.value( 1, 1 ), 11.5 );
+
+    // no data bitmap
+    QgsRasterBlock bitmapBlock( type, 5, 4 );
+    fill( bitmapBlock );
+    double value = bitmapBlock.value( 3, 4 );
+    bitmapBlock.setIsNoData( 3, 4 );
+    bitmapBlock.applyScaleOffset( 3, 0 );
+    QCOMPARE( bitmapBlock.value( 3, 4 ), value );
+    QVERIFY( bitmapBlock.isNoData( 3, 4 ) );
+    QCOMPARE( bitmapBlock.value( 0, 1 ), bitmapBlock.dataType() == QGis::Float32 || bitmapBlock.dataType() == QGis::Float64 ? 4.5 : 3.0 );
+  }
+}
+
+void TestQgsRasterBlock::applyNoDataValues()
+{
+  QgsRasterRangeList ranges;
+  ranges << QgsRasterRange( 10, 12 ) << QgsRasterRange( 30, 30 );
+
+  Q_FOREACH ( QGis::DataType type, numericTypes() )
+  {
+    QgsRasterBlock block( type, 5, 4 );
+    fill( block );
+    block.applyNoDataValues( ranges );
+
+    for ( qgssize i = 0; i < 20; ++i )
+    {
+      double value = block.value( i );
+      QCOMPARE( block.isNoData( i ), QgsRasterRange::contains( value, ranges ) );
+    }
+    QVERIFY( block.isNoData( 1, 0 ) );
+    QVERIFY( !block.isNoData( 1, 3 ) );
+  }
+}
+
+void TestQgsRasterBlock::minimumMaximum()
+{
+  Q_FOREACH ( QGis::DataType type, numericTypes() )
+  {
+    QgsRasterBlock block( type, 5, 4 );
+    fill( block );
+    block.setIsNoData( 0, 0 );
+    block.setIsNoData( 3, 4 );
+
+    double minimum, maximum;
+    QVERIFY( block.minimumMaximum( minimum, maximum ) );
+    QCOMPARE( minimum, block.value( 0, 1 ) );
+    QCOMPARE( maximum, block.value( 3, 3 ) );
+
+    block.setIsNoData();
+    QVERIFY( !block.minimumMaximum( minimum, maximum ) );
+  }
+
+  QgsRasterBlock image( QGis::ARGB32_Premultiplied, 2, 2 );
+  double minimum, maximum;
+  QVERIFY( !image.minimumMaximum( minimum, maximum ) );
+}
+
+QTEST_MAIN( TestQgsRasterBlock )
+#include "testqgsrasterblock.moc"
@@ -22,6 +22,7 @@
 #include <QPainter>
 #include <QTime>
 #include <QDesktopServices>
+#include <QThreadPool>
 
 #include "cpl_conv.h"
 
@@ -33,11 +34,15 @@
 #include <qgsmaplayerregistry.h>
 #include <qgsapplication.h>
 #include <qgsmaprenderer.h>
+#include <qgsmaprendererjob.h>
 #include <qgssinglebandgrayrenderer.h>
 #include <qgssinglebandpseudocolorrenderer.h>
+#include <qgscolorrampshader.h>
+#include <qgsrasterblock.h>
 #include <qgsmultibandcolorrenderer.h>
 #include <qgsvectorcolorrampv2.h>
 #include <qgscptcityarchive.h>
+#include <qgsrasterprojector.h>
 
 //qgis unit test includes
 #include <qgsrenderchecker.h>
@@ -75,6 +80,7 @@ class TestQgsRasterLayer : public QObject
     void colorRamp2();
     void colorRamp3();
     void colorRamp4();
+    void colorRampShadeBlock();
     void landsatBasic();
     void landsatBasic875Qml();
     void checkDimensions();
@@ -86,6 +92,8 @@ class TestQgsRasterLayer : public QObject
     void multiBandColorRenderer();
     void setRenderer();
     void regression992(); //test for issue #992 - GeoJP2 images improperly displayed as all black
+    void projectorMappingCache();
+    void parallelRendering();
 
 
   private:
@@ -199,6 +207,84 @@ void TestQgsRasterLayer::cleanupTestCase()
   }
 }
 
+void TestQgsRasterLayer::projectorMappingCache()
+{
+  QgsCoordinateReferenceSystem destCrs( "EPSG:4326" );
+  QgsCoordinateTransform ct( mpLandsatRasterLayer->crs(), destCrs );
+  QgsRectangle extent = ct.transformBoundingBox( mpLandsatRasterLayer->extent() );
+
+  QList<QgsRasterProjector::Precision> precisions;
+  precisions << QgsRasterProjector::Approximate << QgsRasterProjector::Exact;
+  Q_FOREACH ( QgsRasterProjector::Precision precision, precisions )
+  {
+    QgsRasterProjector projector;
+    projector.setCRS( mpLandsatRasterLayer->crs(), destCrs );
+    projector.setInput( mpLandsatRasterLayer->dataProvider() );
+    projector.setPrecision( precision );
+
+    // calculated mapping, then cached mapping
+    QgsRasterProjector::clearMappingCache();
+    QgsRasterBlock* calculated = projector.block( 1, extent, 300, 200 );
+    QgsRasterBlock* cached = projector.block( 1, extent, 300, 200 );
+
+    // mapping calculated on a single thread
+    QgsRasterProjector::clearMappingCache();
+    int threads = QThreadPool::globalInstance()->maxThreadCount();
+    QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+    QgsRasterBlock* singleThread = projector.block( 1, extent, 300, 200 );
+    QThreadPool::globalInstance()->setMaxThreadCount( threads );
+
+    QVERIFY( !calculated->isEmpty() );
+    int dataCount = 0;
+    for ( int i = 0; i < 300 * 200; ++i )
+    {
+      QCOMPARE( cached->isNoData( i ), calculated->isNoData( i ) );
+      QCOMPARE( singleThread->isNoData( i ), calculated->isNoData( i ) );
+      if ( !calculated->isNoData( i ) )
+      {
+        QCOMPARE( cached->value( i ), calculated->value( i ) );
+        QCOMPARE( singleThread->value( i ), calculated->value( i ) );
+        dataCount++;
+      }
+    }
+    QVERIFY( dataCount > 0 );
+
+    delete calculated;
+    delete cached;
+    delete singleThread;
+  }
+}
+
+void TestQgsRasterLayer::parallelRendering()
+{
+  QVERIFY( mpLandsatRasterLayer->dataProvider()->supportsConcurrentClones() );
+
+  // larger than one tile of the raster iterator, so that the tiles are rendered in parallel
+  QgsMapSettings settings;
+  settings.setLayers( QStringList() << mpLandsatRasterLayer->id() );
+  settings.setDestinationCrs( mpLandsatRasterLayer->crs() );
+  settings.setExtent( mpLandsatRasterLayer->extent() );
+  settings.setOutputSize( QSize( 3000, 2500 ) );
+  settings.setOutputDpi( 96 );
+
+  int threads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  QgsMapRendererSequentialJob serialJob( settings );
+  serialJob.start();
+  serialJob.waitForFinished();
+  QImage serialImage = serialJob.renderedImage();
+
+  QThreadPool::globalInstance()->setMaxThreadCount( qMax( threads, 4 ) );
+  QgsMapRendererSequentialJob parallelJob( settings );
+  parallelJob.start();
+  parallelJob.waitForFinished();
+  QImage parallelImage = parallelJob.renderedImage();
+  QThreadPool::globalInstance()->setMaxThreadCount( threads );
+
+  QCOMPARE( serialImage.size(), QSize( 3000, 2500 ) );
+  QCOMPARE( parallelImage, serialImage );
+}
+
 void TestQgsRasterLayer::isValid()
 {
   QVERIFY( mpRasterLayer->isValid() );
@@ -348,6 +434,70 @@ void TestQgsRasterLayer::colorRamp4()
                           QgsColorRampShader::DISCRETE, 10 ) );
 }
 
+void TestQgsRasterLayer::colorRampShadeBlock()
+{
+  // shading a whole block with the lookup tables gives the same colors as shading each value
+  QList<QgsColorRampShader::ColorRampItem> items;
+  items << QgsColorRampShader::ColorRampItem( -100, QColor( 0, 0, 255 ) )
+  << QgsColorRampShader::ColorRampItem( 0.5, QColor( 0, 255, 0, 128 ) )
+  << QgsColorRampShader::ColorRampItem( 7, QColor( 255, 255, 0 ) )
+  << QgsColorRampShader::ColorRampItem( 200, QColor( 255, 0, 0, 0 ) )
+  << QgsColorRampShader::ColorRampItem( 1000.25, QColor( 10, 20, 30 ) );
+
+  QList<QGis::DataType> types;
+  types << QGis::Byte << QGis::UInt16 << QGis::Int16 << QGis::UInt32 << QGis::Int32 << QGis::Float32 << QGis::Float64;
+  QList<QgsColorRampShader::ColorRamp_TYPE> rampTypes;
+  rampTypes << QgsColorRampShader::INTERPOLATED << QgsColorRampShader::DISCRETE << QgsColorRampShader::EXACT;
+
+  Q_FOREACH ( QGis::DataType type, types )
+  {
+    bool isFloat = type == QGis::Float32 || type == QGis::Float64;
+    bool isSigned = type == QGis::Int16 || type == QGis::Int32 || isFloat;
+    QgsRasterBlock block( type, 100, 30 );
+    for ( int i = 0; i < 3000; ++i )
+    {
+      // values around and between the items
+      double value = ( i % 1200 ) - ( isSigned ? 150 : 0 );
+      if ( isFloat )
+        value += ( i % 7 ) * 0.125;
+      if ( type == QGis::Byte )
+        value = i % 256;
+      block.setValue( i, value );
+    }
+
+    Q_FOREACH ( QgsColorRampShader::ColorRamp_TYPE rampType, rampTypes )
+    {
+      for ( int clip = 0; clip < 2; ++clip )
+      {
+        QgsColorRampShader shader;
+        shader.setColorRampItemList( items );
+        shader.setColorRampType( rampType );
+        shader.setClip( clip );
+
+        QVector<QRgb> colors( 3000 );
+        shader.shadeBlock( &block, colors.data() );
+
+        for ( int i = 0; i < 3000; ++i )
+        {
+          QRgb expected = qRgba( 0, 0, 0, 0 );
+          int red, green, blue, alpha;
+          if ( shader.shade( block.value( i ), &red, &green, &blue, &alpha ) )
+          {
+            if ( alpha < 255 )
+            {
+              red *= ( alpha / 255.0 );
+              blue *= ( alpha / 255.0 );
+              green *= ( alpha / 255.0 );
+            }
+            expected = qRgba( red, green, blue, alpha );
+          }
+          QCOMPARE( colors.at( i ), expected );
+        }
+      }
+    }
+  }
+}
+
 void TestQgsRasterLayer::landsatBasic()
 {
   QVERIFY2( mpLandsatRasterLayer->isValid(), "landsat.tif layer is not valid!" );
@@ -0,0 +1,245 @@
+/***************************************************************************
+     testqgsrasterresampler.cpp
+     --------------------------
+    Date                 : May 2016
+    Copyright            : (C) 2016 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QImage>
+#include <QObject>
+#include <QThreadPool>
+#include <qmath.h>
+
+#include "qgscubicrasterresampler.h"
+
+/** Tests the cubic resampler, which resamples rows in parallel with the four channels
+ * interpolated at once, against a straightforward per pixel and per channel resampling.
+ * Results must be identical to the pixel.
+ */
+class TestQgsRasterResampler: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void cubic_data();
+    void cubic();
+    void cubicSingleThread();
+
+  private:
+    static QImage sourceImage( int width, int height );
+    static QImage referenceCubic( const QImage& srcImage, int width, int height );
+    static void compareCubic( const QImage& srcImage, int width, int height );
+};
+
+static int channel( QRgb px, int c )
+{
+  switch ( c )
+  {
+    case 0:
+      return qRed( px );
+    case 1:
+      return qGreen( px );
+    case 2:
+      return qBlue( px );
+    default:
+      return qAlpha( px );
+  }
+}
+
+static double bernstein( int i, double t )
+{
+  return ( i == 0 || i == 3 ? 1 : 3 ) * qPow( t, i ) * qPow(( 1 - t ), ( 3 - i ) );
+}
+
+static QRgb boundedColor( const int* value )
+{
+  int maxComponentBounds = qBound( 0, value[3], 255 );
+  return qRgba( qBound( 0, value[0], maxComponentBounds ), qBound( 0, value[1], maxComponentBounds ),
+                qBound( 0, value[2], maxComponentBounds ), value[3] );
+}
+
+//! derivative of a channel in x ( dx = 1 ) or y ( dy = 1 ) direction
+static double derivative( const QImage& img, int col, int row, int c, int dx, int dy )
+{
+  int n = dx ? img.width() : img.height();
+  int pos = dx ? col : row;
+  if ( pos == 0 )
+    return channel( img.pixel( col + dx, row + dy ), c ) - channel( img.pixel( col, row ), c );
+  if ( pos == n - 1 )
+    return channel( img.pixel( col, row ), c ) - channel( img.pixel( col - dx, row - dy ), c );
+  return ( channel( img.pixel( col + dx, row + dy ), c ) - channel( img.pixel( col - dx, row - dy ), c ) ) / 2.0;
+}
+
+//! cubic curve between two pixels, dx or dy gives the direction of the derivatives
+static QRgb curve( const QImage& img, int col1, int row1, int col2, int row2, double t, int dx, int dy )
+{
+  int value[4];
+  for ( int c = 0; c < 4; ++c )
+  {
+    double p0 = channel( img.pixel( col1, row1 ), c );
+    double p1 = p0 + 0.333 * derivative( img, col1, row1, c, dx, dy );
+    double p3 = channel( img.pixel( col2, row2 ), c );
+    double p2 = p3 - 0.333 * derivative( img, col2, row2, c, dx, dy );
+    value[c] = static_cast< int >( bernstein( 0, t ) * p0 + bernstein( 1, t ) * p1 + bernstein( 2, t ) * p2 + bernstein( 3, t ) * p3 );
+  }
+  return boundedColor( value );
+}
+
+QImage TestQgsRasterResampler::referenceCubic( const QImage& srcImage, int width, int height )
+{
+  QImage dstImage( width, height, QImage::Format_ARGB32_Premultiplied );
+  int w = srcImage.width();
+  int h = srcImage.height();
+  double nSrcPerDstX = ( double ) w / ( double ) width;
+  double nSrcPerDstY = ( double ) h / ( double ) height;
+
+  double srcRow = nSrcPerDstY / 2.0 - 0.5;
+  for ( int y = 0; y < height; ++y, srcRow += nSrcPerDstY )
+  {
+    int row = floor( srcRow );
+    double v = srcRow - row;
+    double srcCol = nSrcPerDstX / 2.0 - 0.5;
+    for ( int x = 0; x < width; ++x, srcCol += nSrcPerDstX )
+    {
+      int col = floor( srcCol );
+      double u = srcCol - col;
+      QRgb px;
+      if ( row < 0 && col < 0 )
+        px = srcImage.pixel( 0, 0 );
+      else if ( row < 0 && col >= w - 1 )
+        px = srcImage.pixel( w - 1, 0 );
+      else if ( row >= h - 1 && col >= w - 1 )
+        px = srcImage.pixel( w - 1, h - 1 );
+      else if ( row >= h - 1 && col < 0 )
+        px = srcImage.pixel( 0, h - 1 );
+      else if ( row < 0 )
+        px = curve( srcImage, col, 0, col + 1, 0, u, 1, 0 );
+      else if ( row >= h - 1 )
+        px = curve( srcImage, col, h - 1, col + 1, h - 1, u, 1, 0 );
+      else if ( col < 0 )
+        px = curve( srcImage, 0, row, 0, row + 1, v, 0, 1 );
+      else if ( col >= w - 1 )
+        px = curve( srcImage, w - 1, row, w - 1, row + 1, v, 0, 1 );
+      else
+      {
+        int value[4];
+        for ( int c = 0; c < 4; ++c )
+        {
+          // bezier patch, control points cp[j][i]
+          double cp[4][4];
+          cp[0][0] = channel( srcImage.pixel( col, row ), c );
+          cp[0][3] = channel( srcImage.pixel( col + 1, row ), c );
+          cp[3][0] = channel( srcImage.pixel( col, row + 1 ), c );
+          cp[3][3] = channel( srcImage.pixel( col + 1, row + 1 ), c );
+          cp[0][1] = cp[0][0] + 0.333 * derivative( srcImage, col, row, c, 1, 0 );
+          cp[1][0] = cp[0][0] + 0.333 * derivative( srcImage, col, row, c, 0, 1 );
+          cp[1][1] = cp[0][1] + 0.333 * derivative( srcImage, col, row, c, 0, 1 );
+          cp[0][2] = cp[0][3] - 0.333 * derivative( srcImage, col + 1, row, c, 1, 0 );
+          cp[1][3] = cp[0][3] + 0.333 * derivative( srcImage, col + 1, row, c, 0, 1 );
+          cp[1][2] = cp[0][2] + 0.333 * derivative( srcImage, col + 1, row, c, 0, 1 );
+          cp[3][1] = cp[3][0] + 0.333 * derivative( srcImage, col, row + 1, c, 1, 0 );
+          cp[2][0] = cp[3][0] - 0.333 * derivative( srcImage, col, row + 1, c, 0, 1 );
+          cp[2][1] = cp[2][0] + 0.333 * derivative( srcImage, col, row + 1, c, 1, 0 );
+          cp[3][2] = cp[3][3] - 0.333 * derivative( srcImage, col + 1, row + 1, c, 1, 0 );
+          cp[2][3] = cp[3][3] - 0.333 * derivative( srcImage, col + 1, row + 1, c, 0, 1 );
+          cp[2][2] = cp[2][3] - 0.333 * derivative( srcImage, col + 1, row + 1, c, 1, 0 );
+
+          double sum = 0;
+          for ( int j = 0; j < 4; ++j )
+          {
+            for ( int i = 0; i < 4; ++i )
+              sum += bernstein( i, u ) * bernstein( j, v ) * cp[j][i];
+          }
+          value[c] = static_cast< int >( sum );
+        }
+        px = boundedColor( value );
+      }
+      dstImage.setPixel( x, y, px );
+    }
+  }
+  return dstImage;
+}
+
+QImage TestQgsRasterResampler::sourceImage( int width, int height )
+{
+  QImage img( width, height, QImage::Format_ARGB32_Premultiplied );
+  unsigned int state = 1;
+  for ( int y = 0; y < height; ++y )
+  {
+    for ( int x = 0; x < width; ++x )
+    {
+      state = state * 1103515245 + 12345;
+      int a = ( state >> 16 ) % 256;
+      // mostly opaque, with transparent and semi transparent pixels
+      a = a < 32 ? 0 : ( a < 96 ? a : 255 );
+      int r = ( x * 7 + y * 3 ) % 256 * a / 255;
+      int g = ( state >> 8 ) % 256 * a / 255;
+      int b = ( x * y ) % 256 * a / 255;
+      img.setPixel( x, y, qRgba( r, g, b, a ) );
+    }
+  }
+  return img;
+}
+
+void TestQgsRasterResampler::compareCubic( const QImage& srcImage, int width, int height )
+{
+  QImage expected = referenceCubic( srcImage, width, height );
+
+  QImage dstImage( width, height, QImage::Format_ARGB32_Premultiplied );
+  QgsCubicRasterResampler resampler;
+  resampler.resample( srcImage, dstImage );
+
+  for ( int y = 0; y < height; ++y )
+  {
+    for ( int x = 0; x < width; ++x )
+    {
+      if ( dstImage.pixel( x, y ) != expected.pixel( x, y ) )
+      {
+        QFAIL( QString( "Pixel %1,%2: %3 instead of %4" ).arg( x ).arg( y ).arg( dstImage.pixel( x, y ), 0, 16 ).arg( expected.pixel( x, y ), 0, 16 ).toUtf8().constData() );
+      }
+    }
+  }
+}
+
+void TestQgsRasterResampler::cubic_data()
+{
+  QTest::addColumn<int>( "srcWidth" );
+  QTest::addColumn<int>( "srcHeight" );
+  QTest::addColumn<int>( "width" );
+  QTest::addColumn<int>( "height" );
+
+  QTest::newRow( "zoom in" ) << 37 << 23 << 150 << 91;
+  QTest::newRow( "zoom out" ) << 37 << 23 << 20 << 11;
+  QTest::newRow( "same size" ) << 16 << 16 << 16 << 16;
+  QTest::newRow( "large, several chunks of rows" ) << 300 << 200 << 1000 << 700;
+  QTest::newRow( "single column" ) << 1 << 7 << 8 << 30;
+  QTest::newRow( "single pixel" ) << 1 << 1 << 9 << 9;
+}
+
+void TestQgsRasterResampler::cubic()
+{
+  QFETCH( int, srcWidth );
+  QFETCH( int, srcHeight );
+  QFETCH( int, width );
+  QFETCH( int, height );
+
+  compareCubic( sourceImage( srcWidth, srcHeight ), width, height );
+}
+
+void TestQgsRasterResampler::cubicSingleThread()
+{
+  int threads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  compareCubic( sourceImage( 120, 80 ), 500, 330 );
+  QThreadPool::globalInstance()->setMaxThreadCount( threads );
+}
+
+QTEST_MAIN( TestQgsRasterResampler )
+#include "testqgsrasterresampler.moc"
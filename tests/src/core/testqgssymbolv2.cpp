@@ -17,6 +17,7 @@
 #include <QStringList>
 #include <QApplication>
 #include <QFileInfo>
+#include <QPainter>
 
 //qgis includes...
 #include "qgsmultirenderchecker.h"
@@ -32,6 +33,26 @@
 #include "qgssinglesymbolrendererv2.h"
 
 #include "qgsstylev2.h"
+#include "qgsrendercontext.h"
+#include "qgsgeometry.h"
+
+//! Marker symbol layer recording the original geometry of the rendered features
+class TestGeometryMarkerLayer : public QgsMarkerSymbolLayerV2
+{
+  public:
+    QString layerType() const override { return "TestGeometryMarker"; }
+    void startRender( QgsSymbolV2RenderContext& ) override {}
+    void stopRender( QgsSymbolV2RenderContext& ) override {}
+    QgsSymbolLayerV2* clone() const override { return new TestGeometryMarkerLayer(); }
+    QgsStringMap properties() const override { return QgsStringMap(); }
+    void renderPoint( QPointF, QgsSymbolV2RenderContext& context ) override
+    {
+      const QgsAbstractGeometryV2* geometry = context.renderContext().geometry();
+      geometries << ( geometry ? geometry->asWkt() : QString() );
+    }
+
+    QStringList geometries;
+};
 
 /** \ingroup UnitTests
  * This is a unit test to verify that symbols are working correctly
@@ -68,6 +89,7 @@ class TestQgsSymbolV2 : public QObject
     void testParseColor();
     void testParseColorList();
     void symbolProperties();
+    void renderContextGeometry();
 };
 
 TestQgsSymbolV2::TestQgsSymbolV2()
@@ -455,5 +477,28 @@ void TestQgsSymbolV2::symbolProperties()
   delete fillSymbol2;
 }
 
+void TestQgsSymbolV2::renderContextGeometry()
+{
+  // the render context gives the original geometry to the symbol layers,
+  // also when the feature is rendered from its wkb
+  TestGeometryMarkerLayer* layer = new TestGeometryMarkerLayer();
+  QgsMarkerSymbolV2 symbol( QgsSymbolLayerV2List() << layer );
+
+  QgsFeature feature;
+  feature.setGeometry( QgsGeometry::fromWkt( "Point (1 2)" ) );
+
+  QImage image( 10, 10, QImage::Format_ARGB32 );
+  QPainter painter( &image );
+  QgsRenderContext context;
+  context.setPainter( &painter );
+
+  symbol.startRender( context );
+  symbol.renderFeature( feature, context );
+  symbol.stopRender( context );
+  painter.end();
+
+  QCOMPARE( layer->geometries, QStringList() << feature.constGeometry()->geometry()->asWkt() );
+}
+
 QTEST_MAIN( TestQgsSymbolV2 )
 #include "testqgssymbolv2.moc"
@@ -18,9 +18,11 @@
 
 #include <qgsapplication.h>
 #include <qgsgeometry.h>
+#include <qgsfeatureiterator.h>
 #include <qgsfeaturerequest.h>
 #include <qgsvectordataprovider.h>
 #include <qgsvectorlayer.h>
+#include <qgsvectorlayerfeatureiterator.h>
 
 Q_DECLARE_METATYPE( QgsFeatureRequest )
 
@@ -48,6 +50,13 @@ class TestQgsVectorDataProvider : public QObject
 
     void featureAtId();
 
+    // features read ahead on a worker thread
+    void prefetchFeatures_data();
+    void prefetchFeatures();
+    void prefetchRewindClose();
+    void prefetchInterrupted();
+    void prefetchSourceDeleted();
+
   private:
 
     QgsVectorLayer* vlayerPoints;
@@ -226,6 +235,113 @@ void TestQgsVectorDataProvider::featureAtId()
   QVERIFY( !feature.isValid() );
 }
 
+void TestQgsVectorDataProvider::prefetchFeatures_data()
+{
+  QTest::addColumn<QgsFeatureRequest>( "request" );
+
+  QTest::newRow( "all" ) << QgsFeatureRequest();
+  QTest::newRow( "expression" ) << QgsFeatureRequest().setFilterExpression( "\"Value\" > 1" );
+  QTest::newRow( "limit" ) << QgsFeatureRequest().setLimit( 3 );
+  QTest::newRow( "fid" ) << QgsFeatureRequest().setFilterFid( 4 );
+}
+
+void TestQgsVectorDataProvider::prefetchFeatures()
+{
+  QFETCH( QgsFeatureRequest, request );
+
+  QList<QgsFeature> expected;
+  QgsFeatureIterator fi = vlayerLines->getFeatures( request );
+  QgsFeature f;
+  while ( fi.nextFeature( f ) )
+    expected << f;
+  QVERIFY( !expected.isEmpty() );
+
+  QgsFeatureRequest prefetchRequest( request );
+  prefetchRequest.setFlags( request.flags() | QgsFeatureRequest::PrefetchFeatures );
+  QgsFeatureIterator prefetched = vlayerLines->getFeatures( prefetchRequest );
+  int count = 0;
+  while ( prefetched.nextFeature( f ) )
+  {
+    QVERIFY( count < expected.count() );
+    QCOMPARE( f.id(), expected.at( count ).id() );
+    QCOMPARE( f.attributes(), expected.at( count ).attributes() );
+    QCOMPARE( f.geometry()->exportToWkt(), expected.at( count ).geometry()->exportToWkt() );
+    ++count;
+  }
+  QCOMPARE( count, expected.count() );
+  QVERIFY( prefetched.isClosed() );
+}
+
+void TestQgsVectorDataProvider::prefetchRewindClose()
+{
+  QScopedPointer<QgsAbstractFeatureSource> source( vlayerLines->dataProvider()->featureSource() );
+  int total = vlayerLines->dataProvider()->featureCount();
+
+  // buffer smaller than the layer, the worker has to wait for the consumer
+  QgsFeatureIterator fi( new QgsPrefetchingFeatureIterator( source.data(), QgsFeatureRequest(), 2 ) );
+  QgsFeature f;
+  QgsFeatureIds ids;
+  while ( fi.nextFeature( f ) )
+    ids << f.id();
+  QCOMPARE( ids.count(), total );
+
+  QVERIFY( !fi.rewind() ); // closed at the end of the features
+
+  fi = QgsFeatureIterator( new QgsPrefetchingFeatureIterator( source.data(), QgsFeatureRequest(), 2 ) );
+  QVERIFY( fi.nextFeature( f ) );
+  QgsFeatureId first = f.id();
+  QVERIFY( fi.nextFeature( f ) );
+  QVERIFY( fi.rewind() );
+  QVERIFY( fi.nextFeature( f ) );
+  QCOMPARE( f.id(), first );
+
+  // closing while the worker is blocked on a full buffer
+  QVERIFY( fi.close() );
+  QVERIFY( fi.isClosed() );
+  QVERIFY( !fi.nextFeature( f ) );
+}
+
+class TestInterruptionChecker : public QgsInterruptionChecker
+{
+  public:
+    TestInterruptionChecker() : stop( 0 ) {}
+    // queried from the prefetching thread
+    virtual bool mustStop() const override { return stop.fetchAndAddOrdered( 0 ) != 0; }
+    mutable QAtomicInt stop;
+};
+
+void TestQgsVectorDataProvider::prefetchInterrupted()
+{
+  QScopedPointer<QgsAbstractFeatureSource> source( vlayerLines->dataProvider()->featureSource() );
+  TestInterruptionChecker checker;
+
+  QgsFeatureIterator fi( new QgsPrefetchingFeatureIterator( source.data(), QgsFeatureRequest(), 2 ) );
+  fi.setInterruptionChecker( &checker );
+  QgsFeature f;
+  QVERIFY( fi.nextFeature( f ) );
+
+  // the consumer must not wait for features which are not read anymore
+  checker.stop.fetchAndStoreOrdered( 1 );
+  int count = 0;
+  while ( fi.nextFeature( f ) )
+    ++count;
+  QVERIFY( count <= 2 ); // at most the features already in the buffer
+  QVERIFY( fi.isClosed() );
+}
+
+void TestQgsVectorDataProvider::prefetchSourceDeleted()
+{
+  // the layer source releases its provider source while an iterator is prefetching from it
+  QgsAbstractFeatureSource* source = new QgsVectorLayerFeatureSource( vlayerLines );
+  QgsFeatureIterator fi = source->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::PrefetchFeatures ) );
+  QgsFeature f;
+  QVERIFY( fi.nextFeature( f ) );
+
+  delete source;
+  QVERIFY( fi.isClosed() );
+  QVERIFY( !fi.nextFeature( f ) );
+}
+
 
 QTEST_MAIN( TestQgsVectorDataProvider )
 
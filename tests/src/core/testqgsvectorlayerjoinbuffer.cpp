@@ -57,6 +57,7 @@ class TestVectorLayerJoinBuffer : public QObject
     void testJoinTwoTimes_data();
     void testJoinTwoTimes();
     void testJoinLayerDefinitionFile();
+    void testJoinManyFeatures();
 
   private:
     QList<QString> mProviders;
@@ -519,6 +520,77 @@ void TestVectorLayerJoinBuffer::testJoinLayerDefinitionFile()
   QVERIFY( vLayer->fieldNameIndex( joinInfo.prefix + "value" ) >= 0 );
 }
 
+void TestVectorLayerJoinBuffer::testJoinManyFeatures()
+{
+  QgsMapLayerRegistry::instance()->removeAllMapLayers();
+
+  // more target features than in a block of the iterator, some of them without joined feature
+  QgsVectorLayer* layerT = new QgsVectorLayer( "Point?field=key:integer", "layerT", "memory" );
+  QVERIFY( layerT->isValid() );
+  QgsVectorLayer* layerJ = new QgsVectorLayer( "Point?field=key:integer&field=value:integer", "layerJ", "memory" );
+  QVERIFY( layerJ->isValid() );
+  QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer*>() << layerT << layerJ );
+
+  QgsFeatureList features;
+  for ( int i = 0; i < 3000; ++i )
+  {
+    QgsFeature f( layerT->dataProvider()->fields() );
+    f.setAttribute( "key", i % 60 );
+    features << f;
+  }
+  QVERIFY( layerT->dataProvider()->addFeatures( features ) );
+
+  features.clear();
+  for ( int i = 0; i < 50; ++i )
+  {
+    QgsFeature f( layerJ->dataProvider()->fields() );
+    f.setAttribute( "key", i );
+    f.setAttribute( "value", i * 10 );
+    features << f;
+  }
+  QVERIFY( layerJ->dataProvider()->addFeatures( features ) );
+
+  QgsVectorJoinInfo joinInfo;
+  joinInfo.targetFieldName = "key";
+  joinInfo.joinLayerId = layerJ->id();
+  joinInfo.joinFieldName = "key";
+  joinInfo.memoryCache = false;
+  joinInfo.prefix = "J_";
+  QVERIFY( layerT->addJoin( joinInfo ) );
+
+  // twice, the second time from the lookup cache
+  for ( int run = 0; run < 2; ++run )
+  {
+    int count = 0;
+    QgsFeature f;
+    QgsFeatureIterator fi = layerT->getFeatures();
+    while ( fi.nextFeature( f ) )
+    {
+      int key = f.attribute( "key" ).toInt();
+      if ( key < 50 )
+        QCOMPARE( f.attribute( "J_value" ).toInt(), key * 10 );
+      else
+        QVERIFY( f.attribute( "J_value" ).isNull() );
+      ++count;
+    }
+    QCOMPARE( count, 3000 );
+  }
+
+  // changes of the joined layer are visible
+  QgsFeature fJ;
+  QVERIFY( layerJ->getFeatures( QgsFeatureRequest().setFilterExpression( "key = 7" ) ).nextFeature( fJ ) );
+  QVERIFY( layerJ->startEditing() );
+  QVERIFY( layerJ->changeAttributeValue( fJ.id(), 1, 700 ) );
+  QVERIFY( layerJ->commitChanges() );
+
+  QgsFeature f;
+  QgsFeatureIterator fi = layerT->getFeatures( QgsFeatureRequest().setFilterExpression( "key = 7" ) );
+  QVERIFY( fi.nextFeature( f ) );
+  QCOMPARE( f.attribute( "J_value" ).toInt(), 700 );
+
+  QgsMapLayerRegistry::instance()->removeAllMapLayers();
+}
+
 
 QTEST_MAIN( TestVectorLayerJoinBuffer )
 #include "testqgsvectorlayerjoinbuffer.moc"
@@ -231,6 +231,35 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
             if 'precision' in e:
                 self.assertEqual(fields.at(fields.indexFromName(f)).precision(), e['precision'])
 
+    def testStreamedFeatures(self):
+        """Test that features streamed with COPY match the ones fetched from a cursor"""
+
+        def fetch(request):
+            return dict((f.id(), (f.attributes(), f.geometry().exportToWkt() if f.geometry() else None)) for f in self.provider.getFeatures(request))
+
+        requests = [QgsFeatureRequest(),
+                    QgsFeatureRequest().setSubsetOfAttributes([0, 1]),
+                    QgsFeatureRequest().setFlags(QgsFeatureRequest.NoGeometry),
+                    QgsFeatureRequest().setFilterExpression('cnt > 200')]
+        for request in requests:
+            QSettings().setValue(u'/PostgreSQL/streamWithCopy', True)
+            streamed = fetch(request)
+            QSettings().setValue(u'/PostgreSQL/streamWithCopy', False)
+            fetched = fetch(request)
+            self.assertEqual(streamed, fetched)
+            self.assertTrue(len(streamed) > 0)
+        QSettings().remove(u'/PostgreSQL/streamWithCopy')
+
+        # stop iterating before the end of the stream, the connection has to be usable afterwards
+        for i in range(5):
+            it = self.provider.getFeatures()
+            f = QgsFeature()
+            self.assertTrue(it.nextFeature(f))
+            it.rewind()
+            self.assertTrue(it.nextFeature(f))
+            it.close()
+        self.assertEqual(len([f for f in self.provider.getFeatures()]), 5)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -14,11 +14,16 @@ __revision__ = '$Format:%H$'
 
 import os
 import re
+import shutil
+import tempfile
+import time
 import urllib
 from mimetools import Message
 from StringIO import StringIO
 from qgis.server import QgsServer
 from qgis.core import QgsMessageLog
+from qgis.PyQt.QtGui import QImage
+from qgis.PyQt.QtXml import QDomDocument
 from qgis.testing import unittest
 from utilities import unitTestDataPath
 import osgeo.gdal
@@ -201,6 +206,78 @@ class TestQgsServer(unittest.TestCase):
                                  'query_layers=testlayer%20%C3%A8%C3%A9&X=190&Y=320',
                                  'wms_getfeatureinfo-text-plain')
 
+    def test_capabilities_layer_cache(self):
+        """Test that only the edited layer changes in GetCapabilities and GetProjectSettings, and that
+        the documents built with cached layer elements match the ones of a fresh project"""
+        project_dir = tempfile.mkdtemp()
+        fresh_dir = tempfile.mkdtemp()
+        for f in ('testlayer.shp', 'testlayer.shx', 'testlayer.dbf', 'testlayer.prj', 'testlayer.qpj'):
+            shutil.copy(self.testdata_path + f, project_dir)
+            shutil.copy(self.testdata_path + f, fresh_dir)
+        project = os.path.join(project_dir, 'test+project.qgs')
+        fresh_project = os.path.join(fresh_dir, 'test+project.qgs')
+        shutil.copy(self.testdata_path + 'test+project_twolayers.qgs', project)
+        requests = ('GetCapabilities', 'GetProjectSettings')
+
+        def response(project_path, request):
+            query_string = 'MAP=%s&SERVICE=WMS&VERSION=1.3&REQUEST=%s' % (urllib.quote(project_path), request)
+            header, body = [str(_v) for _v in self.server.handleRequest(query_string)]
+            return re.sub(RE_STRIP_PATH, '', body)
+
+        def layer_elements(body):
+            doc = QDomDocument()
+            self.assertTrue(doc.setContent(body), body)
+            elements = {}
+            layers = doc.elementsByTagName('Layer')
+            for i in range(layers.size()):
+                layer = layers.at(i).toElement()
+                if layer.elementsByTagName('Layer').isEmpty():
+                    elements[layer.firstChildElement('Name').text()] = layer
+            return elements
+
+        try:
+            before = {}
+            for request in requests:
+                before[request] = response(project, request)
+
+            # edit the second layer and hide the first one
+            with open(project) as f:
+                content = f.read()
+            content = content.replace('<title>A second test vector layer</title>', '<title>An edited test vector layer</title>')
+            content = content.replace('<legendlayer drawingOrder="-1" open="true" checked="Qt::Checked" name="testlayer \xc3\xa8\xc3\xa9"',
+                                      '<legendlayer drawingOrder="-1" open="true" checked="Qt::Unchecked" name="testlayer \xc3\xa8\xc3\xa9"')
+            for path in (project, fresh_project):
+                with open(path, 'w') as f:
+                    f.write(content)
+            modified = os.path.getmtime(project) + 10
+            os.utime(project, (modified, modified))
+            # the file system watcher of the config cache reports the change asynchronously
+            for i in range(50):
+                if response(project, requests[0]) != before[requests[0]]:
+                    break
+                time.sleep(0.1)
+
+            for request in requests:
+                after = response(project, request)
+                self.assertEqual(after, response(fresh_project, request), "%s with cached layers differs from the fresh document" % request)
+
+                before_layers = layer_elements(before[request])
+                after_layers = layer_elements(after)
+                self.assertEqual(sorted(before_layers.keys()), sorted(after_layers.keys()))
+                self.assertNotEqual(before_layers['testlayer2'].toString(), after_layers['testlayer2'].toString())
+                self.assertEqual(after_layers['testlayer2'].firstChildElement('Title').text(), 'An edited test vector layer')
+                unchanged = before_layers[u'testlayer \xe8\xe9']
+                hidden = after_layers[u'testlayer \xe8\xe9']
+                if request == 'GetProjectSettings':
+                    self.assertEqual(unchanged.attribute('visible'), '1')
+                    self.assertEqual(hidden.attribute('visible'), '0')
+                    unchanged.removeAttribute('visible')
+                    hidden.removeAttribute('visible')
+                self.assertEqual(unchanged.toString(), hidden.toString(), "%s: the layer which was not edited changed" % request)
+        finally:
+            shutil.rmtree(project_dir, True)
+            shutil.rmtree(fresh_dir, True)
+
     def wms_inspire_request_compare(self, request):
         """WMS INSPIRE tests"""
         project = self.testdata_path + "test+project_inspire.qgs"
@@ -301,6 +378,24 @@ class TestQgsServer(unittest.TestCase):
         for id, req in tests:
             self.wfs_getfeature_compare(id, req)
 
+    def test_getfeature_escaping(self):
+        """Test that GetFeature escapes the attribute values like QDomDocument"""
+        project = self.testdata_path + "test+project_wfs_escape.qgs"
+        assert os.path.exists(project), "Project file not found: " + project
+
+        for outputformat in ('GML2', 'GML3'):
+            query_string = 'MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=testlayer&OUTPUTFORMAT=%s' % (urllib.quote(project), outputformat)
+            header, body = [str(_v) for _v in self.server.handleRequest(query_string)]
+            self.assert_headers(header, body)
+            # quotes and tabs are only escaped in XML attributes, carriage returns everywhere
+            self.assertIn('<qgs:name>say "hi" &lt;b> &amp; co&#xd;\nnext</qgs:name>', body, "%s response:\n%s" % (outputformat, body))
+            self.assertIn(u'<qgs:utf8nameè>tab\tend ]]&gt; èé</qgs:utf8nameè>'.encode('utf-8'), body, "%s response:\n%s" % (outputformat, body))
+
+            doc = QDomDocument()
+            self.assertTrue(doc.setContent(body), "%s response:\n%s" % (outputformat, body))
+            self.assertEqual(doc.elementsByTagName('qgs:name').at(0).toElement().text(), u'say "hi" <b> & co\r\nnext')
+            self.assertEqual(doc.elementsByTagName(u'qgs:utf8nameè').at(0).toElement().text(), u'tab\tend ]]> èé')
+
     def test_getLegendGraphics(self):
         """Test that does not return an exception but an image"""
         parms = {
@@ -318,6 +413,95 @@ class TestQgsServer(unittest.TestCase):
         self.assertEqual(-1, h.find('Content-Type: text/xml; charset=utf-8'), "Header: %s\nResponse:\n%s" % (h, r))
         self.assertNotEquals(-1, h.find('Content-Type: image/png'), "Header: %s\nResponse:\n%s" % (h, r))
 
+    def test_getmap_labels_parallel(self):
+        """Test that the parallel rendering labels with the engine settings of the project like the legacy renderer"""
+        project = self.testdata_path + "test+project_labels.qgs"
+        assert os.path.exists(project), "Project file not found: " + project
+        query_string = '&'.join(['MAP=%s' % urllib.quote(project),
+                                 'SERVICE=WMS',
+                                 'VERSION=1.3.0',
+                                 'REQUEST=GetMap',
+                                 'LAYERS=testlayer%20%C3%A8%C3%A9',
+                                 'STYLES=',
+                                 'FORMAT=image%2Fpng',
+                                 'CRS=EPSG%3A3857',
+                                 'WIDTH=600',
+                                 'HEIGHT=400',
+                                 'BBOX=913190.6389747962%2C5606005.488876367%2C913235.426296057%2C5606035.347090538'])
+        images = {}
+        try:
+            for parallel in ('0', '1'):
+                os.environ['QGIS_SERVER_PARALLEL_RENDERING'] = parallel
+                h, r = self.server.handleRequest(query_string)
+                self.assertNotEquals(-1, h.find('Content-Type: image/png'), "Header: %s\nResponse:\n%s" % (h, r))
+                image = QImage()
+                self.assertTrue(image.loadFromData(r, 'PNG'))
+                images[parallel] = image.convertToFormat(QImage.Format_ARGB32)
+        finally:
+            del os.environ['QGIS_SERVER_PARALLEL_RENDERING']
+
+        legacy = images['0']
+        parallel = images['1']
+        self.assertEqual(legacy.size(), parallel.size())
+        mismatches = 0
+        for y in range(legacy.height()):
+            for x in range(legacy.width()):
+                if legacy.pixel(x, y) != parallel.pixel(x, y):
+                    mismatches += 1
+        # the project shows all labels and the label candidates, which the parallel rendering must draw as well
+        self.assertEqual(mismatches, 0, "%d pixels differ between the legacy and the parallel rendering" % mismatches)
+
+    def test_getmap_tile(self):
+        """Test that tiles of the metatile mode are cached until the project file changes"""
+        tmp_dir = tempfile.mkdtemp()
+        for f in ('test+project.qgs', 'testlayer.shp', 'testlayer.shx', 'testlayer.dbf', 'testlayer.prj', 'testlayer.qpj'):
+            shutil.copy(self.testdata_path + f, tmp_dir)
+        project = os.path.join(tmp_dir, 'test+project.qgs')
+        # a cell of a grid of 128 m with its origin at 0,0
+        query_string = '&'.join(['MAP=%s' % urllib.quote(project),
+                                 'SERVICE=WMS',
+                                 'VERSION=1.3.0',
+                                 'REQUEST=GetMap',
+                                 'LAYERS=testlayer%20%C3%A8%C3%A9',
+                                 'STYLES=',
+                                 'FORMAT=image%2Fpng',
+                                 'CRS=EPSG%3A3857',
+                                 'WIDTH=256',
+                                 'HEIGHT=256',
+                                 'BBOX=913152%2C5606016%2C913280%2C5606144'])
+
+        def get_tile():
+            h, r = self.server.handleRequest(query_string)
+            self.assertNotEquals(-1, h.find('Content-Type: image/png'), "Header: %s\nResponse:\n%s" % (h, r))
+            image = QImage()
+            self.assertTrue(image.loadFromData(r, 'PNG'))
+            return image.convertToFormat(QImage.Format_ARGB32)
+
+        os.environ['QGIS_SERVER_METATILE_SIZE'] = '2'
+        try:
+            rendered = get_tile()
+            cached = get_tile()
+            self.assertEqual(rendered, cached, "The cached tile differs from the rendered one")
+
+            # another symbol color, the tile must be rendered again
+            with open(project) as f:
+                content = f.read()
+            with open(project, 'w') as f:
+                f.write(content.replace('<prop k="color" v="102,164,67,255"/>', '<prop k="color" v="255,0,0,255"/>'))
+            # no sleep nor forced modification time: the change may happen within the same second
+            # the file system watcher of the config cache reports the change asynchronously
+            changed = None
+            for i in range(50):
+                changed = get_tile()
+                if changed != rendered:
+                    break
+                time.sleep(0.1)
+            self.assertNotEqual(changed, rendered, "The tile of the previous project is still used")
+            self.assertEqual(changed, get_tile(), "The tile of the changed project is not cached")
+        finally:
+            del os.environ['QGIS_SERVER_METATILE_SIZE']
+            shutil.rmtree(tmp_dir, True)
+
 
 if __name__ == '__main__':
     unittest.main()